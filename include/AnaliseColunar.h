@@ -0,0 +1,92 @@
+#ifndef ANALISE_COLUNAR_H
+#define ANALISE_COLUNAR_H
+
+#include <climits>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+enum class ColunaAnalise {
+    Tempo,
+    Porcoes,
+    Nota,
+    Feita    // 0 ou 1: a media e a fracao de receitas feitas
+};
+
+// Faixas inclusivas; os padroes aceitam tudo
+struct FiltroAnalise {
+    std::string categoria;          // nome exato; vazio = todas
+    int notaMinima = 0;             // 0 = nao avaliada
+    int notaMaxima = 5;
+    int tempoMinimo = INT_MIN;
+    int tempoMaximo = INT_MAX;
+    int feita = -1;                 // -1 = qualquer, 0 = nao feitas, 1 = feitas
+};
+
+struct Agregado {
+    size_t contagem = 0;
+    int64_t soma = 0;
+    int minimo = 0;                 // minimo e maximo so valem com contagem > 0
+    int maximo = 0;
+    double media() const { return contagem ? static_cast<double>(soma) / contagem : 0.0; }
+};
+
+struct GrupoCategoria {
+    std::string categoria;
+    Agregado agregado;
+};
+
+// Colunas numericas das receitas (tempo, porcoes, nota, feita e o codigo da
+// categoria) em arrays contiguos, uma posicao por receita, para estatisticas
+// sem passar pelo SQLite. As consultas andam em blocos de TAMANHO_BLOCO
+// posicoes: cada filtro ativo e uma passada sem desvios sobre uma coluna que
+// reduz a mascara do bloco, e a agregacao combina valores e mascara sem
+// desvios tambem, em lacos que o compilador vetoriza. Remocoes movem a
+// ultima receita para o buraco, entao as colunas nunca tem lacunas.
+class AnaliseColunar {
+public:
+    static const size_t TAMANHO_BLOCO = 4096;
+
+    // Insere ou substitui
+    void definir(int id, int tempo, int porcoes, int nota, bool feita, std::string_view categoria);
+    void remover(int id);
+    void limpar();
+    void reservar(size_t receitas);
+
+    size_t contar(const FiltroAnalise& filtro) const;
+    Agregado agregar(ColunaAnalise coluna, const FiltroAnalise& filtro) const;
+    // Contagem por faixa [i * largura, (i + 1) * largura); valores abaixo de
+    // zero caem no primeiro balde e os acima do ultimo, no ultimo
+    std::vector<size_t> histograma(ColunaAnalise coluna, const FiltroAnalise& filtro, int largura,
+                                   size_t baldes) const;
+    // Um grupo por categoria com ao menos uma receita no filtro, em ordem de nome
+    std::vector<GrupoCategoria> agruparPorCategoria(ColunaAnalise coluna, const FiltroAnalise& filtro) const;
+
+    bool contem(int id) const { return posicaoPorId.count(id) > 0; }
+    size_t size() const { return ids.size(); }
+
+private:
+    const int32_t* coluna(ColunaAnalise coluna) const;
+    // Preenche a mascara das posicoes [inicio, inicio + n); false se o
+    // filtro nao pode casar com nada (categoria inexistente)
+    bool filtrarBloco(const FiltroAnalise& filtro, size_t inicio, size_t n, uint8_t* mascara) const;
+    bool codigoCategoria(const FiltroAnalise& filtro, int32_t& codigo) const;
+    // fn(inicio, n, mascara) para cada bloco; definido e usado so no .cpp
+    template <typename Funcao>
+    void porBloco(const FiltroAnalise& filtro, Funcao fn) const;
+
+    std::vector<int> ids;
+    std::vector<int32_t> tempos;
+    std::vector<int32_t> porcoes;
+    std::vector<int32_t> notas;
+    std::vector<int32_t> feitas;
+    std::vector<int32_t> categorias;        // codigo em nomesCategorias
+    std::unordered_map<int, uint32_t> posicaoPorId;
+
+    std::vector<std::string> nomesCategorias;
+    std::unordered_map<std::string, int32_t> codigoPorCategoria;
+};
+
+#endif // ANALISE_COLUNAR_H
@@ -0,0 +1,83 @@
+#ifndef ARMAZEM_IMAGENS_H
+#define ARMAZEM_IMAGENS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Imagem de um blob mapeada em memoria (somente leitura); desfaz o mapa ao sair
+class ImagemMapeada {
+public:
+    ImagemMapeada() = default;
+    ~ImagemMapeada();
+    ImagemMapeada(ImagemMapeada&& outra) noexcept;
+    ImagemMapeada& operator=(ImagemMapeada&& outra) noexcept;
+    ImagemMapeada(const ImagemMapeada&) = delete;
+    ImagemMapeada& operator=(const ImagemMapeada&) = delete;
+
+    bool aberta() const { return aberto; }
+    const unsigned char* data() const { return static_cast<const unsigned char*>(dados); }
+    size_t size() const { return tamanho; }
+
+private:
+    friend class ArmazemImagens;
+    void* dados = nullptr;
+    size_t tamanho = 0;
+    bool aberto = false;     // um blob vazio fica aberto sem mapa
+};
+
+// Armazem de imagens enderecado por conteudo: cada arquivo e gravado uma
+// unica vez com o nome do seu SHA-256 (<raiz>/ab/cdef...), entao receitas
+// com a mesma imagem compartilham o mesmo blob. Receita::imagem guarda a
+// referencia "sha256:<hex>". Blobs nunca mudam depois de gravados, o que
+// permite copias incrementais (so os nomes que faltam no destino).
+class ArmazemImagens {
+public:
+    static constexpr std::string_view PREFIXO = "sha256:";
+    static const size_t TAMANHO_HASH = 64;   // hex
+
+    explicit ArmazemImagens(const std::string& raiz = "");
+    void definirRaiz(const std::string& raiz) { this->raiz = raiz; }
+    const std::string& diretorio() const { return raiz; }
+
+    // Blob do SHA-256 do conteudo; o hash e calculado antes de qualquer
+    // copia e, se o blob ja existir, nada e escrito (so o mtime e renovado).
+    // Blobs novos e seus diretorios recebem fsync antes do retorno. Retorna a
+    // referencia "sha256:<hex>" ou vazio em erro.
+    std::string guardarArquivo(const std::string& caminho);
+    std::string guardarBytes(std::string_view dados);
+
+    bool contem(std::string_view hash) const;
+    // Blob gravado (ou reaproveitado) ha menos de "segundos"
+    bool recente(std::string_view hash, int segundos) const;
+    // Caminho do blob ("" se o hash for invalido); nao confere se existe
+    std::string caminhoDe(std::string_view hash) const;
+    ImagemMapeada mapear(std::string_view hash) const;
+    bool remover(std::string_view hash);
+    // Hashes de todos os blobs, em ordem
+    std::vector<std::string> listar() const;
+    // Copia para "destino" (outro armazem) os blobs que faltam la. Retorna
+    // quantos foram copiados, ou -1 em erro. Cada copia e conferida pelo hash
+    // e recebe fsync, assim como os diretorios do destino.
+    int copiarPara(const std::string& destino) const;
+    // Recalcula o hash do blob (lido por mmap) e compara com o nome
+    bool verificar(std::string_view hash) const;
+
+    // Hash de uma referencia "sha256:<hex>"; vazio se "imagem" nao for uma
+    static std::string_view hashDaReferencia(std::string_view imagem);
+    static std::string referencia(std::string_view hash) { return std::string(PREFIXO) + std::string(hash); }
+    static bool hashValido(std::string_view hash);
+    static std::string sha256(std::string_view dados);
+    // Tipo MIME pelos primeiros bytes (PNG, JPEG, GIF, WebP); senao octet-stream
+    static const char* tipoMime(const unsigned char* dados, size_t tamanho);
+
+private:
+    bool publicar(const std::string& temporario, const std::string& hash);
+    void renovar(std::string_view hash);
+
+    std::string raiz;
+};
+
+#endif // ARMAZEM_IMAGENS_H
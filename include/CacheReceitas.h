@@ -0,0 +1,81 @@
+#ifndef CACHE_RECEITAS_H
+#define CACHE_RECEITAS_H
+
+#include "Receita.h"
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// Cache LRU de receitas completas (com tags e ingredientes) por id, limitado
+// por um orcamento aproximado de memoria. Nao e thread-safe: cada Database
+// (uma conexao) tem o seu. Acertos, falhas e despejos vao para Metricas.
+class CacheReceitas {
+public:
+    explicit CacheReceitas(size_t orcamentoBytes = 8 * 1024 * 1024);
+
+    bool obter(int id, Receita& saida);
+    void inserir(const Receita& receita);
+    void invalidar(int id);
+    void limpar();
+
+    // 0 desliga o cache
+    void definirOrcamento(size_t bytes);
+    size_t orcamento() const { return orcamentoBytes; }
+    size_t memoriaUtilizada() const { return usados; }
+    size_t size() const { return indice.size(); }
+
+    // Tamanho aproximado de uma receita em memoria (objeto e buffers)
+    static size_t estimarBytes(const Receita& receita);
+
+private:
+    struct Entrada {
+        Receita receita;
+        size_t bytes;
+    };
+
+    void despejarAte(size_t limite);
+
+    size_t orcamentoBytes;
+    size_t usados;
+    std::list<Entrada> ordem;   // mais recente na frente
+    std::unordered_map<int, std::list<Entrada>::iterator> indice;
+};
+
+// Cache LRU de resultados de listagens, chaveado pela forma da consulta e
+// seus parametros ("porNota:5"). Cada entrada guarda a geracao de escrita do
+// banco em que foi lida; se a geracao atual for outra, a entrada e descartada.
+class CacheConsultas {
+public:
+    using Resultado = std::shared_ptr<const std::vector<Receita>>;
+
+    explicit CacheConsultas(size_t orcamentoBytes = 8 * 1024 * 1024);
+
+    // nullptr se ausente ou lido em outra geracao
+    Resultado obter(const std::string& chave, uint64_t geracao);
+    void inserir(const std::string& chave, uint64_t geracao, Resultado resultado);
+    void limpar();
+
+    void definirOrcamento(size_t bytes);
+    size_t orcamento() const { return orcamentoBytes; }
+    size_t memoriaUtilizada() const { return usados; }
+
+private:
+    struct Entrada {
+        std::string chave;
+        uint64_t geracao;
+        Resultado resultado;
+        size_t bytes;
+    };
+
+    void remover(std::list<Entrada>::iterator it);
+    void despejarAte(size_t limite);
+
+    size_t orcamentoBytes;
+    size_t usados;
+    std::list<Entrada> ordem;
+    std::unordered_map<std::string, std::list<Entrada>::iterator> indice;
+};
+
+#endif // CACHE_RECEITAS_H
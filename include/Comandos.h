@@ -0,0 +1,8 @@
+#ifndef COMANDOS_H
+#define COMANDOS_H
+
+// Modo nao interativo: "cookbook [opcoes] <subcomando> [args]" ou
+// "cookbook [opcoes] --batch arquivo". Retorna o codigo de saida do processo.
+int executarLinhaDeComando(int argc, char* argv[]);
+
+#endif // COMANDOS_H
@@ -2,14 +2,224 @@
 #define DATABASE_H
 
 #include "Receita.h"
+#include "ResultadoReceitas.h"
+#include "CacheReceitas.h"
+#include "ListaCompras.h"
+#include "IndiceSimilaridade.h"
+#include "Deduplicador.h"
+#include "AnaliseColunar.h"
+#include "ArmazemImagens.h"
 #include <vector>
 #include <string>
+#include <string_view>
 #include <utility>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+
+// Criterios combinaveis para consultas por visitante; campos vazios/zero
+// nao filtram.
+struct FiltroReceitas {
+    std::string nome;          // trecho do nome (LIKE %nome%)
+    std::string tag;           // nome exato da tag
+    int nota = 0;              // 1 a 5; 0 = qualquer nota
+    bool somenteFeitas = false;
+    int64_t alteradasDesde = 0; // ms desde a epoca; so receitas com atualizada_em >= este valor
+};
+
+// Uma linha do log de alteracoes (tabela alteracoes, mantida por triggers).
+// "tabela" so vale durante o callback de alteracoesDesde.
+struct Alteracao {
+    int64_t seq = 0;           // crescente, nunca reaproveitado
+    std::string_view tabela;   // receitas, tags, receitas_tags, ingredientes ou "*"
+    char operacao = 0;         // 'I', 'U', 'D'; 'R' = vault restaurado, reexportar tudo
+    int receitaId = 0;         // 0 em tags
+    int chave = 0;             // id da linha; tag_id em receitas_tags
+    int64_t momento = 0;       // ms desde a epoca
+};
+
+// Limites de uma chamada de listagem; zero = sem limite
+struct LimitesConsulta {
+    int prazoMs = 0;          // tempo maximo da consulta, incluindo a carga de tags e ingredientes
+    size_t maxLinhas = 0;     // linhas maximas do resultado
+};
+
+// Como uma listagem terminou. Com PrazoEsgotado, Interrompida ou Erro o
+// resultado volta vazio; com LimiteLinhas traz as primeiras maxLinhas.
+enum class StatusConsulta {
+    Ok,
+    LimiteLinhas,
+    PrazoEsgotado,
+    Interrompida,
+    Erro
+};
+
+// Resultado de uma listagem com cache (listarReceitas, getReceitasByTag,
+// getReceitasFeitas, getReceitasPorNota): somente leitura e compartilhado
+// com o cache de consultas, sem copia. Um limite de linhas menor que o
+// resultado guardado so encurta a visao.
+class ListaReceitas {
+public:
+    using const_iterator = std::vector<Receita>::const_iterator;
+
+    ListaReceitas() : tamanho(0) {}
+    explicit ListaReceitas(std::shared_ptr<const std::vector<Receita>> receitas, size_t maxLinhas = 0)
+        : receitas(std::move(receitas)), tamanho(this->receitas ? this->receitas->size() : 0) {
+        if (maxLinhas > 0 && maxLinhas < tamanho) {
+            tamanho = maxLinhas;
+        }
+    }
+
+    const_iterator begin() const { return receitas ? receitas->begin() : const_iterator(); }
+    const_iterator end() const { return receitas ? receitas->begin() + tamanho : const_iterator(); }
+    size_t size() const { return tamanho; }
+    bool empty() const { return tamanho == 0; }
+    const Receita& operator[](size_t i) const { return (*receitas)[i]; }
+    const Receita& front() const { return (*receitas)[0]; }
+    const Receita& back() const { return (*receitas)[tamanho - 1]; }
+    // Copia independente, para quem precisa alterar o resultado
+    std::vector<Receita> copiar() const { return std::vector<Receita>(begin(), end()); }
+
+private:
+    std::shared_ptr<const std::vector<Receita>> receitas;
+    size_t tamanho;
+};
 
 class Database {
 private:
     std::string dbPath;
     void* db; // SQLite database handle
+    
+    // Receitas completas ja lidas por consultarPorId. Cada escrita desta
+    // conexao invalida o id afetado; escritas de outras conexoes sao
+    // detectadas pelo PRAGMA data_version e esvaziam o cache.
+    CacheReceitas cacheReceitas;
+    void* versaoDadosStmt;
+    long long versaoDados;
+    void validarCache();
+    
+    // Listagens por chave de consulta, validas enquanto a geracao de escrita
+    // nao mudar. A geracao avanca a cada linha alterada nesta conexao
+    // (sqlite3_update_hook), a cada ROLLBACK/restauracao e quando outra
+    // conexao confirma escritas.
+    CacheConsultas cacheConsultas;
+    uint64_t geracaoEscrita;
+    static void registrarAlteracao(void* contexto, int operacao, const char* banco, const char* tabela,
+                                   long long rowid);
+    void instalarHooks();
+    std::shared_ptr<const std::vector<Receita>> consultaEmCache(const std::string& chave);
+    // Entrega "receitas" a quem chamou e, se "completa", guarda o mesmo
+    // vetor no cache (movido, sem copia)
+    ListaReceitas guardarConsulta(const std::string& chave, std::vector<Receita> receitas, bool completa);
+    
+    // Indice MinHash/LSH de similares. As assinaturas ficam gravadas na
+    // tabela assinaturas, validas ate o seq do log de alteracoes guardado em
+    // indices_persistidos; a primeira consulta le a tabela e cada consulta
+    // recalcula (e grava) so as receitas alteradas no log depois desse seq.
+    // Um ROLLBACK pode devolver ao log seqs ja aplicados: o indice em memoria
+    // e descartado e relido da tabela.
+    std::unique_ptr<IndiceSimilaridade> indiceSimilares;
+    int64_t seqSimilares;
+    bool similaresDesatualizado;
+    bool atualizarIndiceSimilares();
+    int64_t lerAssinaturasGravadas();
+    bool carregarAssinaturas(const std::vector<int>* ids, bool gravar);
+    // Receitas cujo conteudo mudou no log depois de "desde" (renomear uma
+    // tag alcanca as receitas com ela). false se o log nao cobre o
+    // intervalo (restauracao ou linhas descartadas): so uma carga completa serve.
+    bool receitasAlteradasDesde(int64_t desde, std::vector<int>& ids);
+    
+    // Configuracoes de antes de iniciarCargaEmMassa (-1 fora de uma carga)
+    int sincronoAntesCarga;
+    int64_t cacheAntesCarga;
+    
+    // Colunas numericas para estatisticas, carregadas na primeira consulta e
+    // depois mantidas pelo log de alteracoes como o indice de similares
+    // (escritas desta conexao ou de outras relem so as receitas alteradas).
+    // Um ROLLBACK so reler as receitas aplicadas durante a transacao desfeita.
+    std::unique_ptr<AnaliseColunar> analise;
+    int64_t seqAnalise;
+    std::vector<int> analisePendentes;      // a reler alem do que o log mostrar
+    std::vector<int> analiseNaTransacao;    // aplicadas com transacao aberta
+    int64_t seqAnaliseAntesTransacao;
+    bool analiseCarregadaNaTransacao;       // carga completa com transacao aberta
+    bool analiseDesatualizada;
+    bool carregarColunasAnalise(const std::vector<int>* ids);
+    
+    // ROLLBACK (rollback hook) e ROLLBACK TO: o log pode ter devolvido seqs
+    // ja aplicados aos indices em memoria
+    static void registrarRollback(void* contexto);
+    void registrarDesfazimento();
+    
+    // Toda escrita passa por aqui e invalida o cache por id (em massa: tudo).
+    // O indice de similares e as colunas de analise se guiam pelo log de alteracoes.
+    void registrarEscrita(int receitaId);
+    void registrarEscritaEmMassa();
+    
+    // Tags e ingredientes estruturados das listagens completas, em lotes de
+    // ids; com hidratacao paralela, resultados grandes sao divididos em faixas
+    // de ids entre trabalhadores com conexoes somente leitura proprias. As
+    // conexoes e as threads (uma por conexao) sao criadas juntas em
+    // abrirConexoesLeitura, na primeira hidratacao paralela, e duram ate
+    // fecharConexoesLeitura.
+    static const size_t MINIMO_POR_TRABALHADOR = 1000;
+    int trabalhadoresHidratacao;
+    std::vector<void*> conexoesLeitura;
+    class TrabalhadoresLeitura;
+    std::unique_ptr<TrabalhadoresLeitura> trabalhadoresLeitura;
+    bool abrirConexoesLeitura();
+    void hidratarReceitas(std::vector<Receita>& receitas);
+    void fecharConexoesLeitura();
+    
+    // Prazo da listagem em andamento (ns do steady_clock; 0 = nenhum),
+    // conferido pelo progress handler desta conexao e das de leitura
+    LimitesConsulta limitesPadrao;
+    std::atomic<int64_t> prazoLimite;
+    std::atomic<bool> prazoEsgotado;
+    static int verificarPrazo(void* contexto);
+    void iniciarPrazo(const LimitesConsulta& limites);
+    StatusConsulta encerrarPrazo(StatusConsulta status);
+    // Le as linhas de "stmt" (ja vinculado; finalizado aqui) e hidrata o resultado
+    StatusConsulta executarListagem(void* stmt, const LimitesConsulta& limites, std::vector<Receita>& receitas);
+    // Prazo de configurarLimites para as demais leituras (consultarPorId,
+    // tags, ingredientes, similares, analise, lista de compras, duplicadas).
+    // Chamadas aninhadas correm no prazo de quem as chamou, e uma que ja
+    // comeca com ele vencido nem roda. esgotado(): prazo estourado ou
+    // interrupcao, o resultado deve ser descartado.
+    class EscopoPrazo {
+    public:
+        explicit EscopoPrazo(Database& banco);
+        ~EscopoPrazo();
+        EscopoPrazo(const EscopoPrazo&) = delete;
+        EscopoPrazo& operator=(const EscopoPrazo&) = delete;
+        bool esgotado() const;
+    private:
+        Database& banco;
+        bool proprio;
+    };
+    // Leituras que alimentam uma escrita (atualizarReceita) correm sem prazo:
+    // um vazio por prazo esgotado seria lido como "nada gravado"
+    class SemPrazo {
+    public:
+        explicit SemPrazo(Database& banco);
+        ~SemPrazo();
+        SemPrazo(const SemPrazo&) = delete;
+        SemPrazo& operator=(const SemPrazo&) = delete;
+    private:
+        Database& banco;
+        int64_t limiteAnterior;
+    };
+    int prazoSuspenso;
+    
+    // Blobs das imagens (<vault sem extensao>.imagens/)
+    ArmazemImagens armazemImagens;
+    
+    // db e conexoesLeitura so sao trocados sob mutexConexao (ver interromper)
+    std::mutex mutexConexao;
+    std::atomic<bool> interrupcaoPedida;
+    void definirConexao(void* conexao);
 
     bool executeQuery(const std::string& query);
     bool executeQuerySilent(const std::string& query);
@@ -17,32 +227,183 @@ private:
     bool createTable();
     bool createTagsTables();
     bool createIngredientesTable();
+    bool createAlteracoesTable();
+    bool createAssinaturasTable();
+    bool preencherHashConteudo();
+    
+    friend class ResultadoReceitas;
+    void carregarCamposResultado(ResultadoReceitas& resultado, unsigned campos);
 
 public:
     Database(const std::string& path);
     ~Database();
 
     bool initialize();
+    // Abre uma conexao somente leitura sobre um vault ja inicializado
+    bool initializeSomenteLeitura();
+    // Journal WAL: leitores em outras conexoes nao bloqueiam o escritor
+    bool habilitarWal();
     int cadastrarReceita(const Receita& receita);
-    std::vector<Receita> listarReceitas();
+    // Insere varias receitas (com ingredientes estruturados e tags por nome)
+    // em uma unica transacao, reaproveitando os statements. Retorna quantas
+    // foram inseridas, ou -1 se algo falhou (nada e gravado). Ids em "ids".
+    // Dentro de uma transacao do chamador o lote roda sob um savepoint: se
+    // falhar, so ele e desfeito.
+    int cadastrarReceitasEmLote(const std::vector<Receita>& receitas, std::vector<int>* ids = nullptr);
+    // Carga em massa (GeradorVault): synchronous=OFF, cache de paginas maior
+    // e sem os indices secundarios que a insercao nao consulta. encerrar
+    // recria os indices e volta as configuracoes anteriores (se nao for
+    // chamado, o proximo initialize recria os indices). Uma queda do sistema
+    // no meio da carga pode corromper o vault.
+    bool iniciarCargaEmMassa();
+    bool encerrarCargaEmMassa();
+    // Grava "receita" (estado completo, localizada por receita.id) emitindo
+    // so os UPDATE/INSERT/DELETE necessarios para colunas, ingredientes
+    // estruturados e tags que mudaram, em uma unica transacao (ou sob um
+    // savepoint na do chamador). Ingredientes sao casados por id, conteudo e
+    // nome, e ficam na ordem da lista; o id da receita nao muda.
+    bool atualizarReceita(const Receita& receita);
+    // Listagens completas: "status" diz se o resultado esta inteiro, foi
+    // truncado ou estourou o prazo; "limites" substitui o configurarLimites()
+    ListaReceitas listarReceitas(StatusConsulta* status = nullptr, const LimitesConsulta* limites = nullptr);
+    // campos: mascara de CampoReceita carregada de imediato; os demais sao
+    // lidos sob demanda no primeiro acesso
+    ResultadoReceitas listarReceitasCompacto(unsigned campos = CAMPOS_TODOS);
+    ResultadoReceitas listarReceitasCompacto(const FiltroReceitas& filtro, unsigned campos = CAMPOS_TODOS);
+    // Percorre as receitas do filtro sem copiar colunas; o callback retorna
+    // false para interromper. Retorna o numero de linhas visitadas ou -1 em
+    // erro, prazo esgotado ou interrupcao (o motivo fica em "status").
+    int forEachReceita(const FiltroReceitas& filtro, const std::function<bool(const ReceitaLinha&)>& fn,
+                       unsigned campos = CAMPOS_TODOS, StatusConsulta* status = nullptr,
+                       const LimitesConsulta* limites = nullptr);
     Receita consultarPorId(int id);
-    std::vector<Receita> buscarPorNome(const std::string& nome);
+    std::vector<Receita> buscarPorNome(const std::string& nome, StatusConsulta* status = nullptr,
+                                       const LimitesConsulta* limites = nullptr);
     bool excluirReceita(int id);
     bool marcarReceitaComoFeita(int id, bool feita);
-    std::vector<Receita> getReceitasFeitas();
+    ListaReceitas getReceitasFeitas(StatusConsulta* status = nullptr, const LimitesConsulta* limites = nullptr);
     bool avaliarReceita(int id, int nota);
-    std::vector<Receita> getReceitasPorNota(int nota);
+    ListaReceitas getReceitasPorNota(int nota, StatusConsulta* status = nullptr,
+                                     const LimitesConsulta* limites = nullptr);
     bool fazerBackup(const std::string& caminhoBackup);
     bool restaurarBackup(const std::string& caminhoBackup);
+    // Grava o vault inteiro (lido em uma unica transacao) como um snapshot
+    // binario somente leitura, aberto depois com SnapshotVault
+    bool exportarSnapshot(const std::string& caminho);
+    // Log de alteracoes: triggers em receitas, tags, receitas_tags e
+    // ingredientes gravam uma linha por INSERT/UPDATE/DELETE (tambem os
+    // feitos por cascata), com seq crescente. Quem sincroniza guarda o
+    // ultimo seq visto e pede so o que veio depois; uma linha 'R' (restauracao
+    // de backup) pede uma exportacao completa. receitas.criada_em e
+    // atualizada_em (ms, indexadas) sao mantidas pelos mesmos triggers;
+    // mudar vinculos de tag ou ingredientes tambem avanca atualizada_em.
+    // fn recebe as alteracoes com seq > "desde", em ordem, e retorna false
+    // para parar. Retorna quantas foram entregues, ou -1 (motivo em "status").
+    int alteracoesDesde(int64_t desde, const std::function<bool(const Alteracao&)>& fn,
+                        StatusConsulta* status = nullptr, const LimitesConsulta* limites = nullptr);
+    // Maior seq ja gravado (0 se nenhum), ou -1 em erro
+    int64_t ultimaAlteracao();
+    // Apaga as alteracoes com seq <= "ate", menos a ultima; os seq seguintes
+    // nao mudam. Retorna quantas, ou -1.
+    int descartarAlteracoes(int64_t ate);
+    // Armazem de imagens enderecado por conteudo ao lado do vault
+    // (<vault sem extensao>.imagens/). fazerBackup copia para
+    // <diretorio do backup>/imagens/ so os blobs que ainda nao estao la, e
+    // restaurarBackup traz de volta os que faltarem.
+    ArmazemImagens& imagens();
+    // Guarda no armazem as imagens de receitas que ainda sao caminhos de
+    // arquivo e grava a referencia "sha256:..." no lugar (arquivos
+    // inexistentes ficam como estao). Retorna quantas receitas mudaram, ou -1.
+    int importarImagens();
+    // Apaga blobs que nenhuma receita referencia, conferindo as referencias
+    // com o lock de escrita; blobs gravados ha menos de carenciaSegundos
+    // ficam (podem ser de uma receita ainda sendo salva). Retorna quantos, ou -1
+    int removerImagensSemUso(int carenciaSegundos = 3600);
     void close();
+    // Orcamento (bytes) de cada cache: consultarPorId e listagens; 0 desliga
+    void configurarCache(size_t bytes);
+    // Trabalhadores (cada um com sua conexao somente leitura) que carregam
+    // tags e ingredientes das listagens grandes; 0 ou 1 = so esta conexao.
+    // Dentro de uma transacao aberta a carga volta a ser serial.
+    void configurarHidratacaoParalela(int trabalhadores);
+    // Limites usados pelas listagens chamadas sem "limites" proprios. O prazo
+    // e conferido a cada poucos milhares de instrucoes do SQLite
+    // (sqlite3_progress_handler), tambem nas conexoes de leitura.
+    void configurarLimites(const LimitesConsulta& limites);
+    // Se a ultima leitura sem "status" (consultarPorId, tags, similares...)
+    // estourou o prazo: o resultado vazio dela nao quer dizer "nada encontrado"
+    bool prazoEstourado() const { return prazoEsgotado.load(); }
+    
+    // Interrompe a operacao em andamento (sqlite3_interrupt nesta conexao e
+    // nas de leitura; backups param entre etapas). Seguro a partir de outra
+    // thread. Ate limparInterrupcao(), resultados parciais nao entram nos caches.
+    void interromper();
+    void limparInterrupcao();
+    bool interrompida() const;
+    
+    // Agrupa varias operacoes em uma unica transacao (um unico fsync)
+    bool iniciarTransacao();
+    bool confirmarTransacao();
+    bool desfazerTransacao();
+    // false fora de transacao, inclusive depois de o SQLite desfazer uma por
+    // conta propria (interrupcao, disco cheio, certos erros de restricao)
+    bool emTransacao();
+    // Pontos de retorno aninhados: desfazerSavepoint volta ao estado do
+    // criarSavepoint correspondente e o encerra; fora de transacao, o
+    // savepoint abre uma
+    bool criarSavepoint(const std::string& nome);
+    bool liberarSavepoint(const std::string& nome);
+    bool desfazerSavepoint(const std::string& nome);
+    
+    // Soma os ingredientes estruturados das receitas do plano (escalados pelas
+    // porcoes pedidas) por ingrediente e grandeza, lendo tudo em uma consulta.
+    // Ids repetidos acumulam; receitas sem ingredientes estruturados nao entram.
+    std::vector<ItemCompra> gerarListaCompras(const std::vector<ItemPlano>& plano);
+    // Ate k receitas mais parecidas em ingredientes e tags (Jaccard estimado
+    // por MinHash). A primeira chamada indexa o vault inteiro.
+    std::vector<ReceitaSimilar> similares(int id, size_t k = 10);
+    // Colunas tempo, porcoes, nota, feita e categoria em memoria para
+    // contagens, somas, histogramas e agrupamentos (AnaliseColunar). A
+    // primeira chamada carrega o vault inteiro; as seguintes aplicam so as
+    // receitas que o log de alteracoes mostra como alteradas (por qualquer
+    // conexao). Vale ate a proxima chamada ou close(); nullptr em erro.
+    const AnaliseColunar* analiseColunar();
+    
+    // Id de uma receita gravada com o mesmo nome, ingredientes e preparo
+    // (normalizados; indice sobre hash_conteudo), ou 0. Cadastrar uma
+    // receita assim apenas emite um aviso.
+    int buscarDuplicataExata(const Receita& receita);
+    // Grupos de receitas quase iguais (SimHash a ate "distanciaMaxima" bits,
+    // 0 a Deduplicador::DISTANCIA_MAXIMA), calculados em "threads" threads
+    // (0 = todos os nucleos). Retorna vazio se nada for encontrado ou em erro.
+    // baldesTruncados: ver Deduplicador::agrupar (0 = busca exata).
+    std::vector<GrupoDuplicadas> encontrarDuplicadas(int distanciaMaxima = 4, int threads = 0,
+                                                     size_t* baldesTruncados = nullptr);
+    // Funde "duplicadas" em "principal": tags passam para a principal, feita
+    // e nota ficam com o maior valor e as duplicadas sao excluidas
+    bool mesclarReceitas(int principal, const std::vector<int>& duplicadas);
     
     // Métodos de tags
     int createTag(const std::string& nome);
     std::vector<std::string> getTagsFromReceita(int receitaId);
     void addTagToReceita(int receitaId, int tagId);
     void removeTagFromReceita(int receitaId, int tagId);
-    std::vector<Receita> getReceitasByTag(const std::string& nomeTag);
+    ListaReceitas getReceitasByTag(const std::string& nomeTag, StatusConsulta* status = nullptr,
+                                   const LimitesConsulta* limites = nullptr);
     std::vector<std::pair<int, std::string>> listAllTags();
+    
+    // Operacoes em massa: um INSERT ... SELECT / DELETE por tag sobre todas as
+    // receitas do filtro (filtro vazio = todas), em uma transacao. Retornam
+    // quantos vinculos foram criados/removidos, ou -1 (nada e gravado).
+    int adicionarTagsEmMassa(const FiltroReceitas& filtro, const std::vector<std::string>& tags);
+    int removerTagsEmMassa(const FiltroReceitas& filtro, const std::vector<std::string>& tags);
+    // Move os vinculos de "origem" para "destino" (criada se preciso) e apaga
+    // "origem"; false se "origem" nao existir
+    bool mesclarTags(const std::string& origem, const std::string& destino);
+    // Se "novoNome" ja existir, equivale a mesclarTags
+    bool renomearTag(const std::string& nomeAtual, const std::string& novoNome);
+    // Apaga tags sem nenhuma receita; retorna quantas, ou -1
+    int removerTagsSemUso();
     std::vector<std::string> getTagsByPrefix(const std::string& prefixo);
     
     void addIngredienteToReceita(int receitaId, const Ingrediente& ingrediente);
@@ -0,0 +1,158 @@
+#ifndef DATABASE_ASSINCRONA_H
+#define DATABASE_ASSINCRONA_H
+
+#include "Database.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+
+// Lancada pelo future de uma operacao cancelada (na fila ou em andamento)
+class OperacaoCancelada : public std::runtime_error {
+public:
+    OperacaoCancelada() : std::runtime_error("Operacao cancelada") {}
+};
+
+// Fachada assincrona sobre uma Database: as chamadas entram em uma fila e
+// rodam, em ordem, em uma thread executora dedicada (a conexao SQLite
+// continua sendo usada por uma thread de cada vez). Cada chamada devolve um
+// std::future e, se pedido, o id da tarefa para cancelar(). Enquanto a
+// fachada existir, a Database so deve ser usada atraves dela.
+//
+// Leituras podem ser interrompidas a qualquer momento. Escritas rodam em
+// transacao propria e, se interrompidas, sao desfeitas por inteiro antes de
+// o future lancar OperacaoCancelada; o que nao cabe em uma transacao
+// (restaurarBackup) so pode ser cancelado enquanto estiver na fila.
+class DatabaseAssincrona {
+public:
+    using Tarefa = uint64_t;
+
+    explicit DatabaseAssincrona(Database& db);
+    // Cancela o que estiver na fila, interrompe a tarefa em andamento (se
+    // interrompivel) e espera por ela
+    ~DatabaseAssincrona();
+
+    DatabaseAssincrona(const DatabaseAssincrona&) = delete;
+    DatabaseAssincrona& operator=(const DatabaseAssincrona&) = delete;
+
+    // Agenda fn(db) na executora como escrita; o future entrega o retorno de fn
+    template <typename Funcao>
+    auto executar(Funcao fn, Tarefa* tarefa = nullptr) -> std::future<std::invoke_result_t<Funcao, Database&>>;
+    // Como executar, para fn que so le: roda fora de transacao
+    template <typename Funcao>
+    auto consultar(Funcao fn, Tarefa* tarefa = nullptr) -> std::future<std::invoke_result_t<Funcao, Database&>>;
+
+    std::future<ListaReceitas> listarReceitas(Tarefa* tarefa = nullptr);
+    std::future<std::vector<Receita>> buscarPorNome(const std::string& nome, Tarefa* tarefa = nullptr);
+    std::future<ListaReceitas> getReceitasByTag(const std::string& nomeTag, Tarefa* tarefa = nullptr);
+    std::future<Receita> consultarPorId(int id, Tarefa* tarefa = nullptr);
+    std::future<int> cadastrarReceita(const Receita& receita, Tarefa* tarefa = nullptr);
+    std::future<int> cadastrarReceitasEmLote(const std::vector<Receita>& receitas, Tarefa* tarefa = nullptr);
+    std::future<bool> atualizarReceita(const Receita& receita, Tarefa* tarefa = nullptr);
+    std::future<bool> excluirReceita(int id, Tarefa* tarefa = nullptr);
+    std::future<bool> fazerBackup(const std::string& caminhoBackup, Tarefa* tarefa = nullptr);
+    std::future<bool> restaurarBackup(const std::string& caminhoBackup, Tarefa* tarefa = nullptr);
+    std::future<std::vector<GrupoDuplicadas>> encontrarDuplicadas(int distanciaMaxima = 4, Tarefa* tarefa = nullptr);
+
+    // Retira a tarefa da fila ou interrompe a que esta rodando (Database::
+    // interromper); o future dela passa a lancar OperacaoCancelada. Retorna
+    // false se a tarefa ja terminou, nao existe ou esta rodando sem poder
+    // ser interrompida.
+    bool cancelar(Tarefa tarefa);
+    void cancelarTodas();
+    // Tarefas na fila mais a que esta rodando
+    size_t pendentes() const;
+
+private:
+    enum class Modo {
+        Leitura,      // interrompivel, sem transacao
+        Escrita,      // interrompivel, dentro de um savepoint desfeito na interrupcao
+        Exclusiva     // sem transacao e nao interrompivel depois de comecar
+    };
+
+    struct Trabalho {
+        Tarefa id;
+        Modo modo;
+        std::function<void(Database&)> executar;
+        // Entrega o resultado, ou a falha (OperacaoCancelada, erro ao confirmar) se houver
+        std::function<void(std::exception_ptr falha)> concluir;
+    };
+
+    template <typename Funcao>
+    auto agendarFuncao(Funcao fn, Modo modo, Tarefa* tarefa) -> std::future<std::invoke_result_t<Funcao, Database&>>;
+    Tarefa agendar(Modo modo, std::function<void(Database&)> executar, std::function<void(std::exception_ptr)> concluir);
+    void laco();
+
+    Database& db;
+    mutable std::mutex mutex;
+    std::condition_variable haTrabalho;
+    std::deque<Trabalho> fila;
+    Tarefa proximaTarefa;
+    Tarefa tarefaAtual;   // 0: nenhuma em andamento
+    bool atualInterrompivel;
+    bool encerrando;
+    std::thread executora;
+};
+
+template <typename Funcao>
+auto DatabaseAssincrona::executar(Funcao fn, Tarefa* tarefa) -> std::future<std::invoke_result_t<Funcao, Database&>> {
+    return agendarFuncao(std::move(fn), Modo::Escrita, tarefa);
+}
+
+template <typename Funcao>
+auto DatabaseAssincrona::consultar(Funcao fn, Tarefa* tarefa) -> std::future<std::invoke_result_t<Funcao, Database&>> {
+    return agendarFuncao(std::move(fn), Modo::Leitura, tarefa);
+}
+
+template <typename Funcao>
+auto DatabaseAssincrona::agendarFuncao(Funcao fn, Modo modo, Tarefa* tarefa)
+    -> std::future<std::invoke_result_t<Funcao, Database&>> {
+    using Resultado = std::invoke_result_t<Funcao, Database&>;
+    using Guardado = std::conditional_t<std::is_void_v<Resultado>, bool, Resultado>;
+    struct Estado {
+        std::promise<Resultado> promessa;
+        std::unique_ptr<Guardado> valor;
+        std::exception_ptr erro;
+    };
+    auto estado = std::make_shared<Estado>();
+    std::future<Resultado> futuro = estado->promessa.get_future();
+
+    auto executarNaFila = [estado, fn](Database& alvo) mutable {
+        try {
+            if constexpr (std::is_void_v<Resultado>) {
+                fn(alvo);
+                estado->valor.reset(new Guardado(true));
+            } else {
+                estado->valor.reset(new Guardado(fn(alvo)));
+            }
+        } catch (...) {
+            estado->erro = std::current_exception();
+        }
+    };
+    auto concluir = [estado](std::exception_ptr falha) {
+        if (falha) {
+            estado->promessa.set_exception(falha);
+        } else if (estado->erro) {
+            estado->promessa.set_exception(estado->erro);
+        } else if constexpr (std::is_void_v<Resultado>) {
+            estado->promessa.set_value();
+        } else {
+            estado->promessa.set_value(std::move(*estado->valor));
+        }
+    };
+
+    Tarefa id = agendar(modo, executarNaFila, concluir);
+    if (tarefa) {
+        *tarefa = id;
+    }
+    return futuro;
+}
+
+#endif // DATABASE_ASSINCRONA_H
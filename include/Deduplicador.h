@@ -0,0 +1,63 @@
+#ifndef DEDUPLICADOR_H
+#define DEDUPLICADOR_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Textos crus de uma receita (a normalizacao e feita nas threads de
+// adicionar); "ingredientes" tem um ingrediente por linha
+struct DocumentoDedup {
+    int id = 0;
+    std::string nome;
+    std::string preparo;
+    std::string ingredientes;
+};
+
+struct GrupoDuplicadas {
+    std::vector<int> ids;         // em ordem crescente; o primeiro e o lider do grupo
+    int distanciaMaxima = 0;      // maior distancia de Hamming de um membro ate o lider
+};
+
+// Deteccao de quase-duplicatas por SimHash de 64 bits: tokens do nome,
+// pares de palavras do preparo e nomes de ingredientes, com pesos. As
+// assinaturas sao calculadas em paralelo; para achar pares a distancia <= d,
+// os 64 bits sao divididos em d+1 faixas e so pares com alguma faixa igual
+// sao comparados (se d bits diferem, ao menos uma faixa fica intacta).
+// Dentro de um balde todos os pares sao comparados, entao a busca e exata
+// enquanto nenhum balde passar de BALDE_MAXIMO itens; nos maiores cada item
+// so ve os BALDE_MAXIMO vizinhos seguintes e agrupar informa quantos foram
+// truncados. Cada grupo tem um lider (o primeiro adicionado) e todos os membros ficam
+// a ate d bits dele.
+class Deduplicador {
+public:
+    static const int DISTANCIA_MAXIMA = 6;
+    // Itens de um balde comparados com todos os outros; acima disso o balde
+    // e truncado (cada item ve so os BALDE_MAXIMO seguintes)
+    static const size_t BALDE_MAXIMO = 4096;
+
+    // threads <= 0: todos os nucleos
+    explicit Deduplicador(int threads = 0);
+
+    // Hash exato de conteudo (nome, ingredientes e preparo normalizados)
+    static uint64_t hashConteudo(std::string_view nome, std::string_view ingredientes, std::string_view preparo);
+    static uint64_t simHash(const DocumentoDedup& documento);
+
+    // Calcula as assinaturas do lote em paralelo; os textos podem ser
+    // descartados depois. Lotes em ordem crescente de id fazem do lider o mais antigo.
+    void adicionar(const std::vector<DocumentoDedup>& lote);
+    // baldesTruncados (opcional): quantos baldes passaram de BALDE_MAXIMO,
+    // somando todas as faixas; 0 = resultado exato
+    std::vector<GrupoDuplicadas> agrupar(int distanciaMaxima, size_t* baldesTruncados = nullptr) const;
+
+    size_t size() const { return ids.size(); }
+    int numThreads() const { return threads; }
+
+private:
+    int threads;
+    std::vector<int> ids;
+    std::vector<uint64_t> assinaturas;
+};
+
+#endif // DEDUPLICADOR_H
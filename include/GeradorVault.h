@@ -0,0 +1,62 @@
+#ifndef GERADOR_VAULT_H
+#define GERADOR_VAULT_H
+
+#include "Receita.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Database;
+
+struct ConfiguracaoGerador {
+    uint64_t semente = 42;
+    int numTags = 500;
+    int numIngredientes = 1000;
+    double expoenteZipf = 1.0;     // s da distribuicao de tags e ingredientes
+    double fracaoFeitas = 0.3;
+};
+
+// Gera vaults sinteticos reproduziveis: a mesma semente produz exatamente as
+// mesmas receitas. Tags e ingredientes seguem distribuicoes Zipf (poucos muito
+// comuns, cauda longa de raros); o preparo tem tamanho log-normal em torno de
+// ~600 caracteres. Usa um gerador proprio (xorshift) em vez das distribuicoes
+// da biblioteca padrao, cujos resultados variam entre implementacoes.
+class GeradorVault {
+public:
+    explicit GeradorVault(const ConfiguracaoGerador& configuracao = ConfiguracaoGerador());
+
+    Receita proxima();
+
+    // Grava "total" receitas pelo caminho em lote, sob a configuracao de
+    // carga em massa do Database (fora de transacao); retorna quantas ou -1
+    int gerar(Database& db, int total, size_t tamanhoLote = 10000);
+
+    // Nome da tag/ingrediente na posicao "rank" da distribuicao (0 = mais comum)
+    const std::string& nomeTag(size_t rank) const { return tags[rank]; }
+    const std::string& nomeIngrediente(size_t rank) const { return ingredientes[rank].nome; }
+    size_t numTags() const { return tags.size(); }
+
+private:
+    struct IngredienteBase {
+        std::string nome;
+        std::string unidade;
+        double quantidadeTipica;
+    };
+
+    uint64_t proximoAleatorio();
+    double uniforme();                       // [0, 1)
+    int inteiro(int minimo, int maximo);     // [minimo, maximo]
+    double logNormal(double mediana, double sigma);
+    size_t amostrarZipf(const std::vector<double>& acumulada);
+    void montarAcumulada(std::vector<double>& acumulada, size_t n) const;
+
+    ConfiguracaoGerador configuracao;
+    uint64_t estado;
+    std::vector<std::string> tags;
+    std::vector<IngredienteBase> ingredientes;
+    std::vector<double> acumuladaTags;
+    std::vector<double> acumuladaIngredientes;
+    std::vector<double> acumuladaPrincipais;   // so o vocabulario real, para nomes legiveis
+};
+
+#endif // GERADOR_VAULT_H
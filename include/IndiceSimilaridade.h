@@ -0,0 +1,66 @@
+#ifndef INDICE_SIMILARIDADE_H
+#define INDICE_SIMILARIDADE_H
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct ReceitaSimilar {
+    int id;
+    double similaridade;   // Jaccard estimado (0 a 1)
+};
+
+// Indice MinHash/LSH de receitas por ingredientes e tags. Cada receita tem uma
+// assinatura de 32 minhashes de 16 bits (64 bytes); as assinaturas sao
+// divididas em 8 faixas de 4 valores e receitas com alguma faixa identica
+// ficam no mesmo balde. Os baldes sao listas encadeadas por slot sobre uma
+// tabela de cabecas por faixa, sem alocacao por receita.
+class IndiceSimilaridade {
+public:
+    static const int NUM_HASHES = 32;
+    static const int NUM_FAIXAS = 8;
+    static const int LINHAS_POR_FAIXA = NUM_HASHES / NUM_FAIXAS;
+    using Assinatura = std::array<uint16_t, NUM_HASHES>;
+
+    // Caracteristica = hash de prefixo ("i:", "t:") + texto
+    static uint64_t caracteristica(std::string_view prefixo, std::string_view texto);
+    static Assinatura assinaturaVazia();
+    static void acumular(Assinatura& assinatura, uint64_t caracteristica);
+
+    // Insere ou substitui; assinatura vazia (sem caracteristicas) nao entra nos baldes
+    void definir(int id, const Assinatura& assinatura);
+    void remover(int id);
+    void limpar();
+
+    // Ate k vizinhos por similaridade estimada, sem a propria receita;
+    // examina no maximo maxCandidatos receitas dos baldes
+    std::vector<ReceitaSimilar> similares(int id, size_t k, size_t maxCandidatos = 20000);
+
+    bool contem(int id) const { return slotPorId.count(id) > 0; }
+    size_t size() const { return slotPorId.size(); }
+
+private:
+    static constexpr uint32_t NENHUM = UINT32_MAX;
+
+    static uint64_t chaveFaixa(const Assinatura& assinatura, int faixa);
+    size_t balde(uint64_t chave, int faixa) const;
+    void encadear(uint32_t slot);
+    void desencadear(uint32_t slot);
+    void redimensionar(size_t capacidade);
+
+    std::vector<int> ids;                   // por slot
+    std::vector<Assinatura> assinaturas;    // por slot
+    std::vector<uint8_t> indexado;          // por slot: esta nos baldes
+    std::vector<uint32_t> proximos;         // por slot e faixa
+    std::vector<uint32_t> cabecas;          // por faixa e balde
+    std::vector<uint32_t> livres;
+    std::unordered_map<int, uint32_t> slotPorId;
+    size_t mascara = 0;
+
+    std::vector<uint32_t> marcas;           // dedupe de candidatos por consulta
+    uint32_t marcaAtual = 0;
+};
+
+#endif // INDICE_SIMILARIDADE_H
@@ -0,0 +1,93 @@
+#ifndef LISTA_COMPRAS_H
+#define LISTA_COMPRAS_H
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Grandeza de uma unidade: quantidades so sao somadas dentro da mesma
+// grandeza (massa em g, volume em ml, contagem em unidades). Unidades fora da
+// tabela ("pitada", "dente") ficam como Outra e so somam com a mesma unidade.
+enum class Grandeza {
+    Massa,
+    Volume,
+    Contagem,
+    Outra
+};
+
+struct ConversaoUnidade {
+    std::string_view nome;
+    Grandeza grandeza;
+    double fator;   // multiplicador para a unidade base da grandeza
+};
+
+// Medidas caseiras em valores usuais: xicara 240 ml, colher (de sopa) 15 ml
+constexpr ConversaoUnidade TABELA_UNIDADES[] = {
+    {"", Grandeza::Contagem, 1},
+    {"un", Grandeza::Contagem, 1},
+    {"unidade", Grandeza::Contagem, 1},
+    {"mg", Grandeza::Massa, 0.001},
+    {"g", Grandeza::Massa, 1},
+    {"grama", Grandeza::Massa, 1},
+    {"kg", Grandeza::Massa, 1000},
+    {"quilo", Grandeza::Massa, 1000},
+    {"ml", Grandeza::Volume, 1},
+    {"l", Grandeza::Volume, 1000},
+    {"litro", Grandeza::Volume, 1000},
+    {"xicara", Grandeza::Volume, 240},
+    {"copo", Grandeza::Volume, 200},
+    {"colher", Grandeza::Volume, 15},
+    {"colher de sopa", Grandeza::Volume, 15},
+    {"colher de sobremesa", Grandeza::Volume, 10},
+    {"colher de cha", Grandeza::Volume, 5},
+    {"colher de cafe", Grandeza::Volume, 2.5},
+};
+
+// Busca exata (unidade ja normalizada); nullptr se desconhecida
+constexpr const ConversaoUnidade* localizarUnidade(std::string_view nome) {
+    for (const auto& conversao : TABELA_UNIDADES) {
+        if (conversao.nome == nome) {
+            return &conversao;
+        }
+    }
+    return nullptr;
+}
+
+static_assert(localizarUnidade("kg")->fator == 1000, "tabela de unidades");
+static_assert(localizarUnidade("xicara")->grandeza == Grandeza::Volume, "tabela de unidades");
+
+// Quantas porcoes de uma receita entram na lista; porcoes <= 0 usa o
+// rendimento da propria receita (Receita::porcoes)
+struct ItemPlano {
+    int receitaId;
+    double porcoes;
+};
+
+struct ItemCompra {
+    std::string nome;        // nome canonico (minusculas, sem acentos)
+    double quantidade;
+    std::string unidade;     // g/kg, ml/l, "" (contagem) ou a unidade original
+    Grandeza grandeza;
+    int ocorrencias;         // quantos ingredientes de receitas foram somados
+};
+
+// Soma ingredientes por (nome canonico, grandeza) em uma tabela hash
+class AgregadorCompras {
+public:
+    void adicionar(std::string_view nome, double quantidade, std::string_view unidade, double fator = 1.0);
+    // Em ordem alfabetica, com kg/l a partir de 1000 g/ml
+    std::vector<ItemCompra> resultado() const;
+    size_t size() const { return itens.size(); }
+
+    static std::string normalizar(std::string_view texto);
+    // Normaliza e tira plurais ("Xícaras" -> "xicara"); nullptr se desconhecida
+    static const ConversaoUnidade* converterUnidade(std::string_view unidade, std::string& normalizada);
+
+private:
+    std::unordered_map<std::string, size_t> indice;
+    std::vector<ItemCompra> itens;
+    std::string chave;   // reaproveitado entre chamadas
+};
+
+#endif // LISTA_COMPRAS_H
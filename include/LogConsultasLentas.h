@@ -0,0 +1,95 @@
+#ifndef LOG_CONSULTAS_LENTAS_H
+#define LOG_CONSULTAS_LENTAS_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ConsultaLenta {
+    std::string sql;            // com os parametros ja substituidos
+    std::string plano;          // EXPLAIN QUERY PLAN, etapas separadas por " | "
+    uint64_t duracaoNs = 0;
+    uint64_t linhas = 0;        // lidas (SELECT) ou alteradas (escrita)
+    bool varredura = false;     // o plano contem SCAN (tabela/indice inteiro)
+    std::chrono::system_clock::time_point quando;
+};
+
+// Log de statements acima de um limiar de duracao. Quem mediu so enfileira
+// (SQL e tempos, sem a conexao) em uma fila limitada do processo; uma thread
+// de registro tira o EXPLAIN QUERY PLAN em uma conexao somente leitura
+// propria e grava. As ultimas entradas ficam em um anel de tamanho fixo na
+// memoria; se um arquivo for configurado, cada entrada tambem vira uma
+// linha NDJSON nele, com rotacao por tamanho (arquivo -> arquivo.1 -> ...).
+class LogConsultasLentas {
+public:
+    static LogConsultasLentas& global();
+    ~LogConsultasLentas();
+
+    // limiarMs < 0 desliga o log
+    void configurar(double limiarMs, const std::string& caminhoArquivo = "",
+                    size_t tamanhoMaximoArquivo = 10 * 1024 * 1024, int arquivosMantidos = 3,
+                    size_t capacidadeAnel = 256);
+
+    bool ehLenta(uint64_t duracaoNs) const {
+        int64_t limiar = limiarNs.load(std::memory_order_relaxed);
+        return limiar >= 0 && duracaoNs >= static_cast<uint64_t>(limiar);
+    }
+
+    // Nao bloqueia: com a fila cheia a entrada mais antiga e descartada.
+    // "banco" e o arquivo do vault (vazio = sem plano) e "sqlOriginal" o
+    // texto sem parametros, usados para o EXPLAIN.
+    void enfileirar(ConsultaLenta consulta, std::string banco, std::string sqlOriginal);
+    // Espera a thread de registro gravar tudo o que ja foi enfileirado
+    void esvaziar() const;
+    // Esvazia, encerra a thread e fecha o arquivo (tambem no destrutor)
+    void encerrar();
+    // Entradas perdidas por fila cheia
+    uint64_t descartadas() const { return totalDescartadas.load(std::memory_order_relaxed); }
+    // Da mais antiga para a mais recente, depois de esvaziar a fila
+    std::vector<ConsultaLenta> recentes() const;
+    std::string paraJson() const;
+
+    static void anexarJson(std::string& saida, const ConsultaLenta& consulta);
+
+private:
+    struct Pendente {
+        ConsultaLenta consulta;
+        std::string banco;
+        std::string sqlOriginal;
+    };
+
+    LogConsultasLentas();
+    void registrar(std::vector<Pendente>& lote);
+    void lacoRegistro();
+    void rotacionar();
+
+    static const size_t CAPACIDADE_FILA = 1024;
+    mutable std::mutex mutexFila;
+    mutable std::condition_variable haPendentes;
+    mutable std::condition_variable filaVazia;
+    std::deque<Pendente> fila;
+    bool registrando;   // a thread tem um lote fora da fila
+    bool encerrando;
+    std::thread registradora;
+    std::atomic<uint64_t> totalDescartadas;
+
+    std::atomic<int64_t> limiarNs;
+    mutable std::mutex mutex;
+    std::vector<ConsultaLenta> anel;
+    size_t capacidade;
+    size_t proxima;
+    std::string caminhoArquivo;
+    size_t tamanhoMaximoArquivo;
+    int arquivosMantidos;
+    std::ofstream arquivo;
+    size_t tamanhoArquivo;
+};
+
+#endif // LOG_CONSULTAS_LENTAS_H
@@ -0,0 +1,104 @@
+#ifndef METRICAS_H
+#define METRICAS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+// Histograma de latencias no estilo HDR: 16 faixas lineares por potencia de
+// dois (erro relativo maximo de ~6%), de 1 ns a varios anos, sem alocacao
+// por amostra. Seguro para registrar a partir de varias threads.
+class HistogramaLatencia {
+public:
+    static const int SUBFAIXAS = 16;
+    static const int NUM_FAIXAS = 61 * SUBFAIXAS;
+
+    void registrar(uint64_t nanossegundos);
+    void zerar();
+
+    uint64_t contagem() const { return total.load(std::memory_order_relaxed); }
+    uint64_t soma() const { return somaNs.load(std::memory_order_relaxed); }
+    uint64_t maximo() const { return maximoNs.load(std::memory_order_relaxed); }
+    // Valor (ns) abaixo do qual esta a fracao p das amostras
+    uint64_t percentil(double p) const;
+
+private:
+    static int indice(uint64_t valor);
+    static uint64_t limiteInferior(int indice);
+
+    std::atomic<uint64_t> faixas[NUM_FAIXAS] = {};
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> somaNs{0};
+    std::atomic<uint64_t> maximoNs{0};
+};
+
+// Contadores alimentados pelos hooks do SQLite (sqlite3_trace_v2)
+struct ContadoresSql {
+    std::atomic<uint64_t> preparados{0};
+    std::atomic<uint64_t> executados{0};       // execucoes de statements (SQLITE_TRACE_STMT)
+    std::atomic<uint64_t> linhasLidas{0};      // SQLITE_TRACE_ROW
+    std::atomic<uint64_t> linhasEscritas{0};   // sqlite3_changes de statements de escrita
+    std::atomic<uint64_t> bytesRetornados{0};  // colunas TEXT/BLOB entregues
+    HistogramaLatencia tempo;                  // SQLITE_TRACE_PROFILE
+};
+
+// Caches de receitas por id (CacheReceitas) e de listagens (CacheConsultas)
+struct ContadoresCache {
+    std::atomic<uint64_t> acertos{0};
+    std::atomic<uint64_t> falhas{0};
+    std::atomic<uint64_t> consultasAcertos{0};
+    std::atomic<uint64_t> consultasFalhas{0};
+    std::atomic<uint64_t> despejos{0};
+    std::atomic<uint64_t> invalidacoes{0};
+};
+
+// Registro de metricas do processo: chamadas e latencia por metodo de
+// Database e contadores de SQL. Leitura via paraJson()/escreverTabela().
+class Metricas {
+public:
+    struct Metodo {
+        HistogramaLatencia latencia;
+    };
+
+    static Metricas& global();
+
+    Metodo& metodo(const char* nome);
+    ContadoresSql& sql() { return contadoresSql; }
+    ContadoresCache& cache() { return contadoresCache; }
+
+    std::string paraJson() const;
+    void escreverTabela(std::ostream& saida) const;
+    void zerar();
+
+private:
+    mutable std::mutex mutex;
+    std::map<std::string, std::unique_ptr<Metodo>> metodos;
+    ContadoresSql contadoresSql;
+    ContadoresCache contadoresCache;
+};
+
+// Mede o escopo atual (tipicamente um metodo inteiro: TemporizadorEscopo t(__func__))
+class TemporizadorEscopo {
+public:
+    explicit TemporizadorEscopo(const char* nomeMetodo)
+        : destino(Metricas::global().metodo(nomeMetodo)), inicio(std::chrono::steady_clock::now()) {}
+    ~TemporizadorEscopo() {
+        auto decorrido = std::chrono::steady_clock::now() - inicio;
+        destino.latencia.registrar(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(decorrido).count()));
+    }
+
+    TemporizadorEscopo(const TemporizadorEscopo&) = delete;
+    TemporizadorEscopo& operator=(const TemporizadorEscopo&) = delete;
+
+private:
+    Metricas::Metodo& destino;
+    std::chrono::steady_clock::time_point inicio;
+};
+
+#endif // METRICAS_H
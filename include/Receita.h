@@ -2,8 +2,10 @@
 #define RECEITA_H
 
 #include <string>
+#include <string_view>
 #include <vector>
-#include <sstream>
+#include <charconv>
+#include <cstdint>
 
 struct Ingrediente {
     int id;
@@ -16,24 +18,33 @@ struct Ingrediente {
     Ingrediente(const std::string& nome, double quantidade, const std::string& unidade)
         : id(0), nome(nome), quantidade(quantidade), unidade(unidade) {}
     
-    std::string formatar() const {
-        std::ostringstream oss;
-        oss << quantidade;
-        std::string qtdStr = oss.str();
-        size_t pos = qtdStr.find_last_not_of('0');
-        if (pos != std::string::npos && qtdStr[pos] == '.') {
-            pos--;
-        }
-        if (pos != std::string::npos) {
-            qtdStr = qtdStr.substr(0, pos + 1);
-        }
+    // Anexa a forma legivel ("2 xicaras de farinha") em "saida", sem
+    // alocacoes temporarias. A quantidade usa std::to_chars (independente de
+    // locale) com ate 6 digitos significativos, como o padrao de ostream.
+    void formatarEm(std::string& saida) const {
+        char numero[32];
+        auto fim = std::to_chars(numero, numero + sizeof(numero), quantidade,
+                                 std::chars_format::general, 6).ptr;
+        saida.append(numero, static_cast<size_t>(fim - numero));
+        saida.push_back(' ');
         
         if (unidade.empty() || unidade == "unidade" || unidade == "un") {
-            return qtdStr + " " + nome;
+            saida.append(nome);
         } else {
-            return qtdStr + " " + unidade + (quantidade > 1.0 && unidade.back() != 's' ? "s" : "") + " de " + nome;
+            saida.append(unidade);
+            if (quantidade > 1.0 && unidade.back() != 's') {
+                saida.push_back('s');
+            }
+            saida.append(" de ");
+            saida.append(nome);
         }
     }
+    
+    std::string formatar() const {
+        std::string texto;
+        formatarEm(texto);
+        return texto;
+    }
 };
 
 struct Receita {
@@ -49,19 +60,30 @@ struct Receita {
     int nota;
     std::string imagem; // Caminho para o arquivo de imagem
     std::vector<std::string> tags;
+    // ms desde a epoca, mantidos pelos triggers do banco (0 = ainda nao gravada);
+    // ignorados por cadastrar/atualizar
+    int64_t criadaEm;
+    int64_t atualizadaEm;
 
-    Receita() : id(0), tempo(0), porcoes(0), feita(false), nota(0) {}
+    Receita() : id(0), tempo(0), porcoes(0), feita(false), nota(0), criadaEm(0), atualizadaEm(0) {}
     
     Receita(const std::string& nome, const std::string& ingredientes, 
             const std::string& preparo, int tempo, 
             const std::string& categoria, int porcoes)
         : id(0), nome(nome), ingredientes(ingredientes), preparo(preparo),
-          tempo(tempo), categoria(categoria), porcoes(porcoes), feita(false), nota(0) {}
+          tempo(tempo), categoria(categoria), porcoes(porcoes), feita(false), nota(0), criadaEm(0), atualizadaEm(0) {}
     
     void atualizarIngredientesString() {
-        ingredientes = "";
+        size_t estimativa = 0;
+        for (const auto& ing : ingredientesEstruturados) {
+            // numero + espacos + " de " + plural + ", "
+            estimativa += ing.nome.size() + ing.unidade.size() + 24;
+        }
+        
+        ingredientes.clear();
+        ingredientes.reserve(estimativa);
         for (size_t i = 0; i < ingredientesEstruturados.size(); ++i) {
-            ingredientes += ingredientesEstruturados[i].formatar();
+            ingredientesEstruturados[i].formatarEm(ingredientes);
             if (i < ingredientesEstruturados.size() - 1) {
                 ingredientes += ", ";
             }
@@ -69,5 +91,38 @@ struct Receita {
     }
 };
 
+// Campos opcionais de uma receita para consultas com projecao. id, nome,
+// categoria, tempo, porcoes, feita e nota sao sempre carregados.
+enum CampoReceita : unsigned {
+    CAMPO_INGREDIENTES = 1u << 0, // texto livre e ingredientes estruturados
+    CAMPO_PREPARO      = 1u << 1,
+    CAMPO_TAGS         = 1u << 2,
+    CAMPO_IMAGEM       = 1u << 3,
+    CAMPOS_LISTAGEM    = CAMPO_TAGS,
+    CAMPOS_TODOS       = CAMPO_INGREDIENTES | CAMPO_PREPARO | CAMPO_TAGS | CAMPO_IMAGEM
+};
+
+// Linha de receita sem copia, entregue pelos visitantes do Database.
+// As views apontam para a memoria das colunas do SQLite e so sao
+// validas durante o callback; "tags" vem concatenadas por ", " (para
+// exibir) e "listaTags" traz os mesmos nomes um a um. Campos fora da
+// projecao pedida ficam vazios.
+struct ReceitaLinha {
+    int id = 0;
+    std::string_view nome;
+    std::string_view ingredientes;
+    std::string_view preparo;
+    int tempo = 0;
+    std::string_view categoria;
+    int porcoes = 0;
+    bool feita = false;
+    int nota = 0;
+    std::string_view imagem;
+    std::string_view tags;
+    std::vector<std::string_view> listaTags;
+    int64_t criadaEm = 0;      // ms desde a epoca
+    int64_t atualizadaEm = 0;
+};
+
 #endif // RECEITA_H
 
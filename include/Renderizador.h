@@ -0,0 +1,68 @@
+#ifndef RENDERIZADOR_H
+#define RENDERIZADOR_H
+
+#include "Receita.h"
+#include "ResultadoReceitas.h"
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class FormatoSaida {
+    Tabela,
+    Json,
+    Ndjson
+};
+
+// Formata linhas de receitas em um buffer reutilizavel e escreve no destino
+// uma vez por lote, sem copias por campo. Na tabela, colunas sao truncadas
+// por caractere UTF-8 (nunca no meio de um codepoint).
+class Renderizador {
+public:
+    static const size_t TAMANHO_LOTE_PADRAO = 64 * 1024;
+
+    Renderizador(std::ostream& saida, FormatoSaida formato = FormatoSaida::Tabela,
+                 size_t tamanhoLote = TAMANHO_LOTE_PADRAO);
+    // Acumula tudo em "destino" (sem escrita parcial), util para corpos HTTP
+    Renderizador(std::string& destino, FormatoSaida formato);
+    ~Renderizador();
+    // "buffer" pode referenciar o proprio objeto ou o destino do chamador
+    Renderizador(const Renderizador&) = delete;
+    Renderizador& operator=(const Renderizador&) = delete;
+
+    // Campos extras (CampoReceita) incluidos em JSON/NDJSON; a tabela ignora
+    void definirCampos(unsigned campos) { this->campos = campos; }
+
+    void linha(const ReceitaLinha& receita);
+    void linha(const ResultadoReceitas::ReceitaView& receita);
+    void linha(const Receita& receita);
+
+    // Fecha o documento (cabecalho/"[]" mesmo sem linhas) e descarrega o buffer
+    void finalizar();
+
+    size_t linhasEscritas() const { return linhas; }
+
+    static FormatoSaida formatoPorNome(const std::string& nome, bool* valido = nullptr);
+    // Trunca para no maximo "largura" colunas, contando codepoints UTF-8
+    static void anexarCelula(std::string& saida, std::string_view texto, size_t largura);
+    static void anexarJsonString(std::string& saida, std::string_view texto);
+
+private:
+    void iniciar();
+    void descarregarSeCheio();
+    void escrever(const ReceitaLinha& receita, const std::vector<std::string_view>& tags);
+
+    std::ostream* saida;
+    std::string proprio;
+    std::string& buffer;
+    FormatoSaida formato;
+    size_t tamanhoLote;
+    unsigned campos;
+    size_t linhas;
+    bool iniciado;
+    bool finalizado;
+    std::string tagsTemporarias;
+    std::vector<std::string_view> listaTags;
+};
+
+#endif // RENDERIZADOR_H
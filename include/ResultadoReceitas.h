@@ -0,0 +1,225 @@
+#ifndef RESULTADO_RECEITAS_H
+#define RESULTADO_RECEITAS_H
+
+#include "Receita.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class Database;
+
+// Resultado compacto de uma listagem de receitas.
+// Todos os textos da consulta ficam em poucos pools e as linhas guardam
+// apenas offsets; tags e ingredientes sao arrays planos referenciados por
+// faixas. Nomes de tags repetidos sao armazenados uma unica vez.
+//
+// Campos fora da projecao pedida sao carregados sob demanda, de uma vez
+// para todas as linhas, no primeiro acesso. Por isso o Database de origem
+// precisa continuar aberto enquanto o resultado for usado.
+class ResultadoReceitas {
+public:
+    struct Faixa {
+        uint32_t inicio = 0;
+        uint32_t tamanho = 0;
+    };
+
+    struct Linha {
+        int id = 0;
+        int tempo = 0;
+        int porcoes = 0;
+        int nota = 0;
+        bool feita = false;
+        int64_t criadaEm = 0;
+        int64_t atualizadaEm = 0;
+        Faixa nome;
+        Faixa ingredientes;
+        Faixa preparo;
+        Faixa categoria;
+        Faixa imagem;
+        uint32_t primeiraTag = 0;
+        uint32_t numTags = 0;
+        uint32_t primeiroIngrediente = 0;
+        uint32_t numIngredientes = 0;
+    };
+
+    struct IngredienteCompacto {
+        int id = 0;
+        double quantidade = 0.0;
+        Faixa nome;
+        Faixa unidade;
+    };
+
+    struct IngredienteView {
+        int id;
+        std::string_view nome;
+        double quantidade;
+        std::string_view unidade;
+    };
+
+    // Visao leve de uma linha; valida enquanto o resultado existir.
+    class ReceitaView {
+    public:
+        ReceitaView(const ResultadoReceitas* resultado, size_t indice)
+            : resultado(resultado), linha(&resultado->linhas[indice]) {}
+
+        int id() const { return linha->id; }
+        int tempo() const { return linha->tempo; }
+        int porcoes() const { return linha->porcoes; }
+        int nota() const { return linha->nota; }
+        bool feita() const { return linha->feita; }
+        int64_t criadaEm() const { return linha->criadaEm; }
+        int64_t atualizadaEm() const { return linha->atualizadaEm; }
+        std::string_view nome() const { return resultado->texto(POOL_BASE, linha->nome); }
+        std::string_view categoria() const { return resultado->texto(POOL_BASE, linha->categoria); }
+
+        std::string_view ingredientes() const {
+            resultado->garantir(CAMPO_INGREDIENTES);
+            return resultado->texto(POOL_INGREDIENTES, linha->ingredientes);
+        }
+        std::string_view preparo() const {
+            resultado->garantir(CAMPO_PREPARO);
+            return resultado->texto(POOL_PREPARO, linha->preparo);
+        }
+        std::string_view imagem() const {
+            resultado->garantir(CAMPO_IMAGEM);
+            return resultado->texto(POOL_IMAGEM, linha->imagem);
+        }
+
+        size_t numTags() const {
+            resultado->garantir(CAMPO_TAGS);
+            return linha->numTags;
+        }
+        std::string_view tag(size_t i) const {
+            resultado->garantir(CAMPO_TAGS);
+            return resultado->texto(POOL_TAGS, resultado->dicionarioTags[resultado->tagsPorLinha[linha->primeiraTag + i]]);
+        }
+
+        size_t numIngredientes() const {
+            resultado->garantir(CAMPO_INGREDIENTES);
+            return linha->numIngredientes;
+        }
+        IngredienteView ingrediente(size_t i) const {
+            resultado->garantir(CAMPO_INGREDIENTES);
+            const IngredienteCompacto& ing = resultado->ingredientesPorLinha[linha->primeiroIngrediente + i];
+            return IngredienteView{ing.id, resultado->texto(POOL_INGREDIENTES, ing.nome), ing.quantidade,
+                                   resultado->texto(POOL_INGREDIENTES, ing.unidade)};
+        }
+
+        // Materializa a linha em uma Receita tradicional (aloca e carrega todos os campos).
+        Receita paraReceita() const {
+            Receita r;
+            r.id = id();
+            r.nome = std::string(nome());
+            r.ingredientes = std::string(ingredientes());
+            r.preparo = std::string(preparo());
+            r.tempo = tempo();
+            r.categoria = std::string(categoria());
+            r.porcoes = porcoes();
+            r.feita = feita();
+            r.nota = nota();
+            r.imagem = std::string(imagem());
+            r.criadaEm = criadaEm();
+            r.atualizadaEm = atualizadaEm();
+            r.tags.reserve(numTags());
+            for (size_t i = 0; i < numTags(); ++i) {
+                r.tags.emplace_back(tag(i));
+            }
+            r.ingredientesEstruturados.reserve(numIngredientes());
+            for (size_t i = 0; i < numIngredientes(); ++i) {
+                IngredienteView ing = ingrediente(i);
+                Ingrediente novo(std::string(ing.nome), ing.quantidade, std::string(ing.unidade));
+                novo.id = ing.id;
+                r.ingredientesEstruturados.push_back(std::move(novo));
+            }
+            if (!r.ingredientesEstruturados.empty()) {
+                r.atualizarIngredientesString();
+            }
+            return r;
+        }
+
+    private:
+        const ResultadoReceitas* resultado;
+        const Linha* linha;
+    };
+
+    class Iterador {
+    public:
+        Iterador(const ResultadoReceitas* resultado, size_t indice) : resultado(resultado), indice(indice) {}
+        ReceitaView operator*() const { return ReceitaView(resultado, indice); }
+        Iterador& operator++() { ++indice; return *this; }
+        bool operator!=(const Iterador& outro) const { return indice != outro.indice; }
+
+    private:
+        const ResultadoReceitas* resultado;
+        size_t indice;
+    };
+
+    size_t size() const { return linhas.size(); }
+    bool empty() const { return linhas.empty(); }
+    ReceitaView operator[](size_t indice) const { return ReceitaView(this, indice); }
+    Iterador begin() const { return Iterador(this, 0); }
+    Iterador end() const { return Iterador(this, linhas.size()); }
+
+    // Campos (CampoReceita) ja presentes em memoria.
+    unsigned camposCarregados() const { return carregados; }
+
+    // Offsets sao de 32 bits: um pool nao passa de 4 GiB. Se uma carga
+    // tardia estourar esse limite, os textos que nao couberam ficam vazios
+    // e isto retorna true (a listagem inicial falha inteira nesse caso).
+    bool excedeuLimite() const { return excedeu; }
+
+    // Bytes ocupados pelo resultado (pools + arrays), util para medir listagens.
+    size_t memoriaUtilizada() const {
+        size_t total = linhas.capacity() * sizeof(Linha)
+            + dicionarioTags.capacity() * sizeof(Faixa)
+            + tagsPorLinha.capacity() * sizeof(uint32_t)
+            + ingredientesPorLinha.capacity() * sizeof(IngredienteCompacto);
+        for (const auto& pool : pools) {
+            total += pool.capacity();
+        }
+        return total;
+    }
+
+private:
+    friend class Database;
+
+    // Cada grupo de campos tem seu proprio pool, preenchido uma unica vez;
+    // assim uma carga tardia nao invalida views de outros campos.
+    enum Pool { POOL_BASE, POOL_INGREDIENTES, POOL_PREPARO, POOL_TAGS, POOL_IMAGEM, NUM_POOLS };
+
+    std::string_view texto(Pool pool, Faixa faixa) const {
+        return std::string_view(pools[pool].data() + faixa.inicio, faixa.tamanho);
+    }
+
+    Faixa adicionarTexto(Pool pool, const char* dados, size_t tamanho) {
+        Faixa faixa;
+        if (tamanho > UINT32_MAX - pools[pool].size()) {
+            excedeu = true;
+            return faixa;
+        }
+        faixa.inicio = static_cast<uint32_t>(pools[pool].size());
+        faixa.tamanho = static_cast<uint32_t>(tamanho);
+        if (dados && tamanho > 0) {
+            pools[pool].append(dados, tamanho);
+        }
+        return faixa;
+    }
+
+    // Definido em Database.cpp: carrega o campo para todas as linhas se faltar
+    void garantir(unsigned campo) const;
+
+    Database* origem = nullptr;
+    bool completo = false;       // true quando o resultado cobre a tabela inteira
+    mutable unsigned carregados = 0;
+    mutable bool textoIngredientesLido = false;
+    mutable bool excedeu = false;
+
+    mutable std::string pools[NUM_POOLS];
+    mutable std::vector<Linha> linhas;
+    mutable std::vector<Faixa> dicionarioTags;
+    mutable std::vector<uint32_t> tagsPorLinha;
+    mutable std::vector<IngredienteCompacto> ingredientesPorLinha;
+};
+
+#endif // RESULTADO_RECEITAS_H
@@ -0,0 +1,98 @@
+#ifndef SERVIDOR_HTTP_H
+#define SERVIDOR_HTTP_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Database;
+
+struct ConfiguracaoServidor {
+    std::string caminhoDb = "./data/recipes.db";
+    std::string endereco = "127.0.0.1";
+    int porta = 8080;                // 0 escolhe uma porta livre
+    int trabalhadores = 4;
+    std::string diretorioBackups = "./backups";
+    int prazoConsultaMs = 0;         // prazo de cada listagem; 0 = sem prazo
+};
+
+struct RespostaHttp {
+    int status = 200;
+    std::string tipo = "application/json";
+    std::string corpo;
+    std::string arquivo;     // se preenchido, o corpo e este arquivo (enviado com sendfile)
+};
+
+// Servidor HTTP/1.1 embutido que expoe o vault em JSON.
+// Uma thread de poll aceita conexoes e acompanha as ociosas (keep-alive);
+// conexoes com dados prontos vao para um pool fixo de trabalhadores, cada um
+// com sua propria conexao SQLite somente leitura. Escritas sao enfileiradas
+// para uma unica thread escritora, que agrupa o que estiver pendente em uma
+// so transacao. Requisicoes em pipeline sao respondidas em ordem, com uma
+// escrita por rajada.
+class ServidorHttp {
+public:
+    explicit ServidorHttp(const ConfiguracaoServidor& configuracao);
+    ~ServidorHttp();
+
+    bool iniciar();
+    void parar();
+    int porta() const { return portaEmUso; }
+
+private:
+    struct Conexao {
+        int fd = -1;
+        std::string entrada;
+        std::chrono::steady_clock::time_point ultimaAtividade;
+    };
+
+    struct TarefaEscrita {
+        std::function<RespostaHttp(Database&)> executar;
+        bool exclusiva = false;      // roda fora da transacao em grupo (ex.: backup)
+        std::shared_ptr<std::promise<RespostaHttp>> promessa;
+    };
+
+    void lacoPoll();
+    void lacoTrabalhador(int indice);
+    void lacoEscritor();
+    void devolverAoPoll(std::unique_ptr<Conexao> conexao);
+    void acordarPoll();
+
+    // Retorna false se a conexao deve ser fechada
+    bool atenderConexao(Conexao& conexao, Database& leitura);
+    RespostaHttp rotear(const std::string& metodo, const std::string& caminho,
+                        const std::map<std::string, std::string>& parametros, Database& leitura);
+    RespostaHttp escrever(std::function<RespostaHttp(Database&)> operacao, bool exclusiva = false);
+
+    ConfiguracaoServidor configuracao;
+    int portaEmUso;
+    int socketEscuta;
+    int canalDespertar[2];
+    std::atomic<bool> executando;
+
+    std::unique_ptr<Database> bancoEscrita;
+    std::vector<std::unique_ptr<Database>> bancosLeitura;
+    std::vector<std::thread> threads;
+
+    std::mutex mutexProntas;
+    std::condition_variable condProntas;
+    std::deque<std::unique_ptr<Conexao>> prontas;
+
+    std::mutex mutexDevolvidas;
+    std::vector<std::unique_ptr<Conexao>> devolvidas;
+
+    std::mutex mutexEscritas;
+    std::condition_variable condEscritas;
+    std::deque<TarefaEscrita> escritas;
+};
+
+#endif // SERVIDOR_HTTP_H
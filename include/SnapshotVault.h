@@ -0,0 +1,287 @@
+#ifndef SNAPSHOT_VAULT_H
+#define SNAPSHOT_VAULT_H
+
+#include "Receita.h"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Snapshot somente leitura de um vault inteiro em um unico arquivo binario,
+// aberto com mmap. Campos numericos ficam em colunas (um array por campo, na
+// ordem dos ids), textos longos em heaps com offsets, e categorias, tags,
+// nomes de ingredientes e unidades em dicionarios ordenados. Tags e
+// ingredientes de cada receita sao adjacencias CSR: um array de inicio por
+// receita mais arrays planos.
+//
+// Abrir valida apenas o cabecalho e a tabela de secoes; as consultas leem
+// direto do mapeamento, sem parse nem alocacao. Indices fora de faixa em um
+// arquivo corrompido viram textos vazios, nunca leituras fora do mapeamento.
+//
+// Layout (versao 1, ordem de bytes de quem gravou, conferida na abertura):
+// Cabecalho | Secao[NUM_SECOES] | secoes, cada uma alinhada em 64 bytes.
+class SnapshotVault {
+public:
+    static const uint32_t VERSAO = 1;
+    static constexpr uint32_t NENHUM = UINT32_MAX;
+
+    enum Secao : uint32_t {
+        SECAO_IDS,                 // int32[n], crescente
+        SECAO_TEMPO,               // int32[n]
+        SECAO_PORCOES,             // int32[n]
+        SECAO_NOTA,                // uint8[n]
+        SECAO_FEITA,               // uint8[n]
+        SECAO_CATEGORIA,           // uint32[n], indice no dicionario de categorias
+        SECAO_NOME_OFFSETS,        // textos por receita: uint64[n + 1] + heap
+        SECAO_NOME_HEAP,
+        SECAO_INGREDIENTES_OFFSETS,
+        SECAO_INGREDIENTES_HEAP,
+        SECAO_PREPARO_OFFSETS,
+        SECAO_PREPARO_HEAP,
+        SECAO_IMAGEM_OFFSETS,
+        SECAO_IMAGEM_HEAP,
+        SECAO_CATEGORIAS_OFFSETS,  // dicionarios: uint64[k + 1] + heap, em ordem
+        SECAO_CATEGORIAS_HEAP,
+        SECAO_TAGS_OFFSETS,
+        SECAO_TAGS_HEAP,
+        SECAO_INGR_NOMES_OFFSETS,
+        SECAO_INGR_NOMES_HEAP,
+        SECAO_UNIDADES_OFFSETS,
+        SECAO_UNIDADES_HEAP,
+        SECAO_TAGS_INICIO,         // uint32[n + 1]
+        SECAO_TAGS_RECEITA,        // uint32[vinculos], indice no dicionario de tags
+        SECAO_INGR_INICIO,         // uint32[n + 1]
+        SECAO_INGR_ID,             // int32[m]
+        SECAO_INGR_QUANTIDADE,     // double[m]
+        SECAO_INGR_NOME,           // uint32[m]
+        SECAO_INGR_UNIDADE,        // uint32[m]
+        NUM_SECOES
+    };
+
+    struct Cabecalho {
+        char magica[8];            // "CHEFSNAP"
+        uint32_t versao;
+        uint32_t ordemBytes;       // 0x01020304 na ordem de quem gravou
+        uint32_t numSecoes;
+        uint32_t reservado;
+        uint64_t numReceitas;
+        uint64_t tamanhoArquivo;
+    };
+
+    struct EntradaSecao {
+        uint64_t deslocamento;
+        uint64_t tamanho;
+    };
+
+    struct IngredienteView {
+        int id;
+        std::string_view nome;
+        double quantidade;
+        std::string_view unidade;
+    };
+
+    // Visao de uma receita; valida enquanto o snapshot estiver aberto
+    class ReceitaView {
+    public:
+        ReceitaView(const SnapshotVault* snapshot, uint32_t indice) : snapshot(snapshot), indice(indice) {}
+
+        int id() const { return snapshot->ids[indice]; }
+        int tempo() const { return snapshot->tempos[indice]; }
+        int porcoes() const { return snapshot->porcoes[indice]; }
+        int nota() const { return snapshot->notas[indice]; }
+        bool feita() const { return snapshot->feitas[indice] != 0; }
+        std::string_view nome() const { return snapshot->nomes.texto(indice); }
+        std::string_view ingredientes() const { return snapshot->textosIngredientes.texto(indice); }
+        std::string_view preparo() const { return snapshot->preparos.texto(indice); }
+        std::string_view imagem() const { return snapshot->imagens.texto(indice); }
+        std::string_view categoria() const { return snapshot->categorias.texto(snapshot->categoriaPorReceita[indice]); }
+
+        size_t numTags() const { return snapshot->faixa(snapshot->tagsInicio, snapshot->totalVinculos, indice); }
+        std::string_view tag(size_t i) const {
+            return snapshot->tags.texto(snapshot->tagsPorReceita[snapshot->tagsInicio[indice] + i]);
+        }
+
+        size_t numIngredientes() const {
+            return snapshot->faixa(snapshot->ingredientesInicio, snapshot->totalIngredientes, indice);
+        }
+        IngredienteView ingrediente(size_t i) const {
+            size_t k = snapshot->ingredientesInicio[indice] + i;
+            return IngredienteView{snapshot->ingredienteIds[k], snapshot->nomesIngredientes.texto(snapshot->ingredienteNomes[k]),
+                                   snapshot->ingredienteQuantidades[k], snapshot->unidades.texto(snapshot->ingredienteUnidades[k])};
+        }
+
+        // Materializa a receita (aloca e copia todos os campos)
+        Receita paraReceita() const;
+
+    private:
+        const SnapshotVault* snapshot;
+        uint32_t indice;
+    };
+
+    class Iterador {
+    public:
+        Iterador(const SnapshotVault* snapshot, uint32_t indice) : snapshot(snapshot), indice(indice) {}
+        ReceitaView operator*() const { return ReceitaView(snapshot, indice); }
+        Iterador& operator++() { ++indice; return *this; }
+        bool operator!=(const Iterador& outro) const { return indice != outro.indice; }
+
+    private:
+        const SnapshotVault* snapshot;
+        uint32_t indice;
+    };
+
+    SnapshotVault() = default;
+    ~SnapshotVault();
+    SnapshotVault(const SnapshotVault&) = delete;
+    SnapshotVault& operator=(const SnapshotVault&) = delete;
+
+    // Mapeia o arquivo; false (com mensagem) se faltar, for de outra versao
+    // ou tiver secoes inconsistentes
+    bool abrir(const std::string& caminho);
+    void fechar();
+    bool aberto() const { return mapa != nullptr; }
+
+    size_t size() const { return numReceitas; }
+    bool empty() const { return numReceitas == 0; }
+    ReceitaView operator[](size_t indice) const { return ReceitaView(this, static_cast<uint32_t>(indice)); }
+    Iterador begin() const { return Iterador(this, 0); }
+    Iterador end() const { return Iterador(this, numReceitas); }
+    size_t bytes() const { return tamanhoMapa; }
+
+    // Posicao da receita com o id (busca binaria), ou NENHUM
+    uint32_t indiceDe(int id) const;
+    // Posicao da tag no dicionario (busca binaria), ou NENHUM
+    uint32_t indiceTag(std::string_view nome) const;
+
+    // Colunas completas, na ordem dos ids, para varreduras
+    const int32_t* colunaIds() const { return ids; }
+    const int32_t* colunaTempo() const { return tempos; }
+    const int32_t* colunaPorcoes() const { return porcoes; }
+    const uint8_t* colunaNota() const { return notas; }
+    const uint8_t* colunaFeita() const { return feitas; }
+    const uint32_t* colunaCategoria() const { return categoriaPorReceita; }
+    const uint32_t* inicioTags() const { return tagsInicio; }
+    const uint32_t* tagsDasReceitas() const { return tagsPorReceita; }
+
+    size_t numCategorias() const { return categorias.tamanho; }
+    std::string_view categoria(uint32_t indice) const { return categorias.texto(indice); }
+    size_t numTags() const { return tags.tamanho; }
+    std::string_view nomeTag(uint32_t indice) const { return tags.texto(indice); }
+
+private:
+    // Offsets + heap; texto(i) e vazio para i fora de faixa ou offsets invalidos
+    struct Textos {
+        const uint64_t* offsets = nullptr;
+        const char* heap = nullptr;
+        uint64_t tamanhoHeap = 0;
+        uint32_t tamanho = 0;
+
+        std::string_view texto(uint32_t i) const {
+            if (i >= tamanho || offsets[i] > offsets[i + 1] || offsets[i + 1] > tamanhoHeap) {
+                return std::string_view();
+            }
+            return std::string_view(heap + offsets[i], offsets[i + 1] - offsets[i]);
+        }
+    };
+
+    bool carregarTextos(Secao secaoOffsets, Textos& textos, uint64_t tamanho);
+
+    // Itens da receita em uma adjacencia CSR, limitados ao array plano
+    static size_t faixa(const uint32_t* inicio, uint32_t total, uint32_t indice) {
+        uint32_t fim = std::min(inicio[indice + 1], total);
+        return fim > inicio[indice] ? fim - inicio[indice] : 0;
+    }
+
+    void* mapa = nullptr;
+    size_t tamanhoMapa = 0;
+    const EntradaSecao* secoes = nullptr;
+    uint32_t numReceitas = 0;
+
+    const int32_t* ids = nullptr;
+    const int32_t* tempos = nullptr;
+    const int32_t* porcoes = nullptr;
+    const uint8_t* notas = nullptr;
+    const uint8_t* feitas = nullptr;
+    const uint32_t* categoriaPorReceita = nullptr;
+    Textos nomes;
+    Textos textosIngredientes;
+    Textos preparos;
+    Textos imagens;
+    Textos categorias;
+    Textos tags;
+    Textos nomesIngredientes;
+    Textos unidades;
+    uint32_t totalVinculos = 0;
+    uint32_t totalIngredientes = 0;
+    const uint32_t* tagsInicio = nullptr;
+    const uint32_t* tagsPorReceita = nullptr;
+    const uint32_t* ingredientesInicio = nullptr;
+    const int32_t* ingredienteIds = nullptr;
+    const double* ingredienteQuantidades = nullptr;
+    const uint32_t* ingredienteNomes = nullptr;
+    const uint32_t* ingredienteUnidades = nullptr;
+};
+
+// Monta um snapshot em memoria e grava o arquivo. Receitas entram em ordem
+// crescente de id; tags e ingredientes referenciam a posicao da receita e
+// podem vir em qualquer ordem (a ordem relativa de cada receita se mantem).
+class EscritorSnapshot {
+public:
+    // receita.tags e ignorado: as tags entram por adicionarTag
+    void adicionarReceita(const ReceitaLinha& receita);
+    void adicionarTag(size_t receita, std::string_view nome);
+    void adicionarIngrediente(size_t receita, int id, std::string_view nome, double quantidade, std::string_view unidade);
+
+    size_t size() const { return ids.size(); }
+    const std::vector<int32_t>& idsReceitas() const { return ids; }
+
+    // Grava em caminho + ".tmp" e renomeia por cima: quem ja tem o snapshot
+    // anterior mapeado continua lendo a versao antiga
+    bool gravar(const std::string& caminho) const;
+
+private:
+    struct TextosEscrita {
+        std::vector<uint64_t> offsets{0};
+        std::string heap;
+        void adicionar(std::string_view texto) {
+            heap.append(texto.data(), texto.size());
+            offsets.push_back(heap.size());
+        }
+    };
+
+    // Valores distintos em ordem de chegada; gravar() os ordena e remapeia
+    struct DicionarioEscrita {
+        std::unordered_map<std::string, uint32_t> indices;
+        std::vector<std::string> valores;
+        uint32_t indice(std::string_view valor);
+        // Ordena os valores; retorna o novo indice de cada indice antigo
+        std::vector<uint32_t> ordenar(TextosEscrita& saida) const;
+    };
+
+    std::vector<int32_t> ids;
+    std::vector<int32_t> tempos;
+    std::vector<int32_t> porcoes;
+    std::vector<uint8_t> notas;
+    std::vector<uint8_t> feitas;
+    std::vector<uint32_t> categoriaPorReceita;
+    TextosEscrita nomes;
+    TextosEscrita textosIngredientes;
+    TextosEscrita preparos;
+    TextosEscrita imagens;
+    DicionarioEscrita categorias;
+    DicionarioEscrita tags;
+    DicionarioEscrita nomesIngredientes;
+    DicionarioEscrita unidades;
+
+    std::vector<uint32_t> receitaDaTag;
+    std::vector<uint32_t> tagDoVinculo;
+    std::vector<uint32_t> receitaDoIngrediente;
+    std::vector<int32_t> ingredienteIds;
+    std::vector<double> ingredienteQuantidades;
+    std::vector<uint32_t> ingredienteNomes;
+    std::vector<uint32_t> ingredienteUnidades;
+};
+
+#endif // SNAPSHOT_VAULT_H
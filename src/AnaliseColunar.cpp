@@ -0,0 +1,268 @@
+// ============================================================================
+// INCLUDES
+// ============================================================================
+#include "../include/AnaliseColunar.h"
+#include <algorithm>
+
+// ============================================================================
+// KERNELS
+// ============================================================================
+// Os lacos abaixo nao tem desvios nem dependencias entre iteracoes (fora
+// dos acumuladores), para que o compilador os vetorize em -O2/-O3.
+
+// mascara[i] fica 1 so se minimo <= valores[i] <= maximo
+static void filtrarFaixa(const int32_t* valores, size_t n, int32_t minimo, int32_t maximo, uint8_t* mascara) {
+    for (size_t i = 0; i < n; ++i) {
+        mascara[i] &= static_cast<uint8_t>((valores[i] >= minimo) & (valores[i] <= maximo));
+    }
+}
+
+static void combinar(Agregado& agregado, size_t contagem, int64_t soma, int32_t minimo, int32_t maximo) {
+    if (contagem == 0) {
+        return;
+    }
+    if (agregado.contagem == 0) {
+        agregado.minimo = minimo;
+        agregado.maximo = maximo;
+    } else {
+        agregado.minimo = std::min(agregado.minimo, static_cast<int>(minimo));
+        agregado.maximo = std::max(agregado.maximo, static_cast<int>(maximo));
+    }
+    agregado.contagem += contagem;
+    agregado.soma += soma;
+}
+
+// Posicoes fora da mascara viram o elemento neutro de cada acumulador
+static void agregarBloco(const int32_t* valores, const uint8_t* mascara, size_t n, Agregado& agregado) {
+    uint32_t contagem = 0;
+    int64_t soma = 0;
+    int32_t minimo = INT32_MAX;
+    int32_t maximo = INT32_MIN;
+    for (size_t i = 0; i < n; ++i) {
+        int32_t selecao = -static_cast<int32_t>(mascara[i]);
+        int32_t valor = valores[i] & selecao;
+        contagem += mascara[i];
+        soma += valor;
+        minimo = std::min(minimo, valor | (INT32_MAX & ~selecao));
+        maximo = std::max(maximo, valor | (INT32_MIN & ~selecao));
+    }
+    combinar(agregado, contagem, soma, minimo, maximo);
+}
+
+static size_t contarBloco(const uint8_t* mascara, size_t n) {
+    uint32_t contagem = 0;
+    for (size_t i = 0; i < n; ++i) {
+        contagem += mascara[i];
+    }
+    return contagem;
+}
+
+// ============================================================================
+// ATUALIZACAO
+// ============================================================================
+void AnaliseColunar::definir(int id, int tempo, int porcoes, int nota, bool feita, std::string_view categoria) {
+    auto codigo = codigoPorCategoria.find(std::string(categoria));
+    if (codigo == codigoPorCategoria.end()) {
+        codigo = codigoPorCategoria.emplace(std::string(categoria), static_cast<int32_t>(nomesCategorias.size())).first;
+        nomesCategorias.emplace_back(categoria);
+    }
+
+    auto existente = posicaoPorId.find(id);
+    uint32_t posicao;
+    if (existente != posicaoPorId.end()) {
+        posicao = existente->second;
+    } else {
+        posicao = static_cast<uint32_t>(ids.size());
+        posicaoPorId.emplace(id, posicao);
+        ids.push_back(id);
+        tempos.push_back(0);
+        this->porcoes.push_back(0);
+        notas.push_back(0);
+        feitas.push_back(0);
+        categorias.push_back(0);
+    }
+    tempos[posicao] = tempo;
+    this->porcoes[posicao] = porcoes;
+    notas[posicao] = nota;
+    feitas[posicao] = feita ? 1 : 0;
+    categorias[posicao] = codigo->second;
+}
+
+void AnaliseColunar::remover(int id) {
+    auto existente = posicaoPorId.find(id);
+    if (existente == posicaoPorId.end()) {
+        return;
+    }
+    uint32_t posicao = existente->second;
+    uint32_t ultima = static_cast<uint32_t>(ids.size() - 1);
+    posicaoPorId.erase(existente);
+    if (posicao != ultima) {
+        ids[posicao] = ids[ultima];
+        tempos[posicao] = tempos[ultima];
+        porcoes[posicao] = porcoes[ultima];
+        notas[posicao] = notas[ultima];
+        feitas[posicao] = feitas[ultima];
+        categorias[posicao] = categorias[ultima];
+        posicaoPorId[ids[posicao]] = posicao;
+    }
+    ids.pop_back();
+    tempos.pop_back();
+    porcoes.pop_back();
+    notas.pop_back();
+    feitas.pop_back();
+    categorias.pop_back();
+}
+
+void AnaliseColunar::limpar() {
+    ids.clear();
+    tempos.clear();
+    porcoes.clear();
+    notas.clear();
+    feitas.clear();
+    categorias.clear();
+    posicaoPorId.clear();
+    nomesCategorias.clear();
+    codigoPorCategoria.clear();
+}
+
+void AnaliseColunar::reservar(size_t receitas) {
+    ids.reserve(receitas);
+    tempos.reserve(receitas);
+    porcoes.reserve(receitas);
+    notas.reserve(receitas);
+    feitas.reserve(receitas);
+    categorias.reserve(receitas);
+    posicaoPorId.reserve(receitas);
+}
+
+// ============================================================================
+// FILTROS
+// ============================================================================
+const int32_t* AnaliseColunar::coluna(ColunaAnalise coluna) const {
+    switch (coluna) {
+        case ColunaAnalise::Tempo: return tempos.data();
+        case ColunaAnalise::Porcoes: return porcoes.data();
+        case ColunaAnalise::Nota: return notas.data();
+        case ColunaAnalise::Feita: return feitas.data();
+    }
+    return tempos.data();
+}
+
+bool AnaliseColunar::codigoCategoria(const FiltroAnalise& filtro, int32_t& codigo) const {
+    codigo = -1;
+    if (filtro.categoria.empty()) {
+        return true;
+    }
+    auto encontrado = codigoPorCategoria.find(filtro.categoria);
+    if (encontrado == codigoPorCategoria.end()) {
+        return false;
+    }
+    codigo = encontrado->second;
+    return true;
+}
+
+bool AnaliseColunar::filtrarBloco(const FiltroAnalise& filtro, size_t inicio, size_t n, uint8_t* mascara) const {
+    std::fill(mascara, mascara + n, static_cast<uint8_t>(1));
+    int32_t codigo;
+    if (!codigoCategoria(filtro, codigo)) {
+        return false;
+    }
+    // So os filtros ativos custam uma passada
+    if (codigo >= 0) {
+        filtrarFaixa(categorias.data() + inicio, n, codigo, codigo, mascara);
+    }
+    if (filtro.notaMinima > 0 || filtro.notaMaxima < 5) {
+        filtrarFaixa(notas.data() + inicio, n, filtro.notaMinima, filtro.notaMaxima, mascara);
+    }
+    if (filtro.tempoMinimo != INT_MIN || filtro.tempoMaximo != INT_MAX) {
+        filtrarFaixa(tempos.data() + inicio, n, filtro.tempoMinimo, filtro.tempoMaximo, mascara);
+    }
+    if (filtro.feita >= 0) {
+        filtrarFaixa(feitas.data() + inicio, n, filtro.feita, filtro.feita, mascara);
+    }
+    return true;
+}
+
+template <typename Funcao>
+void AnaliseColunar::porBloco(const FiltroAnalise& filtro, Funcao fn) const {
+    uint8_t mascara[TAMANHO_BLOCO];
+    for (size_t inicio = 0; inicio < ids.size(); inicio += TAMANHO_BLOCO) {
+        size_t n = std::min(TAMANHO_BLOCO, ids.size() - inicio);
+        if (!filtrarBloco(filtro, inicio, n, mascara)) {
+            return;
+        }
+        fn(inicio, n, mascara);
+    }
+}
+
+// ============================================================================
+// AGREGACOES
+// ============================================================================
+size_t AnaliseColunar::contar(const FiltroAnalise& filtro) const {
+    size_t contagem = 0;
+    porBloco(filtro, [&](size_t, size_t n, const uint8_t* mascara) {
+        contagem += contarBloco(mascara, n);
+    });
+    return contagem;
+}
+
+Agregado AnaliseColunar::agregar(ColunaAnalise coluna, const FiltroAnalise& filtro) const {
+    Agregado agregado;
+    const int32_t* valores = this->coluna(coluna);
+    porBloco(filtro, [&](size_t inicio, size_t n, const uint8_t* mascara) {
+        agregarBloco(valores + inicio, mascara, n, agregado);
+    });
+    return agregado;
+}
+
+std::vector<size_t> AnaliseColunar::histograma(ColunaAnalise coluna, const FiltroAnalise& filtro, int largura,
+                                               size_t baldes) const {
+    std::vector<size_t> contagens(baldes, 0);
+    if (baldes == 0 || largura <= 0) {
+        return contagens;
+    }
+    const int32_t* valores = this->coluna(coluna);
+    int32_t ultimo = static_cast<int32_t>(std::min(baldes - 1, static_cast<size_t>(INT32_MAX)));
+    porBloco(filtro, [&](size_t inicio, size_t n, const uint8_t* mascara) {
+        for (size_t i = 0; i < n; ++i) {
+            int32_t balde = std::clamp(valores[inicio + i] / largura, 0, ultimo);
+            contagens[balde] += mascara[i];
+        }
+    });
+    return contagens;
+}
+
+std::vector<GrupoCategoria> AnaliseColunar::agruparPorCategoria(ColunaAnalise coluna,
+                                                                const FiltroAnalise& filtro) const {
+    size_t total = nomesCategorias.size();
+    std::vector<uint32_t> contagens(total, 0);
+    std::vector<int64_t> somas(total, 0);
+    std::vector<int32_t> minimos(total, INT32_MAX);
+    std::vector<int32_t> maximos(total, INT32_MIN);
+    const int32_t* valores = this->coluna(coluna);
+    porBloco(filtro, [&](size_t inicio, size_t n, const uint8_t* mascara) {
+        for (size_t i = 0; i < n; ++i) {
+            int32_t codigo = categorias[inicio + i];
+            int32_t selecao = -static_cast<int32_t>(mascara[i]);
+            int32_t valor = valores[inicio + i] & selecao;
+            contagens[codigo] += mascara[i];
+            somas[codigo] += valor;
+            minimos[codigo] = std::min(minimos[codigo], valor | (INT32_MAX & ~selecao));
+            maximos[codigo] = std::max(maximos[codigo], valor | (INT32_MIN & ~selecao));
+        }
+    });
+
+    std::vector<GrupoCategoria> grupos;
+    for (size_t codigo = 0; codigo < total; ++codigo) {
+        if (contagens[codigo] == 0) {
+            continue;
+        }
+        GrupoCategoria grupo;
+        grupo.categoria = nomesCategorias[codigo];
+        combinar(grupo.agregado, contagens[codigo], somas[codigo], minimos[codigo], maximos[codigo]);
+        grupos.push_back(std::move(grupo));
+    }
+    std::sort(grupos.begin(), grupos.end(),
+              [](const GrupoCategoria& a, const GrupoCategoria& b) { return a.categoria < b.categoria; });
+    return grupos;
+}
@@ -0,0 +1,467 @@
+// ============================================================================
+// INCLUDES
+// ============================================================================
+#include "../include/ArmazemImagens.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ============================================================================
+// SHA-256 (FIPS 180-4)
+// ============================================================================
+namespace {
+
+const uint32_t CONSTANTES[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+inline uint32_t rotacionar(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+// Hash incremental: atualizar() quantas vezes for preciso e hex() uma vez
+class Sha256 {
+public:
+    void atualizar(const unsigned char* dados, size_t n) {
+        total += n;
+        if (usados > 0) {
+            size_t parte = std::min(n, sizeof(bloco) - usados);
+            std::memcpy(bloco + usados, dados, parte);
+            usados += parte;
+            dados += parte;
+            n -= parte;
+            if (usados < sizeof(bloco)) {
+                return;
+            }
+            processar(bloco);
+            usados = 0;
+        }
+        for (; n >= sizeof(bloco); dados += sizeof(bloco), n -= sizeof(bloco)) {
+            processar(dados);
+        }
+        std::memcpy(bloco, dados, n);
+        usados = n;
+    }
+
+    std::string hex() {
+        uint64_t bits = total * 8;
+        unsigned char preenchimento[72] = {0x80};
+        size_t tamanho = (usados < 56 ? 56 - usados : 120 - usados);
+        for (int i = 0; i < 8; ++i) {
+            preenchimento[tamanho + i] = static_cast<unsigned char>(bits >> (56 - 8 * i));
+        }
+        atualizar(preenchimento, tamanho + 8);
+
+        static const char DIGITOS[] = "0123456789abcdef";
+        std::string saida;
+        saida.reserve(ArmazemImagens::TAMANHO_HASH);
+        for (uint32_t palavra : estado) {
+            for (int deslocamento = 28; deslocamento >= 0; deslocamento -= 4) {
+                saida += DIGITOS[(palavra >> deslocamento) & 0xF];
+            }
+        }
+        return saida;
+    }
+
+private:
+    void processar(const unsigned char* p) {
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = (uint32_t(p[4 * i]) << 24) | (uint32_t(p[4 * i + 1]) << 16) | (uint32_t(p[4 * i + 2]) << 8) | p[4 * i + 3];
+        }
+        for (int i = 16; i < 64; ++i) {
+            uint32_t s0 = rotacionar(w[i - 15], 7) ^ rotacionar(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotacionar(w[i - 2], 17) ^ rotacionar(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = estado[0], b = estado[1], c = estado[2], d = estado[3];
+        uint32_t e = estado[4], f = estado[5], g = estado[6], h = estado[7];
+        for (int i = 0; i < 64; ++i) {
+            uint32_t t1 = h + (rotacionar(e, 6) ^ rotacionar(e, 11) ^ rotacionar(e, 25)) + ((e & f) ^ (~e & g)) +
+                          CONSTANTES[i] + w[i];
+            uint32_t t2 = (rotacionar(a, 2) ^ rotacionar(a, 13) ^ rotacionar(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        estado[0] += a;
+        estado[1] += b;
+        estado[2] += c;
+        estado[3] += d;
+        estado[4] += e;
+        estado[5] += f;
+        estado[6] += g;
+        estado[7] += h;
+    }
+
+    uint32_t estado[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                          0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    unsigned char bloco[64];
+    size_t usados = 0;
+    uint64_t total = 0;
+};
+
+bool escreverTudo(int fd, const unsigned char* dados, size_t n) {
+    while (n > 0) {
+        ssize_t escritos = ::write(fd, dados, n);
+        if (escritos < 0 && errno == EINTR) {
+            continue;
+        }
+        if (escritos <= 0) {
+            return false;
+        }
+        dados += escritos;
+        n -= static_cast<size_t>(escritos);
+    }
+    return true;
+}
+
+// Le "origem" ate o fim, passando cada bloco pelo hash e, se destino >= 0,
+// gravando-o la
+bool copiarConteudo(int origem, int destino, Sha256& hash) {
+    unsigned char bloco[64 * 1024];
+    ssize_t lidos;
+    while ((lidos = ::read(origem, bloco, sizeof(bloco))) != 0) {
+        if (lidos < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        hash.atualizar(bloco, static_cast<size_t>(lidos));
+        if (destino >= 0 && !escreverTudo(destino, bloco, static_cast<size_t>(lidos))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// fsync do diretorio: torna duraveis as entradas criadas ou renomeadas nele
+bool sincronizarDiretorio(const std::string& caminho) {
+    int fd = ::open(caminho.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+// Nome temporario unico no proprio armazem (o rename final nao cruza sistemas de arquivos)
+std::string caminhoTemporario(const std::string& raiz) {
+    static std::atomic<uint64_t> contador{0};
+    return (std::filesystem::path(raiz) / (".tmp-" + std::to_string(::getpid()) + "-" +
+                                           std::to_string(contador.fetch_add(1)))).string();
+}
+
+} // namespace
+
+// ============================================================================
+// IMAGEM MAPEADA
+// ============================================================================
+ImagemMapeada::~ImagemMapeada() {
+    if (dados) {
+        munmap(dados, tamanho);
+    }
+}
+
+ImagemMapeada::ImagemMapeada(ImagemMapeada&& outra) noexcept
+    : dados(outra.dados), tamanho(outra.tamanho), aberto(outra.aberto) {
+    outra.dados = nullptr;
+    outra.tamanho = 0;
+    outra.aberto = false;
+}
+
+ImagemMapeada& ImagemMapeada::operator=(ImagemMapeada&& outra) noexcept {
+    if (this != &outra) {
+        if (dados) {
+            munmap(dados, tamanho);
+        }
+        dados = outra.dados;
+        tamanho = outra.tamanho;
+        aberto = outra.aberto;
+        outra.dados = nullptr;
+        outra.tamanho = 0;
+        outra.aberto = false;
+    }
+    return *this;
+}
+
+// ============================================================================
+// REFERENCIAS E CAMINHOS
+// ============================================================================
+ArmazemImagens::ArmazemImagens(const std::string& raiz) : raiz(raiz) {}
+
+bool ArmazemImagens::hashValido(std::string_view hash) {
+    return hash.size() == TAMANHO_HASH &&
+           std::all_of(hash.begin(), hash.end(), [](char c) { return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'); });
+}
+
+std::string_view ArmazemImagens::hashDaReferencia(std::string_view imagem) {
+    if (imagem.substr(0, PREFIXO.size()) != PREFIXO || !hashValido(imagem.substr(PREFIXO.size()))) {
+        return {};
+    }
+    return imagem.substr(PREFIXO.size());
+}
+
+std::string ArmazemImagens::sha256(std::string_view dados) {
+    Sha256 hash;
+    hash.atualizar(reinterpret_cast<const unsigned char*>(dados.data()), dados.size());
+    return hash.hex();
+}
+
+const char* ArmazemImagens::tipoMime(const unsigned char* dados, size_t tamanho) {
+    if (tamanho >= 8 && std::memcmp(dados, "\x89PNG\r\n\x1a\n", 8) == 0) {
+        return "image/png";
+    }
+    if (tamanho >= 3 && dados[0] == 0xFF && dados[1] == 0xD8 && dados[2] == 0xFF) {
+        return "image/jpeg";
+    }
+    if (tamanho >= 6 && (std::memcmp(dados, "GIF87a", 6) == 0 || std::memcmp(dados, "GIF89a", 6) == 0)) {
+        return "image/gif";
+    }
+    if (tamanho >= 12 && std::memcmp(dados, "RIFF", 4) == 0 && std::memcmp(dados + 8, "WEBP", 4) == 0) {
+        return "image/webp";
+    }
+    return "application/octet-stream";
+}
+
+// Dois niveis (ab/cdef...) para nao acumular milhares de arquivos em um so diretorio
+std::string ArmazemImagens::caminhoDe(std::string_view hash) const {
+    if (!hashValido(hash)) {
+        return "";
+    }
+    return (std::filesystem::path(raiz) / std::string(hash.substr(0, 2)) / std::string(hash.substr(2))).string();
+}
+
+bool ArmazemImagens::contem(std::string_view hash) const {
+    std::string caminho = caminhoDe(hash);
+    std::error_code erro;
+    return !caminho.empty() && std::filesystem::is_regular_file(caminho, erro);
+}
+
+// ============================================================================
+// GRAVACAO
+// ============================================================================
+std::string ArmazemImagens::guardarArquivo(const std::string& caminho) {
+    int origem = ::open(caminho.c_str(), O_RDONLY);
+    if (origem < 0) {
+        std::cerr << "Erro ao abrir imagem: " << caminho << std::endl;
+        return "";
+    }
+
+    // Primeiro so o hash: uma imagem que ja esta no armazem nao e copiada
+    Sha256 hash;
+    bool ok = copiarConteudo(origem, -1, hash);
+    std::string hex = hash.hex();
+    if (ok && contem(hex)) {
+        ::close(origem);
+        renovar(hex);
+        return referencia(hex);
+    }
+
+    std::error_code erro;
+    std::filesystem::create_directories(raiz, erro);
+    std::string temporario = caminhoTemporario(raiz);
+    int destino = ok && ::lseek(origem, 0, SEEK_SET) == 0 ? ::open(temporario.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644) : -1;
+    if (destino < 0) {
+        std::cerr << "Erro ao gravar imagem no armazem: " << caminho << std::endl;
+        ::close(origem);
+        return "";
+    }
+    // A copia e conferida contra o hash da primeira leitura (o arquivo pode
+    // ter mudado entre as duas)
+    Sha256 copiado;
+    ok = copiarConteudo(origem, destino, copiado) && copiado.hex() == hex && ::fsync(destino) == 0;
+    ::close(destino);
+    ::close(origem);
+
+    if (!ok || !publicar(temporario, hex)) {
+        std::filesystem::remove(temporario, erro);
+        std::cerr << "Erro ao gravar imagem no armazem: " << caminho << std::endl;
+        return "";
+    }
+    return referencia(hex);
+}
+
+std::string ArmazemImagens::guardarBytes(std::string_view dados) {
+    std::string hex = sha256(dados);
+    if (contem(hex)) {
+        renovar(hex);
+        return referencia(hex);
+    }
+    std::error_code erro;
+    std::filesystem::create_directories(raiz, erro);
+    std::string temporario = caminhoTemporario(raiz);
+    int destino = ::open(temporario.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+    bool ok = destino >= 0 && escreverTudo(destino, reinterpret_cast<const unsigned char*>(dados.data()), dados.size()) &&
+              ::fsync(destino) == 0;
+    if (destino >= 0) {
+        ::close(destino);
+    }
+    if (!ok || !publicar(temporario, hex)) {
+        std::filesystem::remove(temporario, erro);
+        std::cerr << "Erro ao gravar imagem no armazem: " << raiz << std::endl;
+        return "";
+    }
+    return referencia(hex);
+}
+
+// "temporario" (ja com fsync) vira o blob "hash"; as entradas de diretorio
+// novas tambem recebem fsync antes de a referencia ser entregue
+bool ArmazemImagens::publicar(const std::string& temporario, const std::string& hash) {
+    std::error_code erro;
+    std::string caminhoFinal = caminhoDe(hash);
+    std::filesystem::path prefixo = std::filesystem::path(caminhoFinal).parent_path();
+    bool prefixoNovo = std::filesystem::create_directories(prefixo, erro);
+    if (erro) {
+        return false;
+    }
+    if (prefixoNovo && !sincronizarDiretorio(raiz)) {
+        return false;
+    }
+    if (contem(hash)) {
+        // Outro processo gravou o mesmo conteudo nesse meio tempo
+        std::filesystem::remove(temporario, erro);
+        renovar(hash);
+        return true;
+    }
+    return ::rename(temporario.c_str(), caminhoFinal.c_str()) == 0 && sincronizarDiretorio(prefixo.string());
+}
+
+// Blob reaproveitado conta como recem-gravado para removerImagensSemUso
+void ArmazemImagens::renovar(std::string_view hash) {
+    std::string caminho = caminhoDe(hash);
+    if (!caminho.empty()) {
+        ::utimensat(AT_FDCWD, caminho.c_str(), nullptr, 0);
+    }
+}
+
+bool ArmazemImagens::recente(std::string_view hash, int segundos) const {
+    std::string caminho = caminhoDe(hash);
+    struct stat info;
+    if (caminho.empty() || ::stat(caminho.c_str(), &info) != 0) {
+        return false;
+    }
+    return std::time(nullptr) - info.st_mtime < segundos;
+}
+
+bool ArmazemImagens::remover(std::string_view hash) {
+    std::string caminho = caminhoDe(hash);
+    std::error_code erro;
+    return !caminho.empty() && std::filesystem::remove(caminho, erro);
+}
+
+// ============================================================================
+// LEITURA
+// ============================================================================
+ImagemMapeada ArmazemImagens::mapear(std::string_view hash) const {
+    ImagemMapeada imagem;
+    std::string caminho = caminhoDe(hash);
+    int fd = caminho.empty() ? -1 : ::open(caminho.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return imagem;
+    }
+    struct stat info;
+    if (fstat(fd, &info) == 0) {
+        imagem.tamanho = static_cast<size_t>(info.st_size);
+        imagem.aberto = true;
+        if (imagem.tamanho > 0) {
+            void* endereco = mmap(nullptr, imagem.tamanho, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (endereco == MAP_FAILED) {
+                imagem.tamanho = 0;
+                imagem.aberto = false;
+            } else {
+                imagem.dados = endereco;
+            }
+        }
+    }
+    ::close(fd);
+    return imagem;
+}
+
+std::vector<std::string> ArmazemImagens::listar() const {
+    std::vector<std::string> hashes;
+    std::error_code erro;
+    if (!std::filesystem::is_directory(raiz, erro)) {
+        return hashes;
+    }
+    for (const auto& prefixo : std::filesystem::directory_iterator(raiz, erro)) {
+        std::string nomePrefixo = prefixo.path().filename().string();
+        if (nomePrefixo.size() != 2 || !prefixo.is_directory(erro)) {
+            continue;
+        }
+        for (const auto& blob : std::filesystem::directory_iterator(prefixo.path(), erro)) {
+            std::string hash = nomePrefixo + blob.path().filename().string();
+            if (hashValido(hash) && blob.is_regular_file(erro)) {
+                hashes.push_back(std::move(hash));
+            }
+        }
+    }
+    std::sort(hashes.begin(), hashes.end());
+    return hashes;
+}
+
+bool ArmazemImagens::verificar(std::string_view hash) const {
+    ImagemMapeada imagem = mapear(hash);
+    if (!imagem.aberta()) {
+        return false;
+    }
+    Sha256 calculado;
+    calculado.atualizar(imagem.data(), imagem.size());
+    return calculado.hex() == hash;
+}
+
+// ============================================================================
+// COPIA INCREMENTAL
+// ============================================================================
+int ArmazemImagens::copiarPara(const std::string& destino) const {
+    ArmazemImagens alvo(destino);
+    std::error_code erro;
+    std::filesystem::create_directories(destino, erro);
+    int copiados = 0;
+    for (const auto& hash : listar()) {
+        if (alvo.contem(hash)) {
+            continue;   // mesmo nome = mesmo conteudo
+        }
+        std::string temporario = caminhoTemporario(destino);
+        int origem = ::open(caminhoDe(hash).c_str(), O_RDONLY);
+        int copia = origem >= 0 ? ::open(temporario.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644) : -1;
+        Sha256 copiado;
+        bool ok = copia >= 0 && copiarConteudo(origem, copia, copiado) && ::fsync(copia) == 0;
+        if (copia >= 0) {
+            ::close(copia);
+        }
+        if (origem >= 0) {
+            ::close(origem);
+        }
+        // Um blob corrompido na origem nao e propagado com o nome errado
+        if (!ok || copiado.hex() != hash || !alvo.publicar(temporario, hash)) {
+            std::cerr << "Erro ao copiar imagem " << hash << " para " << destino << std::endl;
+            std::filesystem::remove(temporario, erro);
+            return -1;
+        }
+        ++copiados;
+    }
+    return copiados;
+}
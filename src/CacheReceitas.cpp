@@ -0,0 +1,163 @@
+// ============================================================================
+// INCLUDES
+// ============================================================================
+#include "../include/CacheReceitas.h"
+#include "../include/Metricas.h"
+#include <iterator>
+
+// ============================================================================
+// CONSTRUTOR E CONFIGURACAO
+// ============================================================================
+CacheReceitas::CacheReceitas(size_t orcamentoBytes) : orcamentoBytes(orcamentoBytes), usados(0) {
+}
+
+void CacheReceitas::definirOrcamento(size_t bytes) {
+    orcamentoBytes = bytes;
+    despejarAte(orcamentoBytes);
+}
+
+// Tamanho aproximado em memoria: objetos, buffers das strings e nos da lista/mapa
+size_t CacheReceitas::estimarBytes(const Receita& receita) {
+    size_t bytes = sizeof(Entrada) + 4 * sizeof(void*) + sizeof(std::pair<const int, void*>) + 2 * sizeof(void*);
+    bytes += receita.nome.capacity() + receita.ingredientes.capacity() + receita.preparo.capacity() +
+             receita.categoria.capacity() + receita.imagem.capacity();
+    bytes += receita.ingredientesEstruturados.capacity() * sizeof(Ingrediente);
+    for (const auto& ing : receita.ingredientesEstruturados) {
+        bytes += ing.nome.capacity() + ing.unidade.capacity();
+    }
+    bytes += receita.tags.capacity() * sizeof(std::string);
+    for (const auto& tag : receita.tags) {
+        bytes += tag.capacity();
+    }
+    return bytes;
+}
+
+// ============================================================================
+// OPERACOES
+// ============================================================================
+bool CacheReceitas::obter(int id, Receita& saida) {
+    ContadoresCache& contadores = Metricas::global().cache();
+    auto it = indice.find(id);
+    if (it == indice.end()) {
+        contadores.falhas.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    ordem.splice(ordem.begin(), ordem, it->second);
+    saida = it->second->receita;
+    contadores.acertos.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void CacheReceitas::inserir(const Receita& receita) {
+    if (orcamentoBytes == 0 || receita.id == 0) {
+        return;
+    }
+    invalidar(receita.id);
+
+    size_t bytes = estimarBytes(receita);
+    if (bytes > orcamentoBytes) {
+        return;
+    }
+    despejarAte(orcamentoBytes - bytes);
+    ordem.push_front(Entrada{receita, bytes});
+    indice[receita.id] = ordem.begin();
+    usados += bytes;
+}
+
+void CacheReceitas::invalidar(int id) {
+    auto it = indice.find(id);
+    if (it == indice.end()) {
+        return;
+    }
+    usados -= it->second->bytes;
+    ordem.erase(it->second);
+    indice.erase(it);
+    Metricas::global().cache().invalidacoes.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CacheReceitas::limpar() {
+    if (!indice.empty()) {
+        Metricas::global().cache().invalidacoes.fetch_add(indice.size(), std::memory_order_relaxed);
+    }
+    ordem.clear();
+    indice.clear();
+    usados = 0;
+}
+
+void CacheReceitas::despejarAte(size_t limite) {
+    while (usados > limite && !ordem.empty()) {
+        usados -= ordem.back().bytes;
+        indice.erase(ordem.back().receita.id);
+        ordem.pop_back();
+        Metricas::global().cache().despejos.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// ============================================================================
+// CACHE DE CONSULTAS
+// ============================================================================
+CacheConsultas::CacheConsultas(size_t orcamentoBytes) : orcamentoBytes(orcamentoBytes), usados(0) {
+}
+
+void CacheConsultas::definirOrcamento(size_t bytes) {
+    orcamentoBytes = bytes;
+    despejarAte(orcamentoBytes);
+}
+
+CacheConsultas::Resultado CacheConsultas::obter(const std::string& chave, uint64_t geracao) {
+    ContadoresCache& contadores = Metricas::global().cache();
+    auto it = indice.find(chave);
+    if (it == indice.end() || it->second->geracao != geracao) {
+        if (it != indice.end()) {
+            remover(it->second);
+            contadores.invalidacoes.fetch_add(1, std::memory_order_relaxed);
+        }
+        contadores.consultasFalhas.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    ordem.splice(ordem.begin(), ordem, it->second);
+    contadores.consultasAcertos.fetch_add(1, std::memory_order_relaxed);
+    return it->second->resultado;
+}
+
+void CacheConsultas::inserir(const std::string& chave, uint64_t geracao, Resultado resultado) {
+    if (orcamentoBytes == 0 || !resultado) {
+        return;
+    }
+    auto existente = indice.find(chave);
+    if (existente != indice.end()) {
+        remover(existente->second);
+    }
+
+    size_t bytes = sizeof(Entrada) + 2 * chave.capacity() + 6 * sizeof(void*) +
+                   resultado->capacity() * sizeof(Receita);
+    for (const auto& receita : *resultado) {
+        bytes += CacheReceitas::estimarBytes(receita) - sizeof(Receita);
+    }
+    if (bytes > orcamentoBytes) {
+        return;
+    }
+    despejarAte(orcamentoBytes - bytes);
+    ordem.push_front(Entrada{chave, geracao, std::move(resultado), bytes});
+    indice[chave] = ordem.begin();
+    usados += bytes;
+}
+
+void CacheConsultas::limpar() {
+    ordem.clear();
+    indice.clear();
+    usados = 0;
+}
+
+void CacheConsultas::remover(std::list<Entrada>::iterator it) {
+    usados -= it->bytes;
+    indice.erase(it->chave);
+    ordem.erase(it);
+}
+
+void CacheConsultas::despejarAte(size_t limite) {
+    while (usados > limite && !ordem.empty()) {
+        remover(std::prev(ordem.end()));
+        Metricas::global().cache().despejos.fetch_add(1, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,1267 @@
+// ============================================================================
+// INCLUDES
+// ============================================================================
+#include "../include/Comandos.h"
+#include "../include/ArmazemImagens.h"
+#include "../include/Database.h"
+#include "../include/LogConsultasLentas.h"
+#include "../include/Metricas.h"
+#include "../include/Renderizador.h"
+#include "../include/ServidorHttp.h"
+#include "../include/SnapshotVault.h"
+#include <algorithm>
+#include <csignal>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ============================================================================
+// AUXILIARES
+// ============================================================================
+namespace {
+
+struct OpcoesGlobais {
+    std::string caminhoDb = "./data/recipes.db";
+    FormatoSaida formato = FormatoSaida::Tabela;
+    std::string arquivoLote;
+    double limiarLentasMs = 100;
+    std::string arquivoLentas;
+    int leitores = 0;
+    LimitesConsulta limites;
+};
+
+void exibirAjuda() {
+    std::cout <<
+        "Uso: cookbook [--db caminho] [--formato tabela|json|ndjson] <comando> [args]\n"
+        "     cookbook [--db caminho] --batch arquivo   (\"-\" le da entrada padrao)\n"
+        "     [--lentas-ms N] [--lentas-log arquivo]   (log de consultas lentas; -1 desliga)\n"
+        "     [--leitores N]   (conexoes paralelas para carregar listagens grandes)\n"
+        "     [--prazo-ms N] [--max-linhas N]   (limites de cada listagem; 0 = sem limite)\n"
+        "\n"
+        "Comandos:\n"
+        "  add <nome> [--preparo T] [--tempo N] [--categoria C] [--porcoes N]\n"
+        "      [--ingredientes texto] [--ingrediente \"qtd unidade nome\"]...\n"
+        "      [--tag nome]... [--imagem arquivo] [--feita]   (a imagem vai para o armazem)\n"
+        "  edit <id> [--nome N] [mesmas opcoes de add] [--nao-feita] [--sem-tags]\n"
+        "      (--ingrediente/--tag substituem as listas)\n"
+        "  get <id>\n"
+        "  search [trecho do nome] [--tag nome] [--nota N] [--feitas] [--alteradas-desde ms]\n"
+        "  tag <id> add|remove <tag>...\n"
+        "  tags add|remove <tag>... [--busca T] [--tag nome] [--nota N] [--feitas]\n"
+        "  tags merge <origem> <destino> | tags rename <atual> <novo> | tags prune\n"
+        "  compras <id>[:porcoes]...   (lista de compras somada e convertida)\n"
+        "  similares <id> [k]   (receitas parecidas em ingredientes e tags)\n"
+        "  dedup [--distancia N] [--mesclar]   (grupos de receitas quase iguais)\n"
+        "  analise [--categoria C] [--nota N] [--feitas|--nao-feitas] [--tempo-max N]\n"
+        "      [--por-categoria] [--histograma tempo|porcoes|nota [--largura N]]\n"
+        "  imagens importar|gc|verificar|info   (armazem de imagens por conteudo)\n"
+        "  alteracoes [--desde seq] [--limite N]   (log de alteracoes para sincronizar)\n"
+        "  alteracoes descartar <seq>   (apaga o log ate seq, inclusive)\n"
+        "  rate <id> <nota 1-5>\n"
+        "  done <id> [sim|nao]\n"
+        "  backup <caminho>\n"
+        "  snapshot <arquivo>   (snapshot binario somente leitura do vault)\n"
+        "  snapshot-info <arquivo> [id]   (le o snapshot sem abrir o banco)\n"
+        "  restore <caminho>\n"
+        "  stats [--zerar]   (metricas de latencia e SQL deste processo)\n"
+        "  lentas            (consultas lentas recentes deste processo)\n"
+        "  serve [--porta N] [--endereco A] [--trabalhadores N] [--backups dir] [--prazo-ms N]\n"
+        "\n"
+        "Sem comando, abre o menu interativo. Em --batch cada linha e um comando;\n"
+        "todas rodam em uma unica transacao, desfeita ao primeiro erro.\n";
+}
+
+bool lerInteiro(const std::string& texto, int& valor) {
+    const char* fim = texto.data() + texto.size();
+    auto resultado = std::from_chars(texto.data(), fim, valor);
+    return resultado.ec == std::errc() && resultado.ptr == fim;
+}
+
+bool lerInteiro(const std::string& texto, int64_t& valor) {
+    const char* fim = texto.data() + texto.size();
+    auto resultado = std::from_chars(texto.data(), fim, valor);
+    return resultado.ec == std::errc() && resultado.ptr == fim;
+}
+
+// Divide uma linha de lote em argumentos, respeitando aspas e barra invertida
+bool dividirArgumentos(const std::string& linha, std::vector<std::string>& args) {
+    std::string atual;
+    bool emToken = false;
+    char aspas = 0;
+
+    for (size_t i = 0; i < linha.size(); ++i) {
+        char c = linha[i];
+        if (aspas) {
+            if (c == aspas) {
+                aspas = 0;
+            } else if (c == '\\' && aspas == '"' && i + 1 < linha.size()) {
+                atual += linha[++i];
+            } else {
+                atual += c;
+            }
+        } else if (c == '"' || c == '\'') {
+            aspas = c;
+            emToken = true;
+        } else if (c == '\\' && i + 1 < linha.size()) {
+            atual += linha[++i];
+            emToken = true;
+        } else if (c == ' ' || c == '\t' || c == '\r') {
+            if (emToken) {
+                args.push_back(atual);
+                atual.clear();
+                emToken = false;
+            }
+        } else if (c == '#' && !emToken) {
+            break;
+        } else {
+            atual += c;
+            emToken = true;
+        }
+    }
+
+    if (emToken) {
+        args.push_back(atual);
+    }
+    return aspas == 0;
+}
+
+// "2 xicaras farinha" ou "3 ovos"
+bool lerIngrediente(const std::string& texto, Ingrediente& ingrediente) {
+    std::istringstream iss(texto);
+    double quantidade = 0.0;
+    std::string unidade;
+    std::string nome;
+
+    if (!(iss >> quantidade >> unidade)) {
+        return false;
+    }
+    std::getline(iss, nome);
+    nome.erase(0, nome.find_first_not_of(" \t"));
+    if (nome.empty()) {
+        nome = unidade;
+        unidade = "unidade";
+    }
+
+    ingrediente = Ingrediente(nome, quantidade, unidade);
+    return true;
+}
+
+bool adicionarTags(Database& db, int receitaId, const std::vector<std::string>& tags) {
+    for (const auto& tag : tags) {
+        int tagId = db.createTag(tag);
+        if (tagId <= 0) {
+            return false;
+        }
+        db.addTagToReceita(receitaId, tagId);
+    }
+    return true;
+}
+
+// --imagem com caminho de arquivo: o arquivo vai para o armazem e a receita
+// guarda a referencia "sha256:..."
+bool guardarImagem(Database& db, Receita& receita) {
+    if (receita.imagem.empty() || !ArmazemImagens::hashDaReferencia(receita.imagem).empty()) {
+        return true;
+    }
+    std::string referencia = db.imagens().guardarArquivo(receita.imagem);
+    if (referencia.empty()) {
+        return false;
+    }
+    receita.imagem = referencia;
+    return true;
+}
+
+// ============================================================================
+// SUBCOMANDOS
+// ============================================================================
+// Opcoes de receita comuns a add e edit, a partir de args[inicio]; so o
+// edit passa "semTags" (e aceita --nao-feita e --sem-tags)
+bool lerOpcoesReceita(const std::vector<std::string>& args, size_t inicio, Receita& receita,
+                      std::vector<std::string>& tags, std::vector<Ingrediente>& ingredientes,
+                      bool* semTags = nullptr) {
+    for (size_t i = inicio; i < args.size(); ++i) {
+        const std::string& opcao = args[i];
+        if (opcao == "--feita") {
+            receita.feita = true;
+            continue;
+        }
+        if (semTags && opcao == "--nao-feita") {
+            receita.feita = false;
+            continue;
+        }
+        if (semTags && opcao == "--sem-tags") {
+            *semTags = true;
+            continue;
+        }
+        if (i + 1 >= args.size()) {
+            std::cerr << "Valor ausente para " << opcao << std::endl;
+            return false;
+        }
+        const std::string& valor = args[++i];
+
+        if (opcao == "--nome") {
+            receita.nome = valor;
+        } else if (opcao == "--preparo") {
+            receita.preparo = valor;
+        } else if (opcao == "--categoria") {
+            receita.categoria = valor;
+        } else if (opcao == "--ingredientes") {
+            receita.ingredientes = valor;
+        } else if (opcao == "--imagem") {
+            receita.imagem = valor;
+        } else if (opcao == "--tag") {
+            tags.push_back(valor);
+        } else if (opcao == "--tempo" || opcao == "--porcoes") {
+            int numero = 0;
+            if (!lerInteiro(valor, numero)) {
+                std::cerr << "Numero invalido para " << opcao << ": " << valor << std::endl;
+                return false;
+            }
+            (opcao == "--tempo" ? receita.tempo : receita.porcoes) = numero;
+        } else if (opcao == "--ingrediente") {
+            Ingrediente ingrediente;
+            if (!lerIngrediente(valor, ingrediente)) {
+                std::cerr << "Ingrediente invalido (use \"qtd unidade nome\"): " << valor << std::endl;
+                return false;
+            }
+            ingredientes.push_back(ingrediente);
+        } else {
+            std::cerr << "Opcao desconhecida: " << opcao << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int comandoAdd(Database& db, const std::vector<std::string>& args) {
+    if (args.size() < 2) {
+        std::cerr << "Uso: add <nome> [opcoes]" << std::endl;
+        return 1;
+    }
+
+    Receita receita;
+    receita.nome = args[1];
+    std::vector<std::string> tags;
+
+    if (!lerOpcoesReceita(args, 2, receita, tags, receita.ingredientesEstruturados)) {
+        return 1;
+    }
+
+    if (!receita.ingredientesEstruturados.empty()) {
+        receita.atualizarIngredientesString();
+    }
+    if (!guardarImagem(db, receita)) {
+        return 1;
+    }
+
+    int receitaId = db.cadastrarReceita(receita);
+    if (receitaId <= 0 || !adicionarTags(db, receitaId, tags)) {
+        return 1;
+    }
+
+    std::cout << receitaId << "\n";
+    return 0;
+}
+
+// Altera so as opcoes informadas; --ingrediente e --tag substituem as listas
+int comandoEdit(Database& db, const std::vector<std::string>& args) {
+    int id = 0;
+    if (args.size() < 3 || !lerInteiro(args[1], id)) {
+        std::cerr << "Uso: edit <id> [opcoes]" << std::endl;
+        return 1;
+    }
+
+    Receita receita = db.consultarPorId(id);
+    if (receita.id == 0) {
+        std::cerr << "Receita nao encontrada." << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> tags;
+    std::vector<Ingrediente> ingredientes;
+    bool semTags = false;
+    std::string imagemAnterior = receita.imagem;
+    if (!lerOpcoesReceita(args, 2, receita, tags, ingredientes, &semTags)) {
+        return 1;
+    }
+    if (receita.imagem != imagemAnterior && !guardarImagem(db, receita)) {
+        return 1;
+    }
+    if (!ingredientes.empty()) {
+        receita.ingredientesEstruturados = ingredientes;
+        receita.atualizarIngredientesString();
+    }
+    if (!tags.empty() || semTags) {
+        receita.tags = tags;
+    }
+
+    return db.atualizarReceita(receita) ? 0 : 1;
+}
+
+void exibirReceita(const Receita& receita, FormatoSaida formato) {
+    if (formato != FormatoSaida::Tabela) {
+        Renderizador saida(std::cout, formato == FormatoSaida::Json ? FormatoSaida::Ndjson : formato);
+        saida.definirCampos(CAMPOS_TODOS);
+        saida.linha(receita);
+        saida.finalizar();
+        return;
+    }
+
+    std::cout << "=== " << receita.nome << " ===\n"
+              << "ID: " << receita.id << "\n"
+              << "Categoria: " << receita.categoria << "\n"
+              << "Tempo: " << receita.tempo << " minutos\n"
+              << "Porcoes: " << receita.porcoes << "\n"
+              << "Feita: " << (receita.feita ? "Sim" : "Nao") << "\n";
+    if (receita.nota > 0) {
+        std::cout << "Nota: " << receita.nota << "/5\n";
+    }
+    if (!receita.imagem.empty()) {
+        std::cout << "Imagem: " << receita.imagem << "\n";
+    }
+    if (!receita.tags.empty()) {
+        std::cout << "Tags: ";
+        for (size_t i = 0; i < receita.tags.size(); ++i) {
+            std::cout << (i > 0 ? ", " : "") << receita.tags[i];
+        }
+        std::cout << "\n";
+    }
+    std::cout << "\nIngredientes:\n" << receita.ingredientes << "\n"
+              << "\nModo de Preparo:\n" << receita.preparo << "\n";
+}
+
+int comandoGet(Database& db, const std::vector<std::string>& args, FormatoSaida formato) {
+    int id = 0;
+    if (args.size() != 2 || !lerInteiro(args[1], id)) {
+        std::cerr << "Uso: get <id>" << std::endl;
+        return 1;
+    }
+
+    Receita receita = db.consultarPorId(id);
+    if (receita.id == 0) {
+        std::cerr << "Receita nao encontrada." << std::endl;
+        return 1;
+    }
+    exibirReceita(receita, formato);
+    return 0;
+}
+
+int comandoSnapshotInfo(const std::vector<std::string>& args, FormatoSaida formato) {
+    int id = 0;
+    if (args.size() < 2 || args.size() > 3 || (args.size() == 3 && !lerInteiro(args[2], id))) {
+        std::cerr << "Uso: snapshot-info <arquivo> [id]" << std::endl;
+        return 1;
+    }
+
+    auto inicio = std::chrono::steady_clock::now();
+    SnapshotVault snapshot;
+    if (!snapshot.abrir(args[1])) {
+        return 1;
+    }
+    double microssegundos = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - inicio).count();
+
+    if (args.size() == 3) {
+        uint32_t indice = snapshot.indiceDe(id);
+        if (indice == SnapshotVault::NENHUM) {
+            std::cerr << "Receita nao encontrada." << std::endl;
+            return 1;
+        }
+        exibirReceita(snapshot[indice].paraReceita(), formato);
+        return 0;
+    }
+
+    size_t ingredientes = 0;
+    for (const auto& receita : snapshot) {
+        ingredientes += receita.numIngredientes();
+    }
+    std::cout << "Receitas: " << snapshot.size() << "\n"
+              << "Ingredientes: " << ingredientes << "\n"
+              << "Tags: " << snapshot.numTags() << "\n"
+              << "Categorias: " << snapshot.numCategorias() << "\n"
+              << "Tamanho: " << snapshot.bytes() << " bytes\n"
+              << "Aberto em " << microssegundos << " us" << std::endl;
+    return 0;
+}
+
+int comandoSearch(Database& db, const std::vector<std::string>& args, FormatoSaida formato) {
+    FiltroReceitas filtro;
+
+    for (size_t i = 1; i < args.size(); ++i) {
+        const std::string& opcao = args[i];
+        if (opcao == "--feitas") {
+            filtro.somenteFeitas = true;
+        } else if (opcao == "--tag" && i + 1 < args.size()) {
+            filtro.tag = args[++i];
+        } else if (opcao == "--nota" && i + 1 < args.size()) {
+            if (!lerInteiro(args[++i], filtro.nota) || filtro.nota < 1 || filtro.nota > 5) {
+                std::cerr << "Nota deve estar entre 1 e 5." << std::endl;
+                return 1;
+            }
+        } else if (opcao == "--alteradas-desde" && i + 1 < args.size()) {
+            if (!lerInteiro(args[++i], filtro.alteradasDesde) || filtro.alteradasDesde < 0) {
+                std::cerr << "--alteradas-desde espera ms desde a epoca." << std::endl;
+                return 1;
+            }
+        } else if (opcao.rfind("--", 0) == 0) {
+            std::cerr << "Opcao desconhecida: " << opcao << std::endl;
+            return 1;
+        } else {
+            filtro.nome = opcao;
+        }
+    }
+
+    Renderizador saida(std::cout, formato);
+    StatusConsulta status = StatusConsulta::Ok;
+    int linhas = db.forEachReceita(filtro, [&saida](const ReceitaLinha& r) {
+        saida.linha(r);
+        return true;
+    }, CAMPOS_LISTAGEM, &status);
+
+    if (linhas < 0) {
+        if (status == StatusConsulta::PrazoEsgotado) {
+            std::cerr << "Busca interrompida: prazo esgotado." << std::endl;
+        }
+        return 1;
+    }
+    if (linhas > 0 || formato != FormatoSaida::Tabela) {
+        saida.finalizar();
+    }
+    if (status == StatusConsulta::LimiteLinhas) {
+        std::cerr << "Resultado truncado em " << linhas << " linhas." << std::endl;
+    }
+    return 0;
+}
+
+int comandoTag(Database& db, const std::vector<std::string>& args) {
+    int receitaId = 0;
+    if (args.size() < 4 || !lerInteiro(args[1], receitaId) || (args[2] != "add" && args[2] != "remove")) {
+        std::cerr << "Uso: tag <id> add|remove <tag>..." << std::endl;
+        return 1;
+    }
+
+    if (db.consultarPorId(receitaId).id == 0) {
+        std::cerr << "Receita nao encontrada." << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> tags(args.begin() + 3, args.end());
+    if (args[2] == "add") {
+        return adicionarTags(db, receitaId, tags) ? 0 : 1;
+    }
+
+    // Uma leitura das tags para todos os nomes; nomes desconhecidos sao ignorados
+    std::unordered_map<std::string, int> idPorNome;
+    for (auto& tag : db.listAllTags()) {
+        idPorNome.emplace(std::move(tag.second), tag.first);
+    }
+    for (const auto& nome : tags) {
+        auto tag = idPorNome.find(nome);
+        if (tag != idPorNome.end()) {
+            db.removeTagFromReceita(receitaId, tag->second);
+        }
+    }
+    return 0;
+}
+
+// Operacoes sobre o conjunto de tags; add/remove valem para todas as receitas do filtro
+int comandoTags(Database& db, const std::vector<std::string>& args) {
+    const std::string acao = args.size() > 1 ? args[1] : "";
+
+    if ((acao == "merge" || acao == "rename") && args.size() == 4) {
+        bool ok = acao == "merge" ? db.mesclarTags(args[2], args[3]) : db.renomearTag(args[2], args[3]);
+        return ok ? 0 : 1;
+    }
+    if (acao == "prune" && args.size() == 2) {
+        int removidas = db.removerTagsSemUso();
+        if (removidas < 0) {
+            return 1;
+        }
+        std::cout << removidas << " tag(s) sem uso removida(s).\n";
+        return 0;
+    }
+    if (acao != "add" && acao != "remove") {
+        std::cerr << "Uso: tags add|remove <tag>... [--busca trecho] [--tag nome] [--nota N] [--feitas]\n"
+                  << "     tags merge <origem> <destino> | tags rename <atual> <novo> | tags prune" << std::endl;
+        return 1;
+    }
+
+    FiltroReceitas filtro;
+    std::vector<std::string> tags;
+    for (size_t i = 2; i < args.size(); ++i) {
+        const std::string& opcao = args[i];
+        if (opcao == "--feitas") {
+            filtro.somenteFeitas = true;
+        } else if (opcao == "--busca" && i + 1 < args.size()) {
+            filtro.nome = args[++i];
+        } else if (opcao == "--tag" && i + 1 < args.size()) {
+            filtro.tag = args[++i];
+        } else if (opcao == "--nota" && i + 1 < args.size()) {
+            if (!lerInteiro(args[++i], filtro.nota) || filtro.nota < 1 || filtro.nota > 5) {
+                std::cerr << "Nota deve estar entre 1 e 5." << std::endl;
+                return 1;
+            }
+        } else if (opcao.rfind("--", 0) == 0) {
+            std::cerr << "Opcao desconhecida: " << opcao << std::endl;
+            return 1;
+        } else {
+            tags.push_back(opcao);
+        }
+    }
+    if (tags.empty()) {
+        std::cerr << "Informe ao menos uma tag." << std::endl;
+        return 1;
+    }
+
+    int vinculos = acao == "add" ? db.adicionarTagsEmMassa(filtro, tags) : db.removerTagsEmMassa(filtro, tags);
+    if (vinculos < 0) {
+        return 1;
+    }
+    std::cout << vinculos << " vinculo(s) " << (acao == "add" ? "criado(s)" : "removido(s)") << ".\n";
+    return 0;
+}
+
+// compras 3 7:8 7:4  ->  receita 3 no rendimento original, 12 porcoes da receita 7
+int comandoCompras(Database& db, const std::vector<std::string>& args, FormatoSaida formato) {
+    std::vector<ItemPlano> plano;
+    for (size_t i = 1; i < args.size(); ++i) {
+        size_t separador = args[i].find(':');
+        ItemPlano item{0, 0};
+        int porcoes = 0;
+        if (!lerInteiro(args[i].substr(0, separador), item.receitaId) ||
+            (separador != std::string::npos && (!lerInteiro(args[i].substr(separador + 1), porcoes) || porcoes <= 0))) {
+            std::cerr << "Item invalido (use id ou id:porcoes): " << args[i] << std::endl;
+            return 1;
+        }
+        item.porcoes = porcoes;
+        plano.push_back(item);
+    }
+    if (plano.empty()) {
+        std::cerr << "Uso: compras <id>[:porcoes]..." << std::endl;
+        return 1;
+    }
+
+    std::vector<ItemCompra> lista = db.gerarListaCompras(plano);
+    std::string saida;
+    char quantidade[32];
+    for (const auto& item : lista) {
+        std::snprintf(quantidade, sizeof(quantidade), "%g", item.quantidade);
+        if (formato == FormatoSaida::Tabela) {
+            saida += std::string("- ") + quantidade + (item.unidade.empty() ? "" : " " + item.unidade) + " " +
+                     item.nome + "\n";
+            continue;
+        }
+        saida += formato == FormatoSaida::Json ? (saida.empty() ? "[" : ",") : "";
+        saida += "{\"nome\":";
+        Renderizador::anexarJsonString(saida, item.nome);
+        saida += std::string(",\"quantidade\":") + quantidade + ",\"unidade\":";
+        Renderizador::anexarJsonString(saida, item.unidade);
+        saida += formato == FormatoSaida::Json ? "}" : "}\n";
+    }
+    if (formato == FormatoSaida::Json) {
+        saida += saida.empty() ? "[]\n" : "]\n";
+    }
+    std::cout << saida;
+    return 0;
+}
+
+int comandoSimilares(Database& db, const std::vector<std::string>& args, FormatoSaida formato) {
+    int id = 0;
+    int k = 10;
+    if (args.size() < 2 || args.size() > 3 || !lerInteiro(args[1], id) ||
+        (args.size() == 3 && (!lerInteiro(args[2], k) || k <= 0))) {
+        std::cerr << "Uso: similares <id> [k]" << std::endl;
+        return 1;
+    }
+    if (db.consultarPorId(id).id == 0) {
+        std::cerr << "Receita nao encontrada." << std::endl;
+        return 1;
+    }
+
+    std::vector<ReceitaSimilar> vizinhos = db.similares(id, static_cast<size_t>(k));
+    std::string saida;
+    char similaridade[32];
+    for (const auto& vizinho : vizinhos) {
+        std::snprintf(similaridade, sizeof(similaridade), "%.2f", vizinho.similaridade);
+        std::string nome = db.consultarPorId(vizinho.id).nome;
+        if (formato == FormatoSaida::Tabela) {
+            saida += std::to_string(vizinho.id) + "  " + similaridade + "  " + nome + "\n";
+            continue;
+        }
+        saida += formato == FormatoSaida::Json ? (saida.empty() ? "[" : ",") : "";
+        saida += "{\"id\":" + std::to_string(vizinho.id) + ",\"similaridade\":" + similaridade + ",\"nome\":";
+        Renderizador::anexarJsonString(saida, nome);
+        saida += formato == FormatoSaida::Json ? "}" : "}\n";
+    }
+    if (formato == FormatoSaida::Json) {
+        saida += saida.empty() ? "[]\n" : "]\n";
+    }
+    std::cout << saida;
+    return 0;
+}
+
+int comandoDedup(Database& db, const std::vector<std::string>& args, FormatoSaida formato) {
+    int distancia = 4;
+    bool mesclar = false;
+    for (size_t i = 1; i < args.size(); ++i) {
+        if (args[i] == "--mesclar") {
+            mesclar = true;
+        } else if (args[i] == "--distancia" && i + 1 < args.size() && lerInteiro(args[i + 1], distancia) &&
+                   distancia >= 0 && distancia <= Deduplicador::DISTANCIA_MAXIMA) {
+            ++i;
+        } else {
+            std::cerr << "Uso: dedup [--distancia 0-" << Deduplicador::DISTANCIA_MAXIMA << "] [--mesclar]" << std::endl;
+            return 1;
+        }
+    }
+
+    // Com --mesclar, busca e fusoes ficam em uma transacao: ou todos os
+    // grupos sao mesclados ou nenhum
+    if (mesclar && !db.iniciarTransacao()) {
+        return 1;
+    }
+    // Grupos: a receita mais antiga (menor id) e a que fica ao mesclar
+    size_t baldesTruncados = 0;
+    std::vector<GrupoDuplicadas> grupos = db.encontrarDuplicadas(distancia, 0, &baldesTruncados);
+    if (baldesTruncados > 0) {
+        std::cerr << "Aviso: " << baldesTruncados << " balde(s) com mais de " << Deduplicador::BALDE_MAXIMO
+                  << " receitas; alguns pares podem nao ter sido comparados." << std::endl;
+    }
+    std::string saida;
+    for (const auto& grupo : grupos) {
+        std::string nome = db.consultarPorId(grupo.ids.front()).nome;
+        std::string ids;
+        for (size_t i = 0; i < grupo.ids.size(); ++i) {
+            ids += (i > 0 ? "," : "") + std::to_string(grupo.ids[i]);
+        }
+        if (formato == FormatoSaida::Tabela) {
+            saida += ids + "  (distancia " + std::to_string(grupo.distanciaMaxima) + ")  " + nome + "\n";
+            continue;
+        }
+        saida += formato == FormatoSaida::Json ? (saida.empty() ? "[" : ",") : "";
+        saida += "{\"ids\":[" + ids + "],\"distancia\":" + std::to_string(grupo.distanciaMaxima) + ",\"nome\":";
+        Renderizador::anexarJsonString(saida, nome);
+        saida += formato == FormatoSaida::Json ? "}" : "}\n";
+    }
+    if (formato == FormatoSaida::Json) {
+        saida += saida.empty() ? "[]\n" : "]\n";
+    }
+    std::cout << saida;
+
+    if (mesclar) {
+        size_t excluidas = 0;
+        for (const auto& grupo : grupos) {
+            std::vector<int> duplicadas(grupo.ids.begin() + 1, grupo.ids.end());
+            if (!db.mesclarReceitas(grupo.ids.front(), duplicadas)) {
+                db.desfazerTransacao();
+                return 1;
+            }
+            excluidas += duplicadas.size();
+        }
+        if (!db.confirmarTransacao()) {
+            return 1;
+        }
+        std::cerr << grupos.size() << " grupo(s) mesclado(s), " << excluidas << " receita(s) excluida(s)." << std::endl;
+    }
+    return 0;
+}
+
+// Linha de resumo de uma coluna: "min 5, media 42.10, max 180"
+std::string resumirAgregado(const Agregado& agregado, FormatoSaida formato) {
+    char media[32];
+    std::snprintf(media, sizeof(media), "%.2f", agregado.media());
+    if (formato == FormatoSaida::Tabela) {
+        return "min " + std::to_string(agregado.minimo) + ", media " + media + ", max " + std::to_string(agregado.maximo);
+    }
+    return "{\"min\":" + std::to_string(agregado.minimo) + ",\"media\":" + media + ",\"max\":" +
+           std::to_string(agregado.maximo) + "}";
+}
+
+// analise --categoria Doce --feitas --por-categoria --histograma tempo --largura 15
+int comandoAnalise(Database& db, const std::vector<std::string>& args, FormatoSaida formato) {
+    FiltroAnalise filtro;
+    bool porCategoria = false;
+    std::string colunaHistograma;
+    int largura = 0;
+    for (size_t i = 1; i < args.size(); ++i) {
+        const std::string& opcao = args[i];
+        int valor = 0;
+        if (opcao == "--feitas" || opcao == "--nao-feitas") {
+            filtro.feita = opcao == "--feitas" ? 1 : 0;
+        } else if (opcao == "--por-categoria") {
+            porCategoria = true;
+        } else if (opcao == "--categoria" && i + 1 < args.size()) {
+            filtro.categoria = args[++i];
+        } else if (opcao == "--nota" && i + 1 < args.size() && lerInteiro(args[i + 1], valor) && valor >= 0 && valor <= 5) {
+            filtro.notaMinima = filtro.notaMaxima = valor;
+            ++i;
+        } else if (opcao == "--tempo-max" && i + 1 < args.size() && lerInteiro(args[i + 1], valor)) {
+            filtro.tempoMaximo = valor;
+            ++i;
+        } else if (opcao == "--histograma" && i + 1 < args.size() &&
+                   (args[i + 1] == "tempo" || args[i + 1] == "porcoes" || args[i + 1] == "nota")) {
+            colunaHistograma = args[++i];
+        } else if (opcao == "--largura" && i + 1 < args.size() && lerInteiro(args[i + 1], largura) && largura > 0) {
+            ++i;
+        } else {
+            std::cerr << "Uso: analise [--categoria C] [--nota 0-5] [--feitas|--nao-feitas] [--tempo-max N]\n"
+                         "               [--por-categoria] [--histograma tempo|porcoes|nota [--largura N]]" << std::endl;
+            return 1;
+        }
+    }
+
+    const AnaliseColunar* analise = db.analiseColunar();
+    if (!analise) {
+        return 1;
+    }
+    FiltroAnalise avaliadas = filtro;
+    avaliadas.notaMinima = std::max(1, filtro.notaMinima);
+    Agregado feitas = analise->agregar(ColunaAnalise::Feita, filtro);
+    Agregado notas = analise->agregar(ColunaAnalise::Nota, avaliadas);
+    Agregado tempo = analise->agregar(ColunaAnalise::Tempo, filtro);
+    Agregado porcoes = analise->agregar(ColunaAnalise::Porcoes, filtro);
+
+    char fracao[32];
+    char media[32];
+    std::snprintf(fracao, sizeof(fracao), "%.1f", feitas.media() * 100);
+    std::snprintf(media, sizeof(media), "%.2f", notas.media());
+    std::string saida;
+    if (formato == FormatoSaida::Tabela) {
+        saida += "Receitas: " + std::to_string(feitas.contagem) + "\n" +
+                 "Feitas: " + std::to_string(feitas.soma) + " (" + fracao + "%)\n" +
+                 "Nota media: " + media + " (" + std::to_string(notas.contagem) + " avaliadas)\n" +
+                 "Tempo: " + resumirAgregado(tempo, formato) + "\n" +
+                 "Porcoes: " + resumirAgregado(porcoes, formato) + "\n";
+    } else {
+        saida += "{\"receitas\":" + std::to_string(feitas.contagem) + ",\"feitas\":" + std::to_string(feitas.soma) +
+                 ",\"avaliadas\":" + std::to_string(notas.contagem) + ",\"nota_media\":" + media +
+                 ",\"tempo\":" + resumirAgregado(tempo, formato) + ",\"porcoes\":" + resumirAgregado(porcoes, formato);
+    }
+
+    if (porCategoria) {
+        std::vector<GrupoCategoria> grupos = analise->agruparPorCategoria(ColunaAnalise::Feita, filtro);
+        std::vector<GrupoCategoria> notasPorCategoria = analise->agruparPorCategoria(ColunaAnalise::Nota, avaliadas);
+        saida += formato == FormatoSaida::Tabela ? "\nCategoria  receitas  feitas  nota media\n" : ",\"categorias\":[";
+        size_t j = 0;
+        for (size_t i = 0; i < grupos.size(); ++i) {
+            // Os dois agrupamentos vem em ordem de nome; avaliadas e subconjunto
+            while (j < notasPorCategoria.size() && notasPorCategoria[j].categoria < grupos[i].categoria) {
+                ++j;
+            }
+            bool temNota = j < notasPorCategoria.size() && notasPorCategoria[j].categoria == grupos[i].categoria;
+            std::snprintf(fracao, sizeof(fracao), "%.1f", grupos[i].agregado.media() * 100);
+            std::snprintf(media, sizeof(media), "%.2f", temNota ? notasPorCategoria[j].agregado.media() : 0.0);
+            if (formato == FormatoSaida::Tabela) {
+                saida += (grupos[i].categoria.empty() ? "(sem categoria)" : grupos[i].categoria) + "  " +
+                         std::to_string(grupos[i].agregado.contagem) + "  " + fracao + "%  " + media + "\n";
+                continue;
+            }
+            saida += i > 0 ? ",{\"categoria\":" : "{\"categoria\":";
+            Renderizador::anexarJsonString(saida, grupos[i].categoria);
+            saida += ",\"receitas\":" + std::to_string(grupos[i].agregado.contagem) + ",\"feitas\":" +
+                     std::to_string(grupos[i].agregado.soma) + ",\"nota_media\":" + media + "}";
+        }
+        saida += formato == FormatoSaida::Tabela ? "" : "]";
+    }
+
+    if (!colunaHistograma.empty()) {
+        ColunaAnalise coluna = colunaHistograma == "tempo" ? ColunaAnalise::Tempo
+                             : colunaHistograma == "porcoes" ? ColunaAnalise::Porcoes : ColunaAnalise::Nota;
+        if (largura == 0) {
+            largura = coluna == ColunaAnalise::Tempo ? 15 : 1;
+        }
+        // Baldes ate o maximo filtrado, no maximo 100; o ultimo acumula o excedente
+        size_t baldes = 1;
+        Agregado faixa = analise->agregar(coluna, filtro);
+        if (faixa.contagem > 0) {
+            baldes = static_cast<size_t>(std::clamp(faixa.maximo / largura + 1, 1, 100));
+        }
+        std::vector<size_t> contagens = analise->histograma(coluna, filtro, largura, baldes);
+        saida += formato == FormatoSaida::Tabela ? "\nHistograma de " + colunaHistograma + ":\n"
+                                                 : ",\"histograma\":{\"coluna\":\"" + colunaHistograma +
+                                                       "\",\"largura\":" + std::to_string(largura) + ",\"contagens\":[";
+        for (size_t i = 0; i < contagens.size(); ++i) {
+            if (formato != FormatoSaida::Tabela) {
+                saida += (i > 0 ? "," : "") + std::to_string(contagens[i]);
+                continue;
+            }
+            std::string rotulo = std::to_string(static_cast<long long>(i) * largura) +
+                                 (i + 1 == contagens.size() ? "+" : "-" + std::to_string(static_cast<long long>(i + 1) * largura - 1));
+            saida += "  " + rotulo + ": " + std::to_string(contagens[i]) + "\n";
+        }
+        saida += formato == FormatoSaida::Tabela ? "" : "]}";
+    }
+    saida += formato == FormatoSaida::Tabela ? "" : "}\n";
+    std::cout << saida;
+    return 0;
+}
+
+// imagens importar | gc | verificar | info
+int comandoImagens(Database& db, const std::vector<std::string>& args) {
+    const std::string acao = args.size() == 2 ? args[1] : "";
+    ArmazemImagens& armazem = db.imagens();
+    if (acao == "importar") {
+        int alteradas = db.importarImagens();
+        if (alteradas < 0) {
+            return 1;
+        }
+        std::cout << alteradas << " receita(s) passaram a usar o armazem de imagens.\n";
+        return 0;
+    }
+    if (acao == "gc") {
+        int removidos = db.removerImagensSemUso();
+        if (removidos < 0) {
+            return 1;
+        }
+        std::cout << removidos << " imagem(ns) sem uso removida(s).\n";
+        return 0;
+    }
+    if (acao == "verificar") {
+        size_t corrompidas = 0;
+        std::vector<std::string> hashes = armazem.listar();
+        for (const auto& hash : hashes) {
+            if (!armazem.verificar(hash)) {
+                std::cout << "Corrompida: " << hash << "\n";
+                ++corrompidas;
+            }
+        }
+        std::cout << hashes.size() << " imagem(ns) verificada(s), " << corrompidas << " corrompida(s).\n";
+        return corrompidas == 0 ? 0 : 1;
+    }
+    if (acao == "info") {
+        std::vector<std::string> hashes = armazem.listar();
+        uintmax_t bytes = 0;
+        for (const auto& hash : hashes) {
+            std::error_code erro;
+            uintmax_t tamanho = std::filesystem::file_size(armazem.caminhoDe(hash), erro);
+            bytes += erro ? 0 : tamanho;
+        }
+        std::cout << "Diretorio: " << armazem.diretorio() << "\n"
+                  << "Imagens: " << hashes.size() << "\n"
+                  << "Tamanho: " << bytes << " bytes\n";
+        return 0;
+    }
+    std::cerr << "Uso: imagens importar|gc|verificar|info" << std::endl;
+    return 1;
+}
+
+// "2026-03-01 18:04:05.123" (UTC) a partir de ms desde a epoca
+std::string formatarMomento(int64_t momento) {
+    std::time_t segundos = static_cast<std::time_t>(momento / 1000);
+    std::tm utc{};
+    gmtime_r(&segundos, &utc);
+    char texto[40];
+    size_t n = std::strftime(texto, sizeof(texto), "%Y-%m-%d %H:%M:%S", &utc);
+    std::snprintf(texto + n, sizeof(texto) - n, ".%03d", static_cast<int>(momento % 1000));
+    return texto;
+}
+
+// alteracoes --desde 1200 --limite 500  |  alteracoes descartar 1200
+int comandoAlteracoes(Database& db, const std::vector<std::string>& args, FormatoSaida formato) {
+    int64_t seq = 0;
+    if (args.size() == 3 && args[1] == "descartar") {
+        if (!lerInteiro(args[2], seq) || seq < 0) {
+            std::cerr << "Uso: alteracoes descartar <seq>" << std::endl;
+            return 1;
+        }
+        int descartadas = db.descartarAlteracoes(seq);
+        if (descartadas < 0) {
+            return 1;
+        }
+        std::cout << descartadas << " alteracao(oes) descartada(s).\n";
+        return 0;
+    }
+
+    LimitesConsulta limites;
+    bool limitePedido = false;
+    for (size_t i = 1; i < args.size(); ++i) {
+        int limite = 0;
+        if (args[i] == "--desde" && i + 1 < args.size() && lerInteiro(args[i + 1], seq) && seq >= 0) {
+            ++i;
+        } else if (args[i] == "--limite" && i + 1 < args.size() && lerInteiro(args[i + 1], limite) && limite > 0) {
+            limites.maxLinhas = static_cast<size_t>(limite);
+            limitePedido = true;
+            ++i;
+        } else {
+            std::cerr << "Uso: alteracoes [--desde seq] [--limite N] | alteracoes descartar <seq>" << std::endl;
+            return 1;
+        }
+    }
+
+    // Linhas vao para a saida a cada bloco, sem juntar o log inteiro em memoria
+    std::string saida;
+    bool primeira = true;
+    StatusConsulta status = StatusConsulta::Ok;
+    int entregues = db.alteracoesDesde(seq, [&](const Alteracao& a) {
+        if (formato == FormatoSaida::Tabela) {
+            saida += std::to_string(a.seq) + "  " + formatarMomento(a.momento) + "  " + a.operacao + "  ";
+            saida.append(a.tabela);
+            saida += "  receita " + std::to_string(a.receitaId) + "  chave " + std::to_string(a.chave) + "\n";
+        } else {
+            saida += formato == FormatoSaida::Json ? (primeira ? "[" : ",") : "";
+            saida += "{\"seq\":" + std::to_string(a.seq) + ",\"tabela\":";
+            Renderizador::anexarJsonString(saida, a.tabela);
+            saida += ",\"operacao\":\"";
+            saida += a.operacao;
+            saida += "\",\"receita_id\":" + std::to_string(a.receitaId) + ",\"chave\":" + std::to_string(a.chave) +
+                     ",\"momento\":" + std::to_string(a.momento);
+            saida += formato == FormatoSaida::Json ? "}" : "}\n";
+        }
+        primeira = false;
+        if (saida.size() >= 64 * 1024) {
+            std::cout << saida;
+            saida.clear();
+        }
+        return true;
+    }, &status, limitePedido ? &limites : nullptr);
+
+    if (entregues < 0) {
+        if (status == StatusConsulta::PrazoEsgotado) {
+            std::cerr << "Leitura do log interrompida: prazo esgotado." << std::endl;
+        }
+        return 1;
+    }
+    if (formato == FormatoSaida::Json) {
+        saida += primeira ? "[]\n" : "]\n";
+    }
+    std::cout << saida;
+    if (status == StatusConsulta::LimiteLinhas) {
+        std::cerr << "Mais alteracoes depois de " << entregues << " linhas; continue com --desde." << std::endl;
+    }
+    return 0;
+}
+
+int comandoRate(Database& db, const std::vector<std::string>& args) {
+    int id = 0;
+    int nota = 0;
+    if (args.size() != 3 || !lerInteiro(args[1], id) || !lerInteiro(args[2], nota)) {
+        std::cerr << "Uso: rate <id> <nota 1-5>" << std::endl;
+        return 1;
+    }
+    return db.avaliarReceita(id, nota) ? 0 : 1;
+}
+
+int comandoDone(Database& db, const std::vector<std::string>& args) {
+    int id = 0;
+    if (args.size() < 2 || args.size() > 3 || !lerInteiro(args[1], id)) {
+        std::cerr << "Uso: done <id> [sim|nao]" << std::endl;
+        return 1;
+    }
+    bool feita = args.size() == 2 || args[2] == "sim" || args[2] == "s";
+
+    if (db.consultarPorId(id).id == 0) {
+        std::cerr << "Receita nao encontrada." << std::endl;
+        return 1;
+    }
+    return db.marcarReceitaComoFeita(id, feita) ? 0 : 1;
+}
+
+int executarComando(Database& db, const std::vector<std::string>& args, FormatoSaida formato, bool emLote) {
+    const std::string& comando = args[0];
+
+    if (comando == "add") {
+        return comandoAdd(db, args);
+    }
+    if (comando == "edit") {
+        return comandoEdit(db, args);
+    }
+    if (comando == "get") {
+        return comandoGet(db, args, formato);
+    }
+    if (comando == "search") {
+        return comandoSearch(db, args, formato);
+    }
+    if (comando == "tag") {
+        return comandoTag(db, args);
+    }
+    if (comando == "tags") {
+        return comandoTags(db, args);
+    }
+    if (comando == "compras") {
+        return comandoCompras(db, args, formato);
+    }
+    if (comando == "similares") {
+        return comandoSimilares(db, args, formato);
+    }
+    if (comando == "dedup") {
+        return comandoDedup(db, args, formato);
+    }
+    if (comando == "imagens") {
+        return comandoImagens(db, args);
+    }
+    if (comando == "analise") {
+        return comandoAnalise(db, args, formato);
+    }
+    if (comando == "alteracoes") {
+        return comandoAlteracoes(db, args, formato);
+    }
+    if (comando == "rate") {
+        return comandoRate(db, args);
+    }
+    if (comando == "done") {
+        return comandoDone(db, args);
+    }
+    if (comando == "backup" || comando == "restore") {
+        if (emLote) {
+            // Backup e restauracao encerram a transacao corrente
+            std::cerr << comando << " nao pode ser usado dentro de --batch." << std::endl;
+            return 1;
+        }
+        if (args.size() != 2) {
+            std::cerr << "Uso: " << comando << " <caminho>" << std::endl;
+            return 1;
+        }
+        bool ok = comando == "backup" ? db.fazerBackup(args[1]) : db.restaurarBackup(args[1]);
+        return ok ? 0 : 1;
+    }
+    if (comando == "snapshot") {
+        if (args.size() != 2) {
+            std::cerr << "Uso: snapshot <arquivo>" << std::endl;
+            return 1;
+        }
+        return db.exportarSnapshot(args[1]) ? 0 : 1;
+    }
+    if (comando == "lentas") {
+        auto lentas = LogConsultasLentas::global().recentes();
+        if (formato != FormatoSaida::Tabela) {
+            std::cout << LogConsultasLentas::global().paraJson() << std::endl;
+            return 0;
+        }
+        for (const auto& consulta : lentas) {
+            std::cout << (consulta.duracaoNs / 1000000.0) << " ms, " << consulta.linhas << " linha(s)"
+                      << (consulta.varredura ? " [SCAN]" : "") << "\n  " << consulta.sql
+                      << "\n  plano: " << consulta.plano << "\n";
+        }
+        std::cout << lentas.size() << " consulta(s) lenta(s)." << std::endl;
+        return 0;
+    }
+    if (comando == "stats") {
+        // Metricas deste processo: util ao fim de um --batch
+        if (formato == FormatoSaida::Tabela) {
+            Metricas::global().escreverTabela(std::cout);
+        } else {
+            std::cout << Metricas::global().paraJson() << std::endl;
+        }
+        if (args.size() > 1 && args[1] == "--zerar") {
+            Metricas::global().zerar();
+        }
+        return 0;
+    }
+
+    std::cerr << "Comando desconhecido: " << comando << std::endl;
+    return 1;
+}
+
+int executarLote(Database& db, const std::string& arquivo, FormatoSaida formato) {
+    std::ifstream arquivoEntrada;
+    std::istream* entrada = &std::cin;
+    if (arquivo != "-") {
+        arquivoEntrada.open(arquivo);
+        if (!arquivoEntrada) {
+            std::cerr << "Nao foi possivel abrir o arquivo de lote: " << arquivo << std::endl;
+            return 1;
+        }
+        entrada = &arquivoEntrada;
+    }
+
+    if (!db.iniciarTransacao()) {
+        return 1;
+    }
+
+    std::string linha;
+    int numeroLinha = 0;
+    int executados = 0;
+    std::vector<std::string> args;
+
+    while (std::getline(*entrada, linha)) {
+        numeroLinha++;
+        args.clear();
+        if (!dividirArgumentos(linha, args)) {
+            std::cerr << "Linha " << numeroLinha << ": aspas nao fechadas." << std::endl;
+            db.desfazerTransacao();
+            return 1;
+        }
+        if (args.empty()) {
+            continue;
+        }
+        if (executarComando(db, args, formato, true) != 0) {
+            std::cerr << "Linha " << numeroLinha << ": falha em \"" << args[0]
+                      << "\"; lote desfeito." << std::endl;
+            db.desfazerTransacao();
+            return 1;
+        }
+        executados++;
+    }
+
+    if (!db.confirmarTransacao()) {
+        return 1;
+    }
+    std::cerr << executados << " comando(s) aplicado(s)." << std::endl;
+    return 0;
+}
+
+// Sobe a API HTTP e bloqueia ate SIGINT/SIGTERM
+int executarServidor(const std::string& caminhoDb, const std::vector<std::string>& args) {
+    ConfiguracaoServidor configuracao;
+    configuracao.caminhoDb = caminhoDb;
+
+    for (size_t i = 1; i < args.size(); ++i) {
+        if (i + 1 >= args.size()) {
+            std::cerr << "Opcao sem valor: " << args[i] << std::endl;
+            return 1;
+        }
+        const std::string& valor = args[++i];
+        const std::string& opcao = args[i - 1];
+        if (opcao == "--porta") {
+            if (!lerInteiro(valor, configuracao.porta) || configuracao.porta < 0 || configuracao.porta > 65535) {
+                std::cerr << "Porta invalida: " << valor << std::endl;
+                return 1;
+            }
+        } else if (opcao == "--trabalhadores") {
+            if (!lerInteiro(valor, configuracao.trabalhadores) || configuracao.trabalhadores < 1) {
+                std::cerr << "Numero de trabalhadores invalido: " << valor << std::endl;
+                return 1;
+            }
+        } else if (opcao == "--endereco") {
+            configuracao.endereco = valor;
+        } else if (opcao == "--backups") {
+            configuracao.diretorioBackups = valor;
+        } else if (opcao == "--prazo-ms") {
+            if (!lerInteiro(valor, configuracao.prazoConsultaMs) || configuracao.prazoConsultaMs < 0) {
+                std::cerr << "Prazo invalido: " << valor << std::endl;
+                return 1;
+            }
+        } else {
+            std::cerr << "Opcao desconhecida: " << opcao << std::endl;
+            return 1;
+        }
+    }
+
+    // Bloqueia os sinais antes de criar as threads, para que so sigwait os receba
+    sigset_t sinais;
+    sigemptyset(&sinais);
+    sigaddset(&sinais, SIGINT);
+    sigaddset(&sinais, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &sinais, nullptr);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    ServidorHttp servidor(configuracao);
+    if (!servidor.iniciar()) {
+        servidor.parar();
+        return 1;
+    }
+    std::cerr << "Servindo " << caminhoDb << " em http://" << configuracao.endereco << ":"
+              << servidor.porta() << " (" << configuracao.trabalhadores << " trabalhadores)" << std::endl;
+
+    int sinal = 0;
+    sigwait(&sinais, &sinal);
+    std::cerr << "Encerrando servidor..." << std::endl;
+    servidor.parar();
+    return 0;
+}
+
+} // namespace
+
+// ============================================================================
+// PONTO DE ENTRADA
+// ============================================================================
+int executarLinhaDeComando(int argc, char* argv[]) {
+    OpcoesGlobais opcoes;
+    std::vector<std::string> args;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (!args.empty()) {
+            args.push_back(arg);
+        } else if (arg == "--help" || arg == "-h" || arg == "help") {
+            exibirAjuda();
+            return 0;
+        } else if ((arg == "--db" || arg == "--formato" || arg == "--batch" || arg == "--lentas-ms" ||
+                    arg == "--lentas-log" || arg == "--leitores" || arg == "--prazo-ms" ||
+                    arg == "--max-linhas") && i + 1 < argc) {
+            std::string valor = argv[++i];
+            if (arg == "--db") {
+                opcoes.caminhoDb = valor;
+            } else if (arg == "--lentas-ms") {
+                char* fim = nullptr;
+                opcoes.limiarLentasMs = std::strtod(valor.c_str(), &fim);
+                if (fim == valor.c_str() || *fim != '\0') {
+                    std::cerr << "Limiar invalido: " << valor << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--lentas-log") {
+                opcoes.arquivoLentas = valor;
+            } else if (arg == "--leitores") {
+                if (!lerInteiro(valor, opcoes.leitores) || opcoes.leitores < 0) {
+                    std::cerr << "Numero de leitores invalido: " << valor << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--prazo-ms") {
+                if (!lerInteiro(valor, opcoes.limites.prazoMs) || opcoes.limites.prazoMs < 0) {
+                    std::cerr << "Prazo invalido: " << valor << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--max-linhas") {
+                int maxLinhas = 0;
+                if (!lerInteiro(valor, maxLinhas) || maxLinhas < 0) {
+                    std::cerr << "Limite de linhas invalido: " << valor << std::endl;
+                    return 1;
+                }
+                opcoes.limites.maxLinhas = static_cast<size_t>(maxLinhas);
+            } else if (arg == "--batch") {
+                opcoes.arquivoLote = valor;
+            } else {
+                bool valido = false;
+                opcoes.formato = Renderizador::formatoPorNome(valor, &valido);
+                if (!valido) {
+                    std::cerr << "Formato invalido: " << valor << std::endl;
+                    return 1;
+                }
+            }
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Opcao desconhecida: " << arg << std::endl;
+            exibirAjuda();
+            return 1;
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (args.empty() && opcoes.arquivoLote.empty()) {
+        exibirAjuda();
+        return 1;
+    }
+
+    LogConsultasLentas::global().configurar(opcoes.limiarLentasMs, opcoes.arquivoLentas);
+
+    if (opcoes.arquivoLote.empty() && args[0] == "serve") {
+        return executarServidor(opcoes.caminhoDb, args);
+    }
+    // Le apenas o arquivo de snapshot, sem abrir o SQLite
+    if (opcoes.arquivoLote.empty() && args[0] == "snapshot-info") {
+        return comandoSnapshotInfo(args, opcoes.formato);
+    }
+
+    Database db(opcoes.caminhoDb);
+    if (!db.initialize()) {
+        std::cerr << "Erro ao inicializar banco de dados." << std::endl;
+        return 1;
+    }
+    db.configurarHidratacaoParalela(opcoes.leitores);
+    db.configurarLimites(opcoes.limites);
+
+    int codigo = opcoes.arquivoLote.empty()
+        ? executarComando(db, args, opcoes.formato, false)
+        : executarLote(db, opcoes.arquivoLote, opcoes.formato);
+
+    db.close();
+    return codigo;
+}
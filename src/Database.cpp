@@ -2,17 +2,255 @@
 // INCLUDES
 // ============================================================================
 #include "../include/Database.h"
+#include "../include/Metricas.h"
+#include "../include/LogConsultasLentas.h"
+#include "../include/Deduplicador.h"
+#include "../include/SnapshotVault.h"
 #include <sqlite3.h>
 #include <iostream>
 #include <sstream>
 #include <filesystem>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <chrono>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+// ============================================================================
+// INSTRUMENTACAO
+// ============================================================================
+// O tempo do SQLITE_TRACE_PROFILE vem do relogio da VFS, com resolucao de
+// milissegundos; por isso cada thread marca o inicio dos seus statements.
+struct ExecucaoStatement {
+    sqlite3_stmt* stmt;
+    std::chrono::steady_clock::time_point inicio;
+    uint64_t linhas;
+};
+static thread_local std::vector<ExecucaoStatement> execucoes;
+
+// Todo prepare passa por aqui para ser contado em Metricas
+static int preparar(sqlite3* sqliteDb, const char* sql, int tamanho, sqlite3_stmt** stmt, const char** resto) {
+    Metricas::global().sql().preparados.fetch_add(1, std::memory_order_relaxed);
+    return sqlite3_prepare_v2(sqliteDb, sql, tamanho, stmt, resto);
+}
+
+static bool ehEscrita(sqlite3_stmt* stmt) {
+    if (sqlite3_stmt_readonly(stmt)) {
+        return false;
+    }
+    const char* sql = sqlite3_sql(stmt);
+    while (sql && std::isspace(static_cast<unsigned char>(*sql))) {
+        sql++;
+    }
+    char inicio = sql ? static_cast<char>(std::toupper(static_cast<unsigned char>(*sql))) : 0;
+    return inicio == 'I' || inicio == 'U' || inicio == 'D' || inicio == 'R';
+}
+
+static ExecucaoStatement* execucaoDe(sqlite3_stmt* stmt) {
+    for (size_t i = execucoes.size(); i-- > 0;) {
+        if (execucoes[i].stmt == stmt) {
+            return &execucoes[i];
+        }
+    }
+    return nullptr;
+}
+
+static int rastrearSql(unsigned tipo, void*, void* p, void* x) {
+    ContadoresSql& sql = Metricas::global().sql();
+    sqlite3_stmt* stmt = static_cast<sqlite3_stmt*>(p);
+
+    if (tipo == SQLITE_TRACE_STMT) {
+        // Cada trigger disparado tambem chega aqui, com "x" = "-- TRIGGER nome";
+        // o statement que o disparou ja esta sendo medido
+        const char* texto = static_cast<const char*>(x);
+        if (texto && texto[0] == '-' && texto[1] == '-') {
+            return 0;
+        }
+        sql.executados.fetch_add(1, std::memory_order_relaxed);
+        if (execucoes.size() >= 64) {
+            execucoes.erase(execucoes.begin());   // statement abandonado sem reset
+        }
+        execucoes.push_back({stmt, std::chrono::steady_clock::now(), 0});
+    } else if (tipo == SQLITE_TRACE_ROW) {
+        uint64_t bytes = 0;
+        int colunas = sqlite3_data_count(stmt);
+        for (int i = 0; i < colunas; ++i) {
+            int tipoColuna = sqlite3_column_type(stmt, i);
+            if (tipoColuna == SQLITE_TEXT || tipoColuna == SQLITE_BLOB) {
+                bytes += static_cast<uint64_t>(sqlite3_column_bytes(stmt, i));
+            }
+        }
+        sql.linhasLidas.fetch_add(1, std::memory_order_relaxed);
+        sql.bytesRetornados.fetch_add(bytes, std::memory_order_relaxed);
+        if (ExecucaoStatement* execucao = execucaoDe(stmt)) {
+            execucao->linhas++;
+        }
+    } else if (tipo == SQLITE_TRACE_PROFILE) {
+        uint64_t nanossegundos = static_cast<uint64_t>(*static_cast<sqlite3_int64*>(x));
+        uint64_t linhas = 0;
+        if (ExecucaoStatement* execucao = execucaoDe(stmt)) {
+            nanossegundos = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - execucao->inicio).count());
+            linhas = execucao->linhas;
+            execucoes.erase(execucoes.begin() + (execucao - execucoes.data()));
+        }
+        sql.tempo.registrar(nanossegundos);
+
+        bool escrita = ehEscrita(stmt);
+        uint64_t alteradas = escrita ? static_cast<uint64_t>(sqlite3_changes(sqlite3_db_handle(stmt))) : 0;
+        sql.linhasEscritas.fetch_add(alteradas, std::memory_order_relaxed);
+
+        if (LogConsultasLentas::global().ehLenta(nanossegundos)) {
+            // O plano sai depois, na thread do log, por uma conexao dela
+            ConsultaLenta consulta;
+            std::string sqlOriginal = sqlite3_sql(stmt);
+            char* expandido = sqlite3_expanded_sql(stmt);
+            consulta.sql = expandido ? expandido : sqlOriginal;
+            sqlite3_free(expandido);
+            consulta.duracaoNs = nanossegundos;
+            consulta.linhas = escrita ? alteradas : linhas;
+            consulta.quando = std::chrono::system_clock::now();
+            const char* banco = sqlite3_db_filename(sqlite3_db_handle(stmt), "main");
+            LogConsultasLentas::global().enfileirar(std::move(consulta), banco ? banco : "", std::move(sqlOriginal));
+        }
+    }
+    return 0;
+}
+
+static void instalarInstrumentacao(sqlite3* sqliteDb) {
+    sqlite3_trace_v2(sqliteDb, SQLITE_TRACE_STMT | SQLITE_TRACE_ROW | SQLITE_TRACE_PROFILE, rastrearSql, nullptr);
+}
+
+// ============================================================================
+// AUXILIARES DE CONSULTA
+// ============================================================================
+static std::string_view colunaTexto(sqlite3_stmt* stmt, int coluna) {
+    const char* texto = reinterpret_cast<const char*>(sqlite3_column_text(stmt, coluna));
+    if (!texto) {
+        return std::string_view();
+    }
+    return std::string_view(texto, static_cast<size_t>(sqlite3_column_bytes(stmt, coluna)));
+}
+
+// Linha das listagens completas: id, nome, ingredientes, preparo, tempo,
+// categoria, porcoes, feita, nota, imagem, criada_em, atualizada_em
+static Receita lerReceita(sqlite3_stmt* stmt) {
+    Receita r;
+    r.id = sqlite3_column_int(stmt, 0);
+    r.nome = colunaTexto(stmt, 1);
+    r.ingredientes = colunaTexto(stmt, 2);
+    r.preparo = colunaTexto(stmt, 3);
+    r.tempo = sqlite3_column_int(stmt, 4);
+    r.categoria = colunaTexto(stmt, 5);
+    r.porcoes = sqlite3_column_int(stmt, 6);
+    r.feita = (sqlite3_column_int(stmt, 7) == 1);
+    r.nota = sqlite3_column_int(stmt, 8);
+    r.imagem = colunaTexto(stmt, 9);
+    r.criadaEm = sqlite3_column_int64(stmt, 10);
+    r.atualizadaEm = sqlite3_column_int64(stmt, 11);
+    return r;
+}
+
+// Traduz o ultimo retorno de sqlite3_step de uma listagem; SQLITE_ROW
+// significa que ela parou no limite de linhas com mais linhas pela frente
+static StatusConsulta statusDoPasso(sqlite3* sqliteDb, int rc) {
+    if (rc == SQLITE_DONE) {
+        return StatusConsulta::Ok;
+    }
+    if (rc == SQLITE_ROW) {
+        return StatusConsulta::LimiteLinhas;
+    }
+    if (rc != SQLITE_INTERRUPT) {
+        std::cerr << "Erro ao executar consulta: " << sqlite3_errmsg(sqliteDb) << std::endl;
+    }
+    return StatusConsulta::Erro;
+}
+
+// Visao de uma listagem do cache respeitando o limite de linhas da chamada
+static ListaReceitas limitarLista(std::shared_ptr<const std::vector<Receita>> receitas,
+                                  const LimitesConsulta& limites, StatusConsulta* status) {
+    bool truncar = limites.maxLinhas > 0 && receitas->size() > limites.maxLinhas;
+    if (status) {
+        *status = truncar ? StatusConsulta::LimiteLinhas : StatusConsulta::Ok;
+    }
+    return ListaReceitas(std::move(receitas), limites.maxLinhas);
+}
+
+// Intervalo, em instrucoes da VM do SQLite, entre verificacoes de prazo
+static const int INSTRUCOES_POR_VERIFICACAO = 1000;
+
+// Valor gravado em receitas.hash_conteudo (o INTEGER do SQLite e com sinal)
+static sqlite3_int64 hashConteudoReceita(std::string_view nome, std::string_view ingredientes,
+                                         std::string_view preparo) {
+    return static_cast<sqlite3_int64>(Deduplicador::hashConteudo(nome, ingredientes, preparo));
+}
+
+// Instante atual em ms desde a epoca, em SQL (julianday funciona em qualquer
+// versao do SQLite; 'now' e o mesmo durante todo um sqlite3_step)
+#define AGORA_MS "CAST((julianday('now') - 2440587.5) * 86400000 AS INTEGER)"
+
+// Corpo de trigger que avanca receitas.atualizada_em da receita "id" (sempre
+// cresce, como no trigger de receitas, que por isso nao dispara de novo)
+#define TOCAR_RECEITA(id) \
+    "  UPDATE receitas SET atualizada_em = MAX(" AGORA_MS ", COALESCE(atualizada_em, 0) + 1) WHERE id = " id "; "
+
+// Monta a clausula WHERE (sobre o alias r) correspondente ao filtro
+static std::string montarCondicao(const FiltroReceitas& filtro) {
+    std::string condicao;
+    auto adicionar = [&condicao](const char* trecho) {
+        condicao += condicao.empty() ? " WHERE " : " AND ";
+        condicao += trecho;
+    };
+    
+    if (!filtro.nome.empty()) {
+        adicionar("r.nome LIKE ?");
+    }
+    if (!filtro.tag.empty()) {
+        adicionar("r.id IN (SELECT rt.receita_id FROM receitas_tags rt "
+                  "INNER JOIN tags t ON t.id = rt.tag_id WHERE t.nome = ?)");
+    }
+    if (filtro.nota > 0) {
+        adicionar("r.nota = ?");
+    }
+    if (filtro.somenteFeitas || filtro.nota > 0) {
+        adicionar("r.feita = 1");
+    }
+    if (filtro.alteradasDesde > 0) {
+        adicionar("r.atualizada_em >= ?");
+    }
+    return condicao;
+}
+
+// Vincula os parametros na mesma ordem de montarCondicao; retorna o proximo indice livre
+static int vincularFiltro(sqlite3_stmt* stmt, const FiltroReceitas& filtro, int indice) {
+    if (!filtro.nome.empty()) {
+        std::string pattern = "%" + filtro.nome + "%";
+        sqlite3_bind_text(stmt, indice++, pattern.c_str(), -1, SQLITE_TRANSIENT);
+    }
+    if (!filtro.tag.empty()) {
+        sqlite3_bind_text(stmt, indice++, filtro.tag.c_str(), -1, SQLITE_STATIC);
+    }
+    if (filtro.nota > 0) {
+        sqlite3_bind_int(stmt, indice++, filtro.nota);
+    }
+    if (filtro.alteradasDesde > 0) {
+        sqlite3_bind_int64(stmt, indice++, filtro.alteradasDesde);
+    }
+    return indice;
+}
 
 // ============================================================================
 // CONSTRUTOR E DESTRUTOR
 // ============================================================================
-Database::Database(const std::string& path) : dbPath(path), db(nullptr) {
+Database::Database(const std::string& path)
+    : dbPath(path), db(nullptr), versaoDadosStmt(nullptr), versaoDados(-1), geracaoEscrita(0),
+      seqSimilares(-1), similaresDesatualizado(false), sincronoAntesCarga(-1), cacheAntesCarga(0), seqAnalise(-1), seqAnaliseAntesTransacao(-1),
+      analiseCarregadaNaTransacao(false), analiseDesatualizada(false), trabalhadoresHidratacao(0), prazoLimite(0), prazoEsgotado(false), prazoSuspenso(0),
+      armazemImagens(std::filesystem::path(path).replace_extension(".imagens").string()), interrupcaoPedida(false) {
     std::filesystem::path dir = std::filesystem::path(path).parent_path();
     if (!dir.empty() && !std::filesystem::exists(dir)) {
         std::filesystem::create_directories(dir);
@@ -26,11 +264,42 @@ Database::~Database() {
 // ============================================================================
 // INICIALIZAÇÃO E CONFIGURAÇÃO DO BANCO
 // ============================================================================
+// Indices secundarios que a insercao nao consulta: a carga em massa os
+// derruba e recria no fim. O de hash_conteudo fica, porque o lote procura
+// duplicatas por ele.
+static const char* const SQL_IDX_RECEITAS_CRIADA_EM =
+    "CREATE INDEX IF NOT EXISTS idx_receitas_criada_em ON receitas(criada_em)";
+static const char* const SQL_IDX_RECEITAS_ATUALIZADA_EM =
+    "CREATE INDEX IF NOT EXISTS idx_receitas_atualizada_em ON receitas(atualizada_em)";
+static const char* const SQL_IDX_RECEITAS_TAGS_TAG =
+    "CREATE INDEX IF NOT EXISTS idx_receitas_tags_tag ON receitas_tags(tag_id, receita_id)";
+static const char* const SQL_IDX_INGREDIENTES_POSICAO =
+    "CREATE INDEX IF NOT EXISTS idx_ingredientes_posicao ON ingredientes(receita_id, posicao, id)";
+
+static const char* const INDICES_CARGA[][2] = {
+    {"idx_receitas_criada_em", SQL_IDX_RECEITAS_CRIADA_EM},
+    {"idx_receitas_atualizada_em", SQL_IDX_RECEITAS_ATUALIZADA_EM},
+    {"idx_receitas_tags_tag", SQL_IDX_RECEITAS_TAGS_TAG},
+    {"idx_ingredientes_posicao", SQL_IDX_INGREDIENTES_POSICAO},
+};
+
+// Paginas de cache durante a carga em massa (negativo = KiB: 256 MiB)
+static const int64_t CACHE_CARGA_KIB = -262144;
+
 bool Database::initialize() {
-    if (sqlite3_open(dbPath.c_str(), (sqlite3**)&db) != SQLITE_OK) {
+    TemporizadorEscopo medicao(__func__);
+    sqlite3* conexao = nullptr;
+    int rc = sqlite3_open(dbPath.c_str(), &conexao);
+    definirConexao(conexao);
+    if (rc != SQLITE_OK) {
         std::cerr << "Erro ao abrir banco de dados: " << sqlite3_errmsg((sqlite3*)db) << std::endl;
         return false;
     }
+    // Leitores em outras conexoes (hidratacao, plano do log de consultas
+    // lentas) seguram o lock compartilhado por instantes
+    sqlite3_busy_timeout((sqlite3*)db, 5000);
+    instalarInstrumentacao((sqlite3*)db);
+    instalarHooks();
     
     // Habilitar foreign keys
     if (!executeQuery("PRAGMA foreign_keys = ON;")) {
@@ -38,6 +307,10 @@ bool Database::initialize() {
         return false;
     }
     
+    // Com os triggers do log de alteracoes, cada INSERT/UPDATE/DELETE abre um
+    // journal de statement; em memoria ele nao vira arquivo temporario
+    executeQuery("PRAGMA temp_store = MEMORY;");
+    
     if (!createTable()) {
         return false;
     }
@@ -46,7 +319,29 @@ bool Database::initialize() {
         return false;
     }
     
-    return createIngredientesTable();
+    return createIngredientesTable() && createAlteracoesTable() && createAssinaturasTable();
+}
+
+bool Database::initializeSomenteLeitura() {
+    TemporizadorEscopo medicao(__func__);
+    sqlite3* conexao = nullptr;
+    int rc = sqlite3_open_v2(dbPath.c_str(), &conexao, SQLITE_OPEN_READONLY, nullptr);
+    definirConexao(conexao);
+    if (rc != SQLITE_OK) {
+        std::cerr << "Erro ao abrir banco de dados: " << sqlite3_errmsg((sqlite3*)db) << std::endl;
+        return false;
+    }
+    
+    sqlite3_busy_timeout((sqlite3*)db, 5000);
+    instalarInstrumentacao((sqlite3*)db);
+    instalarHooks();
+    return true;
+}
+
+bool Database::habilitarWal() {
+    TemporizadorEscopo medicao(__func__);
+    sqlite3_busy_timeout((sqlite3*)db, 5000);
+    return executeQuery("PRAGMA journal_mode = WAL;") && executeQuery("PRAGMA synchronous = NORMAL;");
 }
 
 bool Database::createTable() {
@@ -61,7 +356,10 @@ bool Database::createTable() {
             porcoes INTEGER,
             feita INTEGER DEFAULT 0,
             nota INTEGER DEFAULT 0,
-            imagem TEXT
+            imagem TEXT,
+            hash_conteudo INTEGER,
+            criada_em INTEGER,
+            atualizada_em INTEGER
         )
     )";
     
@@ -90,7 +388,77 @@ bool Database::createTable() {
         executeQuerySilent(alterQueryImagem);
     }
     
-    return true;
+    if (!columnExists("receitas", "hash_conteudo")) {
+        std::string alterQueryHash = R"(
+            ALTER TABLE receitas ADD COLUMN hash_conteudo INTEGER
+        )";
+        executeQuerySilent(alterQueryHash);
+    }
+    
+    // Sem DEFAULT: ALTER TABLE ADD COLUMN so aceita constantes. Os triggers de
+    // createAlteracoesTable preenchem as colunas; receitas anteriores a elas
+    // ficam com o instante da migracao.
+    if (!columnExists("receitas", "criada_em")) {
+        executeQuerySilent("ALTER TABLE receitas ADD COLUMN criada_em INTEGER");
+    }
+    
+    if (!columnExists("receitas", "atualizada_em")) {
+        executeQuerySilent("ALTER TABLE receitas ADD COLUMN atualizada_em INTEGER");
+    }
+    
+    if (!executeQuery("UPDATE receitas SET criada_em = COALESCE(criada_em, " AGORA_MS "), atualizada_em = " AGORA_MS
+                      " WHERE atualizada_em IS NULL")) {
+        return false;
+    }
+    
+    if (!executeQuery("CREATE INDEX IF NOT EXISTS idx_receitas_hash_conteudo ON receitas(hash_conteudo)") ||
+        !executeQuery(SQL_IDX_RECEITAS_CRIADA_EM) || !executeQuery(SQL_IDX_RECEITAS_ATUALIZADA_EM)) {
+        return false;
+    }
+    
+    return preencherHashConteudo();
+}
+
+// Receitas gravadas antes da coluna hash_conteudo existir
+bool Database::preencherHashConteudo() {
+    sqlite3* sqliteDb = (sqlite3*)db;
+    sqlite3_stmt* pendentes;
+    sqlite3_stmt* gravar;
+    if (preparar(sqliteDb, "SELECT id, nome, ingredientes, preparo FROM receitas WHERE hash_conteudo IS NULL",
+                 -1, &pendentes, nullptr) != SQLITE_OK) {
+        std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
+        return false;
+    }
+    if (sqlite3_step(pendentes) != SQLITE_ROW) {
+        sqlite3_finalize(pendentes);
+        return true;
+    }
+    if (preparar(sqliteDb, "UPDATE receitas SET hash_conteudo = ? WHERE id = ?", -1, &gravar, nullptr) != SQLITE_OK) {
+        std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
+        sqlite3_finalize(pendentes);
+        return false;
+    }
+    
+    bool transacaoPropria = sqlite3_get_autocommit(sqliteDb) != 0;
+    bool ok = !transacaoPropria || iniciarTransacao();
+    do {
+        sqlite3_bind_int64(gravar, 1, hashConteudoReceita(colunaTexto(pendentes, 1), colunaTexto(pendentes, 2),
+                                                          colunaTexto(pendentes, 3)));
+        sqlite3_bind_int(gravar, 2, sqlite3_column_int(pendentes, 0));
+        ok = ok && sqlite3_step(gravar) == SQLITE_DONE;
+        sqlite3_reset(gravar);
+    } while (ok && sqlite3_step(pendentes) == SQLITE_ROW);
+    sqlite3_finalize(pendentes);
+    sqlite3_finalize(gravar);
+    
+    if (!ok) {
+        std::cerr << "Erro ao calcular hash de conteudo: " << sqlite3_errmsg(sqliteDb) << std::endl;
+        if (transacaoPropria) {
+            desfazerTransacao();
+        }
+        return false;
+    }
+    return !transacaoPropria || confirmarTransacao();
 }
 
 bool Database::createTagsTables() {
@@ -115,7 +483,13 @@ bool Database::createTagsTables() {
         )
     )";
     
-    return executeQuery(queryReceitasTags);
+    if (!executeQuery(queryReceitasTags)) {
+        return false;
+    }
+    
+    // A chave primaria cobre receita -> tags; este indice cobre tag -> receitas
+    // (filtros por tag, operacoes em massa e limpeza de tags sem uso)
+    return executeQuery(SQL_IDX_RECEITAS_TAGS_TAG);
 }
 
 bool Database::createIngredientesTable() {
@@ -126,11 +500,151 @@ bool Database::createIngredientesTable() {
             nome TEXT NOT NULL,
             quantidade REAL NOT NULL,
             unidade TEXT,
+            posicao INTEGER,
             FOREIGN KEY (receita_id) REFERENCES receitas(id) ON DELETE CASCADE
         )
     )";
     
-    return executeQuery(queryIngredientes);
+    if (!executeQuery(queryIngredientes)) {
+        return false;
+    }
+    
+    // Ordem dos ingredientes na receita: (posicao, id). Linhas anteriores a
+    // coluna ficam com NULL, que vem antes, e mantem a ordem por id ate a
+    // receita ser editada.
+    if (!columnExists("ingredientes", "posicao")) {
+        executeQuerySilent("ALTER TABLE ingredientes ADD COLUMN posicao INTEGER");
+    }
+    
+    return executeQuery("DROP INDEX IF EXISTS idx_ingredientes_receita") && executeQuery(SQL_IDX_INGREDIENTES_POSICAO);
+}
+
+// Log de alteracoes. Sem AUTOINCREMENT, que atualizaria sqlite_sequence a
+// cada linha: o seq e max + 1, e descartarAlteracoes nunca apaga a ultima
+// linha, entao um seq nao volta. O trigger de UPDATE em receitas so age
+// quando atualizada_em nao mudou, e ele mesmo sempre a muda (no minimo +1 ms):
+// assim o UPDATE que preenche as colunas nao gera outra linha no log.
+bool Database::createAlteracoesTable() {
+    std::string queryAlteracoes = R"(
+        CREATE TABLE IF NOT EXISTS alteracoes (
+            seq INTEGER PRIMARY KEY,
+            tabela TEXT NOT NULL,
+            operacao TEXT NOT NULL,
+            receita_id INTEGER,
+            chave INTEGER,
+            momento INTEGER NOT NULL
+        )
+    )";
+    
+    if (!executeQuery(queryAlteracoes)) {
+        return false;
+    }
+    
+    // Vaults anteriores tem os triggers de vinculos e ingredientes sem o
+    // TOCAR_RECEITA: sao recriados uma vez
+    sqlite3* sqliteDb = (sqlite3*)db;
+    sqlite3_stmt* stmt;
+    if (preparar(sqliteDb, "SELECT COUNT(*) FROM sqlite_master WHERE type = 'trigger' "
+                           "AND (name LIKE 'alteracoes_receitas_tags_%' OR name LIKE 'alteracoes_ingredientes_%') "
+                           "AND sql NOT LIKE '%atualizada_em%'", -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
+        return false;
+    }
+    bool recriar = sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0) > 0;
+    sqlite3_finalize(stmt);
+    if (recriar) {
+        for (const char* tabela : {"receitas_tags", "ingredientes"}) {
+            for (const char* operacao : {"insert", "update", "delete"}) {
+                if (!executeQuery(std::string("DROP TRIGGER IF EXISTS alteracoes_") + tabela + "_" + operacao)) {
+                    return false;
+                }
+            }
+        }
+    }
+    
+    std::string triggers =
+        "CREATE TRIGGER IF NOT EXISTS alteracoes_receitas_insert AFTER INSERT ON receitas BEGIN "
+        "  UPDATE receitas SET criada_em = COALESCE(NEW.criada_em, " AGORA_MS "), atualizada_em = " AGORA_MS
+        "    WHERE id = NEW.id AND NEW.atualizada_em IS NULL; "
+        "  INSERT INTO alteracoes (tabela, operacao, receita_id, chave, momento) "
+        "    VALUES ('receitas', 'I', NEW.id, NEW.id, " AGORA_MS "); "
+        "END; "
+        "CREATE TRIGGER IF NOT EXISTS alteracoes_receitas_update AFTER UPDATE ON receitas "
+        "WHEN NEW.atualizada_em IS OLD.atualizada_em BEGIN "
+        "  UPDATE receitas SET atualizada_em = MAX(" AGORA_MS ", COALESCE(OLD.atualizada_em, 0) + 1) "
+        "    WHERE id = NEW.id; "
+        "  INSERT INTO alteracoes (tabela, operacao, receita_id, chave, momento) "
+        "    VALUES ('receitas', 'U', NEW.id, NEW.id, " AGORA_MS "); "
+        "END; "
+        "CREATE TRIGGER IF NOT EXISTS alteracoes_receitas_delete AFTER DELETE ON receitas BEGIN "
+        "  INSERT INTO alteracoes (tabela, operacao, receita_id, chave, momento) "
+        "    VALUES ('receitas', 'D', OLD.id, OLD.id, " AGORA_MS "); "
+        "END; "
+        "CREATE TRIGGER IF NOT EXISTS alteracoes_tags_insert AFTER INSERT ON tags BEGIN "
+        "  INSERT INTO alteracoes (tabela, operacao, receita_id, chave, momento) "
+        "    VALUES ('tags', 'I', NULL, NEW.id, " AGORA_MS "); "
+        "END; "
+        "CREATE TRIGGER IF NOT EXISTS alteracoes_tags_update AFTER UPDATE ON tags BEGIN "
+        "  INSERT INTO alteracoes (tabela, operacao, receita_id, chave, momento) "
+        "    VALUES ('tags', 'U', NULL, NEW.id, " AGORA_MS "); "
+        "END; "
+        "CREATE TRIGGER IF NOT EXISTS alteracoes_tags_delete AFTER DELETE ON tags BEGIN "
+        "  INSERT INTO alteracoes (tabela, operacao, receita_id, chave, momento) "
+        "    VALUES ('tags', 'D', NULL, OLD.id, " AGORA_MS "); "
+        "END; "
+        // Vinculos sao identificados pelo par (receita, tag): um UPDATE vira remocao + insercao.
+        // Vinculos e ingredientes tambem contam como alteracao da receita (atualizada_em)
+        "CREATE TRIGGER IF NOT EXISTS alteracoes_receitas_tags_insert AFTER INSERT ON receitas_tags BEGIN "
+        "  INSERT INTO alteracoes (tabela, operacao, receita_id, chave, momento) "
+        "    VALUES ('receitas_tags', 'I', NEW.receita_id, NEW.tag_id, " AGORA_MS "); "
+        TOCAR_RECEITA("NEW.receita_id")
+        "END; "
+        "CREATE TRIGGER IF NOT EXISTS alteracoes_receitas_tags_update AFTER UPDATE ON receitas_tags BEGIN "
+        "  INSERT INTO alteracoes (tabela, operacao, receita_id, chave, momento) "
+        "    VALUES ('receitas_tags', 'D', OLD.receita_id, OLD.tag_id, " AGORA_MS "), "
+        "           ('receitas_tags', 'I', NEW.receita_id, NEW.tag_id, " AGORA_MS "); "
+        TOCAR_RECEITA("OLD.receita_id")
+        TOCAR_RECEITA("NEW.receita_id")
+        "END; "
+        "CREATE TRIGGER IF NOT EXISTS alteracoes_receitas_tags_delete AFTER DELETE ON receitas_tags BEGIN "
+        "  INSERT INTO alteracoes (tabela, operacao, receita_id, chave, momento) "
+        "    VALUES ('receitas_tags', 'D', OLD.receita_id, OLD.tag_id, " AGORA_MS "); "
+        TOCAR_RECEITA("OLD.receita_id")
+        "END; "
+        "CREATE TRIGGER IF NOT EXISTS alteracoes_ingredientes_insert AFTER INSERT ON ingredientes BEGIN "
+        "  INSERT INTO alteracoes (tabela, operacao, receita_id, chave, momento) "
+        "    VALUES ('ingredientes', 'I', NEW.receita_id, NEW.id, " AGORA_MS "); "
+        TOCAR_RECEITA("NEW.receita_id")
+        "END; "
+        "CREATE TRIGGER IF NOT EXISTS alteracoes_ingredientes_update AFTER UPDATE ON ingredientes BEGIN "
+        "  INSERT INTO alteracoes (tabela, operacao, receita_id, chave, momento) "
+        "    VALUES ('ingredientes', 'U', NEW.receita_id, NEW.id, " AGORA_MS "); "
+        TOCAR_RECEITA("OLD.receita_id")
+        TOCAR_RECEITA("NEW.receita_id")
+        "END; "
+        "CREATE TRIGGER IF NOT EXISTS alteracoes_ingredientes_delete AFTER DELETE ON ingredientes BEGIN "
+        "  INSERT INTO alteracoes (tabela, operacao, receita_id, chave, momento) "
+        "    VALUES ('ingredientes', 'D', OLD.receita_id, OLD.id, " AGORA_MS "); "
+        TOCAR_RECEITA("OLD.receita_id")
+        "END;";
+    return executeQuery(triggers);
+}
+
+// Assinaturas MinHash do indice de similares (64 bytes, little-endian) e o
+// seq do log de alteracoes ate o qual elas valem
+bool Database::createAssinaturasTable() {
+    std::string query = R"(
+        CREATE TABLE IF NOT EXISTS assinaturas (
+            receita_id INTEGER PRIMARY KEY,
+            sig BLOB NOT NULL,
+            FOREIGN KEY (receita_id) REFERENCES receitas(id) ON DELETE CASCADE
+        );
+        CREATE TABLE IF NOT EXISTS indices_persistidos (
+            nome TEXT PRIMARY KEY,
+            seq INTEGER NOT NULL
+        );
+    )";
+    return executeQuery(query);
 }
 
 // ============================================================================
@@ -166,7 +680,7 @@ bool Database::columnExists(const std::string& tableName, const std::string& col
     sqlite3_stmt* stmt;
     
     const char* sql = "PRAGMA table_info(?);";
-    if (sqlite3_prepare_v2(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    if (preparar(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
         return false;
     }
     
@@ -174,7 +688,7 @@ bool Database::columnExists(const std::string& tableName, const std::string& col
     std::string query = "PRAGMA table_info(" + tableName + ");";
     sqlite3_finalize(stmt);
     
-    if (sqlite3_prepare_v2(sqliteDb, query.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+    if (preparar(sqliteDb, query.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
         return false;
     }
     
@@ -194,12 +708,19 @@ bool Database::columnExists(const std::string& tableName, const std::string& col
 // CRUD DE RECEITAS
 // ============================================================================
 int Database::cadastrarReceita(const Receita& receita) {
+    TemporizadorEscopo medicao(__func__);
     sqlite3* sqliteDb = (sqlite3*)db;
     sqlite3_stmt* stmt;
     
-    const char* sql = "INSERT INTO receitas (nome, ingredientes, preparo, tempo, categoria, porcoes, feita, nota, imagem) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)";
+    const char* sql = "INSERT INTO receitas (nome, ingredientes, preparo, tempo, categoria, porcoes, feita, nota, imagem, hash_conteudo, criada_em, atualizada_em) "
+                      "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, " AGORA_MS ", " AGORA_MS ")";
     
-    if (sqlite3_prepare_v2(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    int original = buscarDuplicataExata(receita);
+    if (original > 0) {
+        std::cerr << "Aviso: conteudo identico ao da receita #" << original << "." << std::endl;
+    }
+    
+    if (preparar(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
         std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
         return 0;
     }
@@ -213,6 +734,7 @@ int Database::cadastrarReceita(const Receita& receita) {
     sqlite3_bind_int(stmt, 7, receita.feita ? 1 : 0);
     sqlite3_bind_int(stmt, 8, receita.nota);
     sqlite3_bind_text(stmt, 9, receita.imagem.empty() ? nullptr : receita.imagem.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 10, hashConteudoReceita(receita.nome, receita.ingredientes, receita.preparo));
     
     if (sqlite3_step(stmt) != SQLITE_DONE) {
         std::cerr << "Erro ao inserir receita: " << sqlite3_errmsg(sqliteDb) << std::endl;
@@ -230,145 +752,1310 @@ int Database::cadastrarReceita(const Receita& receita) {
         }
     }
     
+    registrarEscrita(receitaId);
     return receitaId;
 }
 
-std::vector<Receita> Database::listarReceitas() {
-    std::vector<Receita> receitas;
+int Database::cadastrarReceitasEmLote(const std::vector<Receita>& receitas, std::vector<int>* ids) {
+    TemporizadorEscopo medicao(__func__);
     sqlite3* sqliteDb = (sqlite3*)db;
+    const char* sqls[] = {
+        "INSERT INTO receitas (nome, ingredientes, preparo, tempo, categoria, porcoes, feita, nota, imagem, hash_conteudo, criada_em, atualizada_em) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, " AGORA_MS ", " AGORA_MS ")",
+        "INSERT INTO ingredientes (receita_id, nome, quantidade, unidade, posicao) VALUES (?, ?, ?, ?, ?)",
+        "INSERT OR IGNORE INTO tags (nome) VALUES (?)",
+        "SELECT id FROM tags WHERE nome = ?",
+        "INSERT OR IGNORE INTO receitas_tags (receita_id, tag_id) VALUES (?, ?)",
+        "SELECT 1 FROM receitas WHERE hash_conteudo = ? LIMIT 1"
+    };
+    const int NUM_STMTS = 6;
+    sqlite3_stmt* stmts[NUM_STMTS] = {};
+    sqlite3_stmt*& inserirReceita = stmts[0];
+    sqlite3_stmt*& inserirIngrediente = stmts[1];
+    sqlite3_stmt*& inserirTag = stmts[2];
+    sqlite3_stmt*& buscarTag = stmts[3];
+    sqlite3_stmt*& inserirRelacao = stmts[4];
+    sqlite3_stmt*& buscarHash = stmts[5];
+
+    auto finalizarTodos = [&stmts]() {
+        for (sqlite3_stmt* stmt : stmts) {
+            sqlite3_finalize(stmt);
+        }
+    };
+
+    for (int i = 0; i < NUM_STMTS; ++i) {
+        if (preparar(sqliteDb, sqls[i], -1, &stmts[i], nullptr) != SQLITE_OK) {
+            std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
+            finalizarTodos();
+            return -1;
+        }
+    }
+
+    // Se o chamador ja abriu uma transacao (ex.: --batch), participa dela
+    // sob um savepoint, para que um lote com falha seja desfeito sem levar
+    // junto o que o chamador ja gravou
+    bool transacaoPropria = sqlite3_get_autocommit(sqliteDb) != 0;
+    if (!(transacaoPropria ? iniciarTransacao() : criarSavepoint("lote"))) {
+        finalizarTodos();
+        return -1;
+    }
+
+    auto passo = [sqliteDb](sqlite3_stmt* stmt) {
+        int rc = sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+        if (rc != SQLITE_DONE && rc != SQLITE_ROW) {
+            std::cerr << "Erro ao inserir receita em lote: " << sqlite3_errmsg(sqliteDb) << std::endl;
+            return false;
+        }
+        return true;
+    };
+
+    std::unordered_map<std::string, int> idsTags;
+    bool ok = true;
+    int inseridas = 0;
+    int duplicadas = 0;
+    if (ids) {
+        ids->reserve(ids->size() + receitas.size());
+    }
+
+    for (const auto& receita : receitas) {
+        sqlite3_int64 hash = hashConteudoReceita(receita.nome, receita.ingredientes, receita.preparo);
+        sqlite3_bind_int64(buscarHash, 1, hash);
+        duplicadas += sqlite3_step(buscarHash) == SQLITE_ROW ? 1 : 0;
+        sqlite3_reset(buscarHash);
+        
+        sqlite3_bind_text(inserirReceita, 1, receita.nome.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(inserirReceita, 2, receita.ingredientes.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(inserirReceita, 3, receita.preparo.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(inserirReceita, 4, receita.tempo);
+        sqlite3_bind_text(inserirReceita, 5, receita.categoria.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(inserirReceita, 6, receita.porcoes);
+        sqlite3_bind_int(inserirReceita, 7, receita.feita ? 1 : 0);
+        sqlite3_bind_int(inserirReceita, 8, receita.nota);
+        sqlite3_bind_text(inserirReceita, 9, receita.imagem.empty() ? nullptr : receita.imagem.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int64(inserirReceita, 10, hash);
+        if (!(ok = passo(inserirReceita))) {
+            break;
+        }
+        int receitaId = static_cast<int>(sqlite3_last_insert_rowid(sqliteDb));
+
+        for (size_t n = 0; n < receita.ingredientesEstruturados.size(); ++n) {
+            const Ingrediente& ing = receita.ingredientesEstruturados[n];
+            sqlite3_bind_int(inserirIngrediente, 1, receitaId);
+            sqlite3_bind_text(inserirIngrediente, 2, ing.nome.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_double(inserirIngrediente, 3, ing.quantidade);
+            sqlite3_bind_text(inserirIngrediente, 4, ing.unidade.empty() ? nullptr : ing.unidade.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_int64(inserirIngrediente, 5, static_cast<sqlite3_int64>(n + 1));
+            if (!(ok = passo(inserirIngrediente))) {
+                break;
+            }
+        }
+
+        for (size_t t = 0; ok && t < receita.tags.size(); ++t) {
+            const std::string& nomeTag = receita.tags[t];
+            auto it = idsTags.find(nomeTag);
+            if (it == idsTags.end()) {
+                sqlite3_bind_text(inserirTag, 1, nomeTag.c_str(), -1, SQLITE_STATIC);
+                sqlite3_bind_text(buscarTag, 1, nomeTag.c_str(), -1, SQLITE_STATIC);
+                if (!(ok = passo(inserirTag)) || sqlite3_step(buscarTag) != SQLITE_ROW) {
+                    ok = false;
+                    sqlite3_reset(buscarTag);
+                    break;
+                }
+                it = idsTags.emplace(nomeTag, sqlite3_column_int(buscarTag, 0)).first;
+                sqlite3_reset(buscarTag);
+            }
+            sqlite3_bind_int(inserirRelacao, 1, receitaId);
+            sqlite3_bind_int(inserirRelacao, 2, it->second);
+            ok = passo(inserirRelacao);
+        }
+        if (!ok) {
+            break;
+        }
+
+        if (ids) {
+            ids->push_back(receitaId);
+        }
+        registrarEscrita(receitaId);
+        inseridas++;
+    }
+
+    finalizarTodos();
+
+    ok = ok && (transacaoPropria ? confirmarTransacao() : liberarSavepoint("lote"));
+    if (!ok) {
+        if (transacaoPropria) {
+            desfazerTransacao();
+        } else {
+            desfazerSavepoint("lote");
+        }
+        // Nada do lote ficou gravado
+        if (ids) {
+            ids->resize(ids->size() - inseridas);
+        }
+        return -1;
+    }
+    if (duplicadas > 0) {
+        std::cerr << "Aviso: " << duplicadas << " receita(s) do lote com conteudo identico a receitas ja gravadas." << std::endl;
+    }
+    return inseridas;
+}
+
+// Valor inteiro de um PRAGMA de leitura, ou -1
+static int64_t lerPragma(sqlite3* sqliteDb, const char* sql) {
     sqlite3_stmt* stmt;
-    
-    const char* sql = "SELECT id, nome, ingredientes, preparo, tempo, categoria, porcoes, feita, nota, imagem FROM receitas ORDER BY id";
-    
-    if (sqlite3_prepare_v2(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    if (preparar(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
         std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
-        return receitas;
-    }
-    
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        Receita r;
-        r.id = sqlite3_column_int(stmt, 0);
-        r.nome = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        r.ingredientes = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-        r.preparo = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
-        r.tempo = sqlite3_column_int(stmt, 4);
-        r.categoria = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
-        r.porcoes = sqlite3_column_int(stmt, 6);
-        r.feita = (sqlite3_column_int(stmt, 7) == 1);
-        r.nota = sqlite3_column_int(stmt, 8);
-        const char* img = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 9));
-        r.imagem = (img ? std::string(img) : "");
-        r.tags = getTagsFromReceita(r.id);
-        r.ingredientesEstruturados = getIngredientesFromReceita(r.id);
-        r.atualizarIngredientesString();
-        receitas.push_back(r);
+        return -1;
     }
-    
+    int64_t valor = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : -1;
     sqlite3_finalize(stmt);
-    return receitas;
+    return valor;
 }
 
-Receita Database::consultarPorId(int id) {
-    Receita receita;
+bool Database::iniciarCargaEmMassa() {
+    TemporizadorEscopo medicao(__func__);
     sqlite3* sqliteDb = (sqlite3*)db;
-    sqlite3_stmt* stmt;
-    
-    const char* sql = "SELECT id, nome, ingredientes, preparo, tempo, categoria, porcoes, feita, nota, imagem FROM receitas WHERE id = ?";
-    
-    if (sqlite3_prepare_v2(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-        std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
-        return receita;
+    if (sincronoAntesCarga >= 0) {
+        return true;
+    }
+    // PRAGMA synchronous nao muda no meio de uma transacao
+    if (emTransacao()) {
+        std::cerr << "Carga em massa nao pode comecar dentro de uma transacao." << std::endl;
+        return false;
     }
     
-    sqlite3_bind_int(stmt, 1, id);
+    int64_t sincrono = lerPragma(sqliteDb, "PRAGMA synchronous");
+    int64_t cache = lerPragma(sqliteDb, "PRAGMA cache_size");
+    if (sincrono < 0) {
+        return false;
+    }
     
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        receita.id = sqlite3_column_int(stmt, 0);
-        receita.nome = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        receita.ingredientes = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-        receita.preparo = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
-        receita.tempo = sqlite3_column_int(stmt, 4);
-        receita.categoria = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
-        receita.porcoes = sqlite3_column_int(stmt, 6);
-        receita.feita = (sqlite3_column_int(stmt, 7) == 1);
-        receita.nota = sqlite3_column_int(stmt, 8);
-        const char* img = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 9));
-        receita.imagem = (img ? std::string(img) : "");
-        receita.tags = getTagsFromReceita(receita.id);
-        receita.ingredientesEstruturados = getIngredientesFromReceita(receita.id);
-        receita.atualizarIngredientesString();
+    bool ok = iniciarTransacao();
+    for (const auto& indice : INDICES_CARGA) {
+        ok = ok && executeQuery(std::string("DROP INDEX IF EXISTS ") + indice[0]);
+    }
+    if (!ok || !confirmarTransacao()) {
+        if (emTransacao()) {
+            desfazerTransacao();
+        }
+        return false;
     }
     
-    sqlite3_finalize(stmt);
-    return receita;
+    sincronoAntesCarga = static_cast<int>(sincrono);
+    cacheAntesCarga = cache;
+    executeQuery("PRAGMA synchronous = OFF");
+    executeQuery("PRAGMA cache_size = " + std::to_string(CACHE_CARGA_KIB));
+    return true;
 }
 
-std::vector<Receita> Database::buscarPorNome(const std::string& nome) {
-    std::vector<Receita> receitas;
-    sqlite3* sqlite3Db = (sqlite3*)db;
-    sqlite3_stmt* stmt;
-    
-    const char* sql = "SELECT id, nome, ingredientes, preparo, tempo, categoria, porcoes, feita, nota, imagem FROM receitas WHERE nome LIKE ? ORDER BY id";
-    
-    if (sqlite3_prepare_v2(sqlite3Db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-        std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqlite3Db) << std::endl;
-        return receitas;
+bool Database::encerrarCargaEmMassa() {
+    TemporizadorEscopo medicao(__func__);
+    if (sincronoAntesCarga < 0) {
+        return true;
     }
     
-    std::string pattern = "%" + nome + "%";
-    sqlite3_bind_text(stmt, 1, pattern.c_str(), -1, SQLITE_STATIC);
-    
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        Receita r;
-        r.id = sqlite3_column_int(stmt, 0);
-        r.nome = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        r.ingredientes = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-        r.preparo = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
-        r.tempo = sqlite3_column_int(stmt, 4);
-        r.categoria = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
-        r.porcoes = sqlite3_column_int(stmt, 6);
-        r.feita = (sqlite3_column_int(stmt, 7) == 1);
-        r.nota = sqlite3_column_int(stmt, 8);
-        const char* img = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 9));
-        r.imagem = (img ? std::string(img) : "");
-        r.tags = getTagsFromReceita(r.id);
-        r.ingredientesEstruturados = getIngredientesFromReceita(r.id);
-        r.atualizarIngredientesString();
-        receitas.push_back(r);
+    // Os indices voltam antes do synchronous: a recriacao tambem e escrita em massa
+    bool ok = iniciarTransacao();
+    for (const auto& indice : INDICES_CARGA) {
+        ok = ok && executeQuery(indice[1]);
+    }
+    ok = ok && confirmarTransacao();
+    if (!ok && emTransacao()) {
+        desfazerTransacao();
+    }
+    if (!ok) {
+        std::cerr << "Erro ao recriar os indices depois da carga em massa." << std::endl;
+        return false;
     }
     
-    sqlite3_finalize(stmt);
-    return receitas;
+    executeQuery("PRAGMA cache_size = " + std::to_string(cacheAntesCarga));
+    executeQuery("PRAGMA synchronous = " + std::to_string(sincronoAntesCarga));
+    sincronoAntesCarga = -1;
+    return true;
 }
 
-bool Database::excluirReceita(int id) {
+bool Database::atualizarReceita(const Receita& receita) {
+    TemporizadorEscopo medicao(__func__);
     sqlite3* sqliteDb = (sqlite3*)db;
     sqlite3_stmt* stmt;
     
-    const char* sql = "DELETE FROM receitas WHERE id = ?";
+    if (receita.nota < 0 || receita.nota > 5) {
+        std::cerr << "Nota deve estar entre 1 e 5 (0 = sem nota)." << std::endl;
+        return false;
+    }
     
-    if (sqlite3_prepare_v2(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-        std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
+    // Ingredientes e tags gravados decidem o que inserir e apagar: lidos sem
+    // prazo, e uma interrupcao no meio desfaz a atualizacao
+    SemPrazo semPrazo(*this);
+    
+    // Na transacao do chamador, sob um savepoint: uma falha no meio desfaz
+    // so esta atualizacao
+    bool transacaoPropria = sqlite3_get_autocommit(sqliteDb) != 0;
+    if (!(transacaoPropria ? iniciarTransacao() : criarSavepoint("atualizar_receita"))) {
         return false;
     }
+    auto desfazer = [&]() {
+        if (transacaoPropria) {
+            desfazerTransacao();
+        } else {
+            desfazerSavepoint("atualizar_receita");
+        }
+    };
+    auto falhar = [&](const char* contexto) {
+        std::cerr << contexto << ": " << sqlite3_errmsg(sqliteDb) << std::endl;
+        desfazer();
+        return false;
+    };
     
-    sqlite3_bind_int(stmt, 1, id);
+    // Versao gravada das colunas (texto cru, sem reformatar ingredientes)
+    const char* sqlAtual = "SELECT nome, ingredientes, preparo, tempo, categoria, porcoes, feita, nota, imagem FROM receitas WHERE id = ?";
+    if (preparar(sqliteDb, sqlAtual, -1, &stmt, nullptr) != SQLITE_OK) {
+        return falhar("Erro ao preparar statement");
+    }
+    sqlite3_bind_int(stmt, 1, receita.id);
+    if (sqlite3_step(stmt) != SQLITE_ROW) {
+        sqlite3_finalize(stmt);
+        desfazer();
+        std::cerr << "Receita nao encontrada." << std::endl;
+        return false;
+    }
     
-    bool success = (sqlite3_step(stmt) == SQLITE_DONE);
+    struct Coluna {
+        const char* nome;
+        const std::string* texto;   // nullptr: coluna inteira
+        int inteiro;
+    };
+    Coluna colunas[] = {
+        {"nome", &receita.nome, 0},
+        {"ingredientes", &receita.ingredientes, 0},
+        {"preparo", &receita.preparo, 0},
+        {"tempo", nullptr, receita.tempo},
+        {"categoria", &receita.categoria, 0},
+        {"porcoes", nullptr, receita.porcoes},
+        {"feita", nullptr, receita.feita ? 1 : 0},
+        {"nota", nullptr, receita.nota},
+        {"imagem", &receita.imagem, 0},
+    };
+    std::vector<const Coluna*> alteradas;
+    for (int i = 0; i < 9; ++i) {
+        const Coluna& coluna = colunas[i];
+        if (coluna.texto) {
+            const char* atual = reinterpret_cast<const char*>(sqlite3_column_text(stmt, i));
+            if (*coluna.texto != (atual ? atual : "")) {
+                alteradas.push_back(&coluna);
+            }
+        } else if (sqlite3_column_int(stmt, i) != coluna.inteiro) {
+            alteradas.push_back(&coluna);
+        }
+    }
     sqlite3_finalize(stmt);
     
-    return success;
-}
+    // nome, ingredientes e preparo compoem o hash de conteudo
+    bool conteudoAlterado = false;
+    for (const Coluna* coluna : alteradas) {
+        conteudoAlterado = conteudoAlterado || coluna < colunas + 3;
+    }
+    
+    if (!alteradas.empty()) {
+        std::string sql = "UPDATE receitas SET ";
+        for (size_t i = 0; i < alteradas.size(); ++i) {
+            sql += i > 0 ? ", " : "";
+            sql += alteradas[i]->nome;
+            sql += " = ?";
+        }
+        sql += conteudoAlterado ? ", hash_conteudo = ?" : "";
+        sql += " WHERE id = ?";
+        if (preparar(sqliteDb, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+            return falhar("Erro ao preparar statement");
+        }
+        int indice = 1;
+        for (const Coluna* coluna : alteradas) {
+            if (!coluna->texto) {
+                sqlite3_bind_int(stmt, indice++, coluna->inteiro);
+            } else if (coluna->texto->empty() && coluna->texto == &receita.imagem) {
+                sqlite3_bind_null(stmt, indice++);
+            } else {
+                sqlite3_bind_text(stmt, indice++, coluna->texto->c_str(), -1, SQLITE_STATIC);
+            }
+        }
+        if (conteudoAlterado) {
+            sqlite3_bind_int64(stmt, indice++, hashConteudoReceita(receita.nome, receita.ingredientes, receita.preparo));
+        }
+        sqlite3_bind_int(stmt, indice, receita.id);
+        int rc = sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+        if (rc != SQLITE_DONE) {
+            return falhar("Erro ao atualizar receita");
+        }
+    }
+    
+    // Ingredientes: casa por id, depois por conteudo identico e depois por
+    // nome (o id sobrevive a troca de quantidade); os que sobram sao
+    // reaproveitados em ordem (UPDATE) e o excedente vira INSERT/DELETE. A
+    // posicao de cada um e a da lista nova.
+    std::vector<Ingrediente> gravados = getIngredientesFromReceita(receita.id);
+    if (interrompida()) {
+        return falhar("Atualizacao interrompida");
+    }
+    const std::vector<Ingrediente>& novos = receita.ingredientesEstruturados;
+    auto iguais = [](const Ingrediente& a, const Ingrediente& b) {
+        return a.nome == b.nome && a.quantidade == b.quantidade && a.unidade == b.unidade;
+    };
+    std::vector<int> par(novos.size(), -1);
+    std::vector<bool> usado(gravados.size(), false);
+    
+    // Gravados indexados uma vez (por id, conteudo e nome), cada chave com
+    // suas linhas em ordem: casar e O(n + m) e ainda pega o primeiro livre
+    struct Fila {
+        std::vector<size_t> linhas;
+        size_t proxima = 0;
+    };
+    auto chaveConteudo = [](const Ingrediente& ing) {
+        double quantidade = ing.quantidade == 0 ? 0.0 : ing.quantidade;
+        std::string chave = ing.nome;
+        chave.push_back('\0');
+        chave.append(reinterpret_cast<const char*>(&quantidade), sizeof(quantidade));
+        chave += ing.unidade;
+        return chave;
+    };
+    std::unordered_map<int, size_t> porId;
+    std::unordered_map<std::string, Fila> porConteudo;
+    std::unordered_map<std::string, Fila> porNome;
+    for (size_t g = 0; g < gravados.size(); ++g) {
+        porId.emplace(gravados[g].id, g);
+        porConteudo[chaveConteudo(gravados[g])].linhas.push_back(g);
+        porNome[gravados[g].nome].linhas.push_back(g);
+    }
+    auto casar = [&](size_t n, size_t g) {
+        par[n] = static_cast<int>(g);
+        usado[g] = true;
+    };
+    auto casarPrimeiroLivre = [&](std::unordered_map<std::string, Fila>& indice, const std::string& chave, size_t n) {
+        auto it = indice.find(chave);
+        if (it == indice.end()) {
+            return;
+        }
+        Fila& fila = it->second;
+        while (fila.proxima < fila.linhas.size() && usado[fila.linhas[fila.proxima]]) {
+            ++fila.proxima;
+        }
+        if (fila.proxima < fila.linhas.size()) {
+            casar(n, fila.linhas[fila.proxima++]);
+        }
+    };
+    for (size_t n = 0; n < novos.size(); ++n) {
+        auto it = novos[n].id != 0 ? porId.find(novos[n].id) : porId.end();
+        if (it != porId.end() && !usado[it->second]) {
+            casar(n, it->second);
+        }
+    }
+    for (size_t n = 0; n < novos.size(); ++n) {
+        if (par[n] < 0) {
+            casarPrimeiroLivre(porConteudo, chaveConteudo(novos[n]), n);
+        }
+    }
+    for (size_t n = 0; n < novos.size(); ++n) {
+        if (par[n] < 0) {
+            casarPrimeiroLivre(porNome, novos[n].nome, n);
+        }
+    }
+    size_t proximoLivre = 0;
+    for (size_t n = 0; n < novos.size(); ++n) {
+        while (par[n] < 0 && proximoLivre < gravados.size()) {
+            if (!usado[proximoLivre]) {
+                par[n] = static_cast<int>(proximoLivre);
+                usado[proximoLivre] = true;
+            }
+            ++proximoLivre;
+        }
+    }
+    
+    // Parametros fixos: ?1 nome, ?2 quantidade, ?3 unidade, ?4 posicao,
+    // ?5 id do ingrediente, ?6 receita. So mover nao toca a linha se a
+    // posicao ja e a mesma (e nao entra no log de alteracoes).
+    const char* sqlsIngredientes[] = {
+        "UPDATE ingredientes SET nome = ?1, quantidade = ?2, unidade = ?3, posicao = ?4 WHERE id = ?5 AND receita_id = ?6",
+        "INSERT INTO ingredientes (nome, quantidade, unidade, posicao, receita_id) VALUES (?1, ?2, ?3, ?4, ?6)",
+        "DELETE FROM ingredientes WHERE id = ?5 AND receita_id = ?6",
+        "UPDATE ingredientes SET posicao = ?4 WHERE id = ?5 AND receita_id = ?6 AND posicao IS NOT ?4"
+    };
+    sqlite3_stmt* stmtsIngredientes[4] = {};
+    auto executarIngrediente = [&](int tipo, const Ingrediente* ing, size_t posicao, int idIngrediente) {
+        sqlite3_stmt*& alvo = stmtsIngredientes[tipo];
+        if (!alvo && preparar(sqliteDb, sqlsIngredientes[tipo], -1, &alvo, nullptr) != SQLITE_OK) {
+            return false;
+        }
+        if (ing) {
+            sqlite3_bind_text(alvo, 1, ing->nome.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_double(alvo, 2, ing->quantidade);
+            sqlite3_bind_text(alvo, 3, ing->unidade.empty() ? nullptr : ing->unidade.c_str(), -1, SQLITE_STATIC);
+        }
+        if (posicao > 0) {
+            sqlite3_bind_int64(alvo, 4, static_cast<sqlite3_int64>(posicao));
+        }
+        if (idIngrediente > 0) {
+            sqlite3_bind_int(alvo, 5, idIngrediente);
+        }
+        sqlite3_bind_int(alvo, 6, receita.id);
+        int rc = sqlite3_step(alvo);
+        sqlite3_reset(alvo);
+        sqlite3_clear_bindings(alvo);
+        return rc == SQLITE_DONE;
+    };
+    
+    bool ok = true;
+    for (size_t n = 0; ok && n < novos.size(); ++n) {
+        if (par[n] < 0) {
+            ok = executarIngrediente(1, &novos[n], n + 1, 0);
+        } else if (!iguais(gravados[par[n]], novos[n])) {
+            ok = executarIngrediente(0, &novos[n], n + 1, gravados[par[n]].id);
+        } else {
+            ok = executarIngrediente(3, nullptr, n + 1, gravados[par[n]].id);
+        }
+    }
+    for (size_t g = 0; ok && g < gravados.size(); ++g) {
+        if (!usado[g]) {
+            ok = executarIngrediente(2, nullptr, 0, gravados[g].id);
+        }
+    }
+    for (sqlite3_stmt* pendente : stmtsIngredientes) {
+        sqlite3_finalize(pendente);
+    }
+    if (!ok) {
+        return falhar("Erro ao atualizar ingredientes");
+    }
+    
+    // Tags: so os vinculos que entraram ou sairam
+    std::vector<std::string> tagsGravadas = getTagsFromReceita(receita.id);
+    if (interrompida()) {
+        return falhar("Atualizacao interrompida");
+    }
+    for (const auto& nomeTag : tagsGravadas) {
+        if (std::find(receita.tags.begin(), receita.tags.end(), nomeTag) != receita.tags.end()) {
+            continue;
+        }
+        const char* sqlRemover = "DELETE FROM receitas_tags WHERE receita_id = ? AND tag_id = (SELECT id FROM tags WHERE nome = ?)";
+        if (preparar(sqliteDb, sqlRemover, -1, &stmt, nullptr) != SQLITE_OK) {
+            return falhar("Erro ao preparar statement");
+        }
+        sqlite3_bind_int(stmt, 1, receita.id);
+        sqlite3_bind_text(stmt, 2, nomeTag.c_str(), -1, SQLITE_STATIC);
+        int rc = sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+        if (rc != SQLITE_DONE) {
+            return falhar("Erro ao remover tag");
+        }
+    }
+    for (const auto& nomeTag : receita.tags) {
+        if (std::find(tagsGravadas.begin(), tagsGravadas.end(), nomeTag) != tagsGravadas.end()) {
+            continue;
+        }
+        int tagId = createTag(nomeTag);
+        if (tagId <= 0) {
+            return falhar("Erro ao criar tag");
+        }
+        // Insert conferido (addTagToReceita nao devolve erro): uma falha
+        // desfaz o savepoint
+        const char* sqlVincular = "INSERT OR IGNORE INTO receitas_tags (receita_id, tag_id) VALUES (?, ?)";
+        if (preparar(sqliteDb, sqlVincular, -1, &stmt, nullptr) != SQLITE_OK) {
+            return falhar("Erro ao preparar statement");
+        }
+        sqlite3_bind_int(stmt, 1, receita.id);
+        sqlite3_bind_int(stmt, 2, tagId);
+        int rc = sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+        if (rc != SQLITE_DONE) {
+            return falhar("Erro ao vincular tag");
+        }
+        tagsGravadas.push_back(nomeTag);
+    }
+    
+    registrarEscrita(receita.id);
+    if (!(transacaoPropria ? confirmarTransacao() : liberarSavepoint("atualizar_receita"))) {
+        desfazer();
+        return false;
+    }
+    return true;
+}
+
+ListaReceitas Database::listarReceitas(StatusConsulta* status, const LimitesConsulta* limites) {
+    TemporizadorEscopo medicao(__func__);
+    const LimitesConsulta& limitesChamada = limites ? *limites : limitesPadrao;
+    std::string chave = "todas";
+    if (auto emCache = consultaEmCache(chave)) {
+        return limitarLista(std::move(emCache), limitesChamada, status);
+    }
+    std::vector<Receita> receitas;
+    sqlite3* sqliteDb = (sqlite3*)db;
+    sqlite3_stmt* stmt;
+    
+    const char* sql = "SELECT id, nome, ingredientes, preparo, tempo, categoria, porcoes, feita, nota, imagem, criada_em, atualizada_em FROM receitas ORDER BY id";
+    
+    if (preparar(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
+        if (status) {
+            *status = StatusConsulta::Erro;
+        }
+        return ListaReceitas();
+    }
+    
+    StatusConsulta resultado = executarListagem(stmt, limitesChamada, receitas);
+    if (status) {
+        *status = resultado;
+    }
+    return guardarConsulta(chave, std::move(receitas), resultado == StatusConsulta::Ok);
+}
+
+ResultadoReceitas Database::listarReceitasCompacto(unsigned campos) {
+    return listarReceitasCompacto(FiltroReceitas(), campos);
+}
+
+ResultadoReceitas Database::listarReceitasCompacto(const FiltroReceitas& filtro, unsigned campos) {
+    TemporizadorEscopo medicao(__func__);
+    ResultadoReceitas resultado;
+    resultado.origem = this;
+    sqlite3* sqliteDb = (sqlite3*)db;
+    sqlite3_stmt* stmt;
+    
+    std::string condicao = montarCondicao(filtro);
+    resultado.completo = condicao.empty();
+    
+    // Colunas fora da projecao nao sao lidas: o SQLite nem visita as paginas de overflow
+    std::string sql = std::string("SELECT r.id, r.nome, r.tempo, r.categoria, r.porcoes, r.feita, r.nota, "
+                                  "r.criada_em, r.atualizada_em, ")
+                    + ((campos & CAMPO_INGREDIENTES) ? "r.ingredientes, " : "NULL, ")
+                    + ((campos & CAMPO_PREPARO) ? "r.preparo, " : "NULL, ")
+                    + ((campos & CAMPO_IMAGEM) ? "r.imagem" : "NULL")
+                    + " FROM receitas r" + condicao + " ORDER BY r.id";
+    
+    if (preparar(sqliteDb, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
+        return resultado;
+    }
+    
+    vincularFiltro(stmt, filtro, 1);
+    
+    auto lerTexto = [&resultado](sqlite3_stmt* s, ResultadoReceitas::Pool pool, int coluna) {
+        std::string_view texto = colunaTexto(s, coluna);
+        return resultado.adicionarTexto(pool, texto.data(), texto.size());
+    };
+    
+    while (!resultado.excedeu && sqlite3_step(stmt) == SQLITE_ROW) {
+        ResultadoReceitas::Linha linha;
+        linha.id = sqlite3_column_int(stmt, 0);
+        linha.nome = lerTexto(stmt, ResultadoReceitas::POOL_BASE, 1);
+        linha.tempo = sqlite3_column_int(stmt, 2);
+        linha.categoria = lerTexto(stmt, ResultadoReceitas::POOL_BASE, 3);
+        linha.porcoes = sqlite3_column_int(stmt, 4);
+        linha.feita = (sqlite3_column_int(stmt, 5) == 1);
+        linha.nota = sqlite3_column_int(stmt, 6);
+        linha.criadaEm = sqlite3_column_int64(stmt, 7);
+        linha.atualizadaEm = sqlite3_column_int64(stmt, 8);
+        linha.ingredientes = lerTexto(stmt, ResultadoReceitas::POOL_INGREDIENTES, 9);
+        linha.preparo = lerTexto(stmt, ResultadoReceitas::POOL_PREPARO, 10);
+        linha.imagem = lerTexto(stmt, ResultadoReceitas::POOL_IMAGEM, 11);
+        resultado.linhas.push_back(linha);
+    }
+    sqlite3_finalize(stmt);
+    
+    resultado.carregados = campos & (CAMPO_PREPARO | CAMPO_IMAGEM);
+    resultado.textoIngredientesLido = (campos & CAMPO_INGREDIENTES) != 0;
+    if (!resultado.excedeu && (campos & (CAMPO_TAGS | CAMPO_INGREDIENTES))) {
+        carregarCamposResultado(resultado, campos & (CAMPO_TAGS | CAMPO_INGREDIENTES));
+    }
+    
+    // Offsets de 32 bits: melhor falhar do que devolver textos trocados
+    if (resultado.excedeu) {
+        ResultadoReceitas vazio;
+        vazio.excedeu = true;
+        return vazio;
+    }
+    return resultado;
+}
+
+// Percorre as linhas de "select" restritas aos ids do resultado (em lotes de
+// IN (...)) ou sem restricao quando o resultado cobre a tabela inteira.
+// As linhas chegam ordenadas por "ordem", que deve comecar pela coluna de id.
+static void consultarPorIds(sqlite3* sqliteDb, bool completo,
+                            const std::vector<ResultadoReceitas::Linha>& linhas,
+                            const std::string& select, const char* colunaId, const char* ordem,
+                            const std::function<void(sqlite3_stmt*)>& porLinha) {
+    const size_t tamanhoLote = 256;
+    
+    if (linhas.empty()) {
+        return;
+    }
+    
+    auto executar = [&](const std::string& sql, size_t inicio, size_t fim, bool vincular) {
+        sqlite3_stmt* stmt;
+        if (preparar(sqliteDb, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+            std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
+            return;
+        }
+        if (vincular) {
+            for (size_t i = inicio; i < fim; ++i) {
+                sqlite3_bind_int(stmt, static_cast<int>(i - inicio + 1), linhas[i].id);
+            }
+        }
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            porLinha(stmt);
+        }
+        sqlite3_finalize(stmt);
+    };
+    
+    if (completo) {
+        executar(select + " ORDER BY " + ordem, 0, 0, false);
+        return;
+    }
+    
+    for (size_t inicio = 0; inicio < linhas.size(); inicio += tamanhoLote) {
+        size_t fim = std::min(linhas.size(), inicio + tamanhoLote);
+        std::string sql = select + " WHERE " + colunaId + " IN (?";
+        for (size_t i = inicio + 1; i < fim; ++i) {
+            sql += ",?";
+        }
+        sql += std::string(") ORDER BY ") + ordem;
+        executar(sql, inicio, fim, true);
+    }
+}
+
+void Database::carregarCamposResultado(ResultadoReceitas& resultado, unsigned campos) {
+    sqlite3* sqliteDb = (sqlite3*)db;
+    std::vector<ResultadoReceitas::Linha>& linhas = resultado.linhas;
+    campos &= ~resultado.carregados;
+    
+    // Linhas e consultas vem ordenadas por id: localizar e um merge linear
+    size_t atual = 0;
+    auto localizar = [&linhas, &atual](int id) -> ResultadoReceitas::Linha* {
+        while (atual < linhas.size() && linhas[atual].id < id) {
+            ++atual;
+        }
+        return (atual < linhas.size() && linhas[atual].id == id) ? &linhas[atual] : nullptr;
+    };
+    auto lerTexto = [&resultado](sqlite3_stmt* s, ResultadoReceitas::Pool pool, int coluna) {
+        std::string_view texto = colunaTexto(s, coluna);
+        return resultado.adicionarTexto(pool, texto.data(), texto.size());
+    };
+    
+    auto carregarColuna = [&](const char* coluna, ResultadoReceitas::Pool pool, ResultadoReceitas::Faixa ResultadoReceitas::Linha::*destino) {
+        atual = 0;
+        consultarPorIds(sqliteDb, resultado.completo, linhas, std::string("SELECT id, ") + coluna + " FROM receitas", "id", "id",
+            [&](sqlite3_stmt* stmt) {
+                if (ResultadoReceitas::Linha* linha = localizar(sqlite3_column_int(stmt, 0))) {
+                    linha->*destino = lerTexto(stmt, pool, 1);
+                }
+            });
+    };
+    
+    if (campos & CAMPO_PREPARO) {
+        carregarColuna("preparo", ResultadoReceitas::POOL_PREPARO, &ResultadoReceitas::Linha::preparo);
+    }
+    
+    if (campos & CAMPO_IMAGEM) {
+        carregarColuna("imagem", ResultadoReceitas::POOL_IMAGEM, &ResultadoReceitas::Linha::imagem);
+    }
+    
+    if (campos & CAMPO_TAGS) {
+        // Dicionario de tags: cada nome entra no pool uma unica vez
+        std::unordered_map<int, uint32_t> indicePorTagId;
+        sqlite3_stmt* stmt;
+        if (preparar(sqliteDb, "SELECT id, nome FROM tags", -1, &stmt, nullptr) == SQLITE_OK) {
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                indicePorTagId[sqlite3_column_int(stmt, 0)] = static_cast<uint32_t>(resultado.dicionarioTags.size());
+                resultado.dicionarioTags.push_back(lerTexto(stmt, ResultadoReceitas::POOL_TAGS, 1));
+            }
+            sqlite3_finalize(stmt);
+        } else {
+            std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
+        }
+        
+        atual = 0;
+        consultarPorIds(sqliteDb, resultado.completo, linhas,
+            "SELECT rt.receita_id, rt.tag_id FROM receitas_tags rt INNER JOIN tags t ON t.id = rt.tag_id",
+            "rt.receita_id", "rt.receita_id, t.nome",
+            [&](sqlite3_stmt* stmt) {
+                ResultadoReceitas::Linha* linha = localizar(sqlite3_column_int(stmt, 0));
+                auto tag = indicePorTagId.find(sqlite3_column_int(stmt, 1));
+                if (!linha || tag == indicePorTagId.end()) {
+                    return;
+                }
+                if (linha->numTags == 0) {
+                    linha->primeiraTag = static_cast<uint32_t>(resultado.tagsPorLinha.size());
+                }
+                resultado.tagsPorLinha.push_back(tag->second);
+                linha->numTags++;
+            });
+    }
+    
+    if (campos & CAMPO_INGREDIENTES) {
+        if (!resultado.textoIngredientesLido) {
+            carregarColuna("ingredientes", ResultadoReceitas::POOL_INGREDIENTES, &ResultadoReceitas::Linha::ingredientes);
+        }
+        
+        atual = 0;
+        consultarPorIds(sqliteDb, resultado.completo, linhas,
+            "SELECT receita_id, id, nome, quantidade, unidade FROM ingredientes",
+            "receita_id", "receita_id, posicao, id",
+            [&](sqlite3_stmt* stmt) {
+                ResultadoReceitas::Linha* linha = localizar(sqlite3_column_int(stmt, 0));
+                if (!linha) {
+                    return;
+                }
+                ResultadoReceitas::IngredienteCompacto ing;
+                ing.id = sqlite3_column_int(stmt, 1);
+                ing.nome = lerTexto(stmt, ResultadoReceitas::POOL_INGREDIENTES, 2);
+                ing.quantidade = sqlite3_column_double(stmt, 3);
+                ing.unidade = lerTexto(stmt, ResultadoReceitas::POOL_INGREDIENTES, 4);
+                if (linha->numIngredientes == 0) {
+                    linha->primeiroIngrediente = static_cast<uint32_t>(resultado.ingredientesPorLinha.size());
+                }
+                resultado.ingredientesPorLinha.push_back(ing);
+                linha->numIngredientes++;
+            });
+    }
+    
+    resultado.carregados |= campos;
+    if (resultado.excedeu) {
+        std::cerr << "Erro: textos da listagem passam de 4 GiB; use forEachReceita ou uma projecao menor." << std::endl;
+    }
+}
+
+void ResultadoReceitas::garantir(unsigned campo) const {
+    if ((carregados & campo) == campo || !origem) {
+        return;
+    }
+    origem->carregarCamposResultado(const_cast<ResultadoReceitas&>(*this), campo);
+}
+
+int Database::forEachReceita(const FiltroReceitas& filtro, const std::function<bool(const ReceitaLinha&)>& fn,
+                             unsigned campos, StatusConsulta* status, const LimitesConsulta* limites) {
+    TemporizadorEscopo medicao(__func__);
+    const LimitesConsulta& limitesChamada = limites ? *limites : limitesPadrao;
+    sqlite3* sqliteDb = (sqlite3*)db;
+    sqlite3_stmt* stmt;
+    
+    std::string sql = std::string("SELECT r.id, r.nome, ")
+                    + ((campos & CAMPO_INGREDIENTES) ? "r.ingredientes, " : "NULL, ")
+                    + ((campos & CAMPO_PREPARO) ? "r.preparo, " : "NULL, ")
+                    + "r.tempo, r.categoria, r.porcoes, r.feita, r.nota, "
+                    + ((campos & CAMPO_IMAGEM) ? "r.imagem, " : "NULL, ")
+                    + "r.criada_em, r.atualizada_em, "
+                    + ((campos & CAMPO_TAGS) ? "(SELECT group_concat(nome, char(31)) FROM (SELECT t.nome FROM tags t "
+                                               "INNER JOIN receitas_tags rt ON t.id = rt.tag_id "
+                                               "WHERE rt.receita_id = r.id ORDER BY t.nome)) "
+                                             : "NULL ")
+                    + "FROM receitas r" + montarCondicao(filtro) + " ORDER BY r.id";
+    
+    if (preparar(sqliteDb, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
+        if (status) {
+            *status = StatusConsulta::Erro;
+        }
+        return -1;
+    }
+    
+    vincularFiltro(stmt, filtro, 1);
+    
+    iniciarPrazo(limitesChamada);
+    int visitadas = 0;
+    ReceitaLinha linha;
+    std::string tagsJuntas;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (limitesChamada.maxLinhas > 0 && static_cast<size_t>(visitadas) == limitesChamada.maxLinhas) {
+            break;
+        }
+        linha.id = sqlite3_column_int(stmt, 0);
+        linha.nome = colunaTexto(stmt, 1);
+        linha.ingredientes = colunaTexto(stmt, 2);
+        linha.preparo = colunaTexto(stmt, 3);
+        linha.tempo = sqlite3_column_int(stmt, 4);
+        linha.categoria = colunaTexto(stmt, 5);
+        linha.porcoes = sqlite3_column_int(stmt, 6);
+        linha.feita = (sqlite3_column_int(stmt, 7) == 1);
+        linha.nota = sqlite3_column_int(stmt, 8);
+        linha.imagem = colunaTexto(stmt, 9);
+        linha.criadaEm = sqlite3_column_int64(stmt, 10);
+        linha.atualizadaEm = sqlite3_column_int64(stmt, 11);
+        // Separador US (0x1f): nomes de tag podem conter ", "
+        std::string_view tags = colunaTexto(stmt, 12);
+        linha.listaTags.clear();
+        tagsJuntas.clear();
+        for (size_t inicio = 0; inicio < tags.size();) {
+            size_t fim = std::min(tags.find('\x1f', inicio), tags.size());
+            linha.listaTags.push_back(tags.substr(inicio, fim - inicio));
+            tagsJuntas.append(inicio > 0 ? ", " : "").append(tags.substr(inicio, fim - inicio));
+            inicio = fim + 1;
+        }
+        linha.tags = tagsJuntas;
+        visitadas++;
+        if (!fn(linha)) {
+            rc = SQLITE_DONE;
+            break;
+        }
+    }
+    
+    StatusConsulta resultado = encerrarPrazo(statusDoPasso(sqliteDb, rc));
+    sqlite3_finalize(stmt);
+    if (status) {
+        *status = resultado;
+    }
+    if (resultado != StatusConsulta::Ok && resultado != StatusConsulta::LimiteLinhas) {
+        return -1;
+    }
+    return visitadas;
+}
+
+Receita Database::consultarPorId(int id) {
+    TemporizadorEscopo medicao(__func__);
+    EscopoPrazo prazo(*this);
+    Receita receita;
+    validarCache();
+    if (cacheReceitas.obter(id, receita)) {
+        return receita;
+    }
+    
+    sqlite3* sqliteDb = (sqlite3*)db;
+    sqlite3_stmt* stmt;
+    
+    const char* sql = "SELECT id, nome, ingredientes, preparo, tempo, categoria, porcoes, feita, nota, imagem, criada_em, atualizada_em FROM receitas WHERE id = ?";
+    
+    if (preparar(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
+        return receita;
+    }
+    
+    sqlite3_bind_int(stmt, 1, id);
+    
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        receita.id = sqlite3_column_int(stmt, 0);
+        receita.nome = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+        receita.ingredientes = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+        receita.preparo = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
+        receita.tempo = sqlite3_column_int(stmt, 4);
+        receita.categoria = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
+        receita.porcoes = sqlite3_column_int(stmt, 6);
+        receita.feita = (sqlite3_column_int(stmt, 7) == 1);
+        receita.nota = sqlite3_column_int(stmt, 8);
+        const char* img = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 9));
+        receita.imagem = (img ? std::string(img) : "");
+        receita.criadaEm = sqlite3_column_int64(stmt, 10);
+        receita.atualizadaEm = sqlite3_column_int64(stmt, 11);
+        receita.tags = getTagsFromReceita(receita.id);
+        receita.ingredientesEstruturados = getIngredientesFromReceita(receita.id);
+        receita.atualizarIngredientesString();
+    }
+    
+    sqlite3_finalize(stmt);
+    if (prazo.esgotado()) {
+        return Receita();
+    }
+    if (receita.id != 0) {
+        cacheReceitas.inserir(receita);
+    }
+    return receita;
+}
+
+std::vector<Receita> Database::buscarPorNome(const std::string& nome, StatusConsulta* status,
+                                             const LimitesConsulta* limites) {
+    TemporizadorEscopo medicao(__func__);
+    const LimitesConsulta& limitesChamada = limites ? *limites : limitesPadrao;
+    std::vector<Receita> receitas;
+    sqlite3* sqlite3Db = (sqlite3*)db;
+    sqlite3_stmt* stmt;
+    
+    const char* sql = "SELECT id, nome, ingredientes, preparo, tempo, categoria, porcoes, feita, nota, imagem, criada_em, atualizada_em FROM receitas WHERE nome LIKE ? ORDER BY id";
+    
+    if (preparar(sqlite3Db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqlite3Db) << std::endl;
+        if (status) {
+            *status = StatusConsulta::Erro;
+        }
+        return receitas;
+    }
+    
+    std::string pattern = "%" + nome + "%";
+    sqlite3_bind_text(stmt, 1, pattern.c_str(), -1, SQLITE_STATIC);
+    
+    StatusConsulta resultado = executarListagem(stmt, limitesChamada, receitas);
+    if (status) {
+        *status = resultado;
+    }
+    return receitas;
+}
+
+bool Database::excluirReceita(int id) {
+    TemporizadorEscopo medicao(__func__);
+    registrarEscrita(id);
+    sqlite3* sqliteDb = (sqlite3*)db;
+    sqlite3_stmt* stmt;
+    
+    const char* sql = "DELETE FROM receitas WHERE id = ?";
+    
+    if (preparar(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
+        return false;
+    }
+    
+    sqlite3_bind_int(stmt, 1, id);
+    
+    bool success = (sqlite3_step(stmt) == SQLITE_DONE);
+    sqlite3_finalize(stmt);
+    
+    return success;
+}
+
+// ============================================================================
+// HIDRATACAO DE LISTAGENS
+// ============================================================================
+// Carrega tags e ingredientes estruturados de receitas[inicio, fim), que
+// estao em ordem de id, com duas consultas IN (...) por lote de ids
+static bool hidratarFaixa(sqlite3* sqliteDb, std::vector<Receita>& receitas, size_t inicio, size_t fim) {
+    const size_t tamanhoLote = 500;
+    
+    for (size_t lote = inicio; lote < fim; lote += tamanhoLote) {
+        size_t fimLote = std::min(fim, lote + tamanhoLote);
+        std::string ids = "?";
+        for (size_t i = lote + 1; i < fimLote; ++i) {
+            ids += ",?";
+        }
+        std::string sqls[] = {
+            "SELECT rt.receita_id, t.nome FROM receitas_tags rt INNER JOIN tags t ON t.id = rt.tag_id "
+            "WHERE rt.receita_id IN (" + ids + ") ORDER BY rt.receita_id, t.nome",
+            "SELECT receita_id, id, nome, quantidade, unidade FROM ingredientes "
+            "WHERE receita_id IN (" + ids + ") ORDER BY receita_id, posicao, id"
+        };
+        for (int consulta = 0; consulta < 2; ++consulta) {
+            sqlite3_stmt* stmt;
+            if (preparar(sqliteDb, sqls[consulta].c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+                std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
+                return false;
+            }
+            for (size_t i = lote; i < fimLote; ++i) {
+                sqlite3_bind_int(stmt, static_cast<int>(i - lote + 1), receitas[i].id);
+            }
+            size_t atual = lote;
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                int id = sqlite3_column_int(stmt, 0);
+                while (atual < fimLote && receitas[atual].id < id) {
+                    ++atual;
+                }
+                if (atual == fimLote || receitas[atual].id != id) {
+                    continue;
+                }
+                if (consulta == 0) {
+                    receitas[atual].tags.emplace_back(colunaTexto(stmt, 1));
+                    continue;
+                }
+                Ingrediente ing;
+                ing.id = sqlite3_column_int(stmt, 1);
+                ing.nome = colunaTexto(stmt, 2);
+                ing.quantidade = sqlite3_column_double(stmt, 3);
+                ing.unidade = colunaTexto(stmt, 4);
+                receitas[atual].ingredientesEstruturados.push_back(std::move(ing));
+            }
+            sqlite3_finalize(stmt);
+        }
+    }
+    
+    for (size_t i = inicio; i < fim; ++i) {
+        receitas[i].atualizarIngredientesString();
+    }
+    return true;
+}
+
+// Threads fixas, cada uma presa a uma conexao de leitura, que rodam a mesma
+// tarefa em rodadas: executar() entrega a rodada e espera todas terminarem
+class Database::TrabalhadoresLeitura {
+public:
+    explicit TrabalhadoresLeitura(const std::vector<void*>& conexoes) {
+        for (size_t t = 0; t < conexoes.size(); ++t) {
+            threads.emplace_back(&TrabalhadoresLeitura::laco, this, t, (sqlite3*)conexoes[t]);
+        }
+    }
+
+    ~TrabalhadoresLeitura() {
+        {
+            std::lock_guard<std::mutex> trava(mutex);
+            encerrando = true;
+        }
+        haTarefa.notify_all();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    TrabalhadoresLeitura(const TrabalhadoresLeitura&) = delete;
+    TrabalhadoresLeitura& operator=(const TrabalhadoresLeitura&) = delete;
+
+    // tarefa(t, conexao de t) nos trabalhadores t < quantidade
+    void executar(size_t quantidade, const std::function<void(size_t, sqlite3*)>& tarefa) {
+        std::unique_lock<std::mutex> trava(mutex);
+        tarefaAtual = &tarefa;
+        participantes = std::min(quantidade, threads.size());
+        pendentes = participantes;
+        ++rodada;
+        haTarefa.notify_all();
+        concluida.wait(trava, [this] { return pendentes == 0; });
+        tarefaAtual = nullptr;
+    }
+
+private:
+    void laco(size_t indice, sqlite3* conexao) {
+        uint64_t vista = 0;
+        std::unique_lock<std::mutex> trava(mutex);
+        while (true) {
+            haTarefa.wait(trava, [this, vista] { return encerrando || rodada != vista; });
+            if (encerrando) {
+                return;
+            }
+            vista = rodada;
+            if (indice >= participantes) {
+                continue;
+            }
+            const std::function<void(size_t, sqlite3*)>* tarefa = tarefaAtual;
+            trava.unlock();
+            (*tarefa)(indice, conexao);
+            trava.lock();
+            if (--pendentes == 0) {
+                concluida.notify_one();
+            }
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable haTarefa;
+    std::condition_variable concluida;
+    const std::function<void(size_t, sqlite3*)>* tarefaAtual = nullptr;
+    size_t participantes = 0;
+    size_t pendentes = 0;
+    uint64_t rodada = 0;
+    bool encerrando = false;
+    std::vector<std::thread> threads;
+};
+
+bool Database::abrirConexoesLeitura() {
+    if (trabalhadoresLeitura) {
+        return true;
+    }
+    while (conexoesLeitura.size() < static_cast<size_t>(trabalhadoresHidratacao)) {
+        sqlite3* conexao = nullptr;
+        if (sqlite3_open_v2(dbPath.c_str(), &conexao, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr) != SQLITE_OK) {
+            std::cerr << "Erro ao abrir conexao de leitura: " << sqlite3_errmsg(conexao) << std::endl;
+            sqlite3_close(conexao);
+            break;
+        }
+        sqlite3_busy_timeout(conexao, 5000);
+        instalarInstrumentacao(conexao);
+        sqlite3_progress_handler(conexao, INSTRUCOES_POR_VERIFICACAO, &Database::verificarPrazo, this);
+        std::lock_guard<std::mutex> trava(mutexConexao);
+        conexoesLeitura.push_back(conexao);
+    }
+    if (conexoesLeitura.size() < 2) {
+        fecharConexoesLeitura();
+        return false;
+    }
+    trabalhadoresLeitura = std::make_unique<TrabalhadoresLeitura>(conexoesLeitura);
+    return true;
+}
+
+void Database::hidratarReceitas(std::vector<Receita>& receitas) {
+    // Conexoes de leitura nao enxergam o que esta conexao ainda nao confirmou
+    size_t numTrabalhadores = std::min(static_cast<size_t>(std::max(trabalhadoresHidratacao, 1)),
+                                       receitas.size() / MINIMO_POR_TRABALHADOR);
+    if (numTrabalhadores < 2 || dbPath == ":memory:" || sqlite3_get_autocommit((sqlite3*)db) == 0 ||
+        !abrirConexoesLeitura()) {
+        hidratarFaixa((sqlite3*)db, receitas, 0, receitas.size());
+        return;
+    }
+    numTrabalhadores = std::min(numTrabalhadores, conexoesLeitura.size());
+    
+    // Faixas contiguas de ids: cada trabalhador escreve so nas suas receitas
+    // e a ordem por id do resultado se mantem sem etapa de juncao
+    std::vector<char> concluidos(numTrabalhadores, 0);
+    trabalhadoresLeitura->executar(numTrabalhadores, [&receitas, &concluidos, numTrabalhadores](size_t t, sqlite3* conexao) {
+        size_t inicio = receitas.size() * t / numTrabalhadores;
+        size_t fim = receitas.size() * (t + 1) / numTrabalhadores;
+        concluidos[t] = hidratarFaixa(conexao, receitas, inicio, fim) ? 1 : 0;
+    });
+    
+    // Faixa com erro (ex.: SQLITE_BUSY esgotado) e refeita nesta conexao,
+    // exceto se o prazo acabou ou houve interrupcao: o resultado sera descartado
+    if (prazoEsgotado || interrompida()) {
+        return;
+    }
+    for (size_t t = 0; t < numTrabalhadores; ++t) {
+        if (!concluidos[t]) {
+            size_t inicio = receitas.size() * t / numTrabalhadores;
+            size_t fim = receitas.size() * (t + 1) / numTrabalhadores;
+            for (size_t i = inicio; i < fim; ++i) {
+                receitas[i].tags.clear();
+                receitas[i].ingredientesEstruturados.clear();
+            }
+            hidratarFaixa((sqlite3*)db, receitas, inicio, fim);
+        }
+    }
+}
+
+void Database::configurarHidratacaoParalela(int trabalhadores) {
+    trabalhadores = std::max(trabalhadores, 0);
+    if (trabalhadores != trabalhadoresHidratacao) {
+        fecharConexoesLeitura();
+    }
+    trabalhadoresHidratacao = trabalhadores;
+}
+
+void Database::fecharConexoesLeitura() {
+    // As threads saem antes das conexoes que usam
+    trabalhadoresLeitura.reset();
+    std::vector<void*> conexoes;
+    {
+        std::lock_guard<std::mutex> trava(mutexConexao);
+        conexoes.swap(conexoesLeitura);
+    }
+    for (void* conexao : conexoes) {
+        sqlite3_close((sqlite3*)conexao);
+    }
+}
+
+// ============================================================================
+// INTERRUPCAO
+// ============================================================================
+// db e conexoesLeitura so mudam sob mutexConexao, para que interromper()
+// (chamado de outra thread) nunca toque uma conexao ja fechada
+void Database::definirConexao(void* conexao) {
+    std::lock_guard<std::mutex> trava(mutexConexao);
+    db = conexao;
+}
+
+void Database::interromper() {
+    std::lock_guard<std::mutex> trava(mutexConexao);
+    interrupcaoPedida = true;
+    if (db) {
+        sqlite3_interrupt((sqlite3*)db);
+    }
+    for (void* conexao : conexoesLeitura) {
+        sqlite3_interrupt((sqlite3*)conexao);
+    }
+}
+
+void Database::limparInterrupcao() {
+    interrupcaoPedida = false;
+}
+
+bool Database::interrompida() const {
+    return interrupcaoPedida.load();
+}
+
+// ============================================================================
+// PRAZOS E LIMITES DE LISTAGENS
+// ============================================================================
+static int64_t agoraNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Progress handler: chamado a cada INSTRUCOES_POR_VERIFICACAO instrucoes da
+// VM; retornar 1 aborta o passo atual com SQLITE_INTERRUPT
+int Database::verificarPrazo(void* contexto) {
+    Database* banco = static_cast<Database*>(contexto);
+    int64_t limite = banco->prazoLimite.load(std::memory_order_relaxed);
+    if (limite == 0 || agoraNs() < limite) {
+        return 0;
+    }
+    banco->prazoEsgotado = true;
+    return 1;
+}
+
+void Database::iniciarPrazo(const LimitesConsulta& limites) {
+    prazoEsgotado = false;
+    prazoLimite = limites.prazoMs > 0 && prazoSuspenso == 0 ? agoraNs() + static_cast<int64_t>(limites.prazoMs) * 1000000 : 0;
+}
+
+StatusConsulta Database::encerrarPrazo(StatusConsulta status) {
+    prazoLimite = 0;
+    if (prazoEsgotado) {
+        return StatusConsulta::PrazoEsgotado;
+    }
+    if (interrompida()) {
+        return StatusConsulta::Interrompida;
+    }
+    return status;
+}
+
+StatusConsulta Database::executarListagem(void* stmtListagem, const LimitesConsulta& limites,
+                                          std::vector<Receita>& receitas) {
+    sqlite3_stmt* stmt = (sqlite3_stmt*)stmtListagem;
+    iniciarPrazo(limites);
+    
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (limites.maxLinhas > 0 && receitas.size() == limites.maxLinhas) {
+            break;
+        }
+        receitas.push_back(lerReceita(stmt));
+    }
+    StatusConsulta status = statusDoPasso((sqlite3*)db, rc);
+    sqlite3_finalize(stmt);
+    
+    if (status == StatusConsulta::Ok || status == StatusConsulta::LimiteLinhas) {
+        hidratarReceitas(receitas);
+    }
+    status = encerrarPrazo(status);
+    if (status != StatusConsulta::Ok && status != StatusConsulta::LimiteLinhas) {
+        receitas.clear();
+    }
+    return status;
+}
+
+void Database::configurarLimites(const LimitesConsulta& limites) {
+    limitesPadrao = limites;
+}
+
+Database::EscopoPrazo::EscopoPrazo(Database& banco)
+    : banco(banco), proprio(banco.prazoLimite.load() == 0) {
+    if (!proprio) {
+        if (agoraNs() >= banco.prazoLimite.load()) {
+            banco.prazoEsgotado = true;
+        }
+        return;
+    }
+    // Sem prazo configurado o iniciarPrazo so limpa o estado da chamada anterior
+    banco.iniciarPrazo(banco.limitesPadrao);
+}
+
+Database::EscopoPrazo::~EscopoPrazo() {
+    if (proprio) {
+        banco.prazoLimite = 0;
+    }
+}
+
+bool Database::EscopoPrazo::esgotado() const {
+    return banco.prazoEsgotado || banco.interrompida();
+}
+
+Database::SemPrazo::SemPrazo(Database& banco) : banco(banco), limiteAnterior(banco.prazoLimite.load()) {
+    banco.prazoSuspenso++;
+    banco.prazoLimite = 0;
+}
+
+Database::SemPrazo::~SemPrazo() {
+    banco.prazoSuspenso--;
+    banco.prazoLimite = limiteAnterior;
+}
 
 // ============================================================================
 // GERENCIAMENTO DE TAGS
 // ============================================================================
 int Database::createTag(const std::string& nome) {
+    TemporizadorEscopo medicao(__func__);
     sqlite3* sqliteDb = (sqlite3*)db;
     sqlite3_stmt* stmt;
     
     const char* sqlCheck = "SELECT id FROM tags WHERE nome = ?";
-    if (sqlite3_prepare_v2(sqliteDb, sqlCheck, -1, &stmt, nullptr) != SQLITE_OK) {
+    if (preparar(sqliteDb, sqlCheck, -1, &stmt, nullptr) != SQLITE_OK) {
         std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
         return -1;
     }
@@ -384,7 +2071,7 @@ int Database::createTag(const std::string& nome) {
     sqlite3_finalize(stmt);
     
     const char* sqlInsert = "INSERT INTO tags (nome) VALUES (?)";
-    if (sqlite3_prepare_v2(sqliteDb, sqlInsert, -1, &stmt, nullptr) != SQLITE_OK) {
+    if (preparar(sqliteDb, sqlInsert, -1, &stmt, nullptr) != SQLITE_OK) {
         std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
         return -1;
     }
@@ -404,6 +2091,8 @@ int Database::createTag(const std::string& nome) {
 }
 
 std::vector<std::string> Database::getTagsFromReceita(int receitaId) {
+    TemporizadorEscopo medicao(__func__);
+    EscopoPrazo prazo(*this);
     std::vector<std::string> tags;
     sqlite3* sqliteDb = (sqlite3*)db;
     sqlite3_stmt* stmt;
@@ -412,7 +2101,7 @@ std::vector<std::string> Database::getTagsFromReceita(int receitaId) {
                       "INNER JOIN receitas_tags rt ON t.id = rt.tag_id "
                       "WHERE rt.receita_id = ? ORDER BY t.nome";
     
-    if (sqlite3_prepare_v2(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    if (preparar(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
         std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
         return tags;
     }
@@ -427,16 +2116,21 @@ std::vector<std::string> Database::getTagsFromReceita(int receitaId) {
     }
     
     sqlite3_finalize(stmt);
+    if (prazo.esgotado()) {
+        return {};
+    }
     return tags;
 }
 
 void Database::addTagToReceita(int receitaId, int tagId) {
+    TemporizadorEscopo medicao(__func__);
+    registrarEscrita(receitaId);
     sqlite3* sqliteDb = (sqlite3*)db;
     sqlite3_stmt* stmt;
     
     const char* sql = "INSERT OR IGNORE INTO receitas_tags (receita_id, tag_id) VALUES (?, ?)";
     
-    if (sqlite3_prepare_v2(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    if (preparar(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
         std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
         return;
     }
@@ -449,12 +2143,14 @@ void Database::addTagToReceita(int receitaId, int tagId) {
 }
 
 void Database::removeTagFromReceita(int receitaId, int tagId) {
+    TemporizadorEscopo medicao(__func__);
+    registrarEscrita(receitaId);
     sqlite3* sqliteDb = (sqlite3*)db;
     sqlite3_stmt* stmt;
     
     const char* sql = "DELETE FROM receitas_tags WHERE receita_id = ? AND tag_id = ?";
     
-    if (sqlite3_prepare_v2(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    if (preparar(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
         std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
         return;
     }
@@ -466,55 +2162,52 @@ void Database::removeTagFromReceita(int receitaId, int tagId) {
     sqlite3_finalize(stmt);
 }
 
-std::vector<Receita> Database::getReceitasByTag(const std::string& nomeTag) {
+ListaReceitas Database::getReceitasByTag(const std::string& nomeTag, StatusConsulta* status,
+                                         const LimitesConsulta* limites) {
+    TemporizadorEscopo medicao(__func__);
+    const LimitesConsulta& limitesChamada = limites ? *limites : limitesPadrao;
+    std::string chave = "porTag:" + nomeTag;
+    if (auto emCache = consultaEmCache(chave)) {
+        return limitarLista(std::move(emCache), limitesChamada, status);
+    }
     std::vector<Receita> receitas;
     sqlite3* sqliteDb = (sqlite3*)db;
     sqlite3_stmt* stmt;
     
-    const char* sql = "SELECT DISTINCT r.id, r.nome, r.ingredientes, r.preparo, r.tempo, r.categoria, r.porcoes, r.feita, r.nota, r.imagem "
+    const char* sql = "SELECT DISTINCT r.id, r.nome, r.ingredientes, r.preparo, r.tempo, r.categoria, r.porcoes, r.feita, r.nota, r.imagem, "
+                      "r.criada_em, r.atualizada_em "
                       "FROM receitas r "
                       "INNER JOIN receitas_tags rt ON r.id = rt.receita_id "
                       "INNER JOIN tags t ON rt.tag_id = t.id "
                       "WHERE t.nome = ? ORDER BY r.id";
     
-    if (sqlite3_prepare_v2(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    if (preparar(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
         std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
-        return receitas;
+        if (status) {
+            *status = StatusConsulta::Erro;
+        }
+        return ListaReceitas();
     }
     
     sqlite3_bind_text(stmt, 1, nomeTag.c_str(), -1, SQLITE_STATIC);
     
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        Receita r;
-        r.id = sqlite3_column_int(stmt, 0);
-        r.nome = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        r.ingredientes = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-        r.preparo = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
-        r.tempo = sqlite3_column_int(stmt, 4);
-        r.categoria = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
-        r.porcoes = sqlite3_column_int(stmt, 6);
-        r.feita = (sqlite3_column_int(stmt, 7) == 1);
-        r.nota = sqlite3_column_int(stmt, 8);
-        const char* img = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 9));
-        r.imagem = (img ? std::string(img) : "");
-        r.tags = getTagsFromReceita(r.id);
-        r.ingredientesEstruturados = getIngredientesFromReceita(r.id);
-        r.atualizarIngredientesString();
-        receitas.push_back(r);
+    StatusConsulta resultado = executarListagem(stmt, limitesChamada, receitas);
+    if (status) {
+        *status = resultado;
     }
-    
-    sqlite3_finalize(stmt);
-    return receitas;
+    return guardarConsulta(chave, std::move(receitas), resultado == StatusConsulta::Ok);
 }
 
 std::vector<std::pair<int, std::string>> Database::listAllTags() {
+    TemporizadorEscopo medicao(__func__);
+    EscopoPrazo prazo(*this);
     std::vector<std::pair<int, std::string>> tags;
     sqlite3* sqliteDb = (sqlite3*)db;
     sqlite3_stmt* stmt;
     
     const char* sql = "SELECT id, nome FROM tags ORDER BY nome";
     
-    if (sqlite3_prepare_v2(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    if (preparar(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
         std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
         return tags;
     }
@@ -528,17 +2221,22 @@ std::vector<std::pair<int, std::string>> Database::listAllTags() {
     }
     
     sqlite3_finalize(stmt);
+    if (prazo.esgotado()) {
+        return {};
+    }
     return tags;
 }
 
 std::vector<std::string> Database::getTagsByPrefix(const std::string& prefixo) {
+    TemporizadorEscopo medicao(__func__);
+    EscopoPrazo prazo(*this);
     std::vector<std::string> tags;
     sqlite3* sqliteDb = (sqlite3*)db;
     sqlite3_stmt* stmt;
     
     const char* sql = "SELECT nome FROM tags WHERE nome LIKE ? ORDER BY nome LIMIT 10";
     
-    if (sqlite3_prepare_v2(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    if (preparar(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
         std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
         return tags;
     }
@@ -554,19 +2252,211 @@ std::vector<std::string> Database::getTagsByPrefix(const std::string& prefixo) {
     }
     
     sqlite3_finalize(stmt);
+    if (prazo.esgotado()) {
+        return {};
+    }
     return tags;
 }
 
+// Executa "sql" (ja preparado) com os parametros vinculados por "vincular";
+// retorna sqlite3_changes ou -1
+static int executarAlteracao(sqlite3* sqliteDb, const std::string& sql,
+                             const std::function<void(sqlite3_stmt*)>& vincular) {
+    sqlite3_stmt* stmt;
+    if (preparar(sqliteDb, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
+        return -1;
+    }
+    vincular(stmt);
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        std::cerr << "Erro ao alterar tags: " << sqlite3_errmsg(sqliteDb) << std::endl;
+        return -1;
+    }
+    return sqlite3_changes(sqliteDb);
+}
+
+int Database::adicionarTagsEmMassa(const FiltroReceitas& filtro, const std::vector<std::string>& tags) {
+    TemporizadorEscopo medicao(__func__);
+    sqlite3* sqliteDb = (sqlite3*)db;
+    // Na transacao do chamador, sob um savepoint: uma falha no meio nao deixa
+    // tags ou vinculos pela metade
+    bool transacaoPropria = sqlite3_get_autocommit(sqliteDb) != 0;
+    if (!(transacaoPropria ? iniciarTransacao() : criarSavepoint("tags_em_massa"))) {
+        return -1;
+    }
+    
+    const std::string sqlVincular = "INSERT OR IGNORE INTO receitas_tags (receita_id, tag_id) "
+                                    "SELECT r.id, (SELECT id FROM tags WHERE nome = ?) FROM receitas r" +
+                                    montarCondicao(filtro);
+    int criados = 0;
+    for (const auto& nomeTag : tags) {
+        auto vincularNome = [&nomeTag](sqlite3_stmt* stmt) {
+            sqlite3_bind_text(stmt, 1, nomeTag.c_str(), -1, SQLITE_STATIC);
+        };
+        int novaTag = executarAlteracao(sqliteDb, "INSERT OR IGNORE INTO tags (nome) VALUES (?)", vincularNome);
+        int vinculos = novaTag < 0 ? -1 : executarAlteracao(sqliteDb, sqlVincular, [&](sqlite3_stmt* stmt) {
+            vincularNome(stmt);
+            vincularFiltro(stmt, filtro, 2);
+        });
+        if (vinculos < 0) {
+            criados = -1;
+            break;
+        }
+        criados += vinculos;
+    }
+    
+    registrarEscritaEmMassa();
+    if (criados < 0 || !(transacaoPropria ? confirmarTransacao() : liberarSavepoint("tags_em_massa"))) {
+        transacaoPropria ? desfazerTransacao() : desfazerSavepoint("tags_em_massa");
+        return -1;
+    }
+    return criados;
+}
+
+int Database::removerTagsEmMassa(const FiltroReceitas& filtro, const std::vector<std::string>& tags) {
+    TemporizadorEscopo medicao(__func__);
+    sqlite3* sqliteDb = (sqlite3*)db;
+    bool transacaoPropria = sqlite3_get_autocommit(sqliteDb) != 0;
+    if (!(transacaoPropria ? iniciarTransacao() : criarSavepoint("tags_em_massa"))) {
+        return -1;
+    }
+    
+    std::string sql = "DELETE FROM receitas_tags WHERE tag_id = (SELECT id FROM tags WHERE nome = ?)";
+    std::string condicao = montarCondicao(filtro);
+    if (!condicao.empty()) {
+        sql += " AND receita_id IN (SELECT r.id FROM receitas r" + condicao + ")";
+    }
+    int removidos = 0;
+    for (const auto& nomeTag : tags) {
+        int vinculos = executarAlteracao(sqliteDb, sql, [&](sqlite3_stmt* stmt) {
+            sqlite3_bind_text(stmt, 1, nomeTag.c_str(), -1, SQLITE_STATIC);
+            vincularFiltro(stmt, filtro, 2);
+        });
+        if (vinculos < 0) {
+            removidos = -1;
+            break;
+        }
+        removidos += vinculos;
+    }
+    
+    registrarEscritaEmMassa();
+    if (removidos < 0 || !(transacaoPropria ? confirmarTransacao() : liberarSavepoint("tags_em_massa"))) {
+        transacaoPropria ? desfazerTransacao() : desfazerSavepoint("tags_em_massa");
+        return -1;
+    }
+    return removidos;
+}
+
+bool Database::mesclarTags(const std::string& origem, const std::string& destino) {
+    TemporizadorEscopo medicao(__func__);
+    sqlite3* sqliteDb = (sqlite3*)db;
+    sqlite3_stmt* stmt;
+    bool transacaoPropria = sqlite3_get_autocommit(sqliteDb) != 0;
+    if (!(transacaoPropria ? iniciarTransacao() : criarSavepoint("mesclar_tags"))) {
+        return false;
+    }
+    
+    // Como em renomearTag, origem inexistente e erro (nada e criado)
+    bool existe = false;
+    if (preparar(sqliteDb, "SELECT 1 FROM tags WHERE nome = ?", -1, &stmt, nullptr) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, origem.c_str(), -1, SQLITE_STATIC);
+        existe = sqlite3_step(stmt) == SQLITE_ROW;
+        sqlite3_finalize(stmt);
+    }
+    if (!existe) {
+        std::cerr << "Tag nao encontrada: " << origem << std::endl;
+    }
+    
+    bool ok = existe;
+    if (ok && origem != destino) {
+        auto vincularOrigem = [&origem](sqlite3_stmt* stmt) {
+            sqlite3_bind_text(stmt, 1, origem.c_str(), -1, SQLITE_STATIC);
+        };
+        ok = executarAlteracao(sqliteDb, "INSERT OR IGNORE INTO tags (nome) VALUES (?)", [&destino](sqlite3_stmt* stmt) {
+            sqlite3_bind_text(stmt, 1, destino.c_str(), -1, SQLITE_STATIC);
+        }) >= 0;
+        ok = ok && executarAlteracao(sqliteDb,
+                                     "INSERT OR IGNORE INTO receitas_tags (receita_id, tag_id) "
+                                     "SELECT rt.receita_id, (SELECT id FROM tags WHERE nome = ?2) FROM receitas_tags rt "
+                                     "WHERE rt.tag_id = (SELECT id FROM tags WHERE nome = ?1)",
+                                     [&](sqlite3_stmt* stmt) {
+                                         vincularOrigem(stmt);
+                                         sqlite3_bind_text(stmt, 2, destino.c_str(), -1, SQLITE_STATIC);
+                                     }) >= 0;
+        ok = ok && executarAlteracao(sqliteDb,
+                                     "DELETE FROM receitas_tags WHERE tag_id = (SELECT id FROM tags WHERE nome = ?)",
+                                     vincularOrigem) >= 0;
+        ok = ok && executarAlteracao(sqliteDb, "DELETE FROM tags WHERE nome = ?", vincularOrigem) >= 0;
+        registrarEscritaEmMassa();
+    }
+    
+    if (!ok || !(transacaoPropria ? confirmarTransacao() : liberarSavepoint("mesclar_tags"))) {
+        transacaoPropria ? desfazerTransacao() : desfazerSavepoint("mesclar_tags");
+        return false;
+    }
+    return true;
+}
+
+bool Database::renomearTag(const std::string& nomeAtual, const std::string& novoNome) {
+    TemporizadorEscopo medicao(__func__);
+    sqlite3* sqliteDb = (sqlite3*)db;
+    sqlite3_stmt* stmt;
+    // Conferir o novo nome e renomear (ou mesclar) em uma so transacao
+    bool transacaoPropria = sqlite3_get_autocommit(sqliteDb) != 0;
+    if (!(transacaoPropria ? iniciarTransacao() : criarSavepoint("renomear_tag"))) {
+        return false;
+    }
+    
+    bool existe = false;
+    if (preparar(sqliteDb, "SELECT 1 FROM tags WHERE nome = ?", -1, &stmt, nullptr) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, novoNome.c_str(), -1, SQLITE_STATIC);
+        existe = sqlite3_step(stmt) == SQLITE_ROW;
+        sqlite3_finalize(stmt);
+    }
+    
+    bool ok;
+    if (existe) {
+        ok = mesclarTags(nomeAtual, novoNome);
+    } else {
+        int alteradas = executarAlteracao(sqliteDb, "UPDATE tags SET nome = ? WHERE nome = ?", [&](sqlite3_stmt* alvo) {
+            sqlite3_bind_text(alvo, 1, novoNome.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_text(alvo, 2, nomeAtual.c_str(), -1, SQLITE_STATIC);
+        });
+        if (alteradas == 0) {
+            std::cerr << "Tag nao encontrada: " << nomeAtual << std::endl;
+        }
+        ok = alteradas > 0;
+        registrarEscritaEmMassa();
+    }
+    
+    if (!ok || !(transacaoPropria ? confirmarTransacao() : liberarSavepoint("renomear_tag"))) {
+        transacaoPropria ? desfazerTransacao() : desfazerSavepoint("renomear_tag");
+        return false;
+    }
+    return true;
+}
+
+int Database::removerTagsSemUso() {
+    TemporizadorEscopo medicao(__func__);
+    return executarAlteracao((sqlite3*)db,
+                             "DELETE FROM tags WHERE NOT EXISTS (SELECT 1 FROM receitas_tags rt WHERE rt.tag_id = tags.id)",
+                             [](sqlite3_stmt*) {});
+}
+
 // ============================================================================
 // STATUS "FEITA" DAS RECEITAS
 // ============================================================================
 bool Database::marcarReceitaComoFeita(int id, bool feita) {
+    TemporizadorEscopo medicao(__func__);
+    registrarEscrita(id);
     sqlite3* sqliteDb = (sqlite3*)db;
     sqlite3_stmt* stmt;
     
     const char* sql = "UPDATE receitas SET feita = ? WHERE id = ?";
     
-    if (sqlite3_prepare_v2(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    if (preparar(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
         std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
         return false;
     }
@@ -580,45 +2470,39 @@ bool Database::marcarReceitaComoFeita(int id, bool feita) {
     return success;
 }
 
-std::vector<Receita> Database::getReceitasFeitas() {
+ListaReceitas Database::getReceitasFeitas(StatusConsulta* status, const LimitesConsulta* limites) {
+    TemporizadorEscopo medicao(__func__);
+    const LimitesConsulta& limitesChamada = limites ? *limites : limitesPadrao;
+    std::string chave = "feitas";
+    if (auto emCache = consultaEmCache(chave)) {
+        return limitarLista(std::move(emCache), limitesChamada, status);
+    }
     std::vector<Receita> receitas;
     sqlite3* sqliteDb = (sqlite3*)db;
     sqlite3_stmt* stmt;
     
-    const char* sql = "SELECT id, nome, ingredientes, preparo, tempo, categoria, porcoes, feita, nota, imagem FROM receitas WHERE feita = 1 ORDER BY id";
+    const char* sql = "SELECT id, nome, ingredientes, preparo, tempo, categoria, porcoes, feita, nota, imagem, criada_em, atualizada_em FROM receitas WHERE feita = 1 ORDER BY id";
     
-    if (sqlite3_prepare_v2(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    if (preparar(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
         std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
-        return receitas;
+        if (status) {
+            *status = StatusConsulta::Erro;
+        }
+        return ListaReceitas();
     }
     
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        Receita r;
-        r.id = sqlite3_column_int(stmt, 0);
-        r.nome = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        r.ingredientes = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-        r.preparo = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
-        r.tempo = sqlite3_column_int(stmt, 4);
-        r.categoria = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
-        r.porcoes = sqlite3_column_int(stmt, 6);
-        r.feita = (sqlite3_column_int(stmt, 7) == 1);
-        r.nota = sqlite3_column_int(stmt, 8);
-        const char* img = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 9));
-        r.imagem = (img ? std::string(img) : "");
-        r.tags = getTagsFromReceita(r.id);
-        r.ingredientesEstruturados = getIngredientesFromReceita(r.id);
-        r.atualizarIngredientesString();
-        receitas.push_back(r);
+    StatusConsulta resultado = executarListagem(stmt, limitesChamada, receitas);
+    if (status) {
+        *status = resultado;
     }
-    
-    sqlite3_finalize(stmt);
-    return receitas;
+    return guardarConsulta(chave, std::move(receitas), resultado == StatusConsulta::Ok);
 }
 
 // ============================================================================
 // AVALIAÇÃO DE RECEITAS
 // ============================================================================
 bool Database::avaliarReceita(int id, int nota) {
+    TemporizadorEscopo medicao(__func__);
     sqlite3* sqliteDb = (sqlite3*)db;
     sqlite3_stmt* stmt;
     
@@ -640,13 +2524,14 @@ bool Database::avaliarReceita(int id, int nota) {
     
     const char* sql = "UPDATE receitas SET nota = ? WHERE id = ?";
     
-    if (sqlite3_prepare_v2(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    if (preparar(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
         std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
         return false;
     }
     
     sqlite3_bind_int(stmt, 1, nota);
     sqlite3_bind_int(stmt, 2, id);
+    registrarEscrita(id);
     
     bool success = (sqlite3_step(stmt) == SQLITE_DONE);
     sqlite3_finalize(stmt);
@@ -654,47 +2539,42 @@ bool Database::avaliarReceita(int id, int nota) {
     return success;
 }
 
-std::vector<Receita> Database::getReceitasPorNota(int nota) {
+ListaReceitas Database::getReceitasPorNota(int nota, StatusConsulta* status,
+                                           const LimitesConsulta* limites) {
+    TemporizadorEscopo medicao(__func__);
+    const LimitesConsulta& limitesChamada = limites ? *limites : limitesPadrao;
+    std::string chave = "porNota:" + std::to_string(nota);
+    if (auto emCache = consultaEmCache(chave)) {
+        return limitarLista(std::move(emCache), limitesChamada, status);
+    }
     std::vector<Receita> receitas;
     sqlite3* sqliteDb = (sqlite3*)db;
     sqlite3_stmt* stmt;
     
-    const char* sql = "SELECT id, nome, ingredientes, preparo, tempo, categoria, porcoes, feita, nota, imagem FROM receitas WHERE nota = ? AND feita = 1 ORDER BY id";
+    const char* sql = "SELECT id, nome, ingredientes, preparo, tempo, categoria, porcoes, feita, nota, imagem, criada_em, atualizada_em FROM receitas WHERE nota = ? AND feita = 1 ORDER BY id";
     
-    if (sqlite3_prepare_v2(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    if (preparar(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
         std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
-        return receitas;
+        if (status) {
+            *status = StatusConsulta::Erro;
+        }
+        return ListaReceitas();
     }
     
     sqlite3_bind_int(stmt, 1, nota);
     
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        Receita r;
-        r.id = sqlite3_column_int(stmt, 0);
-        r.nome = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        r.ingredientes = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-        r.preparo = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
-        r.tempo = sqlite3_column_int(stmt, 4);
-        r.categoria = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
-        r.porcoes = sqlite3_column_int(stmt, 6);
-        r.feita = (sqlite3_column_int(stmt, 7) == 1);
-        r.nota = sqlite3_column_int(stmt, 8);
-        const char* img = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 9));
-        r.imagem = (img ? std::string(img) : "");
-        r.tags = getTagsFromReceita(r.id);
-        r.ingredientesEstruturados = getIngredientesFromReceita(r.id);
-        r.atualizarIngredientesString();
-        receitas.push_back(r);
+    StatusConsulta resultado = executarListagem(stmt, limitesChamada, receitas);
+    if (status) {
+        *status = resultado;
     }
-    
-    sqlite3_finalize(stmt);
-    return receitas;
+    return guardarConsulta(chave, std::move(receitas), resultado == StatusConsulta::Ok);
 }
 
 // ============================================================================
 // BACKUP E RESTAURAÇÃO
 // ============================================================================
 bool Database::fazerBackup(const std::string& caminhoBackup) {
+    TemporizadorEscopo medicao(__func__);
     if (!db) {
         std::cerr << "Banco de dados nao esta aberto." << std::endl;
         return false;
@@ -718,7 +2598,7 @@ bool Database::fazerBackup(const std::string& caminhoBackup) {
     sqlite3_stmt* checkStmt;
     const char* countSql = "SELECT COUNT(*) FROM receitas";
     int countAntes = 0;
-    if (sqlite3_prepare_v2(sqliteDb, countSql, -1, &checkStmt, nullptr) == SQLITE_OK) {
+    if (preparar(sqliteDb, countSql, -1, &checkStmt, nullptr) == SQLITE_OK) {
         if (sqlite3_step(checkStmt) == SQLITE_ROW) {
             countAntes = sqlite3_column_int(checkStmt, 0);
         }
@@ -746,8 +2626,20 @@ bool Database::fazerBackup(const std::string& caminhoBackup) {
         return false;
     }
     
-    int result = sqlite3_backup_step(backup, -1);
+    // Em etapas de 256 paginas: sqlite3_interrupt nao alcanca a API de
+    // backup, entao o pedido de interrupcao e conferido entre as etapas
+    int result = SQLITE_OK;
+    while (result == SQLITE_OK && !interrompida()) {
+        result = sqlite3_backup_step(backup, 256);
+    }
     if (result != SQLITE_DONE) {
+        if (interrompida()) {
+            std::cerr << "Backup interrompido." << std::endl;
+            sqlite3_backup_finish(backup);
+            sqlite3_close(backupDb);
+            std::filesystem::remove(caminhoBackup);
+            return false;
+        }
         std::cerr << "Erro durante backup: " << sqlite3_errmsg(backupDb) << std::endl;
         sqlite3_backup_finish(backup);
         sqlite3_close(backupDb);
@@ -781,7 +2673,7 @@ bool Database::fazerBackup(const std::string& caminhoBackup) {
         sqlite3_stmt* verifyStmt;
         const char* verifyCountSql = "SELECT COUNT(*) FROM receitas";
         int countBackup = 0;
-        if (sqlite3_prepare_v2(verifyDb, verifyCountSql, -1, &verifyStmt, nullptr) == SQLITE_OK) {
+        if (preparar(verifyDb, verifyCountSql, -1, &verifyStmt, nullptr) == SQLITE_OK) {
             if (sqlite3_step(verifyStmt) == SQLITE_ROW) {
                 countBackup = sqlite3_column_int(verifyStmt, 0);
             }
@@ -795,10 +2687,18 @@ bool Database::fazerBackup(const std::string& caminhoBackup) {
         }
     }
     
+    // Blobs sao imutaveis: backups no mesmo diretorio compartilham a pasta
+    // imagens/ e cada backup copia so o que ainda nao esta la
+    if (armazemImagens.copiarPara((backupDir / "imagens").string()) < 0) {
+        std::cerr << "Erro ao copiar imagens para o backup." << std::endl;
+        return false;
+    }
+    
     return true;
 }
 
 bool Database::restaurarBackup(const std::string& caminhoBackup) {
+    TemporizadorEscopo medicao(__func__);
     if (!std::filesystem::exists(caminhoBackup)) {
         std::cerr << "Arquivo de backup nao encontrado: " << caminhoBackup << std::endl;
         return false;
@@ -821,7 +2721,7 @@ bool Database::restaurarBackup(const std::string& caminhoBackup) {
     
     sqlite3_stmt* stmt;
     const char* checkSql = "SELECT name FROM sqlite_master WHERE type='table' AND name IN ('receitas', 'tags', 'receitas_tags')";
-    if (sqlite3_prepare_v2(backupDb, checkSql, -1, &stmt, nullptr) == SQLITE_OK) {
+    if (preparar(backupDb, checkSql, -1, &stmt, nullptr) == SQLITE_OK) {
         int count = 0;
         while (sqlite3_step(stmt) == SQLITE_ROW) {
             count++;
@@ -835,10 +2735,30 @@ bool Database::restaurarBackup(const std::string& caminhoBackup) {
     }
     sqlite3_close(backupDb);
     
-    if (db) {
-        sqlite3_close((sqlite3*)db);
-        db = nullptr;
+    // O log do backup para em um seq menor que o atual; a restauracao continua
+    // a contagem de onde o vault atual parou
+    int64_t seqAnterior = ultimaAlteracao();
+    
+    registrarEscritaEmMassa();
+    ++geracaoEscrita;
+    versaoDados = -1;
+    if (versaoDadosStmt) {
+        sqlite3_finalize((sqlite3_stmt*)versaoDadosStmt);
+        versaoDadosStmt = nullptr;
     }
+    fecharConexoesLeitura();
+    if (db) {
+        sqlite3* antiga = (sqlite3*)db;
+        definirConexao(nullptr);
+        sqlite3_close(antiga);
+    }
+    // Indices em memoria descrevem o vault antigo: remontados sob demanda
+    indiceSimilares.reset();
+    seqSimilares = -1;
+    similaresDesatualizado = false;
+    analise.reset();
+    analisePendentes.clear();
+    analiseNaTransacao.clear();
     
     std::string backupSeguranca = dbPath + ".pre_restore";
     if (std::filesystem::exists(dbPath)) {
@@ -861,10 +2781,15 @@ bool Database::restaurarBackup(const std::string& caminhoBackup) {
     
     std::this_thread::sleep_for(std::chrono::milliseconds(200));
     
-    if (sqlite3_open_v2(dbPath.c_str(), (sqlite3**)&db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr) != SQLITE_OK) {
+    sqlite3* conexao = nullptr;
+    int rc = sqlite3_open_v2(dbPath.c_str(), &conexao, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr);
+    definirConexao(conexao);
+    if (rc != SQLITE_OK) {
         std::cerr << "Erro ao reabrir banco de dados: " << sqlite3_errmsg((sqlite3*)db) << std::endl;
         return false;
     }
+    instalarInstrumentacao((sqlite3*)db);
+    instalarHooks();
     
     if (!executeQuery("PRAGMA foreign_keys = ON;")) {
         std::cerr << "Erro ao habilitar foreign keys" << std::endl;
@@ -873,55 +2798,368 @@ bool Database::restaurarBackup(const std::string& caminhoBackup) {
     
     executeQuery("PRAGMA journal_mode = DELETE;");
     executeQuery("PRAGMA synchronous = FULL;");
+    executeQuery("PRAGMA temp_store = MEMORY;");
+    
+    // Backups de versoes anteriores recebem as colunas, indices e tabelas atuais
+    if (!createTable() || !createTagsTables() || !createIngredientesTable() || !createAlteracoesTable() ||
+        !createAssinaturasTable()) {
+        return false;
+    }
     
     sqlite3* sqliteDb = (sqlite3*)db;
     
+    // Marca 'R': quem sincroniza pelo log precisa exportar tudo de novo
+    if (preparar(sqliteDb, "INSERT INTO alteracoes (seq, tabela, operacao, momento) "
+                           "SELECT MAX(?, IFNULL(MAX(seq), 0)) + 1, '*', 'R', " AGORA_MS " FROM alteracoes",
+                 -1, &stmt, nullptr) == SQLITE_OK) {
+        sqlite3_bind_int64(stmt, 1, std::max<int64_t>(seqAnterior, 0));
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            std::cerr << "Aviso: Nao foi possivel registrar a restauracao no log de alteracoes." << std::endl;
+        }
+        sqlite3_finalize(stmt);
+    }
+    
     const char* verifySql = "SELECT COUNT(*) FROM receitas";
     int countReceitas = 0;
-    if (sqlite3_prepare_v2(sqliteDb, verifySql, -1, &stmt, nullptr) == SQLITE_OK) {
+    if (preparar(sqliteDb, verifySql, -1, &stmt, nullptr) == SQLITE_OK) {
         if (sqlite3_step(stmt) == SQLITE_ROW) {
             countReceitas = sqlite3_column_int(stmt, 0);
         }
         sqlite3_finalize(stmt);
     }
     
-    const char* countTagsSql = "SELECT COUNT(*) FROM tags";
-    int countTags = 0;
-    if (sqlite3_prepare_v2(sqliteDb, countTagsSql, -1, &stmt, nullptr) == SQLITE_OK) {
-        if (sqlite3_step(stmt) == SQLITE_ROW) {
-            countTags = sqlite3_column_int(stmt, 0);
+    const char* countTagsSql = "SELECT COUNT(*) FROM tags";
+    int countTags = 0;
+    if (preparar(sqliteDb, countTagsSql, -1, &stmt, nullptr) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            countTags = sqlite3_column_int(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+    
+    const char* countRelSql = "SELECT COUNT(*) FROM receitas_tags";
+    int countRel = 0;
+    if (preparar(sqliteDb, countRelSql, -1, &stmt, nullptr) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            countRel = sqlite3_column_int(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+    
+    sqlite3_exec(sqliteDb, "PRAGMA synchronous = FULL;", nullptr, nullptr, nullptr);
+    sqlite3_exec(sqliteDb, "PRAGMA journal_mode = DELETE;", nullptr, nullptr, nullptr);
+    
+    std::filesystem::path imagensBackup = std::filesystem::path(caminhoBackup).parent_path() / "imagens";
+    std::error_code erroImagens;
+    if (std::filesystem::is_directory(imagensBackup, erroImagens) &&
+        ArmazemImagens(imagensBackup.string()).copiarPara(armazemImagens.diretorio()) < 0) {
+        std::cerr << "Aviso: Nao foi possivel restaurar todas as imagens do backup." << std::endl;
+    }
+    
+    std::cout << "Restaurado: " << countReceitas << " receitas, " 
+              << countTags << " tags, " << countRel << " relacionamentos." << std::endl;
+    
+    return true;
+}
+
+// ============================================================================
+// SNAPSHOT
+// ============================================================================
+bool Database::exportarSnapshot(const std::string& caminho) {
+    TemporizadorEscopo medicao(__func__);
+    sqlite3* sqliteDb = (sqlite3*)db;
+    // Receitas, tags e ingredientes lidos no mesmo estado do banco
+    bool transacaoPropria = sqlite3_get_autocommit(sqliteDb) != 0;
+    if (transacaoPropria && !iniciarTransacao()) {
+        return false;
+    }
+    
+    EscritorSnapshot escritor;
+    LimitesConsulta semLimites;
+    bool ok = forEachReceita(FiltroReceitas(), [&escritor](const ReceitaLinha& r) {
+        escritor.adicionarReceita(r);
+        return true;
+    }, CAMPOS_TODOS & ~CAMPO_TAGS, nullptr, &semLimites) >= 0;
+    
+    // Ambas ordenadas por receita_id: casadas com os ids do escritor em uma passada
+    const char* sqls[] = {
+        "SELECT rt.receita_id, t.nome FROM receitas_tags rt INNER JOIN tags t ON t.id = rt.tag_id "
+        "ORDER BY rt.receita_id, t.nome",
+        "SELECT receita_id, id, nome, quantidade, unidade FROM ingredientes ORDER BY receita_id, posicao, id"
+    };
+    const std::vector<int32_t>& ids = escritor.idsReceitas();
+    for (int consulta = 0; consulta < 2 && ok; ++consulta) {
+        sqlite3_stmt* stmt;
+        if (preparar(sqliteDb, sqls[consulta], -1, &stmt, nullptr) != SQLITE_OK) {
+            std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
+            ok = false;
+            break;
+        }
+        size_t atual = 0;
+        int rc;
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            int id = sqlite3_column_int(stmt, 0);
+            while (atual < ids.size() && ids[atual] < id) {
+                ++atual;
+            }
+            if (atual == ids.size() || ids[atual] != id) {
+                continue;
+            }
+            if (consulta == 0) {
+                escritor.adicionarTag(atual, colunaTexto(stmt, 1));
+            } else {
+                escritor.adicionarIngrediente(atual, sqlite3_column_int(stmt, 1), colunaTexto(stmt, 2),
+                                              sqlite3_column_double(stmt, 3), colunaTexto(stmt, 4));
+            }
+        }
+        if (rc != SQLITE_DONE) {
+            std::cerr << "Erro ao ler vault para o snapshot: " << sqlite3_errmsg(sqliteDb) << std::endl;
+            ok = false;
+        }
+        sqlite3_finalize(stmt);
+    }
+    
+    if (transacaoPropria) {
+        confirmarTransacao();
+    }
+    return ok && escritor.gravar(caminho);
+}
+
+// ============================================================================
+// LOG DE ALTERACOES
+// ============================================================================
+int Database::alteracoesDesde(int64_t desde, const std::function<bool(const Alteracao&)>& fn,
+                              StatusConsulta* status, const LimitesConsulta* limites) {
+    TemporizadorEscopo medicao(__func__);
+    const LimitesConsulta& limitesChamada = limites ? *limites : limitesPadrao;
+    sqlite3* sqliteDb = (sqlite3*)db;
+    sqlite3_stmt* stmt;
+    
+    // Faixa sobre a chave primaria: custa so as linhas entregues
+    const char* sql = "SELECT seq, tabela, operacao, receita_id, chave, momento FROM alteracoes "
+                      "WHERE seq > ? ORDER BY seq";
+    if (preparar(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
+        if (status) {
+            *status = StatusConsulta::Erro;
+        }
+        return -1;
+    }
+    sqlite3_bind_int64(stmt, 1, desde);
+    
+    iniciarPrazo(limitesChamada);
+    int entregues = 0;
+    Alteracao alteracao;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        if (limitesChamada.maxLinhas > 0 && static_cast<size_t>(entregues) == limitesChamada.maxLinhas) {
+            break;
+        }
+        alteracao.seq = sqlite3_column_int64(stmt, 0);
+        alteracao.tabela = colunaTexto(stmt, 1);
+        std::string_view operacao = colunaTexto(stmt, 2);
+        alteracao.operacao = operacao.empty() ? '?' : operacao[0];
+        alteracao.receitaId = sqlite3_column_int(stmt, 3);
+        alteracao.chave = sqlite3_column_int(stmt, 4);
+        alteracao.momento = sqlite3_column_int64(stmt, 5);
+        entregues++;
+        if (!fn(alteracao)) {
+            rc = SQLITE_DONE;
+            break;
+        }
+    }
+    
+    StatusConsulta resultado = encerrarPrazo(statusDoPasso(sqliteDb, rc));
+    sqlite3_finalize(stmt);
+    if (status) {
+        *status = resultado;
+    }
+    if (resultado != StatusConsulta::Ok && resultado != StatusConsulta::LimiteLinhas) {
+        return -1;
+    }
+    return entregues;
+}
+
+int64_t Database::ultimaAlteracao() {
+    TemporizadorEscopo medicao(__func__);
+    sqlite3* sqliteDb = (sqlite3*)db;
+    sqlite3_stmt* stmt;
+    
+    if (preparar(sqliteDb, "SELECT IFNULL(MAX(seq), 0) FROM alteracoes", -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
+        return -1;
+    }
+    int64_t seq = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : -1;
+    sqlite3_finalize(stmt);
+    return seq;
+}
+
+int Database::descartarAlteracoes(int64_t ate) {
+    TemporizadorEscopo medicao(__func__);
+    sqlite3* sqliteDb = (sqlite3*)db;
+    sqlite3_stmt* stmt;
+    
+    // A ultima linha fica: e ela que mantem a contagem do seq
+    if (preparar(sqliteDb, "DELETE FROM alteracoes WHERE seq <= ? AND seq < (SELECT MAX(seq) FROM alteracoes)", -1,
+                 &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
+        return -1;
+    }
+    sqlite3_bind_int64(stmt, 1, ate);
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        std::cerr << "Erro ao descartar alteracoes: " << sqlite3_errmsg(sqliteDb) << std::endl;
+        return -1;
+    }
+    return sqlite3_changes(sqliteDb);
+}
+
+// ============================================================================
+// IMAGENS
+// ============================================================================
+ArmazemImagens& Database::imagens() {
+    return armazemImagens;
+}
+
+int Database::importarImagens() {
+    TemporizadorEscopo medicao(__func__);
+    sqlite3* sqliteDb = (sqlite3*)db;
+    sqlite3_stmt* stmt;
+    
+    // Lidas antes dos UPDATEs para nao alterar a tabela sob um SELECT aberto
+    std::vector<std::pair<int, std::string>> pendentes;
+    const char* sql = "SELECT id, imagem FROM receitas WHERE imagem IS NOT NULL AND imagem <> '' "
+                      "AND imagem NOT LIKE 'sha256:%' ORDER BY id";
+    if (preparar(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
+        return -1;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        pendentes.emplace_back(sqlite3_column_int(stmt, 0), colunaTexto(stmt, 1));
+    }
+    sqlite3_finalize(stmt);
+    if (pendentes.empty()) {
+        return 0;
+    }
+    
+    bool transacaoPropria = sqlite3_get_autocommit(sqliteDb) != 0;
+    if (transacaoPropria && !iniciarTransacao()) {
+        return -1;
+    }
+    if (preparar(sqliteDb, "UPDATE receitas SET imagem = ? WHERE id = ?", -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
+        if (transacaoPropria) {
+            desfazerTransacao();
+        }
+        return -1;
+    }
+    
+    // O mesmo arquivo em varias receitas e lido uma vez
+    std::unordered_map<std::string, std::string> referencias;
+    int alteradas = 0;
+    for (const auto& [id, caminho] : pendentes) {
+        auto encontrada = referencias.find(caminho);
+        if (encontrada == referencias.end()) {
+            std::error_code erro;
+            std::string referencia = std::filesystem::is_regular_file(caminho, erro) ?
+                                     armazemImagens.guardarArquivo(caminho) : "";
+            encontrada = referencias.emplace(caminho, referencia).first;
+        }
+        if (encontrada->second.empty()) {
+            continue;
+        }
+        sqlite3_bind_text(stmt, 1, encontrada->second.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 2, id);
+        registrarEscrita(id);
+        bool ok = sqlite3_step(stmt) == SQLITE_DONE;
+        sqlite3_reset(stmt);
+        if (!ok) {
+            std::cerr << "Erro ao atualizar imagem: " << sqlite3_errmsg(sqliteDb) << std::endl;
+            sqlite3_finalize(stmt);
+            if (transacaoPropria) {
+                desfazerTransacao();
+            }
+            return -1;
+        }
+        ++alteradas;
+    }
+    sqlite3_finalize(stmt);
+    
+    if (transacaoPropria && !confirmarTransacao()) {
+        return -1;
+    }
+    return alteradas;
+}
+
+int Database::removerImagensSemUso(int carenciaSegundos) {
+    TemporizadorEscopo medicao(__func__);
+    sqlite3* sqliteDb = (sqlite3*)db;
+    sqlite3_stmt* stmt;
+    
+    // Candidatos antes do lock: blob que aparecer depois disso nao e tocado
+    std::vector<std::string> candidatos = armazemImagens.listar();
+    if (candidatos.empty()) {
+        return 0;
+    }
+    
+    // As referencias sao relidas com o lock de escrita: nenhuma receita passa
+    // a apontar para um blob entre a leitura e a remocao. Um blob guardado por
+    // quem ainda espera esse lock para gravar a referencia e protegido pela
+    // carencia (guardar* renova o mtime).
+    bool transacaoPropria = sqlite3_get_autocommit(sqliteDb) != 0;
+    if (transacaoPropria && !iniciarTransacao()) {
+        return -1;
+    }
+    auto falhar = [&]() {
+        if (transacaoPropria) {
+            desfazerTransacao();
         }
-        sqlite3_finalize(stmt);
+        return -1;
+    };
+    
+    const char* sql = "SELECT DISTINCT imagem FROM receitas WHERE imagem LIKE 'sha256:%'";
+    if (preparar(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
+        return falhar();
+    }
+    std::unordered_set<std::string> usados;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        usados.emplace(ArmazemImagens::hashDaReferencia(colunaTexto(stmt, 0)));
+    }
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        std::cerr << "Erro ao ler imagens das receitas: " << sqlite3_errmsg(sqliteDb) << std::endl;
+        return falhar();
     }
     
-    const char* countRelSql = "SELECT COUNT(*) FROM receitas_tags";
-    int countRel = 0;
-    if (sqlite3_prepare_v2(sqliteDb, countRelSql, -1, &stmt, nullptr) == SQLITE_OK) {
-        if (sqlite3_step(stmt) == SQLITE_ROW) {
-            countRel = sqlite3_column_int(stmt, 0);
+    int removidos = 0;
+    for (const auto& hash : candidatos) {
+        if (!usados.count(hash) && !armazemImagens.recente(hash, carenciaSegundos) && armazemImagens.remover(hash)) {
+            ++removidos;
         }
-        sqlite3_finalize(stmt);
     }
-    
-    sqlite3_exec(sqliteDb, "PRAGMA synchronous = FULL;", nullptr, nullptr, nullptr);
-    sqlite3_exec(sqliteDb, "PRAGMA journal_mode = DELETE;", nullptr, nullptr, nullptr);
-    
-    std::cout << "Restaurado: " << countReceitas << " receitas, " 
-              << countTags << " tags, " << countRel << " relacionamentos." << std::endl;
-    
-    return true;
+    if (transacaoPropria && !confirmarTransacao()) {
+        return falhar();
+    }
+    return removidos;
 }
 
 // ============================================================================
 // GERENCIAMENTO DE INGREDIENTES ESTRUTURADOS
 // ============================================================================
 void Database::addIngredienteToReceita(int receitaId, const Ingrediente& ingrediente) {
+    TemporizadorEscopo medicao(__func__);
+    registrarEscrita(receitaId);
     sqlite3* sqliteDb = (sqlite3*)db;
     sqlite3_stmt* stmt;
     
-    const char* sql = "INSERT INTO ingredientes (receita_id, nome, quantidade, unidade) VALUES (?, ?, ?, ?)";
+    // No fim da lista da receita
+    const char* sql = "INSERT INTO ingredientes (receita_id, nome, quantidade, unidade, posicao) "
+                      "SELECT ?1, ?2, ?3, ?4, IFNULL(MAX(posicao), 0) + 1 FROM ingredientes WHERE receita_id = ?1";
     
-    if (sqlite3_prepare_v2(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    if (preparar(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
         std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
         return;
     }
@@ -936,13 +3174,15 @@ void Database::addIngredienteToReceita(int receitaId, const Ingrediente& ingredi
 }
 
 std::vector<Ingrediente> Database::getIngredientesFromReceita(int receitaId) {
+    TemporizadorEscopo medicao(__func__);
+    EscopoPrazo prazo(*this);
     std::vector<Ingrediente> ingredientes;
     sqlite3* sqliteDb = (sqlite3*)db;
     sqlite3_stmt* stmt;
     
-    const char* sql = "SELECT id, nome, quantidade, unidade FROM ingredientes WHERE receita_id = ? ORDER BY id";
+    const char* sql = "SELECT id, nome, quantidade, unidade FROM ingredientes WHERE receita_id = ? ORDER BY posicao, id";
     
-    if (sqlite3_prepare_v2(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    if (preparar(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
         std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
         return ingredientes;
     }
@@ -960,16 +3200,21 @@ std::vector<Ingrediente> Database::getIngredientesFromReceita(int receitaId) {
     }
     
     sqlite3_finalize(stmt);
+    if (prazo.esgotado()) {
+        return {};
+    }
     return ingredientes;
 }
 
 void Database::removeIngredienteFromReceita(int receitaId, int ingredienteId) {
+    TemporizadorEscopo medicao(__func__);
+    registrarEscrita(receitaId);
     sqlite3* sqliteDb = (sqlite3*)db;
     sqlite3_stmt* stmt;
     
     const char* sql = "DELETE FROM ingredientes WHERE receita_id = ? AND id = ?";
     
-    if (sqlite3_prepare_v2(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    if (preparar(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
         std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
         return;
     }
@@ -982,12 +3227,14 @@ void Database::removeIngredienteFromReceita(int receitaId, int ingredienteId) {
 }
 
 void Database::clearIngredientesFromReceita(int receitaId) {
+    TemporizadorEscopo medicao(__func__);
+    registrarEscrita(receitaId);
     sqlite3* sqliteDb = (sqlite3*)db;
     sqlite3_stmt* stmt;
     
     const char* sql = "DELETE FROM ingredientes WHERE receita_id = ?";
     
-    if (sqlite3_prepare_v2(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    if (preparar(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
         std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
         return;
     }
@@ -998,12 +3245,731 @@ void Database::clearIngredientesFromReceita(int receitaId) {
     sqlite3_finalize(stmt);
 }
 
+// ============================================================================
+// LISTA DE COMPRAS
+// ============================================================================
+std::vector<ItemCompra> Database::gerarListaCompras(const std::vector<ItemPlano>& plano) {
+    TemporizadorEscopo medicao(__func__);
+    EscopoPrazo prazo(*this);
+    sqlite3* sqliteDb = (sqlite3*)db;
+    
+    // Por receita: porcoes pedidas e quantas vezes entrou com o rendimento original
+    struct Pedido {
+        double porcoes = 0;
+        int lotes = 0;
+    };
+    std::unordered_map<int, Pedido> pedidos;
+    std::vector<int> ids;
+    for (const auto& item : plano) {
+        auto inserido = pedidos.emplace(item.receitaId, Pedido());
+        if (inserido.second) {
+            ids.push_back(item.receitaId);
+        }
+        if (item.porcoes > 0) {
+            inserido.first->second.porcoes += item.porcoes;
+        } else {
+            inserido.first->second.lotes++;
+        }
+    }
+    
+    // Uma consulta por bloco de ids (um unico bloco em planos usuais)
+    const size_t tamanhoBloco = 500;
+    AgregadorCompras agregador;
+    for (size_t inicio = 0; inicio < ids.size(); inicio += tamanhoBloco) {
+        size_t fim = std::min(ids.size(), inicio + tamanhoBloco);
+        std::string sql = "SELECT i.receita_id, r.porcoes, i.nome, i.quantidade, i.unidade "
+                          "FROM ingredientes i INNER JOIN receitas r ON r.id = i.receita_id "
+                          "WHERE i.receita_id IN (";
+        for (size_t i = inicio; i < fim; ++i) {
+            sql += i > inicio ? ",?" : "?";
+        }
+        sql += ")";
+        
+        sqlite3_stmt* stmt;
+        if (preparar(sqliteDb, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+            std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
+            return {};
+        }
+        for (size_t i = inicio; i < fim; ++i) {
+            sqlite3_bind_int(stmt, static_cast<int>(i - inicio + 1), ids[i]);
+        }
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            const Pedido& pedido = pedidos[sqlite3_column_int(stmt, 0)];
+            int rendimento = sqlite3_column_int(stmt, 1);
+            double fator = pedido.porcoes / (rendimento > 0 ? rendimento : 1) + pedido.lotes;
+            agregador.adicionar(colunaTexto(stmt, 2), sqlite3_column_double(stmt, 3), colunaTexto(stmt, 4), fator);
+        }
+        sqlite3_finalize(stmt);
+    }
+    if (prazo.esgotado()) {
+        return {};
+    }
+    return agregador.resultado();
+}
+
+// ============================================================================
+// TRANSACOES
+// ============================================================================
+bool Database::iniciarTransacao() {
+    TemporizadorEscopo medicao(__func__);
+    return executeQuery("BEGIN IMMEDIATE");
+}
+
+bool Database::confirmarTransacao() {
+    TemporizadorEscopo medicao(__func__);
+    return executeQuery("COMMIT");
+}
+
+bool Database::desfazerTransacao() {
+    TemporizadorEscopo medicao(__func__);
+    // Entradas lidas dentro da transacao podem refletir escritas desfeitas
+    registrarEscritaEmMassa();
+    ++geracaoEscrita;
+    return executeQuery("ROLLBACK");
+}
+
+bool Database::emTransacao() {
+    return db && sqlite3_get_autocommit((sqlite3*)db) == 0;
+}
+
+bool Database::criarSavepoint(const std::string& nome) {
+    TemporizadorEscopo medicao(__func__);
+    return executeQuery("SAVEPOINT " + nome);
+}
+
+bool Database::liberarSavepoint(const std::string& nome) {
+    TemporizadorEscopo medicao(__func__);
+    return executeQuery("RELEASE " + nome);
+}
+
+bool Database::desfazerSavepoint(const std::string& nome) {
+    TemporizadorEscopo medicao(__func__);
+    registrarEscritaEmMassa();
+    ++geracaoEscrita;
+    // ROLLBACK TO nao passa pelo rollback hook
+    registrarDesfazimento();
+    // Interrupcao ou erro grave podem ter feito o SQLite desfazer a
+    // transacao inteira, levando o savepoint junto
+    if (!emTransacao()) {
+        return true;
+    }
+    return executeQuery("ROLLBACK TO " + nome) && executeQuery("RELEASE " + nome);
+}
+
 // ============================================================================
 // FECHAMENTO E LIMPEZA
 // ============================================================================
 void Database::close() {
+    cacheReceitas.limpar();
+    cacheConsultas.limpar();
+    indiceSimilares.reset();
+    seqSimilares = -1;
+    analise.reset();
+    analisePendentes.clear();
+    analiseNaTransacao.clear();
+    versaoDados = -1;
+    if (versaoDadosStmt) {
+        sqlite3_finalize((sqlite3_stmt*)versaoDadosStmt);
+        versaoDadosStmt = nullptr;
+    }
+    fecharConexoesLeitura();
     if (db) {
-        sqlite3_close((sqlite3*)db);
-        db = nullptr;
+        sqlite3* antiga = (sqlite3*)db;
+        definirConexao(nullptr);
+        sqlite3_close(antiga);
+    }
+}
+
+// ============================================================================
+// CACHE DE RECEITAS
+// ============================================================================
+void Database::configurarCache(size_t bytes) {
+    cacheReceitas.definirOrcamento(bytes);
+    cacheConsultas.definirOrcamento(bytes);
+}
+
+void Database::validarCache() {
+    if ((cacheReceitas.orcamento() == 0 && cacheConsultas.orcamento() == 0) || !db) {
+        return;
+    }
+    sqlite3* sqliteDb = (sqlite3*)db;
+    if (!versaoDadosStmt &&
+        preparar(sqliteDb, "PRAGMA data_version", -1, (sqlite3_stmt**)&versaoDadosStmt, nullptr) != SQLITE_OK) {
+        registrarEscritaEmMassa();
+        return;
+    }
+    
+    sqlite3_stmt* stmt = (sqlite3_stmt*)versaoDadosStmt;
+    long long versao = -1;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        versao = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_reset(stmt);
+    
+    // data_version so muda com commits de outras conexoes
+    if (versao < 0 || versao != versaoDados) {
+        registrarEscritaEmMassa();
+        ++geracaoEscrita;
+        versaoDados = versao;
+    }
+}
+
+void Database::registrarAlteracao(void* contexto, int, const char*, const char* tabela, long long) {
+    // Gravar assinaturas nao muda nenhuma listagem
+    if (std::strcmp(tabela, "assinaturas") == 0 || std::strcmp(tabela, "indices_persistidos") == 0) {
+        return;
+    }
+    ++static_cast<Database*>(contexto)->geracaoEscrita;
+}
+
+void Database::registrarRollback(void* contexto) {
+    static_cast<Database*>(contexto)->registrarDesfazimento();
+}
+
+void Database::registrarDesfazimento() {
+    similaresDesatualizado = true;
+    // O log volta ao seq de antes da primeira aplicacao dentro da transacao,
+    // e o que foi aplicado desde entao e relido
+    if (analiseCarregadaNaTransacao) {
+        analiseDesatualizada = true;
+        analiseCarregadaNaTransacao = false;
+    } else if (!analiseNaTransacao.empty()) {
+        analisePendentes.insert(analisePendentes.end(), analiseNaTransacao.begin(), analiseNaTransacao.end());
+        analiseNaTransacao.clear();
+        seqAnalise = seqAnaliseAntesTransacao;
+    }
+}
+
+void Database::instalarHooks() {
+    sqlite3_update_hook((sqlite3*)db, &Database::registrarAlteracao, this);
+    sqlite3_rollback_hook((sqlite3*)db, &Database::registrarRollback, this);
+    sqlite3_progress_handler((sqlite3*)db, INSTRUCOES_POR_VERIFICACAO, &Database::verificarPrazo, this);
+}
+
+std::shared_ptr<const std::vector<Receita>> Database::consultaEmCache(const std::string& chave) {
+    if (cacheConsultas.orcamento() == 0) {
+        return nullptr;
+    }
+    validarCache();
+    return cacheConsultas.obter(chave, geracaoEscrita);
+}
+
+ListaReceitas Database::guardarConsulta(const std::string& chave, std::vector<Receita> receitas, bool completa) {
+    auto compartilhadas = std::make_shared<const std::vector<Receita>>(std::move(receitas));
+    if (completa && cacheConsultas.orcamento() > 0 && !interrompida()) {
+        cacheConsultas.inserir(chave, geracaoEscrita, compartilhadas);
+    }
+    return ListaReceitas(std::move(compartilhadas));
+}
+
+void Database::registrarEscrita(int receitaId) {
+    cacheReceitas.invalidar(receitaId);
+}
+
+void Database::registrarEscritaEmMassa() {
+    cacheReceitas.limpar();
+}
+
+// ============================================================================
+// RECEITAS SIMILARES
+// ============================================================================
+static void codificarAssinatura(const IndiceSimilaridade::Assinatura& assinatura,
+                               unsigned char (&bytes)[IndiceSimilaridade::NUM_HASHES * 2]) {
+    for (int i = 0; i < IndiceSimilaridade::NUM_HASHES; ++i) {
+        bytes[2 * i] = static_cast<unsigned char>(assinatura[i] & 0xFF);
+        bytes[2 * i + 1] = static_cast<unsigned char>(assinatura[i] >> 8);
+    }
+}
+
+// Le a tabela assinaturas para o indice (vazio) e retorna o seq ate o qual
+// ela vale; -1 se nunca foi gravada ou em erro
+int64_t Database::lerAssinaturasGravadas() {
+    sqlite3* sqliteDb = (sqlite3*)db;
+    sqlite3_stmt* stmt;
+    int64_t seq = -1;
+    
+    if (preparar(sqliteDb, "SELECT seq FROM indices_persistidos WHERE nome = 'assinaturas'", -1, &stmt,
+                 nullptr) != SQLITE_OK) {
+        return -1;
+    }
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        seq = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    if (seq < 0 || preparar(sqliteDb, "SELECT receita_id, sig FROM assinaturas", -1, &stmt, nullptr) != SQLITE_OK) {
+        return -1;
+    }
+    
+    const int tamanho = IndiceSimilaridade::NUM_HASHES * 2;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(sqlite3_column_blob(stmt, 1));
+        if (!bytes || sqlite3_column_bytes(stmt, 1) != tamanho) {
+            rc = SQLITE_CORRUPT;
+            break;
+        }
+        IndiceSimilaridade::Assinatura assinatura;
+        for (int i = 0; i < IndiceSimilaridade::NUM_HASHES; ++i) {
+            assinatura[i] = static_cast<uint16_t>(bytes[2 * i] | (bytes[2 * i + 1] << 8));
+        }
+        indiceSimilares->definir(sqlite3_column_int(stmt, 0), assinatura);
+    }
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        indiceSimilares->limpar();
+        return -1;
+    }
+    return seq;
+}
+
+bool Database::receitasAlteradasDesde(int64_t desde, std::vector<int>& ids) {
+    sqlite3* sqliteDb = (sqlite3*)db;
+    sqlite3_stmt* stmt;
+    
+    // O log tem de comecar logo depois de "desde" e nao ter restauracao no meio
+    const char* cobertura = "SELECT (SELECT MIN(seq) FROM alteracoes WHERE seq > ?1) <= ?1 + 1 "
+                            "AND NOT EXISTS (SELECT 1 FROM alteracoes WHERE seq > ?1 AND operacao = 'R')";
+    if (preparar(sqliteDb, cobertura, -1, &stmt, nullptr) != SQLITE_OK) {
+        return false;
+    }
+    sqlite3_bind_int64(stmt, 1, desde);
+    bool coberto = sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0) == 1;
+    sqlite3_finalize(stmt);
+    if (!coberto) {
+        return false;
+    }
+    
+    const char* sql = "SELECT receita_id FROM alteracoes WHERE seq > ?1 AND receita_id IS NOT NULL "
+                      "UNION "
+                      "SELECT rt.receita_id FROM alteracoes a INNER JOIN receitas_tags rt ON rt.tag_id = a.chave "
+                      "WHERE a.seq > ?1 AND a.tabela = 'tags' AND a.operacao = 'U' "
+                      "ORDER BY 1";
+    if (preparar(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        return false;
+    }
+    sqlite3_bind_int64(stmt, 1, desde);
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        ids.push_back(sqlite3_column_int(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+    return rc == SQLITE_DONE;
+}
+
+// Recalcula as assinaturas das receitas em "ids" (nullptr: todas) percorrendo
+// receitas, ingredientes e tags em ordem de id, sem materializar as receitas.
+// Com "gravar", a tabela assinaturas acompanha o indice.
+bool Database::carregarAssinaturas(const std::vector<int>* ids, bool gravar) {
+    sqlite3* sqliteDb = (sqlite3*)db;
+    const size_t tamanhoBloco = 500;
+    size_t total = ids ? ids->size() : 1;
+    
+    sqlite3_stmt* gravarStmt = nullptr;
+    sqlite3_stmt* apagarStmt = nullptr;
+    if (gravar && (preparar(sqliteDb, "INSERT OR REPLACE INTO assinaturas (receita_id, sig) VALUES (?, ?)", -1,
+                            &gravarStmt, nullptr) != SQLITE_OK ||
+                   preparar(sqliteDb, "DELETE FROM assinaturas WHERE receita_id = ?", -1, &apagarStmt,
+                            nullptr) != SQLITE_OK ||
+                   (!ids && !executeQuery("DELETE FROM assinaturas")))) {
+        std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
+        sqlite3_finalize(gravarStmt);
+        sqlite3_finalize(apagarStmt);
+        return false;
+    }
+    bool gravou = true;
+    
+    for (size_t inicio = 0; inicio < total; inicio += tamanhoBloco) {
+        size_t fim = ids ? std::min(total, inicio + tamanhoBloco) : 1;
+        std::string filtro;
+        if (ids) {
+            filtro = " WHERE %s IN (";
+            for (size_t i = inicio; i < fim; ++i) {
+                filtro += i > inicio ? ",?" : "?";
+            }
+            filtro += ")";
+        }
+        auto comFiltro = [&filtro](const char* coluna) {
+            std::string texto = filtro;
+            size_t marcador = texto.find("%s");
+            return marcador == std::string::npos ? texto : texto.replace(marcador, 2, coluna);
+        };
+        std::string sqls[] = {
+            "SELECT id FROM receitas" + comFiltro("id") + " ORDER BY id",
+            "SELECT receita_id, nome FROM ingredientes" + comFiltro("receita_id") + " ORDER BY receita_id",
+            "SELECT rt.receita_id, t.nome FROM receitas_tags rt INNER JOIN tags t ON t.id = rt.tag_id" +
+                comFiltro("rt.receita_id") + " ORDER BY rt.receita_id"
+        };
+        sqlite3_stmt* stmts[3] = {};
+        bool preparados = true;
+        for (int i = 0; i < 3 && preparados; ++i) {
+            preparados = preparar(sqliteDb, sqls[i].c_str(), -1, &stmts[i], nullptr) == SQLITE_OK;
+            for (size_t j = inicio; preparados && ids && j < fim; ++j) {
+                sqlite3_bind_int(stmts[i], static_cast<int>(j - inicio + 1), (*ids)[j]);
+            }
+        }
+        if (!preparados) {
+            std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
+            for (sqlite3_stmt* stmt : stmts) {
+                sqlite3_finalize(stmt);
+            }
+            sqlite3_finalize(gravarStmt);
+            sqlite3_finalize(apagarStmt);
+            return false;
+        }
+        
+        sqlite3_stmt* receitas = stmts[0];
+        sqlite3_stmt* ingredientes = stmts[1];
+        sqlite3_stmt* tags = stmts[2];
+        bool temIngrediente = sqlite3_step(ingredientes) == SQLITE_ROW;
+        bool temTag = sqlite3_step(tags) == SQLITE_ROW;
+        std::vector<int> encontrados;
+        while (sqlite3_step(receitas) == SQLITE_ROW) {
+            int id = sqlite3_column_int(receitas, 0);
+            IndiceSimilaridade::Assinatura assinatura = IndiceSimilaridade::assinaturaVazia();
+            while (temIngrediente && sqlite3_column_int(ingredientes, 0) <= id) {
+                if (sqlite3_column_int(ingredientes, 0) == id) {
+                    std::string nome = AgregadorCompras::normalizar(colunaTexto(ingredientes, 1));
+                    IndiceSimilaridade::acumular(assinatura, IndiceSimilaridade::caracteristica("i:", nome));
+                }
+                temIngrediente = sqlite3_step(ingredientes) == SQLITE_ROW;
+            }
+            while (temTag && sqlite3_column_int(tags, 0) <= id) {
+                if (sqlite3_column_int(tags, 0) == id) {
+                    IndiceSimilaridade::acumular(assinatura, IndiceSimilaridade::caracteristica("t:", colunaTexto(tags, 1)));
+                }
+                temTag = sqlite3_step(tags) == SQLITE_ROW;
+            }
+            indiceSimilares->definir(id, assinatura);
+            encontrados.push_back(id);
+            if (gravarStmt) {
+                unsigned char bytes[IndiceSimilaridade::NUM_HASHES * 2];
+                codificarAssinatura(assinatura, bytes);
+                sqlite3_bind_int(gravarStmt, 1, id);
+                sqlite3_bind_blob(gravarStmt, 2, bytes, sizeof(bytes), SQLITE_TRANSIENT);
+                gravou = sqlite3_step(gravarStmt) == SQLITE_DONE && gravou;
+                sqlite3_reset(gravarStmt);
+            }
+        }
+        for (sqlite3_stmt* stmt : stmts) {
+            sqlite3_finalize(stmt);
+        }
+        
+        // Pendentes que nao existem mais foram excluidas
+        for (size_t i = inicio; ids && i < fim; ++i) {
+            if (!std::binary_search(encontrados.begin(), encontrados.end(), (*ids)[i])) {
+                indiceSimilares->remover((*ids)[i]);
+                if (apagarStmt) {
+                    sqlite3_bind_int(apagarStmt, 1, (*ids)[i]);
+                    gravou = sqlite3_step(apagarStmt) == SQLITE_DONE && gravou;
+                    sqlite3_reset(apagarStmt);
+                }
+            }
+        }
+    }
+    sqlite3_finalize(gravarStmt);
+    sqlite3_finalize(apagarStmt);
+    return gravou;
+}
+
+// Traz o indice em memoria (e a tabela assinaturas, se a conexao grava) ate
+// o fim do log de alteracoes, tudo em um savepoint: o que e lido e gravado
+// corresponde a um mesmo estado do vault
+bool Database::atualizarIndiceSimilares() {
+    sqlite3* sqliteDb = (sqlite3*)db;
+    bool gravar = sqlite3_db_readonly(sqliteDb, "main") == 0;
+    if (!criarSavepoint("indice_similares")) {
+        return false;
+    }
+    
+    if (!indiceSimilares || similaresDesatualizado) {
+        indiceSimilares.reset(new IndiceSimilaridade());
+        similaresDesatualizado = false;
+        seqSimilares = lerAssinaturasGravadas();
+    }
+    int64_t ultima = ultimaAlteracao();
+    bool ok = ultima >= 0;
+    if (ok && ultima != seqSimilares) {
+        std::vector<int> ids;
+        bool parcial = seqSimilares >= 0 && receitasAlteradasDesde(seqSimilares, ids);
+        if (!parcial) {
+            indiceSimilares->limpar();
+        }
+        // Cursores interrompidos pelo prazo terminam como se nao houvesse mais linhas
+        ok = carregarAssinaturas(parcial ? &ids : nullptr, gravar) && !prazoEsgotado && !interrompida();
+        if (ok && gravar) {
+            sqlite3_stmt* stmt;
+            ok = preparar(sqliteDb, "INSERT OR REPLACE INTO indices_persistidos (nome, seq) VALUES ('assinaturas', ?)",
+                          -1, &stmt, nullptr) == SQLITE_OK;
+            if (ok) {
+                sqlite3_bind_int64(stmt, 1, ultima);
+                ok = sqlite3_step(stmt) == SQLITE_DONE;
+                sqlite3_finalize(stmt);
+            }
+        }
+        seqSimilares = ultima;
+    }
+    
+    if (!ok || !liberarSavepoint("indice_similares")) {
+        // Com o prazo vencido o proprio ROLLBACK TO seria interrompido
+        prazoLimite = 0;
+        desfazerSavepoint("indice_similares");
+        indiceSimilares.reset();
+        seqSimilares = -1;
+        return false;
+    }
+    return true;
+}
+
+std::vector<ReceitaSimilar> Database::similares(int id, size_t k) {
+    TemporizadorEscopo medicao(__func__);
+    EscopoPrazo prazo(*this);
+    if (prazo.esgotado() || !atualizarIndiceSimilares()) {
+        return {};
+    }
+    return indiceSimilares->similares(id, k);
+}
+
+// ============================================================================
+// ANALISE COLUNAR
+// ============================================================================
+// Le de novo as colunas das receitas em "ids" (nullptr: todas); pendentes que nao
+// existem mais saem das colunas
+bool Database::carregarColunasAnalise(const std::vector<int>* ids) {
+    sqlite3* sqliteDb = (sqlite3*)db;
+    const size_t tamanhoBloco = 500;
+    size_t total = ids ? ids->size() : 1;
+    
+    for (size_t inicio = 0; inicio < total; inicio += tamanhoBloco) {
+        size_t fim = ids ? std::min(total, inicio + tamanhoBloco) : 1;
+        std::string sql = "SELECT id, tempo, porcoes, nota, feita, categoria FROM receitas";
+        if (ids) {
+            sql += " WHERE id IN (";
+            for (size_t i = inicio; i < fim; ++i) {
+                sql += i > inicio ? ",?" : "?";
+            }
+            sql += ")";
+        }
+        sqlite3_stmt* stmt;
+        if (preparar(sqliteDb, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+            std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
+            return false;
+        }
+        for (size_t i = inicio; ids && i < fim; ++i) {
+            sqlite3_bind_int(stmt, static_cast<int>(i - inicio + 1), (*ids)[i]);
+        }
+        
+        std::vector<int> encontrados;
+        int rc;
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            int id = sqlite3_column_int(stmt, 0);
+            const char* categoria = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
+            analise->definir(id, sqlite3_column_int(stmt, 1), sqlite3_column_int(stmt, 2), sqlite3_column_int(stmt, 3),
+                             sqlite3_column_int(stmt, 4) == 1, categoria ? categoria : "");
+            if (ids) {
+                encontrados.push_back(id);
+            }
+        }
+        sqlite3_finalize(stmt);
+        if (rc != SQLITE_DONE) {
+            std::cerr << "Erro ao ler colunas de analise: " << sqlite3_errmsg(sqliteDb) << std::endl;
+            return false;
+        }
+        
+        std::sort(encontrados.begin(), encontrados.end());
+        for (size_t i = inicio; ids && i < fim; ++i) {
+            if (!std::binary_search(encontrados.begin(), encontrados.end(), (*ids)[i])) {
+                analise->remover((*ids)[i]);
+            }
+        }
+    }
+    return true;
+}
+
+// O seq e lido antes das colunas: o que outra conexao confirmar no meio e
+// relido na proxima chamada, o que nao muda o resultado
+const AnaliseColunar* Database::analiseColunar() {
+    TemporizadorEscopo medicao(__func__);
+    EscopoPrazo prazo(*this);
+    int64_t ultima = prazo.esgotado() ? -1 : ultimaAlteracao();
+    if (ultima < 0) {
+        return nullptr;
+    }
+    
+    bool completa = !analise || analiseDesatualizada;
+    std::vector<int> ids;
+    if (!completa && ultima != seqAnalise) {
+        completa = !receitasAlteradasDesde(seqAnalise, ids);
+    }
+    if (completa) {
+        ids.clear();
+    } else {
+        ids.insert(ids.end(), analisePendentes.begin(), analisePendentes.end());
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    }
+    
+    // Dentro de uma transacao, guarda o necessario para um ROLLBACK
+    if (!emTransacao()) {
+        analiseNaTransacao.clear();
+        analiseCarregadaNaTransacao = false;
+    } else if (completa) {
+        analiseNaTransacao.clear();
+        analiseCarregadaNaTransacao = true;
+    } else if (!ids.empty()) {
+        if (analiseNaTransacao.empty()) {
+            seqAnaliseAntesTransacao = seqAnalise;
+        }
+        analiseNaTransacao.insert(analiseNaTransacao.end(), ids.begin(), ids.end());
+    }
+    
+    if (completa) {
+        if (!analise) {
+            analise.reset(new AnaliseColunar());
+        }
+        analise->limpar();
+        analiseDesatualizada = false;
+        if (!carregarColunasAnalise(nullptr)) {
+            analise.reset();
+            return nullptr;
+        }
+    } else if (!ids.empty() && !carregarColunasAnalise(&ids)) {
+        analiseDesatualizada = true;
+        return nullptr;
+    }
+    analisePendentes.clear();
+    seqAnalise = ultima;
+    return analise.get();
+}
+
+// ============================================================================
+// RECEITAS DUPLICADAS
+// ============================================================================
+int Database::buscarDuplicataExata(const Receita& receita) {
+    TemporizadorEscopo medicao(__func__);
+    sqlite3* sqliteDb = (sqlite3*)db;
+    sqlite3_stmt* stmt;
+    
+    const char* sql = "SELECT id FROM receitas WHERE hash_conteudo = ? AND id <> ? ORDER BY id LIMIT 1";
+    if (preparar(sqliteDb, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
+        return 0;
+    }
+    sqlite3_bind_int64(stmt, 1, hashConteudoReceita(receita.nome, receita.ingredientes, receita.preparo));
+    sqlite3_bind_int(stmt, 2, receita.id);
+    int id = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int(stmt, 0) : 0;
+    sqlite3_finalize(stmt);
+    return id;
+}
+
+std::vector<GrupoDuplicadas> Database::encontrarDuplicadas(int distanciaMaxima, int threads, size_t* baldesTruncados) {
+    TemporizadorEscopo medicao(__func__);
+    EscopoPrazo prazo(*this);
+    sqlite3* sqliteDb = (sqlite3*)db;
+    sqlite3_stmt* receitas;
+    sqlite3_stmt* ingredientes;
+    
+    // Dois cursores em ordem de id, intercalados: nenhuma consulta por receita
+    if (preparar(sqliteDb, "SELECT id, nome, ingredientes, preparo FROM receitas ORDER BY id", -1, &receitas,
+                 nullptr) != SQLITE_OK) {
+        std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
+        return {};
+    }
+    if (preparar(sqliteDb, "SELECT receita_id, nome FROM ingredientes ORDER BY receita_id", -1, &ingredientes,
+                 nullptr) != SQLITE_OK) {
+        std::cerr << "Erro ao preparar statement: " << sqlite3_errmsg(sqliteDb) << std::endl;
+        sqlite3_finalize(receitas);
+        return {};
+    }
+    
+    // As assinaturas de um bloco sao calculadas em paralelo enquanto os
+    // textos do bloco estao em memoria; depois so ficam (id, SimHash)
+    const size_t tamanhoBloco = 50000;
+    Deduplicador deduplicador(threads);
+    std::vector<DocumentoDedup> bloco;
+    bloco.reserve(tamanhoBloco);
+    bool temIngrediente = sqlite3_step(ingredientes) == SQLITE_ROW;
+    while (sqlite3_step(receitas) == SQLITE_ROW) {
+        bloco.emplace_back();
+        DocumentoDedup& documento = bloco.back();
+        documento.id = sqlite3_column_int(receitas, 0);
+        documento.nome = colunaTexto(receitas, 1);
+        documento.preparo = colunaTexto(receitas, 3);
+        while (temIngrediente && sqlite3_column_int(ingredientes, 0) <= documento.id) {
+            if (sqlite3_column_int(ingredientes, 0) == documento.id) {
+                documento.ingredientes += colunaTexto(ingredientes, 1);
+                documento.ingredientes += '\n';
+            }
+            temIngrediente = sqlite3_step(ingredientes) == SQLITE_ROW;
+        }
+        // Sem ingredientes estruturados: uma linha do texto por ingrediente
+        if (documento.ingredientes.empty()) {
+            documento.ingredientes = colunaTexto(receitas, 2);
+        }
+        if (bloco.size() == tamanhoBloco) {
+            deduplicador.adicionar(bloco);
+            bloco.clear();
+        }
+    }
+    sqlite3_finalize(receitas);
+    sqlite3_finalize(ingredientes);
+    if (prazo.esgotado()) {
+        return {};
+    }
+    deduplicador.adicionar(bloco);
+    
+    return deduplicador.agrupar(distanciaMaxima, baldesTruncados);
+}
+
+bool Database::mesclarReceitas(int principal, const std::vector<int>& duplicadas) {
+    TemporizadorEscopo medicao(__func__);
+    sqlite3* sqliteDb = (sqlite3*)db;
+    
+    if (consultarPorId(principal).id == 0) {
+        std::cerr << "Receita #" << principal << " nao encontrada." << std::endl;
+        return false;
+    }
+    
+    bool transacaoPropria = sqlite3_get_autocommit(sqliteDb) != 0;
+    if (transacaoPropria && !iniciarTransacao()) {
+        return false;
+    }
+    
+    bool ok = true;
+    for (int duplicada : duplicadas) {
+        if (duplicada == principal) {
+            continue;
+        }
+        auto vincularPar = [principal, duplicada](sqlite3_stmt* stmt) {
+            sqlite3_bind_int(stmt, 1, principal);
+            sqlite3_bind_int(stmt, 2, duplicada);
+        };
+        ok = executarAlteracao(sqliteDb,
+                               "INSERT OR IGNORE INTO receitas_tags (receita_id, tag_id) "
+                               "SELECT ?1, tag_id FROM receitas_tags WHERE receita_id = ?2",
+                               vincularPar) >= 0 &&
+             executarAlteracao(sqliteDb,
+                               "UPDATE receitas SET "
+                               "feita = MAX(feita, COALESCE((SELECT feita FROM receitas WHERE id = ?2), 0)), "
+                               "nota = MAX(nota, COALESCE((SELECT nota FROM receitas WHERE id = ?2), 0)) "
+                               "WHERE id = ?1",
+                               vincularPar) >= 0;
+        int excluidas = ok ? executarAlteracao(sqliteDb, "DELETE FROM receitas WHERE id = ?2", vincularPar) : -1;
+        if (excluidas == 0) {
+            std::cerr << "Receita #" << duplicada << " nao encontrada." << std::endl;
+        }
+        if (excluidas <= 0) {
+            ok = false;
+            break;
+        }
+        registrarEscrita(duplicada);
+    }
+    registrarEscrita(principal);
+    
+    if (!ok) {
+        if (transacaoPropria) {
+            desfazerTransacao();
+        }
+        return false;
     }
+    return !transacaoPropria || confirmarTransacao();
 }
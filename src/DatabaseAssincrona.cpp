@@ -0,0 +1,177 @@
+// ============================================================================
+// INCLUDES
+// ============================================================================
+#include "../include/DatabaseAssincrona.h"
+
+// ============================================================================
+// EXECUTORA
+// ============================================================================
+DatabaseAssincrona::DatabaseAssincrona(Database& db)
+    : db(db), proximaTarefa(1), tarefaAtual(0), atualInterrompivel(false), encerrando(false) {
+    executora = std::thread(&DatabaseAssincrona::laco, this);
+}
+
+DatabaseAssincrona::~DatabaseAssincrona() {
+    cancelarTodas();
+    {
+        std::lock_guard<std::mutex> trava(mutex);
+        encerrando = true;
+    }
+    haTrabalho.notify_all();
+    executora.join();
+    // O Database continua em uso sincrono depois da fachada
+    db.limparInterrupcao();
+}
+
+DatabaseAssincrona::Tarefa DatabaseAssincrona::agendar(Modo modo, std::function<void(Database&)> executar,
+                                                       std::function<void(std::exception_ptr)> concluir) {
+    Tarefa id;
+    {
+        std::lock_guard<std::mutex> trava(mutex);
+        id = proximaTarefa++;
+        fila.push_back({id, modo, std::move(executar), std::move(concluir)});
+    }
+    haTrabalho.notify_one();
+    return id;
+}
+
+void DatabaseAssincrona::laco() {
+    std::unique_lock<std::mutex> trava(mutex);
+    while (true) {
+        haTrabalho.wait(trava, [this]() { return encerrando || !fila.empty(); });
+        if (fila.empty()) {
+            return;
+        }
+        Trabalho trabalho = std::move(fila.front());
+        fila.pop_front();
+        // Escrita sem savepoint (falhou ao abrir) nao teria como ser desfeita:
+        // roda ate o fim, como uma exclusiva
+        bool comSavepoint = trabalho.modo == Modo::Escrita && db.criarSavepoint("tarefa_assincrona");
+        tarefaAtual = trabalho.id;
+        atualInterrompivel = trabalho.modo == Modo::Leitura || comSavepoint;
+        db.limparInterrupcao();
+        trava.unlock();
+
+        trabalho.executar(db);
+
+        // Decidido sob o mutex: um cancelar() que retornou true sempre vira
+        // OperacaoCancelada, e depois daqui nenhum outro pode mais retornar true.
+        // A interrupcao e limpa ja aqui: chamadas sincronas ao Database depois
+        // desta tarefa nao podem continuar vendo-a
+        trava.lock();
+        bool interrompida = db.interrompida();
+        db.limparInterrupcao();
+        tarefaAtual = 0;
+        trava.unlock();
+
+        std::exception_ptr falha;
+        if (interrompida) {
+            if (comSavepoint) {
+                db.desfazerSavepoint("tarefa_assincrona");
+            }
+            falha = std::make_exception_ptr(OperacaoCancelada());
+        } else if (comSavepoint && !db.liberarSavepoint("tarefa_assincrona")) {
+            db.desfazerSavepoint("tarefa_assincrona");
+            falha = std::make_exception_ptr(std::runtime_error("Falha ao confirmar a escrita"));
+        }
+        trabalho.concluir(falha);
+        trava.lock();
+    }
+}
+
+// ============================================================================
+// CANCELAMENTO
+// ============================================================================
+bool DatabaseAssincrona::cancelar(Tarefa tarefa) {
+    std::function<void(std::exception_ptr)> concluir;
+    {
+        std::lock_guard<std::mutex> trava(mutex);
+        if (tarefa != 0 && tarefa == tarefaAtual) {
+            if (!atualInterrompivel) {
+                return false;
+            }
+            db.interromper();
+            return true;
+        }
+        for (auto it = fila.begin(); it != fila.end(); ++it) {
+            if (it->id == tarefa) {
+                concluir = std::move(it->concluir);
+                fila.erase(it);
+                break;
+            }
+        }
+    }
+    if (!concluir) {
+        return false;
+    }
+    concluir(std::make_exception_ptr(OperacaoCancelada()));
+    return true;
+}
+
+void DatabaseAssincrona::cancelarTodas() {
+    std::deque<Trabalho> cancelados;
+    {
+        std::lock_guard<std::mutex> trava(mutex);
+        cancelados.swap(fila);
+        if (tarefaAtual != 0 && atualInterrompivel) {
+            db.interromper();
+        }
+    }
+    for (auto& trabalho : cancelados) {
+        trabalho.concluir(std::make_exception_ptr(OperacaoCancelada()));
+    }
+}
+
+size_t DatabaseAssincrona::pendentes() const {
+    std::lock_guard<std::mutex> trava(mutex);
+    return fila.size() + (tarefaAtual != 0 ? 1 : 0);
+}
+
+// ============================================================================
+// OPERACOES
+// ============================================================================
+std::future<ListaReceitas> DatabaseAssincrona::listarReceitas(Tarefa* tarefa) {
+    return consultar([](Database& alvo) { return alvo.listarReceitas(); }, tarefa);
+}
+
+std::future<std::vector<Receita>> DatabaseAssincrona::buscarPorNome(const std::string& nome, Tarefa* tarefa) {
+    return consultar([nome](Database& alvo) { return alvo.buscarPorNome(nome); }, tarefa);
+}
+
+std::future<ListaReceitas> DatabaseAssincrona::getReceitasByTag(const std::string& nomeTag, Tarefa* tarefa) {
+    return consultar([nomeTag](Database& alvo) { return alvo.getReceitasByTag(nomeTag); }, tarefa);
+}
+
+std::future<Receita> DatabaseAssincrona::consultarPorId(int id, Tarefa* tarefa) {
+    return consultar([id](Database& alvo) { return alvo.consultarPorId(id); }, tarefa);
+}
+
+std::future<int> DatabaseAssincrona::cadastrarReceita(const Receita& receita, Tarefa* tarefa) {
+    return executar([receita](Database& alvo) { return alvo.cadastrarReceita(receita); }, tarefa);
+}
+
+std::future<int> DatabaseAssincrona::cadastrarReceitasEmLote(const std::vector<Receita>& receitas, Tarefa* tarefa) {
+    return executar([receitas](Database& alvo) { return alvo.cadastrarReceitasEmLote(receitas); }, tarefa);
+}
+
+std::future<bool> DatabaseAssincrona::atualizarReceita(const Receita& receita, Tarefa* tarefa) {
+    return executar([receita](Database& alvo) { return alvo.atualizarReceita(receita); }, tarefa);
+}
+
+std::future<bool> DatabaseAssincrona::excluirReceita(int id, Tarefa* tarefa) {
+    return executar([id](Database& alvo) { return alvo.excluirReceita(id); }, tarefa);
+}
+
+std::future<bool> DatabaseAssincrona::fazerBackup(const std::string& caminhoBackup, Tarefa* tarefa) {
+    return consultar([caminhoBackup](Database& alvo) { return alvo.fazerBackup(caminhoBackup); }, tarefa);
+}
+
+std::future<bool> DatabaseAssincrona::restaurarBackup(const std::string& caminhoBackup, Tarefa* tarefa) {
+    // Reabre a conexao: nao roda em transacao nem pode parar no meio
+    return agendarFuncao([caminhoBackup](Database& alvo) { return alvo.restaurarBackup(caminhoBackup); },
+                         Modo::Exclusiva, tarefa);
+}
+
+std::future<std::vector<GrupoDuplicadas>> DatabaseAssincrona::encontrarDuplicadas(int distanciaMaxima, Tarefa* tarefa) {
+    return consultar([distanciaMaxima](Database& alvo) { return alvo.encontrarDuplicadas(distanciaMaxima); }, tarefa);
+}
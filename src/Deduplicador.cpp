@@ -0,0 +1,312 @@
+// ============================================================================
+// INCLUDES
+// ============================================================================
+#include "../include/Deduplicador.h"
+#include "../include/ListaCompras.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <numeric>
+#include <thread>
+
+// ============================================================================
+// AUXILIARES
+// ============================================================================
+namespace {
+
+uint64_t fnv1a(std::string_view texto, uint64_t hash = 0xCBF29CE484222325ull) {
+    for (char c : texto) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+uint64_t misturar(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDull;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ull;
+    return x ^ (x >> 33);
+}
+
+// ESPALHAR[b] tem o bit k de b no byte k (0 ou 1)
+const std::array<uint64_t, 256> ESPALHAR = []() {
+    std::array<uint64_t, 256> tabela{};
+    for (uint64_t b = 0; b < 256; ++b) {
+        for (int k = 0; k < 8; ++k) {
+            tabela[b] |= ((b >> k) & 1) << (8 * k);
+        }
+    }
+    return tabela;
+}();
+
+// Soma, por bit, os pesos das caracteristicas com o bit ligado; o bit final
+// liga se essa soma passa da metade do peso total (equivale a somar +peso/-peso).
+// As somas parciais ficam em 8 contadores de 8 bits por palavra (SWAR): 8
+// somas por caracteristica em vez de 64, descarregadas antes de transbordar.
+struct AcumuladorSimHash {
+    uint64_t parciais[8] = {};
+    uint32_t pesoParcial = 0;
+    uint32_t totais[64] = {};
+    uint32_t pesoTotal = 0;
+
+    void adicionar(uint64_t hash, uint32_t peso) {
+        if (pesoParcial + peso > 255) {
+            descarregar();
+        }
+        hash = misturar(hash);
+        for (int byte = 0; byte < 8; ++byte) {
+            parciais[byte] += ESPALHAR[(hash >> (8 * byte)) & 0xFF] * peso;
+        }
+        pesoParcial += peso;
+    }
+
+    void descarregar() {
+        for (int byte = 0; byte < 8; ++byte) {
+            for (int k = 0; k < 8; ++k) {
+                totais[8 * byte + k] += (parciais[byte] >> (8 * k)) & 0xFF;
+            }
+            parciais[byte] = 0;
+        }
+        pesoTotal += pesoParcial;
+        pesoParcial = 0;
+    }
+
+    uint64_t valor() {
+        descarregar();
+        uint64_t resultado = 0;
+        for (int bit = 0; bit < 64; ++bit) {
+            resultado |= static_cast<uint64_t>(2 * totais[bit] > pesoTotal) << bit;
+        }
+        return resultado;
+    }
+};
+
+// Chama fn(palavra) para cada palavra separada por espacos/pontuacao
+template <typename Funcao>
+void paraCadaPalavra(std::string_view texto, Funcao fn) {
+    size_t i = 0;
+    while (i < texto.size()) {
+        while (i < texto.size() && !std::isalnum(static_cast<unsigned char>(texto[i]))) {
+            ++i;
+        }
+        size_t inicio = i;
+        while (i < texto.size() && std::isalnum(static_cast<unsigned char>(texto[i]))) {
+            ++i;
+        }
+        if (i > inicio) {
+            fn(texto.substr(inicio, i - inicio));
+        }
+    }
+}
+
+} // namespace
+
+// ============================================================================
+// ASSINATURAS
+// ============================================================================
+Deduplicador::Deduplicador(int threads)
+    : threads(threads > 0 ? threads : std::max(1, static_cast<int>(std::thread::hardware_concurrency()))) {
+}
+
+uint64_t Deduplicador::hashConteudo(std::string_view nome, std::string_view ingredientes, std::string_view preparo) {
+    uint64_t hash = fnv1a(AgregadorCompras::normalizar(nome));
+    hash = fnv1a("\x1f", hash);
+    hash = fnv1a(AgregadorCompras::normalizar(ingredientes), hash);
+    hash = fnv1a("\x1f", hash);
+    return fnv1a(AgregadorCompras::normalizar(preparo), hash);
+}
+
+uint64_t Deduplicador::simHash(const DocumentoDedup& documento) {
+    AcumuladorSimHash acumulador;
+    std::string nome = AgregadorCompras::normalizar(documento.nome);
+    std::string preparo = AgregadorCompras::normalizar(documento.preparo);
+    std::string ingredientesNormalizados = AgregadorCompras::normalizar(documento.ingredientes);
+
+    paraCadaPalavra(nome, [&](std::string_view palavra) {
+        acumulador.adicionar(fnv1a(palavra, 0x6E6F6D65ull), 1);
+    });
+
+    // Pares de palavras consecutivas: a ordem do texto conta
+    std::string_view anterior;
+    paraCadaPalavra(preparo, [&](std::string_view palavra) {
+        if (!anterior.empty()) {
+            acumulador.adicionar(fnv1a(palavra, fnv1a(anterior) ^ 0x70726570ull), 1);
+        }
+        anterior = palavra;
+    });
+
+    std::string_view ingredientes(ingredientesNormalizados);
+    size_t inicio = 0;
+    while (inicio < ingredientes.size()) {
+        size_t fim = std::min(ingredientes.find('\n', inicio), ingredientes.size());
+        if (fim > inicio) {
+            acumulador.adicionar(fnv1a(ingredientes.substr(inicio, fim - inicio), 0x696E6772ull), 2);
+        }
+        inicio = fim + 1;
+    }
+    return acumulador.valor();
+}
+
+void Deduplicador::adicionar(const std::vector<DocumentoDedup>& lote) {
+    size_t base = ids.size();
+    ids.resize(base + lote.size());
+    assinaturas.resize(base + lote.size());
+
+    size_t numThreads = std::min(static_cast<size_t>(threads), std::max<size_t>(1, lote.size() / 256));
+    std::vector<std::thread> trabalhadores;
+    for (size_t t = 0; t < numThreads; ++t) {
+        trabalhadores.emplace_back([&, t]() {
+            for (size_t i = t; i < lote.size(); i += numThreads) {
+                ids[base + i] = lote[i].id;
+                assinaturas[base + i] = simHash(lote[i]);
+            }
+        });
+    }
+    for (auto& trabalhador : trabalhadores) {
+        trabalhador.join();
+    }
+}
+
+// ============================================================================
+// AGRUPAMENTO
+// ============================================================================
+std::vector<GrupoDuplicadas> Deduplicador::agrupar(int distanciaMaxima, size_t* baldesTruncados) const {
+    distanciaMaxima = std::max(0, std::min(distanciaMaxima, DISTANCIA_MAXIMA));
+    uint32_t n = static_cast<uint32_t>(ids.size());
+
+    // Assinaturas identicas primeiro: so o primeiro de cada valor entra nas faixas
+    std::vector<uint32_t> ordem(n);
+    std::iota(ordem.begin(), ordem.end(), 0u);
+    std::sort(ordem.begin(), ordem.end(), [this](uint32_t a, uint32_t b) {
+        return assinaturas[a] != assinaturas[b] ? assinaturas[a] < assinaturas[b] : a < b;
+    });
+    std::vector<uint32_t> representante(n);
+    std::vector<uint32_t> distintos;
+    for (uint32_t i = 0; i < n; ++i) {
+        if (i > 0 && assinaturas[ordem[i]] == assinaturas[ordem[i - 1]]) {
+            representante[ordem[i]] = representante[ordem[i - 1]];
+        } else {
+            representante[ordem[i]] = ordem[i];
+            distintos.push_back(ordem[i]);
+        }
+    }
+
+    // Uma faixa por tarefa (d+1 faixas). A assinatura e rotacionada para a
+    // faixa ficar nos bits altos: ordenar agrupa o balde e, dentro dele, poe
+    // vizinhos proximos lado a lado. Cada item e comparado com o resto do
+    // balde, ate BALDE_MAXIMO itens adiante (o que limita baldes enormes).
+    int numFaixas = distanciaMaxima + 1;
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> paresPorFaixa(numFaixas);
+    std::vector<size_t> truncadosPorFaixa(numFaixas, 0);
+    auto processarFaixa = [&](int faixa) {
+        int inicioBit = faixa * 64 / numFaixas;
+        int largura = (faixa + 1) * 64 / numFaixas - inicioBit;
+        int rotacao = 64 - inicioBit - largura;
+        std::vector<std::pair<uint64_t, uint32_t>> chaves;
+        chaves.reserve(distintos.size());
+        for (uint32_t indice : distintos) {
+            uint64_t valor = assinaturas[indice];
+            chaves.emplace_back(rotacao == 0 ? valor : (valor << rotacao) | (valor >> (64 - rotacao)), indice);
+        }
+        std::sort(chaves.begin(), chaves.end());
+        int deslocamentoBalde = 64 - largura;
+        auto& pares = paresPorFaixa[faixa];
+        size_t fimBalde = 0;
+        for (size_t a = 0; a < chaves.size(); ++a) {
+            if (a == fimBalde) {
+                uint64_t balde = chaves[a].first >> deslocamentoBalde;
+                while (fimBalde < chaves.size() && (chaves[fimBalde].first >> deslocamentoBalde) == balde) {
+                    ++fimBalde;
+                }
+                if (fimBalde - a > BALDE_MAXIMO) {
+                    truncadosPorFaixa[faixa]++;
+                }
+            }
+            size_t limite = std::min(fimBalde, a + 1 + BALDE_MAXIMO);
+            for (size_t b = a + 1; b < limite; ++b) {
+                if (__builtin_popcountll(chaves[a].first ^ chaves[b].first) <= distanciaMaxima) {
+                    pares.emplace_back(std::min(chaves[a].second, chaves[b].second),
+                                       std::max(chaves[a].second, chaves[b].second));
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> trabalhadores;
+    for (int faixa = 0; faixa < numFaixas; ++faixa) {
+        if (static_cast<int>(trabalhadores.size()) >= threads) {
+            trabalhadores.front().join();
+            trabalhadores.erase(trabalhadores.begin());
+        }
+        trabalhadores.emplace_back(processarFaixa, faixa);
+    }
+    for (auto& trabalhador : trabalhadores) {
+        trabalhador.join();
+    }
+    if (baldesTruncados) {
+        *baldesTruncados = std::accumulate(truncadosPorFaixa.begin(), truncadosPorFaixa.end(), size_t(0));
+    }
+
+    // Vizinhos de cada item (CSR), so no sentido do maior indice
+    std::vector<uint32_t> inicioVizinhos(n + 1, 0);
+    for (const auto& pares : paresPorFaixa) {
+        for (const auto& par : pares) {
+            inicioVizinhos[par.first + 1]++;
+        }
+    }
+    for (uint32_t i = 0; i < n; ++i) {
+        inicioVizinhos[i + 1] += inicioVizinhos[i];
+    }
+    std::vector<uint32_t> vizinhos(inicioVizinhos[n]);
+    std::vector<uint32_t> proximo(inicioVizinhos.begin(), inicioVizinhos.end() - 1);
+    for (auto& pares : paresPorFaixa) {
+        for (const auto& par : pares) {
+            vizinhos[proximo[par.first]++] = par.second;
+        }
+        std::vector<std::pair<uint32_t, uint32_t>>().swap(pares);
+    }
+
+    // Lider guloso em ordem de insercao: o primeiro item ainda livre vira
+    // lider e leva seus vizinhos livres. Todo membro fica a no maximo d bits
+    // do lider; sem o fechamento transitivo, cadeias de itens parecidos
+    // (a~b~c~...) nao viram um grupo unico.
+    const uint32_t LIVRE = UINT32_MAX;
+    std::vector<uint32_t> lider(n, LIVRE);
+    for (uint32_t i = 0; i < n; ++i) {
+        if (representante[i] != i || lider[i] != LIVRE) {
+            continue;
+        }
+        lider[i] = i;
+        for (uint32_t v = inicioVizinhos[i]; v < inicioVizinhos[i + 1]; ++v) {
+            if (lider[vizinhos[v]] == LIVRE) {
+                lider[vizinhos[v]] = i;
+            }
+        }
+    }
+
+    std::vector<uint32_t> tamanhos(n, 0);
+    for (uint32_t i = 0; i < n; ++i) {
+        tamanhos[lider[representante[i]]]++;
+    }
+    std::vector<uint32_t> grupoDoLider(n, LIVRE);
+    std::vector<GrupoDuplicadas> grupos;
+    for (uint32_t i = 0; i < n; ++i) {
+        uint32_t l = lider[representante[i]];
+        if (tamanhos[l] < 2) {
+            continue;
+        }
+        if (grupoDoLider[l] == LIVRE) {
+            grupoDoLider[l] = static_cast<uint32_t>(grupos.size());
+            grupos.emplace_back();
+        }
+        GrupoDuplicadas& grupo = grupos[grupoDoLider[l]];
+        int distancia = __builtin_popcountll(assinaturas[i] ^ assinaturas[l]);
+        grupo.distanciaMaxima = std::max(grupo.distanciaMaxima, distancia);
+        grupo.ids.push_back(ids[i]);
+    }
+    for (auto& grupo : grupos) {
+        std::sort(grupo.ids.begin(), grupo.ids.end());
+    }
+    return grupos;
+}
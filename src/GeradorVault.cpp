@@ -0,0 +1,235 @@
+// ============================================================================
+// INCLUDES
+// ============================================================================
+#include "../include/GeradorVault.h"
+#include "../include/Database.h"
+#include <algorithm>
+#include <cmath>
+
+// ============================================================================
+// VOCABULARIO
+// ============================================================================
+namespace {
+
+const char* PRATOS[] = {
+    "Bolo", "Torta", "Pao", "Sopa", "Molho", "Salada", "Frango assado", "Arroz", "Feijoada", "Pudim",
+    "Mousse", "Biscoito", "Risoto", "Lasanha", "Quiche", "Escondidinho", "Caldo", "Farofa", "Omelete",
+    "Panqueca", "Strogonoff", "Moqueca", "Empadao", "Cuscuz", "Creme"
+};
+
+const char* COMPLEMENTOS[] = {
+    "da vovo", "caseiro", "rapido", "cremoso", "de domingo", "light", "sem gluten", "especial",
+    "de panela", "simples", "gratinado", "tradicional", "vegano", "de forno", "mineiro"
+};
+
+const char* CATEGORIAS[] = {
+    "Doces", "Salgados", "Massas", "Bebidas", "Sopas", "Carnes", "Aves", "Peixes", "Saladas", "Paes"
+};
+
+const char* TAGS_BASE[] = {
+    "rapida", "doce", "salgada", "vegetariana", "vegana", "sem-gluten", "sem-lactose", "fit", "festa",
+    "natal", "cafe-da-manha", "almoco", "jantar", "lanche", "sobremesa", "economica", "forno",
+    "fogao", "airfryer", "microondas", "congelavel", "marmita", "infantil", "picante", "light",
+    "tradicional", "nordestina", "mineira", "italiana", "japonesa", "mexicana", "arabe",
+    "churrasco", "frutos-do-mar", "low-carb", "proteica", "inverno", "verao", "pascoa", "junina"
+};
+
+struct IngredienteVocabulario {
+    const char* nome;
+    const char* unidade;
+    double quantidade;
+};
+
+const IngredienteVocabulario INGREDIENTES_BASE[] = {
+    {"sal", "colher", 1}, {"oleo", "colher", 2}, {"cebola", "", 1}, {"alho", "dente", 2},
+    {"ovos", "", 3}, {"farinha de trigo", "xicara", 2}, {"acucar", "xicara", 1}, {"leite", "ml", 200},
+    {"manteiga", "g", 50}, {"azeite", "colher", 2}, {"tomate", "", 2}, {"pimenta do reino", "pitada", 1},
+    {"arroz", "xicara", 2}, {"agua", "ml", 500}, {"batata", "g", 500}, {"frango", "g", 600},
+    {"carne moida", "g", 500}, {"queijo", "g", 200}, {"creme de leite", "g", 200}, {"cenoura", "", 2},
+    {"fermento", "colher", 1}, {"chocolate em po", "colher", 3}, {"leite condensado", "g", 395},
+    {"cheiro verde", "colher", 2}, {"limao", "", 1}, {"feijao", "g", 500}, {"bacon", "g", 150},
+    {"presunto", "g", 150}, {"milho", "g", 200}, {"ervilha", "g", 200}, {"macarrao", "g", 500},
+    {"molho de tomate", "ml", 340}, {"oregano", "colher", 1}, {"canela", "colher", 1},
+    {"coco ralado", "g", 100}, {"banana", "", 3}, {"maca", "", 2}, {"mandioca", "g", 800},
+    {"peixe", "g", 700}, {"camarao", "g", 400}, {"pimentao", "", 1}, {"abobrinha", "", 1},
+    {"berinjela", "", 1}, {"espinafre", "g", 200}, {"brocolis", "g", 300}, {"cogumelos", "g", 200},
+    {"iogurte", "g", 170}, {"mel", "colher", 2}, {"aveia", "xicara", 1}, {"castanhas", "g", 100}
+};
+
+const char* FRASES_PREPARO[] = {
+    "Em uma tigela, misture os ingredientes secos ate ficar homogeneo.",
+    "Aqueca o forno a 180 graus e unte a forma com manteiga e farinha.",
+    "Refogue a cebola e o alho no azeite ate dourarem levemente.",
+    "Acrescente os demais ingredientes aos poucos, mexendo sempre.",
+    "Deixe cozinhar em fogo baixo por cerca de vinte minutos, com a panela semitampada.",
+    "Bata no liquidificador ate obter um creme liso e sem grumos.",
+    "Tempere com sal e pimenta a gosto e reserve.",
+    "Despeje a massa na forma e leve ao forno por aproximadamente quarenta minutos.",
+    "Faca o teste do palito: se sair limpo, esta pronto.",
+    "Retire do fogo, deixe amornar e sirva em seguida.",
+    "Enquanto isso, prepare a cobertura derretendo o chocolate em banho-maria.",
+    "Corte em pedacos medios e disponha em uma travessa.",
+    "Cubra com papel aluminio para nao ressecar.",
+    "Se preferir, finalize com cheiro verde picado e um fio de azeite.",
+    "Leve a geladeira por pelo menos duas horas antes de servir.",
+    "Misture delicadamente com uma espatula para nao perder o ar da massa.",
+    "Ajuste o ponto com um pouco mais de agua, se necessario.",
+    "Sirva acompanhado de arroz branco e salada verde."
+};
+
+template <typename T, size_t N>
+constexpr size_t tamanho(const T (&)[N]) {
+    return N;
+}
+
+} // namespace
+
+// ============================================================================
+// CONSTRUTOR
+// ============================================================================
+GeradorVault::GeradorVault(const ConfiguracaoGerador& configuracao)
+    : configuracao(configuracao), estado(configuracao.semente ? configuracao.semente : 1) {
+    size_t numTags = static_cast<size_t>(std::max(1, configuracao.numTags));
+    for (size_t i = 0; i < numTags; ++i) {
+        tags.push_back(i < tamanho(TAGS_BASE) ? std::string(TAGS_BASE[i]) : "tag-" + std::to_string(i));
+    }
+
+    size_t numIngredientes = static_cast<size_t>(std::max(1, configuracao.numIngredientes));
+    for (size_t i = 0; i < numIngredientes; ++i) {
+        if (i < tamanho(INGREDIENTES_BASE)) {
+            const auto& base = INGREDIENTES_BASE[i];
+            ingredientes.push_back({base.nome, base.unidade, base.quantidade});
+        } else {
+            ingredientes.push_back({"ingrediente " + std::to_string(i), "g", 100});
+        }
+    }
+
+    montarAcumulada(acumuladaTags, tags.size());
+    montarAcumulada(acumuladaIngredientes, ingredientes.size());
+    montarAcumulada(acumuladaPrincipais, std::min(ingredientes.size(), tamanho(INGREDIENTES_BASE)));
+}
+
+// ============================================================================
+// ALEATORIEDADE
+// ============================================================================
+uint64_t GeradorVault::proximoAleatorio() {
+    // xorshift64*
+    estado ^= estado >> 12;
+    estado ^= estado << 25;
+    estado ^= estado >> 27;
+    return estado * 2685821657736338717ULL;
+}
+
+double GeradorVault::uniforme() {
+    return static_cast<double>(proximoAleatorio() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+int GeradorVault::inteiro(int minimo, int maximo) {
+    return minimo + static_cast<int>(proximoAleatorio() % static_cast<uint64_t>(maximo - minimo + 1));
+}
+
+double GeradorVault::logNormal(double mediana, double sigma) {
+    // Box-Muller
+    double u1 = std::max(uniforme(), 1e-12);
+    double u2 = uniforme();
+    double normal = std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+    return mediana * std::exp(sigma * normal);
+}
+
+void GeradorVault::montarAcumulada(std::vector<double>& acumulada, size_t n) const {
+    acumulada.resize(n);
+    double soma = 0;
+    for (size_t i = 0; i < n; ++i) {
+        soma += 1.0 / std::pow(static_cast<double>(i + 1), configuracao.expoenteZipf);
+        acumulada[i] = soma;
+    }
+    for (double& valor : acumulada) {
+        valor /= soma;
+    }
+}
+
+size_t GeradorVault::amostrarZipf(const std::vector<double>& acumulada) {
+    auto it = std::upper_bound(acumulada.begin(), acumulada.end(), uniforme());
+    return std::min(static_cast<size_t>(it - acumulada.begin()), acumulada.size() - 1);
+}
+
+// ============================================================================
+// GERACAO
+// ============================================================================
+Receita GeradorVault::proxima() {
+    Receita r;
+
+    r.nome = PRATOS[inteiro(0, static_cast<int>(tamanho(PRATOS)) - 1)];
+    size_t principal = amostrarZipf(acumuladaPrincipais);
+    r.nome += " de ";
+    r.nome += ingredientes[principal].nome;
+    r.nome += " ";
+    r.nome += COMPLEMENTOS[inteiro(0, static_cast<int>(tamanho(COMPLEMENTOS)) - 1)];
+
+    size_t alvoPreparo = static_cast<size_t>(std::clamp(logNormal(600, 0.6), 80.0, 6000.0));
+    while (r.preparo.size() < alvoPreparo) {
+        if (!r.preparo.empty()) {
+            r.preparo += ' ';
+        }
+        r.preparo += FRASES_PREPARO[inteiro(0, static_cast<int>(tamanho(FRASES_PREPARO)) - 1)];
+    }
+
+    r.tempo = static_cast<int>(std::clamp(logNormal(40, 0.7), 5.0, 600.0));
+    r.categoria = CATEGORIAS[inteiro(0, static_cast<int>(tamanho(CATEGORIAS)) - 1)];
+    r.porcoes = inteiro(1, 12);
+    r.feita = uniforme() < configuracao.fracaoFeitas;
+    r.nota = r.feita ? inteiro(1, 5) : 0;
+
+    // Ingredientes distintos; o principal sempre entra
+    int numIngredientes = std::min(inteiro(3, 14), static_cast<int>(ingredientes.size()));
+    std::vector<size_t> escolhidos{principal};
+    for (int tentativas = 0; static_cast<int>(escolhidos.size()) < numIngredientes && tentativas < 64; ++tentativas) {
+        size_t indice = amostrarZipf(acumuladaIngredientes);
+        if (std::find(escolhidos.begin(), escolhidos.end(), indice) == escolhidos.end()) {
+            escolhidos.push_back(indice);
+        }
+    }
+    r.ingredientesEstruturados.reserve(escolhidos.size());
+    for (size_t indice : escolhidos) {
+        const IngredienteBase& base = ingredientes[indice];
+        double fator = 0.5 + 0.25 * inteiro(0, 6);   // 0.5x a 2x, em quartos
+        double quantidade = base.quantidadeTipica * fator;
+        quantidade = quantidade >= 10 ? std::round(quantidade) : std::round(quantidade * 4) / 4;
+        r.ingredientesEstruturados.emplace_back(base.nome, std::max(quantidade, 0.25), base.unidade);
+    }
+    r.atualizarIngredientesString();
+
+    int numTags = std::min(inteiro(0, 6), static_cast<int>(tags.size()));
+    for (int tentativas = 0; static_cast<int>(r.tags.size()) < numTags && tentativas < 64; ++tentativas) {
+        const std::string& tag = tags[amostrarZipf(acumuladaTags)];
+        if (std::find(r.tags.begin(), r.tags.end(), tag) == r.tags.end()) {
+            r.tags.push_back(tag);
+        }
+    }
+    return r;
+}
+
+int GeradorVault::gerar(Database& db, int total, size_t tamanhoLote) {
+    std::vector<Receita> lote;
+    lote.reserve(std::min(tamanhoLote, static_cast<size_t>(std::max(total, 0))));
+    int gravadas = 0;
+    // Dentro da transacao de quem chamou, grava sem a configuracao de carga
+    bool cargaEmMassa = !db.emTransacao() && db.iniciarCargaEmMassa();
+
+    while (gravadas < total) {
+        lote.clear();
+        while (lote.size() < tamanhoLote && gravadas + static_cast<int>(lote.size()) < total) {
+            lote.push_back(proxima());
+        }
+        int inseridas = db.cadastrarReceitasEmLote(lote);
+        if (inseridas < 0) {
+            gravadas = -1;
+            break;
+        }
+        gravadas += inseridas;
+    }
+    if (cargaEmMassa && !db.encerrarCargaEmMassa()) {
+        return -1;
+    }
+    return gravadas;
+}
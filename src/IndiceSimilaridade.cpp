@@ -0,0 +1,202 @@
+// ============================================================================
+// INCLUDES
+// ============================================================================
+#include "../include/IndiceSimilaridade.h"
+#include <algorithm>
+
+// ============================================================================
+// ASSINATURAS
+// ============================================================================
+static uint64_t misturar(uint64_t x) {
+    // splitmix64
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+uint64_t IndiceSimilaridade::caracteristica(std::string_view prefixo, std::string_view texto) {
+    // FNV-1a
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (std::string_view parte : {prefixo, texto}) {
+        for (char c : parte) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001B3ull;
+        }
+    }
+    return hash;
+}
+
+IndiceSimilaridade::Assinatura IndiceSimilaridade::assinaturaVazia() {
+    Assinatura assinatura;
+    assinatura.fill(UINT16_MAX);
+    return assinatura;
+}
+
+void IndiceSimilaridade::acumular(Assinatura& assinatura, uint64_t caracteristica) {
+    for (int i = 0; i < NUM_HASHES; ++i) {
+        uint16_t valor = static_cast<uint16_t>(misturar(caracteristica + static_cast<uint64_t>(i) * 0xD6E8FEB86659FD93ull) >> 48);
+        assinatura[i] = std::min(assinatura[i], valor);
+    }
+}
+
+// 4 valores de 16 bits cabem exatamente em 64 bits
+uint64_t IndiceSimilaridade::chaveFaixa(const Assinatura& assinatura, int faixa) {
+    uint64_t chave = 0;
+    for (int i = 0; i < LINHAS_POR_FAIXA; ++i) {
+        chave = (chave << 16) | assinatura[faixa * LINHAS_POR_FAIXA + i];
+    }
+    return chave;
+}
+
+size_t IndiceSimilaridade::balde(uint64_t chave, int faixa) const {
+    return static_cast<size_t>(faixa) * (mascara + 1) + (misturar(chave ^ static_cast<uint64_t>(faixa)) & mascara);
+}
+
+// ============================================================================
+// BALDES
+// ============================================================================
+void IndiceSimilaridade::encadear(uint32_t slot) {
+    for (int faixa = 0; faixa < NUM_FAIXAS; ++faixa) {
+        uint32_t& cabeca = cabecas[balde(chaveFaixa(assinaturas[slot], faixa), faixa)];
+        proximos[slot * NUM_FAIXAS + faixa] = cabeca;
+        cabeca = slot;
+    }
+    indexado[slot] = 1;
+}
+
+void IndiceSimilaridade::desencadear(uint32_t slot) {
+    for (int faixa = 0; faixa < NUM_FAIXAS; ++faixa) {
+        uint32_t* elo = &cabecas[balde(chaveFaixa(assinaturas[slot], faixa), faixa)];
+        while (*elo != NENHUM && *elo != slot) {
+            elo = &proximos[*elo * NUM_FAIXAS + faixa];
+        }
+        if (*elo == slot) {
+            *elo = proximos[slot * NUM_FAIXAS + faixa];
+        }
+    }
+    indexado[slot] = 0;
+}
+
+void IndiceSimilaridade::redimensionar(size_t capacidade) {
+    size_t baldes = 1024;
+    while (baldes < capacidade) {
+        baldes *= 2;
+    }
+    mascara = baldes - 1;
+    cabecas.assign(baldes * NUM_FAIXAS, NENHUM);
+    for (uint32_t slot = 0; slot < ids.size(); ++slot) {
+        if (indexado[slot]) {
+            encadear(slot);
+        }
+    }
+}
+
+// ============================================================================
+// MANUTENCAO
+// ============================================================================
+void IndiceSimilaridade::definir(int id, const Assinatura& assinatura) {
+    uint32_t slot;
+    auto existente = slotPorId.find(id);
+    if (existente != slotPorId.end()) {
+        slot = existente->second;
+        if (indexado[slot]) {
+            desencadear(slot);
+        }
+    } else if (!livres.empty()) {
+        slot = livres.back();
+        livres.pop_back();
+        slotPorId.emplace(id, slot);
+    } else {
+        slot = static_cast<uint32_t>(ids.size());
+        ids.push_back(id);
+        assinaturas.emplace_back();
+        indexado.push_back(0);
+        proximos.resize(proximos.size() + NUM_FAIXAS, NENHUM);
+        marcas.push_back(0);
+        slotPorId.emplace(id, slot);
+    }
+    ids[slot] = id;
+    assinaturas[slot] = assinatura;
+
+    if (ids.size() > mascara + 1 || cabecas.empty()) {
+        redimensionar(ids.size());
+    }
+    if (assinatura != assinaturaVazia()) {
+        encadear(slot);
+    }
+}
+
+void IndiceSimilaridade::remover(int id) {
+    auto existente = slotPorId.find(id);
+    if (existente == slotPorId.end()) {
+        return;
+    }
+    uint32_t slot = existente->second;
+    if (indexado[slot]) {
+        desencadear(slot);
+    }
+    slotPorId.erase(existente);
+    livres.push_back(slot);
+}
+
+void IndiceSimilaridade::limpar() {
+    ids.clear();
+    assinaturas.clear();
+    indexado.clear();
+    proximos.clear();
+    cabecas.clear();
+    livres.clear();
+    slotPorId.clear();
+    marcas.clear();
+    mascara = 0;
+    marcaAtual = 0;
+}
+
+// ============================================================================
+// CONSULTA
+// ============================================================================
+std::vector<ReceitaSimilar> IndiceSimilaridade::similares(int id, size_t k, size_t maxCandidatos) {
+    std::vector<ReceitaSimilar> resultado;
+    auto existente = slotPorId.find(id);
+    if (existente == slotPorId.end() || !indexado[existente->second] || k == 0) {
+        return resultado;
+    }
+    uint32_t origem = existente->second;
+    const Assinatura& alvo = assinaturas[origem];
+
+    if (++marcaAtual == 0) {
+        std::fill(marcas.begin(), marcas.end(), 0);
+        marcaAtual = 1;
+    }
+    marcas[origem] = marcaAtual;
+
+    size_t examinados = 0;
+    for (int faixa = 0; faixa < NUM_FAIXAS && examinados < maxCandidatos; ++faixa) {
+        uint64_t chave = chaveFaixa(alvo, faixa);
+        for (uint32_t slot = cabecas[balde(chave, faixa)]; slot != NENHUM && examinados < maxCandidatos;
+             slot = proximos[slot * NUM_FAIXAS + faixa]) {
+            // O balde pode misturar chaves diferentes: confere a faixa
+            if (marcas[slot] == marcaAtual || chaveFaixa(assinaturas[slot], faixa) != chave) {
+                continue;
+            }
+            marcas[slot] = marcaAtual;
+            examinados++;
+            int iguais = 0;
+            for (int i = 0; i < NUM_HASHES; ++i) {
+                iguais += assinaturas[slot][i] == alvo[i];
+            }
+            resultado.push_back({ids[slot], static_cast<double>(iguais) / NUM_HASHES});
+        }
+    }
+
+    auto ordem = [](const ReceitaSimilar& a, const ReceitaSimilar& b) {
+        return a.similaridade != b.similaridade ? a.similaridade > b.similaridade : a.id < b.id;
+    };
+    if (resultado.size() > k) {
+        std::partial_sort(resultado.begin(), resultado.begin() + static_cast<std::ptrdiff_t>(k), resultado.end(), ordem);
+        resultado.resize(k);
+    } else {
+        std::sort(resultado.begin(), resultado.end(), ordem);
+    }
+    return resultado;
+}
@@ -0,0 +1,105 @@
+// ============================================================================
+// INCLUDES
+// ============================================================================
+#include "../include/ListaCompras.h"
+#include <algorithm>
+
+// ============================================================================
+// NORMALIZACAO
+// ============================================================================
+// Minusculas, sem acentos (UTF-8 de U+00C0 a U+00FF), espacos simples
+std::string AgregadorCompras::normalizar(std::string_view texto) {
+    static const char SEM_ACENTO[64 + 1] =
+        "aaaaaaaceeeeiiiidnooooo*ouuuuyps"   // U+00C0 .. U+00DF
+        "aaaaaaaceeeeiiiidnooooo/ouuuuypy";  // U+00E0 .. U+00FF
+    std::string saida;
+    saida.reserve(texto.size());
+    bool espaco = false;
+    for (size_t i = 0; i < texto.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(texto[i]);
+        char convertido;
+        if (c == 0xC3 && i + 1 < texto.size()) {
+            unsigned char segundo = static_cast<unsigned char>(texto[++i]);
+            convertido = SEM_ACENTO[(segundo - 0x80) & 0x3F];
+        } else if (c == ' ' || c == '\t') {
+            espaco = !saida.empty();
+            continue;
+        } else {
+            convertido = (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : static_cast<char>(c);
+        }
+        if (espaco) {
+            saida += ' ';
+            espaco = false;
+        }
+        saida += convertido;
+    }
+    return saida;
+}
+
+const ConversaoUnidade* AgregadorCompras::converterUnidade(std::string_view unidade, std::string& normalizada) {
+    normalizada = normalizar(unidade);
+    if (const ConversaoUnidade* conversao = localizarUnidade(normalizada)) {
+        return conversao;
+    }
+    // Plurais: "xicaras", "gs" (formatacao de Ingrediente), "colheres"; em
+    // unidades compostas o plural fica na primeira palavra ("colheres de sopa")
+    size_t fimPalavra = std::min(normalizada.find(' '), normalizada.size());
+    std::string_view primeira(normalizada.data(), fimPalavra);
+    std::string_view resto(normalizada.data() + fimPalavra, normalizada.size() - fimPalavra);
+    for (size_t corte : {size_t(1), size_t(2)}) {
+        if (primeira.size() > corte && primeira.back() == 's') {
+            std::string singular = std::string(primeira.substr(0, primeira.size() - corte)) + std::string(resto);
+            if (const ConversaoUnidade* conversao = localizarUnidade(singular)) {
+                normalizada = std::move(singular);
+                return conversao;
+            }
+        }
+    }
+    return nullptr;
+}
+
+// ============================================================================
+// AGREGACAO
+// ============================================================================
+void AgregadorCompras::adicionar(std::string_view nome, double quantidade, std::string_view unidade, double fator) {
+    std::string unidadeNormalizada;
+    const ConversaoUnidade* conversao = converterUnidade(unidade, unidadeNormalizada);
+    Grandeza grandeza = conversao ? conversao->grandeza : Grandeza::Outra;
+    double base = quantidade * fator * (conversao ? conversao->fator : 1.0);
+
+    chave = normalizar(nome);
+    chave += '\x1f';
+    chave += static_cast<char>('0' + static_cast<int>(grandeza));
+    if (!conversao) {
+        chave += unidadeNormalizada;
+    }
+
+    auto encontrado = indice.find(chave);
+    if (encontrado == indice.end()) {
+        size_t separador = chave.find('\x1f');
+        encontrado = indice.emplace(chave, itens.size()).first;
+        itens.push_back(ItemCompra{chave.substr(0, separador), 0.0,
+                                   conversao ? std::string() : unidadeNormalizada, grandeza, 0});
+    }
+    ItemCompra& item = itens[encontrado->second];
+    item.quantidade += base;
+    item.ocorrencias++;
+}
+
+std::vector<ItemCompra> AgregadorCompras::resultado() const {
+    std::vector<ItemCompra> lista = itens;
+    for (auto& item : lista) {
+        if (item.grandeza == Grandeza::Massa) {
+            item.unidade = item.quantidade >= 1000 ? "kg" : "g";
+        } else if (item.grandeza == Grandeza::Volume) {
+            item.unidade = item.quantidade >= 1000 ? "l" : "ml";
+        }
+        if (item.quantidade >= 1000 && (item.grandeza == Grandeza::Massa || item.grandeza == Grandeza::Volume)) {
+            item.quantidade /= 1000;
+        }
+    }
+    std::sort(lista.begin(), lista.end(), [](const ItemCompra& a, const ItemCompra& b) {
+        return a.nome != b.nome ? a.nome < b.nome : a.grandeza < b.grandeza;
+    });
+    return lista;
+}
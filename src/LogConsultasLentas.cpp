@@ -0,0 +1,264 @@
+// ============================================================================
+// INCLUDES
+// ============================================================================
+#include "../include/LogConsultasLentas.h"
+#include "../include/Renderizador.h"
+#include <sqlite3.h>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <unordered_map>
+
+// ============================================================================
+// CONFIGURACAO
+// ============================================================================
+LogConsultasLentas::LogConsultasLentas()
+    : registrando(false), encerrando(false), totalDescartadas(0), limiarNs(100 * 1000 * 1000), capacidade(256),
+      proxima(0), tamanhoMaximoArquivo(10 * 1024 * 1024), arquivosMantidos(3), tamanhoArquivo(0) {
+}
+
+LogConsultasLentas::~LogConsultasLentas() {
+    encerrar();
+}
+
+LogConsultasLentas& LogConsultasLentas::global() {
+    static LogConsultasLentas instancia;
+    return instancia;
+}
+
+void LogConsultasLentas::configurar(double limiarMs, const std::string& caminho, size_t tamanhoMaximo,
+                                    int mantidos, size_t capacidadeAnel) {
+    // O que ja foi medido vai para o arquivo e o anel anteriores
+    esvaziar();
+    std::lock_guard<std::mutex> trava(mutex);
+    limiarNs = limiarMs < 0 ? -1 : static_cast<int64_t>(limiarMs * 1e6);
+    capacidade = capacidadeAnel > 0 ? capacidadeAnel : 1;
+    anel.clear();
+    proxima = 0;
+    tamanhoMaximoArquivo = tamanhoMaximo;
+    arquivosMantidos = mantidos;
+
+    if (arquivo.is_open()) {
+        arquivo.close();
+    }
+    caminhoArquivo = caminho;
+    tamanhoArquivo = 0;
+    if (!caminhoArquivo.empty()) {
+        std::filesystem::path dir = std::filesystem::path(caminhoArquivo).parent_path();
+        if (!dir.empty() && !std::filesystem::exists(dir)) {
+            std::filesystem::create_directories(dir);
+        }
+        arquivo.open(caminhoArquivo, std::ios::app);
+        if (!arquivo) {
+            std::cerr << "Erro ao abrir log de consultas lentas: " << caminhoArquivo << std::endl;
+        }
+        std::error_code erro;
+        auto tamanho = std::filesystem::file_size(caminhoArquivo, erro);
+        tamanhoArquivo = erro ? 0 : static_cast<size_t>(tamanho);
+    }
+}
+
+// ============================================================================
+// REGISTRO
+// ============================================================================
+void LogConsultasLentas::enfileirar(ConsultaLenta consulta, std::string banco, std::string sqlOriginal) {
+    std::lock_guard<std::mutex> trava(mutexFila);
+    if (fila.size() >= CAPACIDADE_FILA) {
+        fila.pop_front();
+        totalDescartadas.fetch_add(1, std::memory_order_relaxed);
+    }
+    fila.push_back({std::move(consulta), std::move(banco), std::move(sqlOriginal)});
+    if (!registradora.joinable()) {
+        registradora = std::thread(&LogConsultasLentas::lacoRegistro, this);
+    }
+    haPendentes.notify_one();
+}
+
+void LogConsultasLentas::esvaziar() const {
+    std::unique_lock<std::mutex> trava(mutexFila);
+    filaVazia.wait(trava, [this] { return (fila.empty() && !registrando) || !registradora.joinable(); });
+}
+
+void LogConsultasLentas::encerrar() {
+    std::thread thread;
+    {
+        std::lock_guard<std::mutex> trava(mutexFila);
+        encerrando = true;
+        thread = std::move(registradora);
+    }
+    haPendentes.notify_one();
+    if (thread.joinable()) {
+        thread.join();
+    }
+    {
+        std::lock_guard<std::mutex> trava(mutexFila);
+        encerrando = false;
+    }
+    filaVazia.notify_all();
+    std::lock_guard<std::mutex> trava(mutex);
+    if (arquivo.is_open()) {
+        arquivo.flush();
+    }
+}
+
+void LogConsultasLentas::lacoRegistro() {
+    std::unique_lock<std::mutex> trava(mutexFila);
+    while (true) {
+        haPendentes.wait(trava, [this] { return !fila.empty() || encerrando; });
+        if (fila.empty()) {
+            return;   // encerrando, e tudo ja foi gravado
+        }
+        std::vector<Pendente> lote(std::make_move_iterator(fila.begin()), std::make_move_iterator(fila.end()));
+        fila.clear();
+        registrando = true;
+        trava.unlock();
+        registrar(lote);
+        trava.lock();
+        registrando = false;
+        if (fila.empty()) {
+            filaVazia.notify_all();
+        }
+    }
+}
+
+// Preenche plano e varredura. A conexao e so desta thread e dura um lote:
+// um vault restaurado no meio nao deixa um handle velho para tras. Statements
+// sobre tabelas temporarias da conexao original ficam sem plano.
+static void explicar(sqlite3* conexao, const std::string& sqlOriginal, ConsultaLenta& consulta) {
+    std::string explicar = "EXPLAIN QUERY PLAN " + sqlOriginal;
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(conexao, explicar.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            const char* texto = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
+            std::string_view detalhe = texto ? texto : "";
+            if (!consulta.plano.empty()) {
+                consulta.plano += " | ";
+            }
+            consulta.plano.append(detalhe.data(), detalhe.size());
+            // "SCAN (subquery-N)" e "SCAN CONSTANT ROW" nao leem tabelas
+            if (detalhe.substr(0, 5) == "SCAN " && detalhe.substr(5, 1) != "(" &&
+                detalhe.substr(5, 8) != "CONSTANT") {
+                consulta.varredura = true;
+            }
+        }
+    }
+    sqlite3_finalize(stmt);
+}
+
+void LogConsultasLentas::registrar(std::vector<Pendente>& lote) {
+    std::unordered_map<std::string, sqlite3*> conexoes;
+    for (auto& pendente : lote) {
+        if (pendente.banco.empty()) {
+            continue;
+        }
+        auto it = conexoes.find(pendente.banco);
+        if (it == conexoes.end()) {
+            sqlite3* conexao = nullptr;
+            if (sqlite3_open_v2(pendente.banco.c_str(), &conexao, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+                sqlite3_close(conexao);
+                conexao = nullptr;
+            } else {
+                // O escritor pode estar no meio de um COMMIT; o plano nao vale esperar mais
+                sqlite3_busy_timeout(conexao, 100);
+            }
+            it = conexoes.emplace(pendente.banco, conexao).first;
+        }
+        if (it->second) {
+            explicar(it->second, pendente.sqlOriginal, pendente.consulta);
+        }
+    }
+    for (auto& [banco, conexao] : conexoes) {
+        sqlite3_close(conexao);
+    }
+
+    std::lock_guard<std::mutex> trava(mutex);
+    for (auto& pendente : lote) {
+        if (arquivo.is_open()) {
+            std::string linha;
+            anexarJson(linha, pendente.consulta);
+            linha += '\n';
+            if (tamanhoMaximoArquivo > 0 && tamanhoArquivo + linha.size() > tamanhoMaximoArquivo && tamanhoArquivo > 0) {
+                rotacionar();
+            }
+            arquivo << linha;
+            tamanhoArquivo += linha.size();
+        }
+        if (anel.size() < capacidade) {
+            anel.push_back(std::move(pendente.consulta));
+        } else {
+            anel[proxima] = std::move(pendente.consulta);
+        }
+        proxima = (proxima + 1) % capacidade;
+    }
+    if (arquivo.is_open()) {
+        arquivo.flush();
+    }
+}
+
+void LogConsultasLentas::rotacionar() {
+    arquivo.close();
+    std::error_code erro;
+    if (arquivosMantidos <= 0) {
+        std::filesystem::remove(caminhoArquivo, erro);
+    } else {
+        std::filesystem::remove(caminhoArquivo + "." + std::to_string(arquivosMantidos), erro);
+        for (int i = arquivosMantidos - 1; i >= 1; --i) {
+            std::string origem = caminhoArquivo + "." + std::to_string(i);
+            if (std::filesystem::exists(origem)) {
+                std::filesystem::rename(origem, caminhoArquivo + "." + std::to_string(i + 1), erro);
+            }
+        }
+        std::filesystem::rename(caminhoArquivo, caminhoArquivo + ".1", erro);
+    }
+    arquivo.open(caminhoArquivo, std::ios::trunc);
+    tamanhoArquivo = 0;
+}
+
+std::vector<ConsultaLenta> LogConsultasLentas::recentes() const {
+    esvaziar();
+    std::lock_guard<std::mutex> trava(mutex);
+    std::vector<ConsultaLenta> resultado;
+    resultado.reserve(anel.size());
+    size_t inicio = anel.size() < capacidade ? 0 : proxima;
+    for (size_t i = 0; i < anel.size(); ++i) {
+        resultado.push_back(anel[(inicio + i) % anel.size()]);
+    }
+    return resultado;
+}
+
+// ============================================================================
+// SAIDA
+// ============================================================================
+void LogConsultasLentas::anexarJson(std::string& saida, const ConsultaLenta& consulta) {
+    char texto[64];
+    std::time_t segundos = std::chrono::system_clock::to_time_t(consulta.quando);
+    std::tm local{};
+    localtime_r(&segundos, &local);
+    std::strftime(texto, sizeof(texto), "%Y-%m-%dT%H:%M:%S", &local);
+
+    saida += "{\"quando\":\"";
+    saida += texto;
+    std::snprintf(texto, sizeof(texto), "\",\"duracao_ms\":%.3f", static_cast<double>(consulta.duracaoNs) / 1e6);
+    saida += texto;
+    saida += ",\"linhas\":" + std::to_string(consulta.linhas);
+    saida += consulta.varredura ? ",\"varredura\":true" : ",\"varredura\":false";
+    saida += ",\"sql\":";
+    Renderizador::anexarJsonString(saida, consulta.sql);
+    saida += ",\"plano\":";
+    Renderizador::anexarJsonString(saida, consulta.plano);
+    saida += "}";
+}
+
+std::string LogConsultasLentas::paraJson() const {
+    std::string saida = "[";
+    std::vector<ConsultaLenta> lista = recentes();
+    for (size_t i = 0; i < lista.size(); ++i) {
+        if (i > 0) {
+            saida += ",";
+        }
+        anexarJson(saida, lista[i]);
+    }
+    saida += "]";
+    return saida;
+}
@@ -0,0 +1,211 @@
+// ============================================================================
+// INCLUDES
+// ============================================================================
+#include "../include/Metricas.h"
+#include "../include/Renderizador.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+
+// ============================================================================
+// HISTOGRAMA
+// ============================================================================
+int HistogramaLatencia::indice(uint64_t valor) {
+    if (valor < SUBFAIXAS) {
+        return static_cast<int>(valor);
+    }
+    int expoente = 63 - __builtin_clzll(valor);          // >= 4
+    int subfaixa = static_cast<int>((valor >> (expoente - 4)) & (SUBFAIXAS - 1));
+    return (expoente - 3) * SUBFAIXAS + subfaixa;
+}
+
+uint64_t HistogramaLatencia::limiteInferior(int indice) {
+    if (indice < SUBFAIXAS) {
+        return static_cast<uint64_t>(indice);
+    }
+    int expoente = indice / SUBFAIXAS + 3;
+    uint64_t subfaixa = static_cast<uint64_t>(indice % SUBFAIXAS);
+    return (SUBFAIXAS + subfaixa) << (expoente - 4);
+}
+
+void HistogramaLatencia::registrar(uint64_t nanossegundos) {
+    faixas[indice(nanossegundos)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    somaNs.fetch_add(nanossegundos, std::memory_order_relaxed);
+    uint64_t atual = maximoNs.load(std::memory_order_relaxed);
+    while (nanossegundos > atual &&
+           !maximoNs.compare_exchange_weak(atual, nanossegundos, std::memory_order_relaxed)) {
+    }
+}
+
+void HistogramaLatencia::zerar() {
+    for (auto& faixa : faixas) {
+        faixa.store(0, std::memory_order_relaxed);
+    }
+    total = 0;
+    somaNs = 0;
+    maximoNs = 0;
+}
+
+uint64_t HistogramaLatencia::percentil(double p) const {
+    uint64_t n = contagem();
+    if (n == 0) {
+        return 0;
+    }
+    uint64_t alvo = static_cast<uint64_t>(std::ceil(p * static_cast<double>(n)));
+    alvo = alvo == 0 ? 1 : alvo;
+    uint64_t acumulado = 0;
+    for (int i = 0; i < NUM_FAIXAS; ++i) {
+        acumulado += faixas[i].load(std::memory_order_relaxed);
+        if (acumulado >= alvo) {
+            // Meio da faixa, limitado ao maximo observado
+            uint64_t inferior = limiteInferior(i);
+            uint64_t superior = i + 1 < NUM_FAIXAS ? limiteInferior(i + 1) : inferior;
+            return std::min(inferior + (superior - inferior) / 2, maximo());
+        }
+    }
+    return maximo();
+}
+
+// ============================================================================
+// REGISTRO
+// ============================================================================
+Metricas& Metricas::global() {
+    static Metricas instancia;
+    return instancia;
+}
+
+Metricas::Metodo& Metricas::metodo(const char* nome) {
+    std::lock_guard<std::mutex> trava(mutex);
+    auto it = metodos.find(nome);
+    if (it == metodos.end()) {
+        it = metodos.emplace(nome, std::unique_ptr<Metodo>(new Metodo())).first;
+    }
+    return *it->second;
+}
+
+void Metricas::zerar() {
+    // Zera no lugar: temporizadores ativos guardam referencias aos metodos
+    std::lock_guard<std::mutex> trava(mutex);
+    for (auto& item : metodos) {
+        item.second->latencia.zerar();
+    }
+    contadoresSql.tempo.zerar();
+    contadoresSql.preparados = 0;
+    contadoresSql.executados = 0;
+    contadoresSql.linhasLidas = 0;
+    contadoresSql.linhasEscritas = 0;
+    contadoresSql.bytesRetornados = 0;
+    contadoresCache.acertos = 0;
+    contadoresCache.falhas = 0;
+    contadoresCache.consultasAcertos = 0;
+    contadoresCache.consultasFalhas = 0;
+    contadoresCache.despejos = 0;
+    contadoresCache.invalidacoes = 0;
+}
+
+// ============================================================================
+// SAIDA
+// ============================================================================
+static void anexarNumero(std::string& saida, uint64_t valor) {
+    saida += std::to_string(valor);
+}
+
+static void anexarMicros(std::string& saida, uint64_t nanossegundos) {
+    char texto[32];
+    std::snprintf(texto, sizeof(texto), "%.1f", static_cast<double>(nanossegundos) / 1000.0);
+    saida += texto;
+}
+
+static void anexarResumo(std::string& saida, const HistogramaLatencia& h) {
+    saida += "{\"chamadas\":";
+    anexarNumero(saida, h.contagem());
+    saida += ",\"total_us\":";
+    anexarMicros(saida, h.soma());
+    saida += ",\"p50_us\":";
+    anexarMicros(saida, h.percentil(0.50));
+    saida += ",\"p90_us\":";
+    anexarMicros(saida, h.percentil(0.90));
+    saida += ",\"p99_us\":";
+    anexarMicros(saida, h.percentil(0.99));
+    saida += ",\"max_us\":";
+    anexarMicros(saida, h.maximo());
+    saida += "}";
+}
+
+std::string Metricas::paraJson() const {
+    std::string saida = "{\"metodos\":{";
+    {
+        std::lock_guard<std::mutex> trava(mutex);
+        bool primeiro = true;
+        for (const auto& item : metodos) {
+            if (!primeiro) {
+                saida += ",";
+            }
+            primeiro = false;
+            Renderizador::anexarJsonString(saida, item.first);
+            saida += ":";
+            anexarResumo(saida, item.second->latencia);
+        }
+    }
+    saida += "},\"sql\":{\"preparados\":";
+    anexarNumero(saida, contadoresSql.preparados.load());
+    saida += ",\"executados\":";
+    anexarNumero(saida, contadoresSql.executados.load());
+    saida += ",\"linhas_lidas\":";
+    anexarNumero(saida, contadoresSql.linhasLidas.load());
+    saida += ",\"linhas_escritas\":";
+    anexarNumero(saida, contadoresSql.linhasEscritas.load());
+    saida += ",\"bytes_retornados\":";
+    anexarNumero(saida, contadoresSql.bytesRetornados.load());
+    saida += ",\"tempo\":";
+    anexarResumo(saida, contadoresSql.tempo);
+    saida += "},\"cache\":{\"acertos\":";
+    anexarNumero(saida, contadoresCache.acertos.load());
+    saida += ",\"falhas\":";
+    anexarNumero(saida, contadoresCache.falhas.load());
+    saida += ",\"consultas_acertos\":";
+    anexarNumero(saida, contadoresCache.consultasAcertos.load());
+    saida += ",\"consultas_falhas\":";
+    anexarNumero(saida, contadoresCache.consultasFalhas.load());
+    saida += ",\"despejos\":";
+    anexarNumero(saida, contadoresCache.despejos.load());
+    saida += ",\"invalidacoes\":";
+    anexarNumero(saida, contadoresCache.invalidacoes.load());
+    saida += "}}";
+    return saida;
+}
+
+void Metricas::escreverTabela(std::ostream& saida) const {
+    saida << std::left << std::setw(32) << "Metodo" << std::right << std::setw(10) << "Chamadas"
+          << std::setw(14) << "Total (ms)" << std::setw(12) << "p50 (us)" << std::setw(12) << "p99 (us)"
+          << std::setw(12) << "Max (us)" << "\n";
+    saida << std::string(92, '-') << "\n";
+    saida << std::fixed << std::setprecision(1);
+
+    auto linha = [&saida](const std::string& nome, const HistogramaLatencia& h) {
+        saida << std::left << std::setw(32) << nome << std::right << std::setw(10) << h.contagem()
+              << std::setw(14) << h.soma() / 1e6 << std::setw(12) << h.percentil(0.50) / 1e3
+              << std::setw(12) << h.percentil(0.99) / 1e3 << std::setw(12) << h.maximo() / 1e3 << "\n";
+    };
+    {
+        std::lock_guard<std::mutex> trava(mutex);
+        for (const auto& item : metodos) {
+            linha(item.first, item.second->latencia);
+        }
+    }
+    linha("(sql)", contadoresSql.tempo);
+
+    saida << "\nStatements preparados: " << contadoresSql.preparados.load()
+          << "\nStatements executados: " << contadoresSql.executados.load()
+          << "\nLinhas lidas: " << contadoresSql.linhasLidas.load()
+          << "\nLinhas escritas: " << contadoresSql.linhasEscritas.load()
+          << "\nBytes retornados: " << contadoresSql.bytesRetornados.load()
+          << "\nCache de receitas: " << contadoresCache.acertos.load() << " acerto(s), "
+          << contadoresCache.falhas.load() << " falha(s)"
+          << "\nCache de consultas: " << contadoresCache.consultasAcertos.load() << " acerto(s), "
+          << contadoresCache.consultasFalhas.load() << " falha(s)"
+          << "\nDespejos/invalidacoes: " << contadoresCache.despejos.load() << " / "
+          << contadoresCache.invalidacoes.load() << std::endl;
+}
@@ -0,0 +1,318 @@
+// ============================================================================
+// INCLUDES
+// ============================================================================
+#include "../include/Renderizador.h"
+#include <charconv>
+
+// ============================================================================
+// AUXILIARES
+// ============================================================================
+static const size_t LARGURA_ID = 5;
+static const size_t LARGURA_NOME = 30;
+static const size_t LARGURA_CATEGORIA = 15;
+static const size_t LARGURA_TEMPO = 10;
+static const size_t LARGURA_PORCOES = 10;
+static const size_t LARGURA_FEITA = 8;
+static const size_t LARGURA_NOTA = 8;
+static const size_t LARGURA_TAGS = 30;
+static const size_t LARGURA_TABELA = 116;
+
+static void anexarInteiro(std::string& saida, int64_t valor) {
+    char numero[24];
+    auto fim = std::to_chars(numero, numero + sizeof(numero), valor).ptr;
+    saida.append(numero, static_cast<size_t>(fim - numero));
+}
+
+// Como std::setw: completa com espacos, sem truncar
+static void anexarPreenchido(std::string& saida, std::string_view texto, size_t largura) {
+    saida.append(texto.data(), texto.size());
+    if (texto.size() < largura) {
+        saida.append(largura - texto.size(), ' ');
+    }
+}
+
+static void anexarNumero(std::string& saida, int valor, size_t largura) {
+    char numero[16];
+    auto fim = std::to_chars(numero, numero + sizeof(numero), valor).ptr;
+    anexarPreenchido(saida, std::string_view(numero, static_cast<size_t>(fim - numero)), largura);
+}
+
+// Quantos bytes ocupam os primeiros "limite" codepoints; "total" recebe a contagem completa
+static size_t bytesDosPrimeiros(std::string_view texto, size_t limite, size_t& total) {
+    size_t bytes = texto.size();
+    total = 0;
+    for (size_t i = 0; i < texto.size(); ++i) {
+        if ((static_cast<unsigned char>(texto[i]) & 0xC0) != 0x80) {
+            if (total == limite) {
+                bytes = i;
+            }
+            total++;
+        }
+    }
+    return bytes;
+}
+
+// ============================================================================
+// CONSTRUTORES
+// ============================================================================
+Renderizador::Renderizador(std::ostream& saida, FormatoSaida formato, size_t tamanhoLote)
+    : saida(&saida), buffer(proprio), formato(formato), tamanhoLote(tamanhoLote),
+      campos(CAMPOS_LISTAGEM), linhas(0), iniciado(false), finalizado(false) {
+    buffer.reserve(tamanhoLote + 1024);
+}
+
+Renderizador::Renderizador(std::string& destino, FormatoSaida formato)
+    : saida(nullptr), buffer(destino), formato(formato), tamanhoLote(0),
+      campos(CAMPOS_LISTAGEM), linhas(0), iniciado(false), finalizado(false) {
+}
+
+Renderizador::~Renderizador() {
+    if (iniciado && !finalizado) {
+        finalizar();
+    }
+}
+
+FormatoSaida Renderizador::formatoPorNome(const std::string& nome, bool* valido) {
+    if (valido) {
+        *valido = true;
+    }
+    if (nome == "json") {
+        return FormatoSaida::Json;
+    }
+    if (nome == "ndjson") {
+        return FormatoSaida::Ndjson;
+    }
+    if (valido && nome != "tabela" && nome != "table") {
+        *valido = false;
+    }
+    return FormatoSaida::Tabela;
+}
+
+// ============================================================================
+// FORMATACAO DE CAMPOS
+// ============================================================================
+void Renderizador::anexarCelula(std::string& saida, std::string_view texto, size_t largura) {
+    size_t total = 0;
+    size_t visiveis = largura - 2;
+    size_t bytes = bytesDosPrimeiros(texto, largura - 3, total);
+
+    if (total > visiveis) {
+        saida.append(texto.data(), bytes);
+        saida.append("..");
+        visiveis = largura - 1;
+    } else {
+        saida.append(texto.data(), texto.size());
+        visiveis = total;
+    }
+    saida.append(largura - visiveis, ' ');
+}
+
+void Renderizador::anexarJsonString(std::string& saida, std::string_view texto) {
+    static const char* hex = "0123456789abcdef";
+    saida.push_back('"');
+    size_t inicio = 0;
+    for (size_t i = 0; i < texto.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(texto[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        saida.append(texto.data() + inicio, i - inicio);
+        inicio = i + 1;
+        switch (c) {
+            case '"': saida.append("\\\""); break;
+            case '\\': saida.append("\\\\"); break;
+            case '\n': saida.append("\\n"); break;
+            case '\r': saida.append("\\r"); break;
+            case '\t': saida.append("\\t"); break;
+            default:
+                saida.append("\\u00");
+                saida.push_back(hex[c >> 4]);
+                saida.push_back(hex[c & 0x0F]);
+                break;
+        }
+    }
+    saida.append(texto.data() + inicio, texto.size() - inicio);
+    saida.push_back('"');
+}
+
+// ============================================================================
+// ESCRITA DE LINHAS
+// ============================================================================
+void Renderizador::iniciar() {
+    iniciado = true;
+    if (formato == FormatoSaida::Json) {
+        buffer.push_back('[');
+    } else if (formato == FormatoSaida::Tabela) {
+        anexarPreenchido(buffer, "ID", LARGURA_ID);
+        anexarPreenchido(buffer, "Nome", LARGURA_NOME);
+        anexarPreenchido(buffer, "Categoria", LARGURA_CATEGORIA);
+        anexarPreenchido(buffer, "Tempo", LARGURA_TEMPO);
+        anexarPreenchido(buffer, "Porcoes", LARGURA_PORCOES);
+        anexarPreenchido(buffer, "Feita", LARGURA_FEITA);
+        anexarPreenchido(buffer, "Nota", LARGURA_NOTA);
+        anexarPreenchido(buffer, "Tags", LARGURA_TAGS);
+        buffer.push_back('\n');
+        buffer.append(LARGURA_TABELA, '-');
+        buffer.push_back('\n');
+    }
+}
+
+void Renderizador::descarregarSeCheio() {
+    if (saida && buffer.size() >= tamanhoLote) {
+        saida->write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        buffer.clear();
+    }
+}
+
+void Renderizador::escrever(const ReceitaLinha& r, const std::vector<std::string_view>& tags) {
+    if (!iniciado) {
+        iniciar();
+    }
+
+    if (formato == FormatoSaida::Tabela) {
+        anexarNumero(buffer, r.id, LARGURA_ID);
+        anexarCelula(buffer, r.nome, LARGURA_NOME);
+        anexarCelula(buffer, r.categoria, LARGURA_CATEGORIA);
+        anexarNumero(buffer, r.tempo, LARGURA_TEMPO);
+        anexarNumero(buffer, r.porcoes, LARGURA_PORCOES);
+        anexarPreenchido(buffer, r.feita ? "Sim" : "Nao", LARGURA_FEITA);
+        if (r.nota > 0) {
+            anexarNumero(buffer, r.nota, LARGURA_NOTA);
+        } else {
+            anexarPreenchido(buffer, "-", LARGURA_NOTA);
+        }
+        anexarCelula(buffer, r.tags.empty() ? std::string_view("-") : r.tags, LARGURA_TAGS);
+        buffer.push_back('\n');
+    } else {
+        if (formato == FormatoSaida::Json && linhas > 0) {
+            buffer.push_back(',');
+        }
+        buffer.append("{\"id\":");
+        anexarInteiro(buffer, r.id);
+        buffer.append(",\"nome\":");
+        anexarJsonString(buffer, r.nome);
+        buffer.append(",\"categoria\":");
+        anexarJsonString(buffer, r.categoria);
+        buffer.append(",\"tempo\":");
+        anexarInteiro(buffer, r.tempo);
+        buffer.append(",\"porcoes\":");
+        anexarInteiro(buffer, r.porcoes);
+        buffer.append(r.feita ? ",\"feita\":true" : ",\"feita\":false");
+        buffer.append(",\"nota\":");
+        anexarInteiro(buffer, r.nota);
+        buffer.append(",\"criada_em\":");
+        anexarInteiro(buffer, r.criadaEm);
+        buffer.append(",\"atualizada_em\":");
+        anexarInteiro(buffer, r.atualizadaEm);
+        buffer.append(",\"tags\":[");
+        for (size_t i = 0; i < tags.size(); ++i) {
+            if (i > 0) {
+                buffer.push_back(',');
+            }
+            anexarJsonString(buffer, tags[i]);
+        }
+        buffer.push_back(']');
+        if (campos & CAMPO_INGREDIENTES) {
+            buffer.append(",\"ingredientes\":");
+            anexarJsonString(buffer, r.ingredientes);
+        }
+        if (campos & CAMPO_PREPARO) {
+            buffer.append(",\"preparo\":");
+            anexarJsonString(buffer, r.preparo);
+        }
+        if (campos & CAMPO_IMAGEM) {
+            buffer.append(",\"imagem\":");
+            anexarJsonString(buffer, r.imagem);
+        }
+        buffer.push_back('}');
+        if (formato == FormatoSaida::Ndjson) {
+            buffer.push_back('\n');
+        }
+    }
+
+    linhas++;
+    descarregarSeCheio();
+}
+
+void Renderizador::linha(const ReceitaLinha& receita) {
+    escrever(receita, receita.listaTags);
+}
+
+void Renderizador::linha(const ResultadoReceitas::ReceitaView& receita) {
+    ReceitaLinha r;
+    r.id = receita.id();
+    r.nome = receita.nome();
+    r.categoria = receita.categoria();
+    r.tempo = receita.tempo();
+    r.porcoes = receita.porcoes();
+    r.feita = receita.feita();
+    r.nota = receita.nota();
+    r.criadaEm = receita.criadaEm();
+    r.atualizadaEm = receita.atualizadaEm();
+    if (formato != FormatoSaida::Tabela) {
+        // Campos pesados so sao tocados (e carregados) quando serao exibidos
+        if (campos & CAMPO_INGREDIENTES) r.ingredientes = receita.ingredientes();
+        if (campos & CAMPO_PREPARO) r.preparo = receita.preparo();
+        if (campos & CAMPO_IMAGEM) r.imagem = receita.imagem();
+    }
+
+    tagsTemporarias.clear();
+    listaTags.clear();
+    for (size_t i = 0; i < receita.numTags(); ++i) {
+        if (i > 0) {
+            tagsTemporarias.append(", ");
+        }
+        std::string_view tag = receita.tag(i);
+        tagsTemporarias.append(tag.data(), tag.size());
+        listaTags.push_back(tag);
+    }
+    r.tags = tagsTemporarias;
+    escrever(r, listaTags);
+}
+
+void Renderizador::linha(const Receita& receita) {
+    ReceitaLinha r;
+    r.id = receita.id;
+    r.nome = receita.nome;
+    r.ingredientes = receita.ingredientes;
+    r.preparo = receita.preparo;
+    r.categoria = receita.categoria;
+    r.tempo = receita.tempo;
+    r.porcoes = receita.porcoes;
+    r.feita = receita.feita;
+    r.nota = receita.nota;
+    r.imagem = receita.imagem;
+    r.criadaEm = receita.criadaEm;
+    r.atualizadaEm = receita.atualizadaEm;
+
+    tagsTemporarias.clear();
+    listaTags.clear();
+    for (size_t i = 0; i < receita.tags.size(); ++i) {
+        if (i > 0) {
+            tagsTemporarias.append(", ");
+        }
+        tagsTemporarias.append(receita.tags[i]);
+        listaTags.push_back(receita.tags[i]);
+    }
+    r.tags = tagsTemporarias;
+    escrever(r, listaTags);
+}
+
+void Renderizador::finalizar() {
+    if (finalizado) {
+        return;
+    }
+    if (!iniciado) {
+        iniciar();
+    }
+    if (formato == FormatoSaida::Json) {
+        buffer.append("]\n");
+    }
+    finalizado = true;
+
+    if (saida) {
+        saida->write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        saida->flush();
+        buffer.clear();
+    }
+}
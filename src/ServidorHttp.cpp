@@ -0,0 +1,983 @@
+// ============================================================================
+// INCLUDES
+// ============================================================================
+#include "../include/ServidorHttp.h"
+#include "../include/ArmazemImagens.h"
+#include "../include/Database.h"
+#include "../include/LogConsultasLentas.h"
+#include "../include/Metricas.h"
+#include "../include/Renderizador.h"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+
+// ============================================================================
+// AUXILIARES HTTP
+// ============================================================================
+namespace {
+
+const size_t TAMANHO_MAXIMO_CABECALHO = 16 * 1024;
+const size_t TAMANHO_MAXIMO_CORPO = 1024 * 1024;
+const auto TEMPO_MAXIMO_OCIOSO = std::chrono::seconds(60);
+
+const char* textoStatus(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 201: return "Created";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 413: return "Payload Too Large";
+        case 500: return "Internal Server Error";
+        case 501: return "Not Implemented";
+        case 503: return "Service Unavailable";
+        default: return "Unknown";
+    }
+}
+
+RespostaHttp respostaErro(int status, const std::string& mensagem) {
+    RespostaHttp resposta;
+    resposta.status = status;
+    resposta.corpo = "{\"erro\":";
+    Renderizador::anexarJsonString(resposta.corpo, mensagem);
+    resposta.corpo += "}";
+    return resposta;
+}
+
+RespostaHttp respostaOk(const std::string& corpo = "{\"ok\":true}", int status = 200) {
+    RespostaHttp resposta;
+    resposta.status = status;
+    resposta.corpo = corpo;
+    return resposta;
+}
+
+void anexarCabecalho(std::string& saida, const RespostaHttp& resposta, size_t tamanhoCorpo, bool manterConexao) {
+    char numero[24];
+    saida += "HTTP/1.1 ";
+    auto fim = std::to_chars(numero, numero + sizeof(numero), resposta.status).ptr;
+    saida.append(numero, static_cast<size_t>(fim - numero));
+    saida += " ";
+    saida += textoStatus(resposta.status);
+    saida += "\r\nContent-Type: ";
+    saida += resposta.tipo;
+    saida += "\r\nContent-Length: ";
+    fim = std::to_chars(numero, numero + sizeof(numero), tamanhoCorpo).ptr;
+    saida.append(numero, static_cast<size_t>(fim - numero));
+    if (!resposta.arquivo.empty()) {
+        // Blobs enderecados por conteudo nunca mudam
+        saida += "\r\nCache-Control: public, max-age=31536000, immutable";
+    }
+    saida += manterConexao ? "\r\nConnection: keep-alive\r\n\r\n" : "\r\nConnection: close\r\n\r\n";
+}
+
+// Sem corpo (HEAD), o cabecalho continua com o Content-Length que o GET teria
+void anexarResposta(std::string& saida, const RespostaHttp& resposta, bool comCorpo, bool manterConexao) {
+    anexarCabecalho(saida, resposta, resposta.corpo.size(), manterConexao);
+    if (comCorpo) {
+        saida += resposta.corpo;
+    }
+}
+
+bool enviarTudo(int fd, const std::string& saida) {
+    size_t enviado = 0;
+    while (enviado < saida.size()) {
+        ssize_t n = send(fd, saida.data() + enviado, saida.size() - enviado, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        enviado += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Descarrega as respostas pendentes com o cabecalho desta e manda o corpo
+// direto do arquivo para o socket (sendfile), sem copia-lo para o processo.
+// Retorna false se a conexao deve ser fechada.
+bool enviarArquivo(int socket, std::string& saida, RespostaHttp resposta, bool comCorpo, bool manterConexao) {
+    int fd = ::open(resposta.arquivo.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        anexarResposta(saida, respostaErro(404, "imagem nao encontrada"), comCorpo, manterConexao);
+        return true;
+    }
+    unsigned char inicio[16];
+    ssize_t lidos = pread(fd, inicio, sizeof(inicio), 0);
+    resposta.tipo = ArmazemImagens::tipoMime(inicio, lidos > 0 ? static_cast<size_t>(lidos) : 0);
+    size_t tamanho = static_cast<size_t>(info.st_size);
+
+    anexarCabecalho(saida, resposta, tamanho, manterConexao);
+    bool ok = enviarTudo(socket, saida);
+    saida.clear();
+    off_t deslocamento = 0;
+    while (ok && comCorpo && static_cast<size_t>(deslocamento) < tamanho) {
+        ssize_t n = sendfile(socket, fd, &deslocamento, tamanho - static_cast<size_t>(deslocamento));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        ok = n > 0;
+    }
+    ::close(fd);
+    return ok;
+}
+
+std::string decodificarUrl(const std::string& texto) {
+    std::string resultado;
+    resultado.reserve(texto.size());
+    for (size_t i = 0; i < texto.size(); ++i) {
+        if (texto[i] == '+') {
+            resultado += ' ';
+        } else if (texto[i] == '%' && i + 2 < texto.size()) {
+            int valor = 0;
+            auto r = std::from_chars(texto.data() + i + 1, texto.data() + i + 3, valor, 16);
+            if (r.ec == std::errc() && r.ptr == texto.data() + i + 3) {
+                resultado += static_cast<char>(valor);
+                i += 2;
+            } else {
+                resultado += texto[i];
+            }
+        } else {
+            resultado += texto[i];
+        }
+    }
+    return resultado;
+}
+
+void lerParametros(const std::string& texto, std::map<std::string, std::string>& parametros) {
+    size_t inicio = 0;
+    while (inicio < texto.size()) {
+        size_t fim = texto.find('&', inicio);
+        if (fim == std::string::npos) {
+            fim = texto.size();
+        }
+        std::string par = texto.substr(inicio, fim - inicio);
+        size_t igual = par.find('=');
+        if (!par.empty()) {
+            if (igual == std::string::npos) {
+                parametros[decodificarUrl(par)] = "";
+            } else {
+                parametros[decodificarUrl(par.substr(0, igual))] = decodificarUrl(par.substr(igual + 1));
+            }
+        }
+        inicio = fim + 1;
+    }
+}
+
+std::vector<std::string> dividirCaminho(const std::string& caminho) {
+    std::vector<std::string> partes;
+    size_t inicio = 0;
+    while (inicio < caminho.size()) {
+        size_t fim = caminho.find('/', inicio);
+        if (fim == std::string::npos) {
+            fim = caminho.size();
+        }
+        if (fim > inicio) {
+            partes.push_back(decodificarUrl(caminho.substr(inicio, fim - inicio)));
+        }
+        inicio = fim + 1;
+    }
+    return partes;
+}
+
+bool lerInteiro(const std::string& texto, int& valor) {
+    const char* fim = texto.data() + texto.size();
+    auto resultado = std::from_chars(texto.data(), fim, valor);
+    return !texto.empty() && resultado.ec == std::errc() && resultado.ptr == fim;
+}
+
+bool lerInteiro(const std::string& texto, int64_t& valor) {
+    const char* fim = texto.data() + texto.size();
+    auto resultado = std::from_chars(texto.data(), fim, valor);
+    return !texto.empty() && resultado.ec == std::errc() && resultado.ptr == fim;
+}
+
+std::string parametro(const std::map<std::string, std::string>& parametros, const char* nome) {
+    auto it = parametros.find(nome);
+    return it == parametros.end() ? std::string() : it->second;
+}
+
+bool igualSemCaixa(const std::string& a, const char* b) {
+    size_t n = std::strlen(b);
+    if (a.size() != n) {
+        return false;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Lista separada por virgulas, sem espacos nas pontas
+std::vector<std::string> dividirLista(const std::string& texto) {
+    std::vector<std::string> itens;
+    size_t inicio = 0;
+    while (inicio <= texto.size()) {
+        size_t fim = texto.find(',', inicio);
+        if (fim == std::string::npos) {
+            fim = texto.size();
+        }
+        std::string item = texto.substr(inicio, fim - inicio);
+        item.erase(0, item.find_first_not_of(" \t"));
+        item.erase(item.find_last_not_of(" \t") + 1);
+        if (!item.empty()) {
+            itens.push_back(item);
+        }
+        inicio = fim + 1;
+    }
+    return itens;
+}
+
+std::string receitaJson(const Receita& receita) {
+    std::string corpo;
+    Renderizador saida(corpo, FormatoSaida::Ndjson);
+    saida.definirCampos(CAMPOS_TODOS);
+    saida.linha(receita);
+    saida.finalizar();
+    if (!corpo.empty() && corpo.back() == '\n') {
+        corpo.pop_back();
+    }
+    return corpo;
+}
+
+} // namespace
+
+// ============================================================================
+// CICLO DE VIDA
+// ============================================================================
+ServidorHttp::ServidorHttp(const ConfiguracaoServidor& configuracao)
+    : configuracao(configuracao), portaEmUso(0), socketEscuta(-1), canalDespertar{-1, -1}, executando(false) {
+}
+
+ServidorHttp::~ServidorHttp() {
+    parar();
+}
+
+bool ServidorHttp::iniciar() {
+    bancoEscrita.reset(new Database(configuracao.caminhoDb));
+    if (!bancoEscrita->initialize() || !bancoEscrita->habilitarWal()) {
+        std::cerr << "Erro ao abrir o vault para escrita." << std::endl;
+        return false;
+    }
+
+    int trabalhadores = std::max(1, configuracao.trabalhadores);
+    for (int i = 0; i < trabalhadores; ++i) {
+        bancosLeitura.emplace_back(new Database(configuracao.caminhoDb));
+        if (!bancosLeitura.back()->initializeSomenteLeitura()) {
+            return false;
+        }
+        LimitesConsulta limites;
+        limites.prazoMs = configuracao.prazoConsultaMs;
+        bancosLeitura.back()->configurarLimites(limites);
+    }
+
+    socketEscuta = socket(AF_INET, SOCK_STREAM, 0);
+    if (socketEscuta < 0) {
+        std::cerr << "Erro ao criar socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    int ligado = 1;
+    setsockopt(socketEscuta, SOL_SOCKET, SO_REUSEADDR, &ligado, sizeof(ligado));
+
+    sockaddr_in endereco{};
+    endereco.sin_family = AF_INET;
+    endereco.sin_port = htons(static_cast<uint16_t>(configuracao.porta));
+    if (inet_pton(AF_INET, configuracao.endereco.c_str(), &endereco.sin_addr) != 1) {
+        std::cerr << "Endereco invalido: " << configuracao.endereco << std::endl;
+        return false;
+    }
+
+    if (bind(socketEscuta, reinterpret_cast<sockaddr*>(&endereco), sizeof(endereco)) != 0 ||
+        listen(socketEscuta, 512) != 0) {
+        std::cerr << "Erro ao escutar em " << configuracao.endereco << ":" << configuracao.porta
+                  << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    socklen_t tamanho = sizeof(endereco);
+    getsockname(socketEscuta, reinterpret_cast<sockaddr*>(&endereco), &tamanho);
+    portaEmUso = ntohs(endereco.sin_port);
+    fcntl(socketEscuta, F_SETFL, fcntl(socketEscuta, F_GETFL) | O_NONBLOCK);
+
+    if (pipe(canalDespertar) != 0) {
+        std::cerr << "Erro ao criar pipe: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    fcntl(canalDespertar[0], F_SETFL, fcntl(canalDespertar[0], F_GETFL) | O_NONBLOCK);
+
+    executando = true;
+    threads.emplace_back(&ServidorHttp::lacoPoll, this);
+    threads.emplace_back(&ServidorHttp::lacoEscritor, this);
+    for (int i = 0; i < trabalhadores; ++i) {
+        threads.emplace_back(&ServidorHttp::lacoTrabalhador, this, i);
+    }
+    return true;
+}
+
+void ServidorHttp::parar() {
+    if (executando.exchange(false)) {
+        acordarPoll();
+        condProntas.notify_all();
+        condEscritas.notify_all();
+    }
+    for (auto& thread : threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    threads.clear();
+
+    for (auto& conexao : prontas) {
+        close(conexao->fd);
+    }
+    prontas.clear();
+    for (auto& conexao : devolvidas) {
+        close(conexao->fd);
+    }
+    devolvidas.clear();
+
+    if (socketEscuta >= 0) {
+        close(socketEscuta);
+        socketEscuta = -1;
+    }
+    for (int& fd : canalDespertar) {
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    bancosLeitura.clear();
+    bancoEscrita.reset();
+}
+
+// ============================================================================
+// THREADS
+// ============================================================================
+void ServidorHttp::acordarPoll() {
+    if (canalDespertar[1] >= 0) {
+        char byte = 1;
+        ssize_t escrito = write(canalDespertar[1], &byte, 1);
+        (void)escrito;
+    }
+}
+
+void ServidorHttp::devolverAoPoll(std::unique_ptr<Conexao> conexao) {
+    {
+        std::lock_guard<std::mutex> trava(mutexDevolvidas);
+        devolvidas.push_back(std::move(conexao));
+    }
+    acordarPoll();
+}
+
+void ServidorHttp::lacoPoll() {
+    std::vector<std::unique_ptr<Conexao>> ociosas;
+    std::vector<pollfd> descritores;
+
+    while (executando) {
+        {
+            std::lock_guard<std::mutex> trava(mutexDevolvidas);
+            for (auto& conexao : devolvidas) {
+                ociosas.push_back(std::move(conexao));
+            }
+            devolvidas.clear();
+        }
+
+        descritores.clear();
+        descritores.push_back({socketEscuta, POLLIN, 0});
+        descritores.push_back({canalDespertar[0], POLLIN, 0});
+        for (const auto& conexao : ociosas) {
+            descritores.push_back({conexao->fd, POLLIN, 0});
+        }
+
+        if (poll(descritores.data(), descritores.size(), 1000) < 0 && errno != EINTR) {
+            break;
+        }
+
+        if (descritores[1].revents & POLLIN) {
+            char lixo[64];
+            while (read(canalDespertar[0], lixo, sizeof(lixo)) > 0) {
+            }
+        }
+
+        auto agora = std::chrono::steady_clock::now();
+        std::vector<std::unique_ptr<Conexao>> paraTrabalhadores;
+        size_t mantidas = 0;
+        for (size_t i = 0; i < ociosas.size(); ++i) {
+            short eventos = descritores[i + 2].revents;
+            if (eventos & (POLLIN | POLLHUP | POLLERR)) {
+                paraTrabalhadores.push_back(std::move(ociosas[i]));
+            } else if (agora - ociosas[i]->ultimaAtividade > TEMPO_MAXIMO_OCIOSO) {
+                close(ociosas[i]->fd);
+            } else {
+                ociosas[mantidas++] = std::move(ociosas[i]);
+            }
+        }
+        ociosas.resize(mantidas);
+
+        if (descritores[0].revents & POLLIN) {
+            while (true) {
+                int fd = accept(socketEscuta, nullptr, nullptr);
+                if (fd < 0) {
+                    break;
+                }
+                int ligado = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &ligado, sizeof(ligado));
+                timeval limite{10, 0};
+                setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &limite, sizeof(limite));
+                std::unique_ptr<Conexao> conexao(new Conexao());
+                conexao->fd = fd;
+                conexao->ultimaAtividade = agora;
+                ociosas.push_back(std::move(conexao));
+            }
+        }
+
+        if (!paraTrabalhadores.empty()) {
+            std::lock_guard<std::mutex> trava(mutexProntas);
+            for (auto& conexao : paraTrabalhadores) {
+                prontas.push_back(std::move(conexao));
+            }
+        }
+        condProntas.notify_all();
+    }
+
+    for (auto& conexao : ociosas) {
+        close(conexao->fd);
+    }
+}
+
+void ServidorHttp::lacoTrabalhador(int indice) {
+    Database& leitura = *bancosLeitura[indice];
+
+    while (true) {
+        std::unique_ptr<Conexao> conexao;
+        {
+            std::unique_lock<std::mutex> trava(mutexProntas);
+            condProntas.wait(trava, [this] { return !prontas.empty() || !executando; });
+            if (!executando) {
+                return;
+            }
+            conexao = std::move(prontas.front());
+            prontas.pop_front();
+        }
+
+        if (atenderConexao(*conexao, leitura)) {
+            conexao->ultimaAtividade = std::chrono::steady_clock::now();
+            devolverAoPoll(std::move(conexao));
+        } else {
+            close(conexao->fd);
+        }
+    }
+}
+
+void ServidorHttp::lacoEscritor() {
+    Database& banco = *bancoEscrita;
+
+    while (true) {
+        std::deque<TarefaEscrita> lote;
+        {
+            std::unique_lock<std::mutex> trava(mutexEscritas);
+            condEscritas.wait(trava, [this] { return !escritas.empty() || !executando; });
+            if (escritas.empty()) {
+                return;
+            }
+            lote.swap(escritas);
+        }
+
+        // Tudo o que chegou junto vai em uma unica transacao (um fsync por grupo)
+        size_t i = 0;
+        while (i < lote.size()) {
+            if (lote[i].exclusiva) {
+                lote[i].promessa->set_value(lote[i].executar(banco));
+                ++i;
+                continue;
+            }
+
+            size_t fim = i;
+            while (fim < lote.size() && !lote[fim].exclusiva) {
+                ++fim;
+            }
+
+            // Cada tarefa tem seu savepoint: uma que falha (status >= 400) e
+            // desfeita sem levar as outras junto
+            std::vector<RespostaHttp> respostas(fim - i);
+            size_t inicioGrupo = i;
+            bool emTransacao = banco.iniciarTransacao();
+            for (size_t j = i; j < fim; ++j) {
+                bool comSavepoint = emTransacao && banco.criarSavepoint("tarefa");
+                RespostaHttp resposta = lote[j].executar(banco);
+                if (emTransacao && !banco.emTransacao()) {
+                    // O SQLite desfez a transacao do grupo: as tarefas anteriores
+                    // se perderam com ela, e esta pode ter gravado so uma parte
+                    for (size_t k = inicioGrupo; k <= j; ++k) {
+                        respostas[k - i] = respostaErro(500, "transacao desfeita");
+                    }
+                    inicioGrupo = j + 1;
+                    emTransacao = banco.iniciarTransacao();
+                    continue;
+                }
+                if (comSavepoint && resposta.status >= 400) {
+                    banco.desfazerSavepoint("tarefa");
+                } else if (comSavepoint && !banco.liberarSavepoint("tarefa")) {
+                    banco.desfazerSavepoint("tarefa");
+                    resposta = respostaErro(500, "falha ao gravar");
+                }
+                respostas[j - i] = std::move(resposta);
+            }
+            if (emTransacao && !banco.confirmarTransacao()) {
+                banco.desfazerTransacao();
+                for (size_t k = inicioGrupo; k < fim; ++k) {
+                    respostas[k - i] = respostaErro(500, "falha ao confirmar transacao");
+                }
+            }
+            for (size_t j = i; j < fim; ++j) {
+                lote[j].promessa->set_value(std::move(respostas[j - i]));
+            }
+            i = fim;
+        }
+    }
+}
+
+RespostaHttp ServidorHttp::escrever(std::function<RespostaHttp(Database&)> operacao, bool exclusiva) {
+    TarefaEscrita tarefa;
+    tarefa.executar = std::move(operacao);
+    tarefa.exclusiva = exclusiva;
+    tarefa.promessa = std::make_shared<std::promise<RespostaHttp>>();
+    std::future<RespostaHttp> futuro = tarefa.promessa->get_future();
+
+    {
+        std::lock_guard<std::mutex> trava(mutexEscritas);
+        if (!executando) {
+            return respostaErro(500, "servidor encerrando");
+        }
+        escritas.push_back(std::move(tarefa));
+    }
+    condEscritas.notify_one();
+    return futuro.get();
+}
+
+// ============================================================================
+// PROTOCOLO
+// ============================================================================
+bool ServidorHttp::atenderConexao(Conexao& conexao, Database& leitura) {
+    char bloco[64 * 1024];
+    ssize_t lidos = recv(conexao.fd, bloco, sizeof(bloco), 0);
+    if (lidos <= 0) {
+        return false;
+    }
+    conexao.entrada.append(bloco, static_cast<size_t>(lidos));
+
+    std::string saida;
+    bool manter = true;
+    size_t consumido = 0;
+
+    // Atende em ordem todas as requisicoes completas do buffer (pipelining)
+    while (manter) {
+        size_t fimCabecalho = conexao.entrada.find("\r\n\r\n", consumido);
+        if (fimCabecalho == std::string::npos) {
+            if (conexao.entrada.size() - consumido > TAMANHO_MAXIMO_CABECALHO) {
+                anexarResposta(saida, respostaErro(413, "cabecalho muito grande"), true, false);
+                manter = false;
+            }
+            break;
+        }
+
+        std::string metodo;
+        std::string alvo;
+        std::string versao;
+        size_t tamanhoCorpo = 0;
+        bool fecharPedido = false;
+        bool chunked = false;
+
+        size_t inicioLinha = consumido;
+        bool primeira = true;
+        while (inicioLinha < fimCabecalho) {
+            size_t fimLinha = conexao.entrada.find("\r\n", inicioLinha);
+            std::string linha = conexao.entrada.substr(inicioLinha, fimLinha - inicioLinha);
+            inicioLinha = fimLinha + 2;
+
+            if (primeira) {
+                size_t a = linha.find(' ');
+                size_t b = linha.find(' ', a == std::string::npos ? a : a + 1);
+                if (a != std::string::npos && b != std::string::npos) {
+                    metodo = linha.substr(0, a);
+                    alvo = linha.substr(a + 1, b - a - 1);
+                    versao = linha.substr(b + 1);
+                }
+                primeira = false;
+                continue;
+            }
+
+            size_t doisPontos = linha.find(':');
+            if (doisPontos == std::string::npos) {
+                continue;
+            }
+            std::string nome = linha.substr(0, doisPontos);
+            std::string valor = linha.substr(doisPontos + 1);
+            valor.erase(0, valor.find_first_not_of(" \t"));
+
+            if (igualSemCaixa(nome, "content-length")) {
+                tamanhoCorpo = static_cast<size_t>(std::strtoull(valor.c_str(), nullptr, 10));
+            } else if (igualSemCaixa(nome, "connection")) {
+                fecharPedido = igualSemCaixa(valor, "close");
+            } else if (igualSemCaixa(nome, "transfer-encoding")) {
+                chunked = !igualSemCaixa(valor, "identity");
+            }
+        }
+
+        if (versao == "HTTP/1.0") {
+            fecharPedido = true;
+        }
+
+        if (metodo.empty() || versao.rfind("HTTP/1.", 0) != 0) {
+            anexarResposta(saida, respostaErro(400, "requisicao invalida"), true, false);
+            manter = false;
+            break;
+        }
+        if (chunked) {
+            anexarResposta(saida, respostaErro(501, "transfer-encoding nao suportado"), metodo != "HEAD", false);
+            manter = false;
+            break;
+        }
+        if (tamanhoCorpo > TAMANHO_MAXIMO_CORPO) {
+            anexarResposta(saida, respostaErro(413, "corpo muito grande"), metodo != "HEAD", false);
+            manter = false;
+            break;
+        }
+
+        size_t inicioCorpo = fimCabecalho + 4;
+        if (conexao.entrada.size() < inicioCorpo + tamanhoCorpo) {
+            break;  // corpo ainda incompleto: aguarda mais dados
+        }
+
+        std::map<std::string, std::string> parametros;
+        std::string caminho = alvo;
+        size_t interrogacao = alvo.find('?');
+        if (interrogacao != std::string::npos) {
+            caminho = alvo.substr(0, interrogacao);
+            lerParametros(alvo.substr(interrogacao + 1), parametros);
+        }
+        if (tamanhoCorpo > 0) {
+            lerParametros(conexao.entrada.substr(inicioCorpo, tamanhoCorpo), parametros);
+        }
+
+        consumido = inicioCorpo + tamanhoCorpo;
+        manter = !fecharPedido;
+        RespostaHttp resposta = rotear(metodo, caminho, parametros, leitura);
+        bool comCorpo = metodo != "HEAD";
+        if (resposta.arquivo.empty()) {
+            anexarResposta(saida, resposta, comCorpo, manter);
+        } else if (!enviarArquivo(conexao.fd, saida, std::move(resposta), comCorpo, manter)) {
+            return false;
+        }
+    }
+
+    conexao.entrada.erase(0, consumido);
+    return enviarTudo(conexao.fd, saida) && manter;
+}
+
+// ============================================================================
+// ROTAS
+// ============================================================================
+RespostaHttp ServidorHttp::rotear(const std::string& metodo, const std::string& caminho,
+                                  const std::map<std::string, std::string>& parametros, Database& leitura) {
+    std::vector<std::string> partes = dividirCaminho(caminho);
+    bool leituraPedida = metodo == "GET" || metodo == "HEAD";
+
+    if (partes.empty()) {
+        return respostaOk("{\"servico\":\"chefvault\"}");
+    }
+
+    // /receitas
+    if (partes[0] == "receitas" && partes.size() == 1) {
+        if (leituraPedida) {
+            FiltroReceitas filtro;
+            filtro.nome = parametro(parametros, "busca");
+            filtro.tag = parametro(parametros, "tag");
+            filtro.somenteFeitas = parametro(parametros, "feitas") == "1";
+            std::string nota = parametro(parametros, "nota");
+            if (!nota.empty() && (!lerInteiro(nota, filtro.nota) || filtro.nota < 1 || filtro.nota > 5)) {
+                return respostaErro(400, "nota deve estar entre 1 e 5");
+            }
+            std::string alteradasDesde = parametro(parametros, "alteradas_desde");
+            if (!alteradasDesde.empty() && (!lerInteiro(alteradasDesde, filtro.alteradasDesde) ||
+                                            filtro.alteradasDesde < 0)) {
+                return respostaErro(400, "alteradas_desde deve ser ms desde a epoca");
+            }
+
+            RespostaHttp resposta;
+            Renderizador saida(resposta.corpo, FormatoSaida::Json);
+            StatusConsulta status = StatusConsulta::Ok;
+            if (leitura.forEachReceita(filtro, [&saida](const ReceitaLinha& r) {
+                    saida.linha(r);
+                    return true;
+                }, CAMPOS_LISTAGEM, &status) < 0) {
+                if (status == StatusConsulta::PrazoEsgotado) {
+                    return respostaErro(503, "consulta excedeu o prazo");
+                }
+                return respostaErro(500, "falha na consulta");
+            }
+            saida.finalizar();
+            return resposta;
+        }
+
+        if (metodo == "POST") {
+            Receita receita;
+            receita.nome = parametro(parametros, "nome");
+            receita.ingredientes = parametro(parametros, "ingredientes");
+            receita.preparo = parametro(parametros, "preparo");
+            receita.categoria = parametro(parametros, "categoria");
+            receita.imagem = parametro(parametros, "imagem");
+            receita.feita = parametro(parametros, "feita") == "1";
+            lerInteiro(parametro(parametros, "tempo"), receita.tempo);
+            lerInteiro(parametro(parametros, "porcoes"), receita.porcoes);
+            if (receita.nome.empty()) {
+                return respostaErro(400, "nome obrigatorio");
+            }
+            std::vector<std::string> tags = dividirLista(parametro(parametros, "tags"));
+
+            return escrever([receita, tags](Database& banco) {
+                int id = banco.cadastrarReceita(receita);
+                if (id <= 0) {
+                    return respostaErro(500, "falha ao cadastrar receita");
+                }
+                for (const auto& tag : tags) {
+                    int tagId = banco.createTag(tag);
+                    if (tagId > 0) {
+                        banco.addTagToReceita(id, tagId);
+                    }
+                }
+                return respostaOk("{\"id\":" + std::to_string(id) + "}", 201);
+            });
+        }
+        return respostaErro(405, "metodo nao permitido");
+    }
+
+    // /receitas/{id}[/...]
+    if (partes[0] == "receitas") {
+        int id = 0;
+        if (!lerInteiro(partes[1], id)) {
+            return respostaErro(404, "recurso nao encontrado");
+        }
+
+        if (partes.size() == 2) {
+            if (leituraPedida) {
+                Receita receita = leitura.consultarPorId(id);
+                if (receita.id == 0) {
+                    return leitura.prazoEstourado() ? respostaErro(503, "consulta excedeu o prazo")
+                                                    : respostaErro(404, "receita nao encontrada");
+                }
+                return respostaOk(receitaJson(receita));
+            }
+            if (metodo == "DELETE") {
+                return escrever([id](Database& banco) {
+                    if (banco.consultarPorId(id).id == 0) {
+                        return respostaErro(404, "receita nao encontrada");
+                    }
+                    return banco.excluirReceita(id) ? respostaOk() : respostaErro(500, "falha ao excluir");
+                });
+            }
+            return respostaErro(405, "metodo nao permitido");
+        }
+
+        const std::string& recurso = partes[2];
+        bool alteracao = metodo == "POST" || metodo == "PUT";
+
+        if (recurso == "nota" && partes.size() == 3 && alteracao) {
+            int nota = 0;
+            if (!lerInteiro(parametro(parametros, "nota"), nota) || nota < 1 || nota > 5) {
+                return respostaErro(400, "nota deve estar entre 1 e 5");
+            }
+            return escrever([id, nota](Database& banco) {
+                Receita receita = banco.consultarPorId(id);
+                if (receita.id == 0) {
+                    return respostaErro(404, "receita nao encontrada");
+                }
+                if (!receita.feita) {
+                    return respostaErro(400, "a receita precisa ser marcada como feita antes de ser avaliada");
+                }
+                return banco.avaliarReceita(id, nota) ? respostaOk() : respostaErro(500, "falha ao avaliar");
+            });
+        }
+
+        if (recurso == "feita" && partes.size() == 3 && alteracao) {
+            bool feita = parametro(parametros, "feita") != "0";
+            return escrever([id, feita](Database& banco) {
+                if (banco.consultarPorId(id).id == 0) {
+                    return respostaErro(404, "receita nao encontrada");
+                }
+                return banco.marcarReceitaComoFeita(id, feita) ? respostaOk() : respostaErro(500, "falha ao atualizar");
+            });
+        }
+
+        if (recurso == "tags") {
+            if (partes.size() == 3 && leituraPedida) {
+                std::string corpo = "[";
+                auto tags = leitura.getTagsFromReceita(id);
+                for (size_t i = 0; i < tags.size(); ++i) {
+                    if (i > 0) {
+                        corpo += ",";
+                    }
+                    Renderizador::anexarJsonString(corpo, tags[i]);
+                }
+                if (leitura.prazoEstourado()) {
+                    return respostaErro(503, "consulta excedeu o prazo");
+                }
+                return respostaOk(corpo + "]");
+            }
+            if (partes.size() == 3 && alteracao) {
+                std::vector<std::string> tags = dividirLista(parametro(parametros, "tag"));
+                if (tags.empty()) {
+                    return respostaErro(400, "informe tag=nome[,nome...]");
+                }
+                return escrever([id, tags](Database& banco) {
+                    if (banco.consultarPorId(id).id == 0) {
+                        return respostaErro(404, "receita nao encontrada");
+                    }
+                    for (const auto& tag : tags) {
+                        int tagId = banco.createTag(tag);
+                        if (tagId <= 0) {
+                            return respostaErro(500, "falha ao criar tag");
+                        }
+                        banco.addTagToReceita(id, tagId);
+                    }
+                    return respostaOk();
+                });
+            }
+            if (partes.size() == 4 && metodo == "DELETE") {
+                std::string nomeTag = partes[3];
+                return escrever([id, nomeTag](Database& banco) {
+                    for (const auto& tag : banco.listAllTags()) {
+                        if (tag.second == nomeTag) {
+                            banco.removeTagFromReceita(id, tag.first);
+                            return respostaOk();
+                        }
+                    }
+                    return respostaErro(404, "tag nao encontrada");
+                });
+            }
+        }
+        return respostaErro(404, "recurso nao encontrado");
+    }
+
+    // /imagens/{hash}: blob do armazem de imagens, enviado com sendfile
+    if (partes[0] == "imagens" && partes.size() == 2 && leituraPedida) {
+        if (!leitura.imagens().contem(partes[1])) {
+            return respostaErro(404, "imagem nao encontrada");
+        }
+        RespostaHttp resposta;
+        resposta.arquivo = leitura.imagens().caminhoDe(partes[1]);
+        return resposta;
+    }
+
+    // /alteracoes: log de alteracoes depois de "desde"; o cliente continua a
+    // partir do "ultimo" devolvido enquanto "mais" for true
+    if (partes[0] == "alteracoes" && partes.size() == 1 && leituraPedida) {
+        int64_t desde = 0;
+        int limite = 1000;
+        std::string textoDesde = parametro(parametros, "desde");
+        std::string textoLimite = parametro(parametros, "limite");
+        if ((!textoDesde.empty() && (!lerInteiro(textoDesde, desde) || desde < 0)) ||
+            (!textoLimite.empty() && (!lerInteiro(textoLimite, limite) || limite <= 0))) {
+            return respostaErro(400, "desde e limite devem ser inteiros positivos");
+        }
+
+        LimitesConsulta limites;
+        limites.prazoMs = configuracao.prazoConsultaMs;
+        limites.maxLinhas = static_cast<size_t>(limite);
+        std::string itens;
+        int64_t ultimo = desde;
+        StatusConsulta status = StatusConsulta::Ok;
+        if (leitura.alteracoesDesde(desde, [&itens, &ultimo](const Alteracao& a) {
+                itens += (itens.empty() ? "{\"seq\":" : ",{\"seq\":") + std::to_string(a.seq) + ",\"tabela\":";
+                Renderizador::anexarJsonString(itens, a.tabela);
+                itens += ",\"operacao\":\"";
+                itens += a.operacao;
+                itens += "\",\"receita_id\":" + std::to_string(a.receitaId) + ",\"chave\":" +
+                         std::to_string(a.chave) + ",\"momento\":" + std::to_string(a.momento) + "}";
+                ultimo = a.seq;
+                return true;
+            }, &status, &limites) < 0) {
+            if (status == StatusConsulta::PrazoEsgotado) {
+                return respostaErro(503, "consulta excedeu o prazo");
+            }
+            return respostaErro(500, "falha na consulta");
+        }
+        return respostaOk("{\"ultimo\":" + std::to_string(ultimo) + ",\"mais\":" +
+                          (status == StatusConsulta::LimiteLinhas ? "true" : "false") + ",\"alteracoes\":[" + itens +
+                          "]}");
+    }
+
+    // /stats: metricas acumuladas desde o inicio do servidor
+    if (partes[0] == "stats" && partes.size() == 1 && leituraPedida) {
+        return respostaOk(Metricas::global().paraJson());
+    }
+    if (partes[0] == "stats" && partes.size() == 2 && partes[1] == "lentas" && leituraPedida) {
+        return respostaOk(LogConsultasLentas::global().paraJson());
+    }
+
+    // /tags
+    if (partes[0] == "tags" && partes.size() == 1 && leituraPedida) {
+        std::string corpo = "[";
+        std::string prefixo = parametro(parametros, "prefixo");
+        if (!prefixo.empty()) {
+            auto tags = leitura.getTagsByPrefix(prefixo);
+            for (size_t i = 0; i < tags.size(); ++i) {
+                if (i > 0) {
+                    corpo += ",";
+                }
+                Renderizador::anexarJsonString(corpo, tags[i]);
+            }
+        } else {
+            auto tags = leitura.listAllTags();
+            for (size_t i = 0; i < tags.size(); ++i) {
+                corpo += (i > 0 ? ",{\"id\":" : "{\"id\":") + std::to_string(tags[i].first) + ",\"nome\":";
+                Renderizador::anexarJsonString(corpo, tags[i].second);
+                corpo += "}";
+            }
+        }
+        if (leitura.prazoEstourado()) {
+            return respostaErro(503, "consulta excedeu o prazo");
+        }
+        return respostaOk(corpo + "]");
+    }
+
+    // /backup: grava em diretorioBackups; o nome nao pode conter caminho
+    if (partes[0] == "backup" && partes.size() == 1 && metodo == "POST") {
+        std::string nome = parametro(parametros, "nome");
+        if (nome.empty()) {
+            nome = "recipes_backup_" + std::to_string(std::time(nullptr)) + ".db";
+        }
+        if (nome.find('/') != std::string::npos || nome.find('\\') != std::string::npos || nome[0] == '.') {
+            return respostaErro(400, "nome de backup invalido");
+        }
+        std::string destino = (std::filesystem::path(configuracao.diretorioBackups) / nome).string();
+        return escrever([destino](Database& banco) {
+            if (!banco.fazerBackup(destino)) {
+                return respostaErro(500, "falha ao fazer backup");
+            }
+            std::string corpo = "{\"caminho\":";
+            Renderizador::anexarJsonString(corpo, destino);
+            return respostaOk(corpo + "}", 201);
+        }, true);
+    }
+
+    return respostaErro(404, "recurso nao encontrado");
+}
@@ -0,0 +1,397 @@
+// ============================================================================
+// INCLUDES
+// ============================================================================
+#include "../include/SnapshotVault.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char MAGICA[8] = {'C', 'H', 'E', 'F', 'S', 'N', 'A', 'P'};
+static const uint32_t ORDEM_BYTES = 0x01020304;
+static const uint64_t ALINHAMENTO = 64;
+
+// ============================================================================
+// LEITURA
+// ============================================================================
+SnapshotVault::~SnapshotVault() {
+    fechar();
+}
+
+bool SnapshotVault::abrir(const std::string& caminho) {
+    fechar();
+    int fd = ::open(caminho.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Erro ao abrir snapshot: " << caminho << std::endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(Cabecalho)) {
+        std::cerr << "Snapshot invalido (arquivo curto): " << caminho << std::endl;
+        ::close(fd);
+        return false;
+    }
+    tamanhoMapa = static_cast<size_t>(info.st_size);
+    void* endereco = mmap(nullptr, tamanhoMapa, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (endereco == MAP_FAILED) {
+        std::cerr << "Erro ao mapear snapshot: " << caminho << std::endl;
+        tamanhoMapa = 0;
+        return false;
+    }
+    mapa = endereco;
+
+    const char* base = static_cast<const char*>(mapa);
+    const Cabecalho* cabecalho = reinterpret_cast<const Cabecalho*>(base);
+    const char* erro = nullptr;
+    if (std::memcmp(cabecalho->magica, MAGICA, sizeof(MAGICA)) != 0) {
+        erro = "nao e um snapshot ChefVault";
+    } else if (cabecalho->ordemBytes != ORDEM_BYTES) {
+        erro = "gravado com outra ordem de bytes";
+    } else if (cabecalho->versao != VERSAO) {
+        erro = "versao nao suportada";
+    } else if (cabecalho->numSecoes != NUM_SECOES || cabecalho->tamanhoArquivo != tamanhoMapa ||
+               tamanhoMapa < sizeof(Cabecalho) + NUM_SECOES * sizeof(EntradaSecao) ||
+               cabecalho->numReceitas >= NENHUM) {
+        erro = "cabecalho inconsistente";
+    }
+    if (!erro) {
+        secoes = reinterpret_cast<const EntradaSecao*>(base + sizeof(Cabecalho));
+        for (uint32_t s = 0; s < NUM_SECOES && !erro; ++s) {
+            if (secoes[s].deslocamento % 8 != 0 || secoes[s].deslocamento > tamanhoMapa ||
+                secoes[s].tamanho > tamanhoMapa - secoes[s].deslocamento) {
+                erro = "secao fora do arquivo";
+            }
+        }
+    }
+
+    numReceitas = erro ? 0 : static_cast<uint32_t>(cabecalho->numReceitas);
+    uint64_t n = numReceitas;
+    auto secao = [&](Secao s, uint64_t tamanhoElemento, uint64_t elementos) -> const void* {
+        if (erro) {
+            return nullptr;
+        }
+        if (secoes[s].tamanho != tamanhoElemento * elementos) {
+            erro = "secao com tamanho inconsistente";
+            return nullptr;
+        }
+        return base + secoes[s].deslocamento;
+    };
+    ids = static_cast<const int32_t*>(secao(SECAO_IDS, 4, n));
+    tempos = static_cast<const int32_t*>(secao(SECAO_TEMPO, 4, n));
+    porcoes = static_cast<const int32_t*>(secao(SECAO_PORCOES, 4, n));
+    notas = static_cast<const uint8_t*>(secao(SECAO_NOTA, 1, n));
+    feitas = static_cast<const uint8_t*>(secao(SECAO_FEITA, 1, n));
+    categoriaPorReceita = static_cast<const uint32_t*>(secao(SECAO_CATEGORIA, 4, n));
+    tagsInicio = static_cast<const uint32_t*>(secao(SECAO_TAGS_INICIO, 4, n + 1));
+    ingredientesInicio = static_cast<const uint32_t*>(secao(SECAO_INGR_INICIO, 4, n + 1));
+
+    // O ultimo inicio da o tamanho dos arrays planos; os demais nao sao
+    // conferidos aqui (faixa() limita cada receita ao array plano)
+    uint64_t vinculos = tagsInicio ? tagsInicio[n] : 0;
+    uint64_t ingredientes = ingredientesInicio ? ingredientesInicio[n] : 0;
+    totalVinculos = static_cast<uint32_t>(vinculos);
+    totalIngredientes = static_cast<uint32_t>(ingredientes);
+    tagsPorReceita = static_cast<const uint32_t*>(secao(SECAO_TAGS_RECEITA, 4, vinculos));
+    ingredienteIds = static_cast<const int32_t*>(secao(SECAO_INGR_ID, 4, ingredientes));
+    ingredienteQuantidades = static_cast<const double*>(secao(SECAO_INGR_QUANTIDADE, 8, ingredientes));
+    ingredienteNomes = static_cast<const uint32_t*>(secao(SECAO_INGR_NOME, 4, ingredientes));
+    ingredienteUnidades = static_cast<const uint32_t*>(secao(SECAO_INGR_UNIDADE, 4, ingredientes));
+
+    if (!erro && !(carregarTextos(SECAO_NOME_OFFSETS, nomes, n) &&
+                   carregarTextos(SECAO_INGREDIENTES_OFFSETS, textosIngredientes, n) &&
+                   carregarTextos(SECAO_PREPARO_OFFSETS, preparos, n) &&
+                   carregarTextos(SECAO_IMAGEM_OFFSETS, imagens, n) &&
+                   carregarTextos(SECAO_CATEGORIAS_OFFSETS, categorias, 0) &&
+                   carregarTextos(SECAO_TAGS_OFFSETS, tags, 0) &&
+                   carregarTextos(SECAO_INGR_NOMES_OFFSETS, nomesIngredientes, 0) &&
+                   carregarTextos(SECAO_UNIDADES_OFFSETS, unidades, 0))) {
+        erro = "textos inconsistentes";
+    }
+
+    if (erro) {
+        std::cerr << "Snapshot invalido (" << erro << "): " << caminho << std::endl;
+        fechar();
+        return false;
+    }
+    return true;
+}
+
+// tamanho 0: dicionario, com o numero de entradas deduzido dos offsets
+bool SnapshotVault::carregarTextos(Secao secaoOffsets, Textos& textos, uint64_t tamanho) {
+    const char* base = static_cast<const char*>(mapa);
+    const EntradaSecao& offsets = secoes[secaoOffsets];
+    const EntradaSecao& heap = secoes[secaoOffsets + 1];
+    if (offsets.tamanho < 8 || offsets.tamanho % 8 != 0 || (tamanho > 0 && offsets.tamanho != (tamanho + 1) * 8) ||
+        offsets.tamanho / 8 - 1 >= NENHUM) {
+        return false;
+    }
+    textos.offsets = reinterpret_cast<const uint64_t*>(base + offsets.deslocamento);
+    textos.heap = base + heap.deslocamento;
+    textos.tamanhoHeap = heap.tamanho;
+    textos.tamanho = static_cast<uint32_t>(offsets.tamanho / 8 - 1);
+    return textos.offsets[textos.tamanho] <= heap.tamanho;
+}
+
+void SnapshotVault::fechar() {
+    if (mapa) {
+        munmap(mapa, tamanhoMapa);
+    }
+    mapa = nullptr;
+    tamanhoMapa = 0;
+    secoes = nullptr;
+    numReceitas = 0;
+    for (Textos* textos : {&nomes, &textosIngredientes, &preparos, &imagens, &categorias, &tags,
+                           &nomesIngredientes, &unidades}) {
+        *textos = Textos();
+    }
+}
+
+uint32_t SnapshotVault::indiceDe(int id) const {
+    const int32_t* fim = ids + numReceitas;
+    const int32_t* posicao = std::lower_bound(ids, fim, id);
+    return (posicao != fim && *posicao == id) ? static_cast<uint32_t>(posicao - ids) : NENHUM;
+}
+
+uint32_t SnapshotVault::indiceTag(std::string_view nome) const {
+    uint32_t inicio = 0;
+    uint32_t fim = tags.tamanho;
+    while (inicio < fim) {
+        uint32_t meio = inicio + (fim - inicio) / 2;
+        if (tags.texto(meio) < nome) {
+            inicio = meio + 1;
+        } else {
+            fim = meio;
+        }
+    }
+    return (inicio < tags.tamanho && tags.texto(inicio) == nome) ? inicio : NENHUM;
+}
+
+Receita SnapshotVault::ReceitaView::paraReceita() const {
+    Receita r;
+    r.id = id();
+    r.nome = std::string(nome());
+    r.ingredientes = std::string(ingredientes());
+    r.preparo = std::string(preparo());
+    r.tempo = tempo();
+    r.categoria = std::string(categoria());
+    r.porcoes = porcoes();
+    r.feita = feita();
+    r.nota = nota();
+    r.imagem = std::string(imagem());
+    r.tags.reserve(numTags());
+    for (size_t i = 0; i < numTags(); ++i) {
+        r.tags.emplace_back(tag(i));
+    }
+    r.ingredientesEstruturados.reserve(numIngredientes());
+    for (size_t i = 0; i < numIngredientes(); ++i) {
+        IngredienteView ing = ingrediente(i);
+        Ingrediente novo(std::string(ing.nome), ing.quantidade, std::string(ing.unidade));
+        novo.id = ing.id;
+        r.ingredientesEstruturados.push_back(std::move(novo));
+    }
+    // Como em Database::consultarPorId, o texto e refeito a partir da lista estruturada
+    r.atualizarIngredientesString();
+    return r;
+}
+
+// ============================================================================
+// ESCRITA
+// ============================================================================
+uint32_t EscritorSnapshot::DicionarioEscrita::indice(std::string_view valor) {
+    auto encontrado = indices.find(std::string(valor));
+    if (encontrado != indices.end()) {
+        return encontrado->second;
+    }
+    uint32_t novo = static_cast<uint32_t>(valores.size());
+    valores.emplace_back(valor);
+    indices.emplace(valores.back(), novo);
+    return novo;
+}
+
+std::vector<uint32_t> EscritorSnapshot::DicionarioEscrita::ordenar(TextosEscrita& saida) const {
+    std::vector<uint32_t> ordem(valores.size());
+    std::iota(ordem.begin(), ordem.end(), 0u);
+    std::sort(ordem.begin(), ordem.end(), [this](uint32_t a, uint32_t b) { return valores[a] < valores[b]; });
+    std::vector<uint32_t> novoIndice(valores.size());
+    for (uint32_t i = 0; i < ordem.size(); ++i) {
+        novoIndice[ordem[i]] = i;
+        saida.adicionar(valores[ordem[i]]);
+    }
+    return novoIndice;
+}
+
+void EscritorSnapshot::adicionarReceita(const ReceitaLinha& receita) {
+    ids.push_back(receita.id);
+    tempos.push_back(receita.tempo);
+    porcoes.push_back(receita.porcoes);
+    notas.push_back(static_cast<uint8_t>(receita.nota));
+    feitas.push_back(receita.feita ? 1 : 0);
+    categoriaPorReceita.push_back(categorias.indice(receita.categoria));
+    nomes.adicionar(receita.nome);
+    textosIngredientes.adicionar(receita.ingredientes);
+    preparos.adicionar(receita.preparo);
+    imagens.adicionar(receita.imagem);
+}
+
+void EscritorSnapshot::adicionarTag(size_t receita, std::string_view nome) {
+    receitaDaTag.push_back(static_cast<uint32_t>(receita));
+    tagDoVinculo.push_back(tags.indice(nome));
+}
+
+void EscritorSnapshot::adicionarIngrediente(size_t receita, int id, std::string_view nome, double quantidade,
+                                            std::string_view unidade) {
+    receitaDoIngrediente.push_back(static_cast<uint32_t>(receita));
+    ingredienteIds.push_back(id);
+    ingredienteQuantidades.push_back(quantidade);
+    ingredienteNomes.push_back(nomesIngredientes.indice(nome));
+    ingredienteUnidades.push_back(unidades.indice(unidade));
+}
+
+// Posicao final de cada item agrupado por receita (ordenacao por contagem,
+// estavel) e o array de inicio por receita
+static std::vector<uint32_t> agruparPorReceita(const std::vector<uint32_t>& receitaDoItem, size_t numReceitas,
+                                               std::vector<uint32_t>& inicio) {
+    inicio.assign(numReceitas + 1, 0);
+    for (uint32_t receita : receitaDoItem) {
+        inicio[receita + 1]++;
+    }
+    for (size_t i = 0; i < numReceitas; ++i) {
+        inicio[i + 1] += inicio[i];
+    }
+    std::vector<uint32_t> proximo(inicio.begin(), inicio.end() - 1);
+    std::vector<uint32_t> posicao(receitaDoItem.size());
+    for (size_t i = 0; i < receitaDoItem.size(); ++i) {
+        posicao[i] = proximo[receitaDoItem[i]]++;
+    }
+    return posicao;
+}
+
+template <typename T, typename Valor>
+static std::vector<T> espalhar(const std::vector<Valor>& valores, const std::vector<uint32_t>& posicao) {
+    std::vector<T> saida(valores.size());
+    for (size_t i = 0; i < valores.size(); ++i) {
+        saida[posicao[i]] = static_cast<T>(valores[i]);
+    }
+    return saida;
+}
+
+bool EscritorSnapshot::gravar(const std::string& caminho) const {
+    size_t n = ids.size();
+    for (size_t i = 0; i < receitaDaTag.size() || i < receitaDoIngrediente.size(); ++i) {
+        if ((i < receitaDaTag.size() && receitaDaTag[i] >= n) ||
+            (i < receitaDoIngrediente.size() && receitaDoIngrediente[i] >= n)) {
+            std::cerr << "Snapshot: vinculo para receita inexistente." << std::endl;
+            return false;
+        }
+    }
+
+    TextosEscrita textosCategorias, textosTags, textosNomesIngredientes, textosUnidades;
+    std::vector<uint32_t> novaCategoria = categorias.ordenar(textosCategorias);
+    std::vector<uint32_t> novaTag = tags.ordenar(textosTags);
+    std::vector<uint32_t> novoNome = nomesIngredientes.ordenar(textosNomesIngredientes);
+    std::vector<uint32_t> novaUnidade = unidades.ordenar(textosUnidades);
+
+    std::vector<uint32_t> categoriaFinal(n);
+    for (size_t i = 0; i < n; ++i) {
+        categoriaFinal[i] = novaCategoria[categoriaPorReceita[i]];
+    }
+
+    // Tags de cada receita em ordem alfabetica, como em getTagsFromReceita
+    std::vector<uint32_t> tagsInicio;
+    std::vector<uint32_t> tagsFinal = espalhar<uint32_t>(tagDoVinculo, agruparPorReceita(receitaDaTag, n, tagsInicio));
+    for (size_t i = 0; i < n; ++i) {
+        std::transform(tagsFinal.begin() + tagsInicio[i], tagsFinal.begin() + tagsInicio[i + 1],
+                       tagsFinal.begin() + tagsInicio[i], [&novaTag](uint32_t tag) { return novaTag[tag]; });
+        std::sort(tagsFinal.begin() + tagsInicio[i], tagsFinal.begin() + tagsInicio[i + 1]);
+    }
+
+    std::vector<uint32_t> ingredientesInicio;
+    std::vector<uint32_t> posicao = agruparPorReceita(receitaDoIngrediente, n, ingredientesInicio);
+    std::vector<int32_t> idsFinal = espalhar<int32_t>(ingredienteIds, posicao);
+    std::vector<double> quantidadesFinal = espalhar<double>(ingredienteQuantidades, posicao);
+    std::vector<uint32_t> nomesFinal = espalhar<uint32_t>(ingredienteNomes, posicao);
+    std::vector<uint32_t> unidadesFinal = espalhar<uint32_t>(ingredienteUnidades, posicao);
+    for (uint32_t& nome : nomesFinal) {
+        nome = novoNome[nome];
+    }
+    for (uint32_t& unidade : unidadesFinal) {
+        unidade = novaUnidade[unidade];
+    }
+
+    struct Bloco {
+        const void* dados;
+        uint64_t tamanho;
+    };
+    auto bloco = [](const auto& vetor) {
+        return Bloco{vetor.data(), vetor.size() * sizeof(vetor[0])};
+    };
+    auto heap = [](const std::string& texto) { return Bloco{texto.data(), texto.size()}; };
+    Bloco blocos[SnapshotVault::NUM_SECOES] = {
+        bloco(ids), bloco(tempos), bloco(porcoes), bloco(notas), bloco(feitas), bloco(categoriaFinal),
+        bloco(nomes.offsets), heap(nomes.heap),
+        bloco(textosIngredientes.offsets), heap(textosIngredientes.heap),
+        bloco(preparos.offsets), heap(preparos.heap),
+        bloco(imagens.offsets), heap(imagens.heap),
+        bloco(textosCategorias.offsets), heap(textosCategorias.heap),
+        bloco(textosTags.offsets), heap(textosTags.heap),
+        bloco(textosNomesIngredientes.offsets), heap(textosNomesIngredientes.heap),
+        bloco(textosUnidades.offsets), heap(textosUnidades.heap),
+        bloco(tagsInicio), bloco(tagsFinal),
+        bloco(ingredientesInicio), bloco(idsFinal), bloco(quantidadesFinal), bloco(nomesFinal), bloco(unidadesFinal),
+    };
+
+    SnapshotVault::Cabecalho cabecalho{};
+    std::memcpy(cabecalho.magica, MAGICA, sizeof(MAGICA));
+    cabecalho.versao = SnapshotVault::VERSAO;
+    cabecalho.ordemBytes = ORDEM_BYTES;
+    cabecalho.numSecoes = SnapshotVault::NUM_SECOES;
+    cabecalho.numReceitas = n;
+
+    SnapshotVault::EntradaSecao secoes[SnapshotVault::NUM_SECOES];
+    uint64_t deslocamento = sizeof(cabecalho) + sizeof(secoes);
+    for (uint32_t s = 0; s < SnapshotVault::NUM_SECOES; ++s) {
+        deslocamento = (deslocamento + ALINHAMENTO - 1) / ALINHAMENTO * ALINHAMENTO;
+        secoes[s].deslocamento = deslocamento;
+        secoes[s].tamanho = blocos[s].tamanho;
+        deslocamento += blocos[s].tamanho;
+    }
+    cabecalho.tamanhoArquivo = deslocamento;
+
+    std::string temporario = caminho + ".tmp";
+    std::ofstream arquivo(temporario, std::ios::binary | std::ios::trunc);
+    if (!arquivo) {
+        std::cerr << "Erro ao criar snapshot: " << temporario << std::endl;
+        return false;
+    }
+    arquivo.write(reinterpret_cast<const char*>(&cabecalho), sizeof(cabecalho));
+    arquivo.write(reinterpret_cast<const char*>(secoes), sizeof(secoes));
+    uint64_t escrito = sizeof(cabecalho) + sizeof(secoes);
+    static const char zeros[ALINHAMENTO] = {};
+    for (uint32_t s = 0; s < SnapshotVault::NUM_SECOES; ++s) {
+        arquivo.write(zeros, static_cast<std::streamsize>(secoes[s].deslocamento - escrito));
+        arquivo.write(static_cast<const char*>(blocos[s].dados), static_cast<std::streamsize>(blocos[s].tamanho));
+        escrito = secoes[s].deslocamento + blocos[s].tamanho;
+    }
+    arquivo.close();
+    if (!arquivo) {
+        std::cerr << "Erro ao gravar snapshot: " << temporario << std::endl;
+        std::filesystem::remove(temporario);
+        return false;
+    }
+
+    std::error_code erro;
+    std::filesystem::rename(temporario, caminho, erro);
+    if (erro) {
+        std::cerr << "Erro ao substituir snapshot: " << erro.message() << std::endl;
+        std::filesystem::remove(temporario);
+        return false;
+    }
+    return true;
+}
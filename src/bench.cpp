@@ -0,0 +1,374 @@
+#include "../include/Database.h"
+#include "../include/GeradorVault.h"
+#include "../include/SnapshotVault.h"
+#include "../include/Receita.h"
+#include "../include/Renderizador.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// CONTAGEM DE ALOCACOES
+// ============================================================================
+// Substitui o operator new global para contar alocacoes do lado C++.
+// Alocacoes internas do SQLite (malloc direto) nao entram na conta.
+static std::atomic<unsigned long long> alocacoes{0};
+static std::atomic<unsigned long long> bytesAlocados{0};
+
+void* operator new(std::size_t tamanho) {
+    alocacoes.fetch_add(1, std::memory_order_relaxed);
+    bytesAlocados.fetch_add(tamanho, std::memory_order_relaxed);
+    if (void* p = std::malloc(tamanho ? tamanho : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t tamanho) {
+    return operator new(tamanho);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+// ============================================================================
+// MEDICAO
+// ============================================================================
+struct Opcoes {
+    std::vector<int> tamanhos = {1000, 100000, 1000000};
+    double segundosPorMetodo = 1.0;
+    int maxIteracoes = 10000;
+    std::string diretorio = "./bench_data";
+    std::string saida;
+};
+
+struct Resultado {
+    std::string metodo;
+    int receitas = 0;
+    size_t iteracoes = 0;
+    double segundos = 0;
+    double p50 = 0;
+    double p99 = 0;
+    double alocacoesPorOp = 0;
+    double bytesPorOp = 0;
+};
+
+// Gerador deterministico (xorshift) para que execucoes sejam comparaveis
+struct Aleatorio {
+    unsigned long long estado;
+    explicit Aleatorio(unsigned long long semente) : estado(semente ? semente : 1) {}
+    unsigned long long proximo() {
+        estado ^= estado << 13;
+        estado ^= estado >> 7;
+        estado ^= estado << 17;
+        return estado;
+    }
+    int ate(int limite) { return static_cast<int>(proximo() % static_cast<unsigned long long>(limite)); }
+};
+
+static double percentil(std::vector<double>& latencias, double p) {
+    if (latencias.empty()) {
+        return 0;
+    }
+    size_t indice = static_cast<size_t>(p * static_cast<double>(latencias.size() - 1) + 0.5);
+    std::nth_element(latencias.begin(), latencias.begin() + indice, latencias.end());
+    return latencias[indice];
+}
+
+// Executa "operacao(i)" ate esgotar o tempo ou o numero maximo de iteracoes
+// (ao menos uma vez) e resume latencias em microssegundos.
+static Resultado medir(const Opcoes& opcoes, const std::string& metodo, int receitas,
+                       const std::function<void(size_t)>& operacao, int maxIteracoes = 0) {
+    using relogio = std::chrono::steady_clock;
+    size_t limite = static_cast<size_t>(maxIteracoes > 0 ? maxIteracoes : opcoes.maxIteracoes);
+    std::vector<double> latencias;
+    latencias.reserve(std::min<size_t>(limite, 100000));
+
+    unsigned long long alocacoesAntes = alocacoes.load();
+    unsigned long long bytesAntes = bytesAlocados.load();
+    unsigned long long alocacoesMedicao = 0;
+    unsigned long long bytesMedicao = 0;
+
+    auto inicio = relogio::now();
+    auto prazo = inicio + std::chrono::duration<double>(opcoes.segundosPorMetodo);
+    size_t i = 0;
+    while (i < limite && (i == 0 || relogio::now() < prazo)) {
+        // Descontar as alocacoes do proprio vetor de latencias
+        unsigned long long a = alocacoes.load();
+        unsigned long long b = bytesAlocados.load();
+        latencias.emplace_back();
+        alocacoesMedicao += alocacoes.load() - a;
+        bytesMedicao += bytesAlocados.load() - b;
+
+        auto t0 = relogio::now();
+        operacao(i);
+        latencias.back() = std::chrono::duration<double, std::micro>(relogio::now() - t0).count();
+        ++i;
+    }
+    double total = std::chrono::duration<double>(relogio::now() - inicio).count();
+
+    Resultado resultado;
+    resultado.metodo = metodo;
+    resultado.receitas = receitas;
+    resultado.iteracoes = i;
+    resultado.segundos = total;
+    resultado.alocacoesPorOp = static_cast<double>(alocacoes.load() - alocacoesAntes - alocacoesMedicao) / i;
+    resultado.bytesPorOp = static_cast<double>(bytesAlocados.load() - bytesAntes - bytesMedicao) / i;
+    resultado.p50 = percentil(latencias, 0.50);
+    resultado.p99 = percentil(latencias, 0.99);
+
+    std::cerr << "  " << metodo << ": " << i << " op(s), p50 " << resultado.p50 << " us" << std::endl;
+    return resultado;
+}
+
+// ============================================================================
+// CENARIOS
+// ============================================================================
+static void executarTamanho(const Opcoes& opcoes, int total, std::vector<Resultado>& resultados) {
+    std::string caminho = opcoes.diretorio + "/bench_" + std::to_string(total) + ".db";
+    std::string caminhoBackup = opcoes.diretorio + "/bench_" + std::to_string(total) + "_backup.db";
+    std::filesystem::remove(caminho);
+
+    std::cerr << "Preparando " << total << " receitas..." << std::endl;
+    Aleatorio aleatorio(42 + static_cast<unsigned long long>(total));
+    ConfiguracaoGerador configuracao;
+    configuracao.semente = 42;
+    GeradorVault gerador(configuracao);
+    Database db(caminho);
+    if (!db.initialize() || gerador.gerar(db, total) != total) {
+        std::cerr << "Erro ao preparar banco de benchmark." << std::endl;
+        return;
+    }
+
+    std::vector<int> feitas;
+    FiltroReceitas filtroFeitas;
+    filtroFeitas.somenteFeitas = true;
+    db.forEachReceita(filtroFeitas, [&feitas](const ReceitaLinha& r) {
+        feitas.push_back(r.id);
+        return true;
+    }, 0);
+    if (feitas.empty()) {
+        std::cerr << "Nenhuma receita feita no vault gerado." << std::endl;
+        return;
+    }
+    int numTags = static_cast<int>(gerador.numTags());
+
+    auto id = [&aleatorio, total]() { return 1 + aleatorio.ate(total); };
+    auto registrar = [&](const std::string& metodo, const std::function<void(size_t)>& operacao, int max = 0) {
+        resultados.push_back(medir(opcoes, metodo, total, operacao, max));
+    };
+
+    // Leituras pontuais
+    registrar("consultarPorId", [&](size_t) { db.consultarPorId(id()); });
+    registrar("getTagsFromReceita", [&](size_t) { db.getTagsFromReceita(id()); });
+    registrar("getIngredientesFromReceita", [&](size_t) { db.getIngredientesFromReceita(id()); });
+    registrar("getTagsByPrefix", [&](size_t) { db.getTagsByPrefix(gerador.nomeTag(aleatorio.ate(numTags)).substr(0, 2)); });
+    registrar("listAllTags", [&](size_t) { db.listAllTags(); });
+    db.similares(1, 10);   // constroi o indice fora da medicao
+    registrar("similares", [&](size_t) { db.similares(id(), 10); });
+    const AnaliseColunar* analise = db.analiseColunar();   // carrega as colunas fora da medicao
+    FiltroAnalise avaliadas;
+    avaliadas.notaMinima = 1;
+    registrar("AnaliseColunar::agregar(nota)", [&](size_t) { analise->agregar(ColunaAnalise::Nota, avaliadas); });
+    registrar("AnaliseColunar::agruparPorCategoria", [&](size_t) {
+        analise->agruparPorCategoria(ColunaAnalise::Nota, avaliadas);
+    });
+    registrar("AnaliseColunar::histograma(tempo, nota 5)", [&](size_t) {
+        FiltroAnalise filtro;
+        filtro.notaMinima = 5;
+        analise->histograma(ColunaAnalise::Tempo, filtro, 15, 40);
+    });
+
+    // Consultas que varrem a tabela
+    registrar("buscarPorNome", [&](size_t) { db.buscarPorNome("de " + gerador.nomeIngrediente(aleatorio.ate(20))); });
+    db.configurarHidratacaoParalela(4);
+    registrar("buscarPorNome(4 leitores)", [&](size_t) { db.buscarPorNome("de " + gerador.nomeIngrediente(aleatorio.ate(20))); });
+    db.configurarHidratacaoParalela(0);
+    registrar("getReceitasByTag", [&](size_t) { db.getReceitasByTag(gerador.nomeTag(aleatorio.ate(numTags))); });
+    registrar("getReceitasPorNota", [&](size_t) { db.getReceitasPorNota(1 + aleatorio.ate(5)); });
+    registrar("getReceitasFeitas", [&](size_t) { db.getReceitasFeitas(); });
+    registrar("listarReceitas", [&](size_t) { db.listarReceitas(); });
+    registrar("listarReceitasCompacto", [&](size_t) { db.listarReceitasCompacto(CAMPOS_LISTAGEM); });
+    registrar("forEachReceita", [&](size_t) {
+        db.forEachReceita(FiltroReceitas(), [](const ReceitaLinha&) { return true; }, CAMPOS_LISTAGEM);
+    });
+
+    // Snapshot somente leitura: abrir e percorrer sem passar pelo SQLite
+    std::string caminhoSnapshot = opcoes.diretorio + "/bench_" + std::to_string(total) + ".snap";
+    db.exportarSnapshot(caminhoSnapshot);
+    registrar("SnapshotVault::abrir", [&](size_t) {
+        SnapshotVault snapshot;
+        snapshot.abrir(caminhoSnapshot);
+    });
+    SnapshotVault snapshot;
+    snapshot.abrir(caminhoSnapshot);
+    volatile size_t descarteSnapshot = 0;
+    registrar("SnapshotVault(percorrer)", [&](size_t) {
+        size_t soma = 0;
+        for (const auto& receita : snapshot) {
+            soma += receita.nome().size() + receita.numTags() + receita.numIngredientes();
+        }
+        descarteSnapshot = soma;
+    });
+    snapshot.fechar();
+    std::filesystem::remove(caminhoSnapshot);
+
+    // Escritas (autocommit: um fsync por operacao). As receitas novas sao
+    // geradas antes, para nao entrarem na latencia nem nas alocacoes.
+    std::vector<Receita> novas;
+    std::vector<std::vector<Receita>> lotes(10);
+    for (int i = 0; i < 1000; ++i) {
+        novas.push_back(gerador.proxima());
+        lotes[static_cast<size_t>(i % 10)].push_back(gerador.proxima());
+    }
+    std::vector<int> inseridas;
+    registrar("cadastrarReceita", [&](size_t i) {
+        inseridas.push_back(db.cadastrarReceita(novas[i % novas.size()]));
+    });
+    registrar("cadastrarReceitasEmLote(100)", [&](size_t i) {
+        db.cadastrarReceitasEmLote(lotes[i % lotes.size()], &inseridas);
+    });
+    registrar("createTag", [&](size_t i) { db.createTag("bench" + std::to_string(i)); });
+    registrar("addTagToReceita", [&](size_t i) {
+        db.addTagToReceita(inseridas[i % inseridas.size()], 1 + static_cast<int>(i % static_cast<size_t>(numTags)));
+    });
+    registrar("removeTagFromReceita", [&](size_t i) {
+        db.removeTagFromReceita(inseridas[i % inseridas.size()], 1 + static_cast<int>(i % static_cast<size_t>(numTags)));
+    });
+    registrar("marcarReceitaComoFeita", [&](size_t) { db.marcarReceitaComoFeita(id(), true); });
+    registrar("avaliarReceita", [&](size_t i) { db.avaliarReceita(feitas[i % feitas.size()], 1 + aleatorio.ate(5)); });
+    registrar("excluirReceita", [&](size_t i) { db.excluirReceita(inseridas[i]); },
+              static_cast<int>(inseridas.size()));
+
+    // Sincronizacao incremental: as ultimas 1000 linhas do log de alteracoes
+    int64_t ultimaAlteracao = db.ultimaAlteracao();
+    LimitesConsulta mil{0, 1000};
+    registrar("alteracoesDesde(1000)", [&](size_t) {
+        db.alteracoesDesde(std::max<int64_t>(0, ultimaAlteracao - 1000), [](const Alteracao&) { return true; },
+                           nullptr, &mil);
+    });
+
+    // Backup e restauracao do arquivo inteiro
+    registrar("fazerBackup", [&](size_t) { db.fazerBackup(caminhoBackup); }, 5);
+    registrar("restaurarBackup", [&](size_t) { db.restaurarBackup(caminhoBackup); }, 5);
+
+    db.close();
+    std::filesystem::remove(caminho);
+    std::filesystem::remove(caminho + ".pre_restore");
+    std::filesystem::remove(caminhoBackup);
+}
+
+// ============================================================================
+// SAIDA
+// ============================================================================
+static void escreverJson(std::ostream& saida, const std::vector<Resultado>& resultados) {
+    std::string texto = "{\"resultados\":[";
+    for (size_t i = 0; i < resultados.size(); ++i) {
+        const Resultado& r = resultados[i];
+        texto += i > 0 ? ",\n" : "\n";
+        texto += "{\"metodo\":";
+        Renderizador::anexarJsonString(texto, r.metodo);
+        texto += ",\"receitas\":" + std::to_string(r.receitas);
+        texto += ",\"iteracoes\":" + std::to_string(r.iteracoes);
+        texto += ",\"ops_por_segundo\":" + std::to_string(r.iteracoes / r.segundos);
+        texto += ",\"p50_us\":" + std::to_string(r.p50);
+        texto += ",\"p99_us\":" + std::to_string(r.p99);
+        texto += ",\"alocacoes_por_op\":" + std::to_string(r.alocacoesPorOp);
+        texto += ",\"bytes_por_op\":" + std::to_string(r.bytesPorOp);
+        texto += "}";
+    }
+    texto += "\n]}\n";
+    saida << texto;
+}
+
+static void exibirAjuda() {
+    std::cout <<
+        "Uso: bench_chefvault [--tamanhos 1000,100000,1000000] [--segundos S]\n"
+        "                     [--iteracoes N] [--dir caminho] [--saida arquivo.json]\n"
+        "\n"
+        "Mede cada metodo de Database e imprime JSON com ops/s, latencia p50/p99 (us)\n"
+        "e alocacoes C++ por operacao. Progresso vai para a saida de erro.\n";
+}
+
+int main(int argc, char* argv[]) {
+    Opcoes opcoes;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            exibirAjuda();
+            return 0;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Opcao sem valor: " << arg << std::endl;
+            return 1;
+        }
+        std::string valor = argv[++i];
+        if (arg == "--tamanhos") {
+            opcoes.tamanhos.clear();
+            size_t inicio = 0;
+            while (inicio < valor.size()) {
+                size_t fim = valor.find(',', inicio);
+                if (fim == std::string::npos) {
+                    fim = valor.size();
+                }
+                int tamanho = std::atoi(valor.substr(inicio, fim - inicio).c_str());
+                if (tamanho > 0) {
+                    opcoes.tamanhos.push_back(tamanho);
+                }
+                inicio = fim + 1;
+            }
+        } else if (arg == "--segundos") {
+            opcoes.segundosPorMetodo = std::atof(valor.c_str());
+        } else if (arg == "--iteracoes") {
+            opcoes.maxIteracoes = std::max(1, std::atoi(valor.c_str()));
+        } else if (arg == "--dir") {
+            opcoes.diretorio = valor;
+        } else if (arg == "--saida") {
+            opcoes.saida = valor;
+        } else {
+            std::cerr << "Opcao desconhecida: " << arg << std::endl;
+            exibirAjuda();
+            return 1;
+        }
+    }
+
+    std::filesystem::create_directories(opcoes.diretorio);
+    std::vector<Resultado> resultados;
+
+    // Mensagens dos metodos medidos nao podem se misturar ao JSON
+    std::ofstream descarte;
+    std::streambuf* coutOriginal = std::cout.rdbuf(descarte.rdbuf());
+    for (int tamanho : opcoes.tamanhos) {
+        executarTamanho(opcoes, tamanho, resultados);
+    }
+    std::cout.rdbuf(coutOriginal);
+
+    if (opcoes.saida.empty()) {
+        escreverJson(std::cout, resultados);
+    } else {
+        std::ofstream arquivo(opcoes.saida);
+        escreverJson(arquivo, resultados);
+    }
+    return resultados.empty() ? 1 : 0;
+}
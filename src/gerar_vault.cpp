@@ -0,0 +1,92 @@
+#include "../include/Database.h"
+#include "../include/GeradorVault.h"
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+static void exibirAjuda() {
+    std::cout <<
+        "Uso: gerar_vault --db caminho [--receitas N] [--semente S] [--tags N]\n"
+        "                 [--ingredientes N] [--zipf S] [--feitas F] [--lote N] [--substituir]\n"
+        "\n"
+        "Gera um vault sintetico reproduzivel: a mesma semente produz o mesmo conteudo.\n";
+}
+
+int main(int argc, char* argv[]) {
+    ConfiguracaoGerador configuracao;
+    std::string caminhoDb;
+    int receitas = 1000;
+    size_t tamanhoLote = 10000;
+    bool substituir = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            exibirAjuda();
+            return 0;
+        }
+        if (arg == "--substituir") {
+            substituir = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Opcao sem valor: " << arg << std::endl;
+            return 1;
+        }
+        std::string valor = argv[++i];
+        if (arg == "--db") {
+            caminhoDb = valor;
+        } else if (arg == "--receitas") {
+            receitas = std::atoi(valor.c_str());
+        } else if (arg == "--semente") {
+            configuracao.semente = std::strtoull(valor.c_str(), nullptr, 10);
+        } else if (arg == "--tags") {
+            configuracao.numTags = std::atoi(valor.c_str());
+        } else if (arg == "--ingredientes") {
+            configuracao.numIngredientes = std::atoi(valor.c_str());
+        } else if (arg == "--zipf") {
+            configuracao.expoenteZipf = std::atof(valor.c_str());
+        } else if (arg == "--feitas") {
+            configuracao.fracaoFeitas = std::atof(valor.c_str());
+        } else if (arg == "--lote") {
+            tamanhoLote = static_cast<size_t>(std::max(1, std::atoi(valor.c_str())));
+        } else {
+            std::cerr << "Opcao desconhecida: " << arg << std::endl;
+            exibirAjuda();
+            return 1;
+        }
+    }
+
+    if (caminhoDb.empty() || receitas < 0) {
+        exibirAjuda();
+        return 1;
+    }
+    if (std::filesystem::exists(caminhoDb)) {
+        if (!substituir) {
+            std::cerr << "O arquivo " << caminhoDb << " ja existe (use --substituir)." << std::endl;
+            return 1;
+        }
+        std::filesystem::remove(caminhoDb);
+    }
+
+    Database db(caminhoDb);
+    if (!db.initialize()) {
+        std::cerr << "Erro ao inicializar banco de dados." << std::endl;
+        return 1;
+    }
+
+    auto inicio = std::chrono::steady_clock::now();
+    GeradorVault gerador(configuracao);
+    int gravadas = gerador.gerar(db, receitas, tamanhoLote);
+    double segundos = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+    db.close();
+
+    if (gravadas < 0) {
+        std::cerr << "Erro ao gerar receitas." << std::endl;
+        return 1;
+    }
+    std::cerr << gravadas << " receitas geradas em " << segundos << " s." << std::endl;
+    return 0;
+}
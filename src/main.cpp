@@ -2,7 +2,10 @@
 // INCLUDES
 // ============================================================================
 #include "../include/Database.h"
+#include "../include/DatabaseAssincrona.h"
 #include "../include/Receita.h"
+#include "../include/Renderizador.h"
+#include "../include/Comandos.h"
 #include <sqlite3.h>
 #include <iostream>
 #include <string>
@@ -13,6 +16,8 @@
 #include <ctime>
 #include <filesystem>
 #include <cctype>
+#include <chrono>
+#include <csignal>
 
 // ============================================================================
 // FUNÇÕES AUXILIARES
@@ -108,6 +113,42 @@ std::string solicitarTagsComAutocompletarSimples(Database& db) {
     return input;
 }
 
+// std::vector<Receita> ou ListaReceitas
+template <typename Lista>
+void exibirTabelaReceitas(const Lista& receitas) {
+    Renderizador saida(std::cout);
+    for (const auto& r : receitas) {
+        saida.linha(r);
+    }
+    saida.finalizar();
+}
+
+volatile std::sig_atomic_t ctrlCPressionado = 0;
+
+// Espera o future da fachada assincrona; Ctrl+C durante a espera cancela a
+// tarefa em vez de encerrar o programa. Retorna false se foi cancelada.
+template <typename Resultado>
+bool aguardarCancelavel(DatabaseAssincrona& assincrona, std::future<Resultado>& futuro,
+                        DatabaseAssincrona::Tarefa tarefa, Resultado& resultado) {
+    ctrlCPressionado = 0;
+    auto tratadorAnterior = std::signal(SIGINT, [](int) { ctrlCPressionado = 1; });
+    bool avisou = false;
+    while (futuro.wait_for(std::chrono::milliseconds(100)) != std::future_status::ready) {
+        if (ctrlCPressionado && !avisou) {
+            assincrona.cancelar(tarefa);
+            avisou = true;
+        }
+    }
+    std::signal(SIGINT, tratadorAnterior);
+    try {
+        resultado = futuro.get();
+        return true;
+    } catch (const OperacaoCancelada&) {
+        std::cout << "\nOperacao cancelada.\n";
+        return false;
+    }
+}
+
 // ============================================================================
 // MENU PRINCIPAL
 // ============================================================================
@@ -262,6 +303,14 @@ void cadastrarReceita(Database& db) {
     std::cout << "Caminho da imagem (ou Enter para pular): ";
     limparBuffer();
     std::getline(std::cin, receita.imagem);
+    if (!receita.imagem.empty()) {
+        // Copiada para o armazem de imagens; a receita guarda so a referencia
+        std::string referencia = db.imagens().guardarArquivo(receita.imagem);
+        if (referencia.empty()) {
+            std::cout << "Imagem nao encontrada; a receita sera salva sem imagem.\n";
+        }
+        receita.imagem = referencia;
+    }
     
     int receitaId = db.cadastrarReceita(receita);
     
@@ -307,49 +356,19 @@ void cadastrarReceita(Database& db) {
 void listarReceitas(Database& db) {
     std::cout << "\n--- Lista de Receitas ---\n";
     
-    auto receitas = db.listarReceitas();
+    // A listagem nao exibe preparo nem ingredientes: evita ler esses textos
+    ResultadoReceitas receitas = db.listarReceitasCompacto(CAMPOS_LISTAGEM);
     
     if (receitas.empty()) {
         std::cout << "Nenhuma receita cadastrada.\n";
         return;
     }
     
-    std::cout << std::left << std::setw(5) << "ID" 
-              << std::setw(30) << "Nome" 
-              << std::setw(15) << "Categoria" 
-              << std::setw(10) << "Tempo" 
-              << std::setw(10) << "Porcoes" 
-              << std::setw(8) << "Feita"
-              << std::setw(8) << "Nota"
-              << std::setw(30) << "Tags"
-              << "\n";
-    std::cout << std::string(116, '-') << "\n";
-    
+    Renderizador saida(std::cout);
     for (const auto& r : receitas) {
-        std::string tagsStr = "";
-        if (!r.tags.empty()) {
-            for (size_t i = 0; i < r.tags.size(); ++i) {
-                tagsStr += r.tags[i];
-                if (i < r.tags.size() - 1) {
-                    tagsStr += ", ";
-                }
-            }
-        } else {
-            tagsStr = "-";
-        }
-        
-        std::string notaStr = (r.nota > 0) ? std::to_string(r.nota) : "-";
-        
-        std::cout << std::left << std::setw(5) << r.id 
-                  << std::setw(30) << (r.nome.length() > 28 ? r.nome.substr(0, 27) + ".." : r.nome)
-                  << std::setw(15) << (r.categoria.length() > 13 ? r.categoria.substr(0, 12) + ".." : r.categoria)
-                  << std::setw(10) << r.tempo 
-                  << std::setw(10) << r.porcoes 
-                  << std::setw(8) << (r.feita ? "Sim" : "Nao")
-                  << std::setw(8) << notaStr
-                  << std::setw(30) << (tagsStr.length() > 28 ? tagsStr.substr(0, 27) + ".." : tagsStr)
-                  << "\n";
+        saida.linha(r);
     }
+    saida.finalizar();
 }
 
 void consultarPorId(Database& db) {
@@ -412,7 +431,14 @@ void buscarPorNome(Database& db) {
     std::string nome;
     std::getline(std::cin, nome);
     
-    auto receitas = db.buscarPorNome(nome);
+    // Buscas amplas em vaults grandes podem demorar: Ctrl+C cancela
+    DatabaseAssincrona assincrona(db);
+    DatabaseAssincrona::Tarefa tarefa = 0;
+    auto futuro = assincrona.buscarPorNome(nome, &tarefa);
+    std::vector<Receita> receitas;
+    if (!aguardarCancelavel(assincrona, futuro, tarefa, receitas)) {
+        return;
+    }
     
     if (receitas.empty()) {
         std::cout << "Nenhuma receita encontrada.\n";
@@ -420,42 +446,7 @@ void buscarPorNome(Database& db) {
     }
     
     std::cout << "\nReceitas encontradas:\n";
-    std::cout << std::left << std::setw(5) << "ID" 
-              << std::setw(30) << "Nome" 
-              << std::setw(15) << "Categoria" 
-              << std::setw(10) << "Tempo" 
-              << std::setw(10) << "Porcoes" 
-              << std::setw(8) << "Feita"
-              << std::setw(8) << "Nota"
-              << std::setw(30) << "Tags"
-              << "\n";
-    std::cout << std::string(116, '-') << "\n";
-    
-    for (const auto& r : receitas) {
-        std::string tagsStr = "";
-        if (!r.tags.empty()) {
-            for (size_t i = 0; i < r.tags.size(); ++i) {
-                tagsStr += r.tags[i];
-                if (i < r.tags.size() - 1) {
-                    tagsStr += ", ";
-                }
-            }
-        } else {
-            tagsStr = "-";
-        }
-        
-        std::string notaStr = (r.nota > 0) ? std::to_string(r.nota) : "-";
-        
-        std::cout << std::left << std::setw(5) << r.id 
-                  << std::setw(30) << (r.nome.length() > 28 ? r.nome.substr(0, 27) + ".." : r.nome)
-                  << std::setw(15) << (r.categoria.length() > 13 ? r.categoria.substr(0, 12) + ".." : r.categoria)
-                  << std::setw(10) << r.tempo 
-                  << std::setw(10) << r.porcoes 
-                  << std::setw(8) << (r.feita ? "Sim" : "Nao")
-                  << std::setw(8) << notaStr
-                  << std::setw(30) << (tagsStr.length() > 28 ? tagsStr.substr(0, 27) + ".." : tagsStr)
-                  << "\n";
-    }
+    exibirTabelaReceitas(receitas);
 }
 
 void excluirReceita(Database& db) {
@@ -690,42 +681,7 @@ void filtrarReceitasPorTag(Database& db) {
     }
     
     std::cout << "\nReceitas com a tag \"" << tagNome << "\":\n";
-    std::cout << std::left << std::setw(5) << "ID" 
-              << std::setw(30) << "Nome" 
-              << std::setw(15) << "Categoria" 
-              << std::setw(10) << "Tempo" 
-              << std::setw(10) << "Porcoes" 
-              << std::setw(8) << "Feita"
-              << std::setw(8) << "Nota"
-              << std::setw(30) << "Tags"
-              << "\n";
-    std::cout << std::string(116, '-') << "\n";
-    
-    for (const auto& r : receitas) {
-        std::string tagsStr = "";
-        if (!r.tags.empty()) {
-            for (size_t i = 0; i < r.tags.size(); ++i) {
-                tagsStr += r.tags[i];
-                if (i < r.tags.size() - 1) {
-                    tagsStr += ", ";
-                }
-            }
-        } else {
-            tagsStr = "-";
-        }
-        
-        std::string notaStr = (r.nota > 0) ? std::to_string(r.nota) : "-";
-        
-        std::cout << std::left << std::setw(5) << r.id 
-                  << std::setw(30) << (r.nome.length() > 28 ? r.nome.substr(0, 27) + ".." : r.nome)
-                  << std::setw(15) << (r.categoria.length() > 13 ? r.categoria.substr(0, 12) + ".." : r.categoria)
-                  << std::setw(10) << r.tempo 
-                  << std::setw(10) << r.porcoes 
-                  << std::setw(8) << (r.feita ? "Sim" : "Nao")
-                  << std::setw(8) << notaStr
-                  << std::setw(30) << (tagsStr.length() > 28 ? tagsStr.substr(0, 27) + ".." : tagsStr)
-                  << "\n";
-    }
+    exibirTabelaReceitas(receitas);
 }
 
 // ============================================================================
@@ -769,42 +725,7 @@ void listarReceitasFeitas(Database& db) {
         return;
     }
     
-    std::cout << std::left << std::setw(5) << "ID" 
-              << std::setw(30) << "Nome" 
-              << std::setw(15) << "Categoria" 
-              << std::setw(10) << "Tempo" 
-              << std::setw(10) << "Porcoes" 
-              << std::setw(8) << "Feita"
-              << std::setw(8) << "Nota"
-              << std::setw(30) << "Tags"
-              << "\n";
-    std::cout << std::string(116, '-') << "\n";
-    
-    for (const auto& r : receitas) {
-        std::string tagsStr = "";
-        if (!r.tags.empty()) {
-            for (size_t i = 0; i < r.tags.size(); ++i) {
-                tagsStr += r.tags[i];
-                if (i < r.tags.size() - 1) {
-                    tagsStr += ", ";
-                }
-            }
-        } else {
-            tagsStr = "-";
-        }
-        
-        std::string notaStr = (r.nota > 0) ? std::to_string(r.nota) : "-";
-        
-        std::cout << std::left << std::setw(5) << r.id 
-                  << std::setw(30) << (r.nome.length() > 28 ? r.nome.substr(0, 27) + ".." : r.nome)
-                  << std::setw(15) << (r.categoria.length() > 13 ? r.categoria.substr(0, 12) + ".." : r.categoria)
-                  << std::setw(10) << r.tempo 
-                  << std::setw(10) << r.porcoes 
-                  << std::setw(8) << (r.feita ? "Sim" : "Nao")
-                  << std::setw(8) << notaStr
-                  << std::setw(30) << (tagsStr.length() > 28 ? tagsStr.substr(0, 27) + ".." : tagsStr)
-                  << "\n";
-    }
+    exibirTabelaReceitas(receitas);
 }
 
 // ============================================================================
@@ -869,42 +790,7 @@ void filtrarReceitasPorNota(Database& db) {
     }
     
     std::cout << "\nReceitas com nota " << nota << ":\n";
-    std::cout << std::left << std::setw(5) << "ID" 
-              << std::setw(30) << "Nome" 
-              << std::setw(15) << "Categoria" 
-              << std::setw(10) << "Tempo" 
-              << std::setw(10) << "Porcoes" 
-              << std::setw(8) << "Feita"
-              << std::setw(8) << "Nota"
-              << std::setw(30) << "Tags"
-              << "\n";
-    std::cout << std::string(116, '-') << "\n";
-    
-    for (const auto& r : receitas) {
-        std::string tagsStr = "";
-        if (!r.tags.empty()) {
-            for (size_t i = 0; i < r.tags.size(); ++i) {
-                tagsStr += r.tags[i];
-                if (i < r.tags.size() - 1) {
-                    tagsStr += ", ";
-                }
-            }
-        } else {
-            tagsStr = "-";
-        }
-        
-        std::string notaStr = (r.nota > 0) ? std::to_string(r.nota) : "-";
-        
-        std::cout << std::left << std::setw(5) << r.id 
-                  << std::setw(30) << (r.nome.length() > 28 ? r.nome.substr(0, 27) + ".." : r.nome)
-                  << std::setw(15) << (r.categoria.length() > 13 ? r.categoria.substr(0, 12) + ".." : r.categoria)
-                  << std::setw(10) << r.tempo 
-                  << std::setw(10) << r.porcoes 
-                  << std::setw(8) << (r.feita ? "Sim" : "Nao")
-                  << std::setw(8) << notaStr
-                  << std::setw(30) << (tagsStr.length() > 28 ? tagsStr.substr(0, 27) + ".." : tagsStr)
-                  << "\n";
-    }
+    exibirTabelaReceitas(receitas);
 }
 
 // ============================================================================
@@ -929,9 +815,17 @@ void fazerBackup(Database& db) {
         caminhoBackup = nomePadrao;
     }
     
-    std::cout << "Fazendo backup para: " << caminhoBackup << "\n";
+    std::cout << "Fazendo backup para: " << caminhoBackup << " (Ctrl+C cancela)\n";
     
-    if (db.fazerBackup(caminhoBackup)) {
+    DatabaseAssincrona assincrona(db);
+    DatabaseAssincrona::Tarefa tarefa = 0;
+    auto futuro = assincrona.fazerBackup(caminhoBackup, &tarefa);
+    bool sucesso = false;
+    if (!aguardarCancelavel(assincrona, futuro, tarefa, sucesso)) {
+        return;
+    }
+    
+    if (sucesso) {
         if (std::filesystem::exists(caminhoBackup)) {
             auto tamanho = std::filesystem::file_size(caminhoBackup);
             std::cout << "Backup concluido com sucesso!\n";
@@ -1082,7 +976,11 @@ void restaurarBackup(Database& db) {
 // ============================================================================
 // FUNÇÃO PRINCIPAL
 // ============================================================================
-int main() {
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        return executarLinhaDeComando(argc, argv);
+    }
+    
     Database db("./data/recipes.db");
     
     if (!db.initialize()) {
@@ -1,8 +1,28 @@
+#include "../include/ArmazemImagens.h"
+#include "../include/Comandos.h"
 #include "../include/Database.h"
+#include "../include/DatabaseAssincrona.h"
+#include "../include/GeradorVault.h"
+#include "../include/LogConsultasLentas.h"
+#include "../include/Metricas.h"
 #include "../include/Receita.h"
+#include "../include/Renderizador.h"
+#include "../include/ServidorHttp.h"
+#include "../include/SnapshotVault.h"
+#include <arpa/inet.h>
+#include <sqlite3.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
 #include <iostream>
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cmath>
 #include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
 #include <vector>
 #include <string>
 
@@ -36,6 +56,45 @@ void test_listar_receitas(Database& db) {
     test_result("Listar receitas", !receitas.empty());
 }
 
+void test_listar_receitas_compacto(Database& db) {
+    auto completas = db.listarReceitas();
+    ResultadoReceitas compacto = db.listarReceitasCompacto();
+    
+    bool iguais = completas.size() == compacto.size();
+    for (size_t i = 0; iguais && i < compacto.size(); ++i) {
+        Receita r = compacto[i].paraReceita();
+        iguais = r.id == completas[i].id && r.nome == completas[i].nome
+              && r.tags == completas[i].tags
+              && r.ingredientesEstruturados.size() == completas[i].ingredientesEstruturados.size();
+    }
+    test_result("Listar receitas (resultado compacto)", !compacto.empty() && iguais);
+}
+
+void test_projecao_carga_tardia(Database& db) {
+    FiltroReceitas filtro;
+    filtro.nome = "Teste Receita";
+    ResultadoReceitas resultado = db.listarReceitasCompacto(filtro, CAMPOS_LISTAGEM);
+    
+    bool semPreparo = !(resultado.camposCarregados() & CAMPO_PREPARO);
+    bool preparoTardio = !resultado.empty() && resultado[0].preparo() == "Modo de preparo teste";
+    bool carregouDepois = (resultado.camposCarregados() & CAMPO_PREPARO) != 0;
+    test_result("Projecao com carga tardia do preparo", semPreparo && preparoTardio && carregouDepois);
+}
+
+void test_visitar_receitas(Database& db) {
+    FiltroReceitas filtro;
+    filtro.tag = "filtro-tag";
+    
+    bool encontrou = false;
+    int visitadas = db.forEachReceita(filtro, [&](const ReceitaLinha& linha) {
+        encontrou = linha.nome == "Receita filtro tag" && linha.tags == "filtro-tag";
+        return true;
+    });
+    
+    int interrompidas = db.forEachReceita(FiltroReceitas(), [](const ReceitaLinha&) { return false; });
+    test_result("Visitar receitas sem copia", visitadas == 1 && encontrou && interrompidas == 1);
+}
+
 void test_consultar_por_id(Database& db) {
     Receita receita = db.consultarPorId(1);
     test_result("Consultar receita por ID", receita.id > 0 && receita.nome == "Teste Receita");
@@ -211,6 +270,1148 @@ void test_validacao_nota_invalida(Database& db) {
     test_result("Validar nota inválida (0)", !sucesso);
 }
 
+// Testes de Transação
+void test_desfazer_transacao(Database& db) {
+    db.iniciarTransacao();
+    Receita receita("Receita desfeita", "Ingredientes", "Preparo", 10, "Teste", 1);
+    int id = db.cadastrarReceita(receita);
+    db.desfazerTransacao();
+    
+    test_result("Desfazer transacao de lote", id > 0 && db.consultarPorId(id).id == 0);
+}
+
+void test_savepoints(Database& db) {
+    db.iniciarTransacao();
+    db.criarSavepoint("tarefa");
+    int mantida = db.cadastrarReceita(Receita("Receita do savepoint", "", "Preparo", 10, "Teste", 1));
+    db.liberarSavepoint("tarefa");
+    db.criarSavepoint("tarefa");
+    int desfeita = db.cadastrarReceita(Receita("Receita desfeita no savepoint", "", "Preparo", 10, "Teste", 1));
+    db.desfazerSavepoint("tarefa");
+    bool aberta = db.emTransacao();
+    db.confirmarTransacao();
+
+    bool ok = aberta && !db.emTransacao() && db.consultarPorId(mantida).id == mantida &&
+              desfeita > 0 && db.consultarPorId(desfeita).id == 0;
+    db.excluirReceita(mantida);
+    test_result("Savepoint desfaz so a tarefa que falhou", ok);
+}
+
+// Testes de Edição
+void test_atualizar_receita(Database& db, const std::string& caminho) {
+    Receita receita("Receita editavel", "", "Preparo", 10, "Teste", 2);
+    receita.ingredientesEstruturados.push_back(Ingrediente("farinha", 2, "xicara"));
+    receita.ingredientesEstruturados.push_back(Ingrediente("ovos", 3, "un"));
+    receita.ingredientesEstruturados.push_back(Ingrediente("sal", 1, "pitada"));
+    receita.atualizarIngredientesString();
+    int id = db.cadastrarReceita(receita);
+    db.addTagToReceita(id, db.createTag("editavel-antiga"));
+    db.addTagToReceita(id, db.createTag("editavel-mantida"));
+
+    Receita editada = db.consultarPorId(id);
+    std::vector<Ingrediente> antes = editada.ingredientesEstruturados;
+    editada.tempo = 25;
+    editada.ingredientesEstruturados[1].quantidade = 4;
+    editada.tags = {"editavel-mantida", "editavel-nova"};
+
+    // 1 UPDATE em receitas, 1 UPDATE de ingrediente, 1 vinculo removido, tag e vinculo novos
+    uint64_t escritas = Metricas::global().sql().linhasEscritas.load();
+    bool ok = db.atualizarReceita(editada);
+    uint64_t alteradas = Metricas::global().sql().linhasEscritas.load() - escritas;
+    bool semMudanca = db.atualizarReceita(editada) &&
+                      Metricas::global().sql().linhasEscritas.load() - escritas == alteradas;
+
+    Receita gravada = db.consultarPorId(id);
+    bool mesmosIds = gravada.ingredientesEstruturados.size() == 3;
+    for (size_t i = 0; mesmosIds && i < 3; ++i) {
+        mesmosIds = gravada.ingredientesEstruturados[i].id == antes[i].id;
+    }
+    bool conteudo = gravada.tempo == 25 && gravada.ingredientesEstruturados[1].quantidade == 4 &&
+                    gravada.tags.size() == 2 &&
+                    std::find(gravada.tags.begin(), gravada.tags.end(), "editavel-nova") != gravada.tags.end();
+
+    // Lista nova sem ids (como a do edit): a ordem dada vale e os ids seguem pelo nome
+    Receita reordenada = gravada;
+    reordenada.ingredientesEstruturados = {Ingrediente("sal", 1, "pitada"), Ingrediente("farinha", 3, "xicara"),
+                                           Ingrediente("ovos", 4, "un")};
+    db.atualizarReceita(reordenada);
+    std::vector<Ingrediente> ordem = db.getIngredientesFromReceita(id);
+    bool manteveOrdem = ordem.size() == 3 && ordem[0].nome == "sal" && ordem[1].nome == "farinha" &&
+                        ordem[1].quantidade == 3 && ordem[0].id == antes[2].id && ordem[1].id == antes[0].id &&
+                        ordem[2].id == antes[1].id;
+
+    // Conteudo repetido: cada copia casa com a proxima linha livre, na ordem
+    Receita repetida = gravada;
+    repetida.ingredientesEstruturados = {Ingrediente("ovos", 4, "un"), Ingrediente("ovos", 4, "un"),
+                                         Ingrediente("sal", 1, "pitada")};
+    db.atualizarReceita(repetida);
+    repetida.ingredientesEstruturados = {Ingrediente("sal", 1, "pitada"), Ingrediente("ovos", 4, "un"),
+                                         Ingrediente("ovos", 4, "un")};
+    db.atualizarReceita(repetida);
+    std::vector<Ingrediente> copias = db.getIngredientesFromReceita(id);
+    bool casouCopias = copias.size() == 3 && copias[0].id == antes[2].id && copias[1].id == antes[1].id &&
+                       copias[2].id == antes[0].id && copias[2].nome == "ovos";
+
+    // Falha dentro da transacao do chamador desfaz so a atualizacao
+    db.iniciarTransacao();
+    db.marcarReceitaComoFeita(id, true);
+    Receita invalida = db.consultarPorId(id);
+    invalida.tempo = 99;
+    invalida.ingredientesEstruturados.push_back(Ingrediente("agua", std::nan(""), "ml"));
+    bool recusou = !db.atualizarReceita(invalida) && db.emTransacao();
+    db.confirmarTransacao();
+    Receita depois = db.consultarPorId(id);
+    bool desfezSo = recusou && depois.feita && depois.tempo == 25 && depois.ingredientesEstruturados.size() == 3;
+
+    // Vinculo de tag recusado (gatilho) desfaz a atualizacao inteira
+    sqlite3* outra = nullptr;
+    bool gatilho = sqlite3_open(caminho.c_str(), &outra) == SQLITE_OK &&
+                   sqlite3_exec(outra,
+                                "CREATE TRIGGER falhar_vinculo BEFORE INSERT ON receitas_tags "
+                                "WHEN NEW.tag_id = (SELECT id FROM tags WHERE nome = 'editavel-falha') "
+                                "BEGIN SELECT RAISE(ABORT, 'falha'); END;",
+                                nullptr, nullptr, nullptr) == SQLITE_OK;
+    Receita comTag = db.consultarPorId(id);
+    comTag.tempo = 40;
+    comTag.tags.push_back("editavel-falha");
+    bool vinculoDesfeito = gatilho && !db.atualizarReceita(comTag) && db.consultarPorId(id).tempo == 25 &&
+                           db.getTagsFromReceita(id).size() == 2 && db.getTagsByPrefix("editavel-falha").empty();
+    sqlite3_exec(outra, "DROP TRIGGER IF EXISTS falhar_vinculo;", nullptr, nullptr, nullptr);
+    sqlite3_close(outra);
+
+    db.excluirReceita(id);
+    test_result("Atualizar receita com escritas minimas",
+                ok && alteradas == 5 && semMudanca && mesmosIds && conteudo && manteveOrdem && casouCopias &&
+                    desfezSo && vinculoDesfeito);
+}
+
+// Testes de Tags em Massa
+void test_tags_em_massa(Database& db, const std::string& caminho) {
+    FiltroReceitas filtro;
+    filtro.nome = "Receita";
+    size_t alvo = db.listarReceitasCompacto(filtro, 0).size();
+
+    int criados = db.adicionarTagsEmMassa(filtro, {"massa-a", "massa-b"});
+    bool adicionou = criados == static_cast<int>(2 * alvo) && db.getReceitasByTag("massa-a").size() == alvo;
+
+    // Mescla a em b (vinculos duplicados somem), renomeia b e remove so das feitas
+    bool mesclou = !db.mesclarTags("massa-inexistente", "massa-nova") && db.getTagsByPrefix("massa-nova").empty() &&
+                   db.mesclarTags("massa-a", "massa-b") && db.getReceitasByTag("massa-a").empty() &&
+                   db.renomearTag("massa-b", "massa-c") && db.getReceitasByTag("massa-c").size() == alvo;
+    FiltroReceitas feitas;
+    feitas.somenteFeitas = true;
+    int removidos = db.removerTagsEmMassa(feitas, {"massa-c"});
+    bool removeu = removidos >= 0 && db.getReceitasByTag("massa-c").size() == alvo - static_cast<size_t>(removidos);
+
+    db.removerTagsEmMassa(FiltroReceitas(), {"massa-c"});
+    bool podou = db.removerTagsSemUso() >= 1 && db.getTagsByPrefix("massa-").empty();
+    test_result("Tags em massa, mesclar, renomear e limpar", alvo > 0 && adicionou && mesclou && removeu && podou);
+
+    // Falha no meio, dentro da transacao do chamador: so a operacao e desfeita
+    sqlite3* outra = nullptr;
+    bool gatilho = sqlite3_open(caminho.c_str(), &outra) == SQLITE_OK &&
+                   sqlite3_exec(outra,
+                                "CREATE TRIGGER falhar_massa BEFORE INSERT ON tags WHEN NEW.nome = 'massa-falha' "
+                                "BEGIN SELECT RAISE(ABORT, 'falha'); END;",
+                                nullptr, nullptr, nullptr) == SQLITE_OK;
+    db.createTag("massa-velha");
+    bool transacao = gatilho && db.iniciarTransacao();
+    bool renomeou = transacao && db.renomearTag("massa-velha", "massa-nova") && !db.renomearTag("massa-sumida", "x");
+    bool falhou = db.adicionarTagsEmMassa(filtro, {"massa-x", "massa-falha"}) < 0 &&
+                  db.getReceitasByTag("massa-x").empty() && db.getTagsByPrefix("massa-x").empty();
+    bool mesclaFalhou = !db.mesclarTags("massa-nova", "massa-falha") && db.getTagsByPrefix("massa-nova").size() == 1;
+    bool manteve = db.emTransacao() && db.confirmarTransacao() && db.getTagsByPrefix("massa-velha").empty() &&
+                   db.getTagsByPrefix("massa-nova").size() == 1;
+    sqlite3_exec(outra, "DROP TRIGGER IF EXISTS falhar_massa;", nullptr, nullptr, nullptr);
+    sqlite3_close(outra);
+    db.removerTagsSemUso();
+    test_result("Tags em massa desfeitas na transacao do chamador", renomeou && falhou && mesclaFalhou && manteve);
+}
+
+// Testes de Ingredientes
+void test_formatar_ingredientes() {
+    Receita receita;
+    receita.ingredientesEstruturados.push_back(Ingrediente("farinha", 2, "xicara"));
+    receita.ingredientesEstruturados.push_back(Ingrediente("leite", 100, "ml"));
+    receita.ingredientesEstruturados.push_back(Ingrediente("ovos", 3, "un"));
+    receita.ingredientesEstruturados.push_back(Ingrediente("sal", 0.5, "colher"));
+    receita.atualizarIngredientesString();
+    
+    test_result("Formatar ingredientes estruturados",
+                receita.ingredientes == "2 xicaras de farinha, 100 mls de leite, 3 ovos, 0.5 colher de sal");
+}
+
+void test_lista_compras(Database& db) {
+    AgregadorCompras agregador;
+    agregador.adicionar("Farinha de Trigo", 2, "xícaras");
+    agregador.adicionar("farinha de  trigo", 120, "ml");
+    agregador.adicionar("Açúcar", 500, "g");
+    agregador.adicionar("acucar", 0.75, "kg");
+    agregador.adicionar("sal", 1, "pitada");
+    auto lista = agregador.resultado();
+    bool converteu = lista.size() == 3 && lista[0].nome == "acucar" && lista[0].quantidade == 1.25 &&
+                     lista[0].unidade == "kg" && lista[1].nome == "farinha de trigo" &&
+                     lista[1].quantidade == 600 && lista[1].unidade == "ml" && lista[2].unidade == "pitada";
+
+    // Receita de 4 porcoes pedida para 8, mais um lote da mesma receita
+    Receita receita("Receita compras", "", "Preparo", 10, "Teste", 4);
+    receita.ingredientesEstruturados.push_back(Ingrediente("leite", 300, "ml"));
+    receita.ingredientesEstruturados.push_back(Ingrediente("ovos", 2, "un"));
+    int id = db.cadastrarReceita(receita);
+    auto compras = db.gerarListaCompras({{id, 8}, {id, 0}});
+    db.excluirReceita(id);
+    bool escalou = compras.size() == 2 && compras[0].nome == "leite" && compras[0].quantidade == 900 &&
+                   compras[1].nome == "ovos" && compras[1].quantidade == 6 && compras[1].unidade.empty();
+    test_result("Lista de compras com conversao e porcoes", converteu && escalou);
+}
+
+void test_similares(Database& db, const std::string& caminho) {
+    auto nova = [&db](const std::string& nome, std::vector<std::string> ingredientes) {
+        Receita receita(nome, "", "Preparo", 10, "Teste", 1);
+        for (const auto& ingrediente : ingredientes) {
+            receita.ingredientesEstruturados.push_back(Ingrediente(ingrediente, 1, "un"));
+        }
+        return db.cadastrarReceita(receita);
+    };
+    int base = nova("Similar base", {"grao-a", "grao-b", "grao-c", "grao-d", "grao-e", "grao-f"});
+    int parecida = nova("Similar parecida", {"grao-a", "grao-b", "grao-c", "grao-d", "grao-e", "grao-g"});
+    int diferente = nova("Similar diferente", {"pedra-x", "pedra-y", "pedra-z"});
+
+    auto vizinhos = db.similares(base, 3);
+    bool achou = !vizinhos.empty() && vizinhos[0].id == parecida && vizinhos[0].similaridade > 0.4;
+    bool semDiferente = std::none_of(vizinhos.begin(), vizinhos.end(),
+                                     [diferente](const ReceitaSimilar& r) { return r.id == diferente; });
+
+    // Escritas posteriores atualizam o indice de forma incremental
+    db.clearIngredientesFromReceita(diferente);
+    for (const char* ingrediente : {"grao-a", "grao-b", "grao-c", "grao-d", "grao-e", "grao-f"}) {
+        db.addIngredienteToReceita(diferente, Ingrediente(ingrediente, 2, "un"));
+    }
+    db.excluirReceita(parecida);
+    vizinhos = db.similares(base, 3);
+    bool atualizou = !vizinhos.empty() && vizinhos[0].id == diferente && vizinhos[0].similaridade == 1.0 &&
+                     std::none_of(vizinhos.begin(), vizinhos.end(),
+                                  [parecida](const ReceitaSimilar& r) { return r.id == parecida; });
+
+    // Outra conexao parte das assinaturas gravadas e, depois de uma escrita
+    // externa, recalcula so a receita alterada (assinatura + seq gravados)
+    Database outra(caminho);
+    bool persistiu = outra.initialize() && !outra.similares(base, 3).empty();
+    db.addIngredienteToReceita(diferente, Ingrediente("pedra-x", 1, "un"));
+    uint64_t escritas = Metricas::global().sql().linhasEscritas.load();
+    vizinhos = outra.similares(base, 3);
+    persistiu = persistiu && Metricas::global().sql().linhasEscritas.load() - escritas == 2 &&
+                !vizinhos.empty() && vizinhos[0].id == diferente && vizinhos[0].similaridade < 1.0;
+    outra.close();
+
+    // Um ROLLBACK devolve o indice ao estado confirmado
+    db.iniciarTransacao();
+    db.clearIngredientesFromReceita(diferente);
+    bool vazia = db.similares(base, 3).empty();
+    db.desfazerTransacao();
+    vizinhos = db.similares(base, 3);
+    bool desfez = vazia && !vizinhos.empty() && vizinhos[0].id == diferente;
+
+    db.excluirReceita(base);
+    db.excluirReceita(diferente);
+    test_result("Receitas similares por MinHash/LSH", achou && semDiferente && atualizou);
+    test_result("Assinaturas gravadas e atualizadas pelo log", persistiu && desfez);
+}
+
+// Backup de antes das assinaturas persistidas: a restauracao cria as
+// tabelas e o indice e remontado a partir do vault restaurado
+void test_restaurar_backup_sem_assinaturas() {
+    std::string caminho = "./test_restaurar.db";
+    std::string diretorio = "./test_restaurar_backups";
+    std::filesystem::remove(caminho);
+    std::filesystem::remove_all(diretorio);
+    Database vault(caminho);
+    bool ok = vault.initialize();
+    auto nova = [&vault](const std::string& nome) {
+        Receita receita(nome, "", "Preparo", 10, "Teste", 1);
+        for (const char* ingrediente : {"trigo-a", "trigo-b", "trigo-c", "trigo-d"}) {
+            receita.ingredientesEstruturados.push_back(Ingrediente(ingrediente, 1, "un"));
+        }
+        return vault.cadastrarReceita(receita);
+    };
+    int antes = nova("Restaurada antes");
+    ok = ok && !vault.similares(nova("Restaurada vizinha"), 3).empty();
+    std::string backup = diretorio + "/antigo.db";
+    ok = ok && vault.fazerBackup(backup);
+
+    sqlite3* antigo = nullptr;
+    ok = ok && sqlite3_open(backup.c_str(), &antigo) == SQLITE_OK &&
+         sqlite3_exec(antigo, "DROP TABLE assinaturas; DROP TABLE indices_persistidos;", nullptr, nullptr, nullptr) == SQLITE_OK;
+    sqlite3_close(antigo);
+
+    ok = ok && vault.restaurarBackup(backup);
+    int depois = nova("Restaurada depois");
+    auto vizinhos = vault.similares(depois, 3);
+    bool achou = std::any_of(vizinhos.begin(), vizinhos.end(), [antes](const ReceitaSimilar& r) { return r.id == antes; });
+
+    vault.close();
+    std::filesystem::remove(caminho);
+    std::filesystem::remove(caminho + ".pre_restore");
+    std::filesystem::remove_all("./test_restaurar.imagens");
+    std::filesystem::remove_all(diretorio);
+    test_result("Restaurar backup sem tabela de assinaturas", ok && achou);
+}
+
+void test_duplicadas(Database& db) {
+    const std::string preparo =
+        "Aqueca o forno a 180 graus. Misture a farinha, o acucar e os ovos ate formar uma massa lisa. "
+        "Acrescente o leite aos poucos, mexendo sempre. Despeje em forma untada e asse por 40 minutos "
+        "ou ate dourar. Deixe esfriar antes de desenformar e sirva com calda de chocolate.";
+    Receita original("Bolo de fuba dedup", "2 xicaras de fuba\n3 ovos", preparo, 50, "Teste", 8);
+    original.ingredientesEstruturados = {Ingrediente("fuba", 2, "xicara"), Ingrediente("ovo", 3, "un")};
+    int idOriginal = db.cadastrarReceita(original);
+
+    // Exata: mesmo conteudo a menos de caixa, acentos e espacos
+    Receita copia = original;
+    copia.nome = "BOLO  DE FUBÁ DEDUP";
+    bool exata = db.buscarDuplicataExata(copia) == idOriginal;
+
+    Receita parecida = original;
+    parecida.nome = "Bolo de fuba dedup caseiro";
+    parecida.preparo.replace(parecida.preparo.find("40 minutos"), 10, "45 minutos");
+    parecida.nota = 5;
+    parecida.tags = {"dedup-tag"};
+    int idParecida = db.cadastrarReceita(parecida);
+    db.addTagToReceita(idParecida, db.createTag("dedup-tag"));
+    Receita diferente("Torta dedup", "", "Abra a massa e recheie com frango desfiado.", 30, "Teste", 4);
+    int idDiferente = db.cadastrarReceita(diferente);
+
+    parecida.id = idParecida;
+    bool semDuplicataFalsa = db.buscarDuplicataExata(parecida) == 0;
+    size_t baldesTruncados = 1;
+    std::vector<GrupoDuplicadas> grupos = db.encontrarDuplicadas(5, 2, &baldesTruncados);
+    auto grupo = std::find_if(grupos.begin(), grupos.end(), [idOriginal](const GrupoDuplicadas& g) {
+        return std::find(g.ids.begin(), g.ids.end(), idOriginal) != g.ids.end();
+    });
+    bool agrupou = baldesTruncados == 0 && grupo != grupos.end() && grupo->ids.front() == idOriginal &&
+                   std::find(grupo->ids.begin(), grupo->ids.end(), idParecida) != grupo->ids.end() &&
+                   std::find(grupo->ids.begin(), grupo->ids.end(), idDiferente) == grupo->ids.end();
+
+    bool mesclou = db.mesclarReceitas(idOriginal, {idParecida});
+    Receita mesclada = db.consultarPorId(idOriginal);
+    std::vector<std::string> tags = db.getTagsFromReceita(idOriginal);
+    mesclou = mesclou && db.consultarPorId(idParecida).id == 0 && mesclada.nota == 5 &&
+              std::find(tags.begin(), tags.end(), "dedup-tag") != tags.end();
+
+    db.excluirReceita(idOriginal);
+    db.excluirReceita(idDiferente);
+    test_result("Duplicatas exatas por hash de conteudo", exata && semDuplicataFalsa);
+    test_result("Agrupar e mesclar receitas quase iguais (SimHash)", agrupou && mesclou);
+}
+
+// Testes de Renderização
+void test_renderizar_celula_utf8() {
+    std::string celula;
+    Renderizador::anexarCelula(celula, "Pão de queijo com requeijão cremoso", 15);
+    // 12 caracteres + ".." + 1 espaço; "ã" ocupa 2 bytes
+    test_result("Truncar coluna respeitando UTF-8", celula == "Pão de queij.. ");
+}
+
+void test_renderizar_json(Database& db) {
+    std::string saida;
+    {
+        Renderizador json(saida, FormatoSaida::Json);
+        FiltroReceitas filtro;
+        filtro.tag = "filtro-tag";
+        db.forEachReceita(filtro, [&json](const ReceitaLinha& r) {
+            json.linha(r);
+            return true;
+        }, CAMPOS_LISTAGEM);
+        json.finalizar();
+    }
+    bool ok = saida.front() == '[' && saida.find("\"nome\":\"Receita filtro tag\"") != std::string::npos
+           && saida.find("\"tags\":[\"filtro-tag\"]") != std::string::npos;
+
+    // Nome de tag com ", " continua sendo uma tag so
+    Receita receita("Receita tag com virgula", "", "", 5, "Teste", 1);
+    int id = db.cadastrarReceita(receita);
+    db.addTagToReceita(id, db.createTag("doce, salgado"));
+    db.addTagToReceita(id, db.createTag("rapida"));
+    std::string porLinha;
+    std::string porReceita;
+    {
+        Renderizador json(porLinha, FormatoSaida::Ndjson);
+        FiltroReceitas filtro;
+        filtro.tag = "doce, salgado";
+        db.forEachReceita(filtro, [&json](const ReceitaLinha& r) {
+            json.linha(r);
+            return true;
+        }, CAMPOS_LISTAGEM);
+        json.finalizar();
+        Renderizador ndjson(porReceita, FormatoSaida::Ndjson);
+        ndjson.linha(db.consultarPorId(id));
+        ndjson.finalizar();
+    }
+    const std::string esperado = "\"tags\":[\"doce, salgado\",\"rapida\"]";
+    ok = ok && porLinha.find(esperado) != std::string::npos && porReceita.find(esperado) != std::string::npos;
+    db.excluirReceita(id);
+    test_result("Renderizar receitas em JSON", ok);
+}
+
+// Testes de Carga em Lote
+void test_gerar_vault_em_lote(Database& db) {
+    GeradorVault a;
+    GeradorVault b;
+    std::vector<Receita> lote;
+    bool mesmaSequencia = true;
+    for (int i = 0; i < 50; ++i) {
+        lote.push_back(a.proxima());
+        Receita copia = b.proxima();
+        mesmaSequencia = mesmaSequencia && copia.nome == lote.back().nome && copia.tags == lote.back().tags;
+    }
+
+    std::vector<int> ids;
+    int inseridas = db.cadastrarReceitasEmLote(lote, &ids);
+    bool gravou = inseridas == 50 && ids.size() == 50 &&
+                  db.getIngredientesFromReceita(ids[0]).size() == lote[0].ingredientesEstruturados.size() &&
+                  db.getTagsFromReceita(ids[0]).size() == lote[0].tags.size();
+    test_result("Gerar vault reproduzivel em lote", mesmaSequencia && gravou);
+}
+
+void test_lote_com_falha_em_transacao(Database& db) {
+    db.iniciarTransacao();
+    Receita anterior("Receita antes do lote falho", "sal", "Misturar", 5, "Teste", 1);
+    int idAnterior = db.cadastrarReceita(anterior);
+
+    std::vector<Receita> lote;
+    lote.push_back(Receita("Receita lote falho 1", "", "Misturar", 5, "Teste", 1));
+    lote.push_back(Receita("Receita lote falho 2", "", "Misturar", 5, "Teste", 1));
+    // NaN vira NULL no bind e quebra o NOT NULL de ingredientes.quantidade
+    lote.back().ingredientesEstruturados.push_back(Ingrediente("sal", std::nan(""), "g"));
+    std::vector<int> ids;
+    bool falhou = db.cadastrarReceitasEmLote(lote, &ids) == -1 && ids.empty();
+    bool manteveAnterior = db.emTransacao() && db.consultarPorId(idAnterior).id == idAnterior &&
+                           db.buscarPorNome("Receita lote falho").empty();
+    db.confirmarTransacao();
+    bool confirmou = db.consultarPorId(idAnterior).id == idAnterior;
+    db.excluirReceita(idAnterior);
+    test_result("Lote com falha desfaz so o lote na transacao do chamador", falhou && manteveAnterior && confirmou);
+}
+
+// Testes de Hidratação Paralela
+void test_hidratacao_paralela(Database& db) {
+    GeradorVault gerador;
+    std::vector<Receita> lote;
+    for (int i = 0; i < 2500; ++i) {
+        lote.push_back(gerador.proxima());
+    }
+    std::vector<int> ids;
+    db.cadastrarReceitasEmLote(lote, &ids);
+
+    auto iguais = [](const std::vector<Receita>& a, const std::vector<Receita>& b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (a[i].id != b[i].id || a[i].tags != b[i].tags || a[i].ingredientes != b[i].ingredientes ||
+                a[i].ingredientesEstruturados.size() != b[i].ingredientesEstruturados.size()) {
+                return false;
+            }
+        }
+        return true;
+    };
+    std::vector<Receita> serial = db.buscarPorNome("");
+    db.configurarHidratacaoParalela(3);
+    std::vector<Receita> paralelo = db.buscarPorNome("");
+    // Segunda rodada nos mesmos trabalhadores
+    std::vector<Receita> paraleloDeNovo = db.buscarPorNome("");
+    // Dentro de uma transacao os leitores nao veriam a receita nova: volta ao serial
+    db.iniciarTransacao();
+    Receita pendente("Receita pendente hidratacao", "", "", 1, "Teste", 1);
+    pendente.ingredientesEstruturados.push_back(Ingrediente("sal", 1, "g"));
+    int idPendente = db.cadastrarReceita(pendente);
+    std::vector<Receita> emTransacao = db.buscarPorNome("");
+    bool viuPendente = !emTransacao.empty() && emTransacao.back().id == idPendente &&
+                       emTransacao.back().ingredientesEstruturados.size() == 1;
+    db.desfazerTransacao();
+    db.configurarHidratacaoParalela(0);
+
+    db.iniciarTransacao();
+    for (int id : ids) {
+        db.excluirReceita(id);
+    }
+    db.confirmarTransacao();
+    test_result("Hidratacao paralela em conexoes de leitura",
+                serial.size() >= 2500 && iguais(serial, paralelo) && iguais(serial, paraleloDeNovo) && viuPendente);
+}
+
+// Testes de Limites de Consulta
+void test_limites_consulta(Database& db) {
+    GeradorVault gerador;
+    std::vector<Receita> lote;
+    for (int i = 0; i < 3000; ++i) {
+        lote.push_back(gerador.proxima());
+    }
+    std::vector<int> ids;
+    db.cadastrarReceitasEmLote(lote, &ids);
+
+    StatusConsulta status = StatusConsulta::Erro;
+    LimitesConsulta poucas;
+    poucas.maxLinhas = 10;
+    std::vector<Receita> truncadas = db.buscarPorNome("", &status, &poucas);
+    bool truncou = truncadas.size() == 10 && status == StatusConsulta::LimiteLinhas;
+    std::vector<Receita> inteiras = db.buscarPorNome("", &status);
+    bool semLimite = inteiras.size() >= 3000 && status == StatusConsulta::Ok;
+
+    // Interrupcao pedida antes da consulta: o resultado e descartado
+    db.interromper();
+    std::vector<Receita> interrompidas = db.buscarPorNome("", &status);
+    bool interrompeu = interrompidas.empty() && status == StatusConsulta::Interrompida;
+    db.limparInterrupcao();
+
+    // Limites padrao valem para o visitante; o primeiro callback estoura o
+    // prazo, e leituras aninhadas que comecam depois dele nem rodam
+    LimitesConsulta curto;
+    curto.prazoMs = 1;
+    db.configurarLimites(curto);
+    bool primeira = true;
+    bool aninhadasVazias = false;
+    int visitadas = db.forEachReceita(FiltroReceitas(), [&](const ReceitaLinha& linha) {
+        if (primeira) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            primeira = false;
+            aninhadasVazias = db.consultarPorId(linha.id).id == 0 && db.listAllTags().empty() &&
+                              db.similares(linha.id).empty() && db.prazoEstourado();
+        }
+        return true;
+    }, CAMPOS_LISTAGEM, &status);
+    bool visitanteEsgotou = visitadas == -1 && status == StatusConsulta::PrazoEsgotado && aninhadasVazias;
+
+    // Edicao com o prazo ja vencido: as leituras de ingredientes e tags que
+    // decidem o que inserir e apagar nao podem voltar vazias
+    Receita grande("Receita edicao sem prazo", "", "", 10, "Teste", 1);
+    for (int i = 0; i < 2000; ++i) {
+        grande.ingredientesEstruturados.push_back(Ingrediente("item " + std::to_string(i), 1, "g"));
+    }
+    grande.tags = {"prazo-a", "prazo-b"};
+    std::vector<int> idGrande;
+    db.cadastrarReceitasEmLote({grande}, &idGrande);
+    Receita editada = grande;
+    editada.id = idGrande[0];
+    editada.tags = {"prazo-a"};
+    bool editou = false;
+    db.forEachReceita(FiltroReceitas(), [&](const ReceitaLinha&) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        editou = db.atualizarReceita(editada);
+        return false;
+    });
+    db.configurarLimites(LimitesConsulta());
+    editou = editou && db.getIngredientesFromReceita(idGrande[0]).size() == 2000 &&
+             db.getTagsFromReceita(idGrande[0]) == std::vector<std::string>{"prazo-a"};
+    db.excluirReceita(idGrande[0]);
+    bool limpo = db.consultarPorId(ids[0]).id == ids[0] && !db.prazoEstourado();
+    bool depois = db.listarReceitas(&status).size() >= 3000 && status == StatusConsulta::Ok;
+
+    db.iniciarTransacao();
+    for (int id : ids) {
+        db.excluirReceita(id);
+    }
+    db.confirmarTransacao();
+    test_result("Prazo e limite de linhas por consulta",
+                truncou && semLimite && interrompeu && visitanteEsgotou && editou && limpo && depois);
+}
+
+// Testes de Análise Colunar
+void test_analise_colunar(Database& db, const std::string& caminho) {
+    // Kernels: filtros combinados, remocao no meio e grupos por categoria
+    AnaliseColunar colunas;
+    colunas.definir(1, 10, 2, 5, true, "Doce");
+    colunas.definir(2, 40, 4, 0, false, "Doce");
+    colunas.definir(3, 25, 6, 3, true, "Sopa");
+    colunas.definir(4, 90, 8, 5, false, "Sopa");
+    colunas.remover(2);
+    colunas.definir(3, 30, 6, 4, true, "Sopa");
+    FiltroAnalise feitas;
+    feitas.feita = 1;
+    FiltroAnalise sopas;
+    sopas.categoria = "Sopa";
+    FiltroAnalise inexistente;
+    inexistente.categoria = "Nenhuma";
+    Agregado tempo = colunas.agregar(ColunaAnalise::Tempo, sopas);
+    std::vector<size_t> histograma = colunas.histograma(ColunaAnalise::Tempo, FiltroAnalise(), 20, 3);
+    std::vector<GrupoCategoria> grupos = colunas.agruparPorCategoria(ColunaAnalise::Nota, FiltroAnalise());
+    bool kernels = colunas.size() == 3 && colunas.contar(feitas) == 2 && colunas.contar(inexistente) == 0 &&
+                   tempo.contagem == 2 && tempo.soma == 120 && tempo.minimo == 30 && tempo.maximo == 90 &&
+                   histograma == std::vector<size_t>({1, 1, 1}) && grupos.size() == 2 &&
+                   grupos[0].categoria == "Doce" && grupos[0].agregado.soma == 5 &&
+                   grupos[1].agregado.soma == 9 && grupos[1].agregado.minimo == 4;
+
+    // Pela Database: carga inicial igual as listagens e escritas aplicadas por id
+    const AnaliseColunar* analise = db.analiseColunar();
+    ListaReceitas todas = db.listarReceitas();
+    size_t feitasListadas = 0;
+    for (const auto& receita : todas) {
+        feitasListadas += receita.feita ? 1 : 0;
+    }
+    bool carga = analise && analise->size() == todas.size() &&
+                 static_cast<size_t>(analise->agregar(ColunaAnalise::Feita, FiltroAnalise()).soma) == feitasListadas;
+
+    int id = db.cadastrarReceita(Receita("Analise colunar", "", "", 37, "CategoriaAnalise", 2));
+    FiltroAnalise categoria;
+    categoria.categoria = "CategoriaAnalise";
+    analise = db.analiseColunar();
+    bool inserida = analise && analise->contar(categoria) == 1 && analise->agregar(ColunaAnalise::Tempo, categoria).minimo == 37;
+    db.marcarReceitaComoFeita(id, true);
+    db.avaliarReceita(id, 4);
+    analise = db.analiseColunar();
+    bool avaliada = analise && analise->agregar(ColunaAnalise::Nota, categoria).soma == 4 &&
+                    analise->agregar(ColunaAnalise::Feita, categoria).soma == 1;
+    db.excluirReceita(id);
+    analise = db.analiseColunar();
+    bool excluida = analise && analise->contar(categoria) == 0 && analise->size() == todas.size();
+
+    // ROLLBACK: antes de chegar as colunas nao pede nada; depois, so a receita aplicada e relida
+    uint64_t lidas = Metricas::global().sql().linhasLidas.load();
+    db.iniciarTransacao();
+    db.cadastrarReceita(Receita("Analise desfeita", "", "", 5, "CategoriaAnalise", 1));
+    db.desfazerTransacao();
+    analise = db.analiseColunar();
+    db.iniciarTransacao();
+    db.cadastrarReceita(Receita("Analise desfeita", "", "", 5, "CategoriaAnalise", 1));
+    bool vista = db.analiseColunar()->contar(categoria) == 1;
+    db.desfazerTransacao();
+    analise = db.analiseColunar();
+    bool desfeita = vista && analise && analise->contar(categoria) == 0 && analise->size() == todas.size() &&
+                    Metricas::global().sql().linhasLidas.load() - lidas < 100;
+
+    // Escrita de outra conexao: aplicada pelo log, sem recarga completa
+    Database outra(caminho);
+    int externa = outra.initialize() ? outra.cadastrarReceita(Receita("Analise externa", "", "", 5, "CategoriaAnalise", 1)) : -1;
+    lidas = Metricas::global().sql().linhasLidas.load();
+    analise = db.analiseColunar();
+    bool externaAplicada = externa > 0 && analise && analise->contar(categoria) == 1 &&
+                           Metricas::global().sql().linhasLidas.load() - lidas < 100;
+    outra.excluirReceita(externa);
+    outra.close();
+
+    test_result("Analise colunar incremental", kernels && carga && inserida && avaliada && excluida);
+    test_result("Analise colunar segue o log e desfaz so o aplicado", desfeita && externaAplicada);
+}
+
+// Testes de Log de Alterações
+void test_log_alteracoes(Database& db) {
+    int64_t inicio = db.ultimaAlteracao();
+    Receita receita("Receita do log", "", "", 10, "Teste", 1);
+    receita.ingredientesEstruturados.push_back(Ingrediente("farinha", 2, "xicara"));
+    int id = db.cadastrarReceita(receita);
+    db.addTagToReceita(id, db.createTag("tag-log"));
+    db.marcarReceitaComoFeita(id, true);
+    db.excluirReceita(id);
+
+    // Seq crescente; a exclusao chega tambem aos vinculos e ingredientes (cascata)
+    std::vector<std::string> vistas;
+    int64_t anterior = inicio;
+    bool crescente = true;
+    int entregues = db.alteracoesDesde(inicio, [&](const Alteracao& a) {
+        crescente = crescente && a.seq > anterior;
+        anterior = a.seq;
+        if (a.receitaId == id || a.tabela == "tags") {
+            vistas.push_back(std::string(a.tabela) + ":" + a.operacao);
+        }
+        return true;
+    });
+    auto viu = [&vistas](const std::string& alteracao) {
+        return std::find(vistas.begin(), vistas.end(), alteracao) != vistas.end();
+    };
+    bool completo = entregues > 0 && crescente && viu("receitas:I") && viu("ingredientes:I") && viu("tags:I") &&
+                    viu("receitas_tags:I") && viu("receitas:U") && viu("receitas_tags:D") &&
+                    viu("ingredientes:D") && viu("receitas:D") &&
+                    std::count(vistas.begin(), vistas.end(), "receitas:U") == 1;
+
+    // Limite de linhas, timestamps e filtro por atualizada_em
+    LimitesConsulta duas{0, 2};
+    StatusConsulta status = StatusConsulta::Ok;
+    bool limitado = db.alteracoesDesde(inicio, [](const Alteracao&) { return true; }, &status, &duas) == 2 &&
+                    status == StatusConsulta::LimiteLinhas;
+    int outra = db.cadastrarReceita(Receita("Receita recente", "", "", 5, "Teste", 1));
+    FiltroReceitas recentes;
+    recentes.alteradasDesde = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count() - 60000;
+    int encontradas = 0;
+    int64_t criadaEm = 0;
+    db.forEachReceita(recentes, [&](const ReceitaLinha& r) {
+        encontradas += r.id == outra;
+        criadaEm = r.id == outra ? r.criadaEm : criadaEm;
+        return true;
+    });
+
+    // Vinculos e ingredientes tambem avancam atualizada_em, sem linha 'U' de receitas
+    Receita antes = db.consultarPorId(outra);
+    int64_t seqAntes = db.ultimaAlteracao();
+    db.addTagToReceita(outra, db.createTag("tag-log"));
+    Receita comTag = db.consultarPorId(outra);
+    db.addIngredienteToReceita(outra, Ingrediente("sal", 1, "g"));
+    Receita comIngrediente = db.consultarPorId(outra);
+    bool semUpdateReceita = true;
+    db.alteracoesDesde(seqAntes, [&](const Alteracao& a) {
+        semUpdateReceita = semUpdateReceita && !(std::string(a.tabela) == "receitas" && a.operacao == 'U');
+        return true;
+    });
+    std::ostringstream json;
+    {
+        Renderizador saida(json, FormatoSaida::Json);
+        saida.linha(comIngrediente);
+        saida.finalizar();
+    }
+    bool carimbos = criadaEm > 0 && antes.criadaEm == criadaEm && antes.atualizadaEm >= criadaEm &&
+                    comTag.atualizadaEm > antes.atualizadaEm &&
+                    comIngrediente.atualizadaEm > comTag.atualizadaEm && comIngrediente.criadaEm == criadaEm &&
+                    semUpdateReceita &&
+                    json.str().find("\"atualizada_em\":" + std::to_string(comIngrediente.atualizadaEm)) !=
+                        std::string::npos;
+    db.excluirReceita(outra);
+
+    // Descartar preserva a ultima linha, entao o seq segue crescendo
+    int64_t ultima = db.ultimaAlteracao();
+    bool descartou = db.descartarAlteracoes(ultima) >= 0 && db.ultimaAlteracao() == ultima;
+    db.excluirReceita(db.cadastrarReceita(Receita("Receita depois do descarte", "", "", 5, "Teste", 1)));
+    bool segue = db.ultimaAlteracao() > ultima;
+    test_result("Log de alteracoes", completo && limitado && encontradas == 1 && descartou && segue);
+    test_result("Vinculos e ingredientes avancam atualizada_em", carimbos);
+}
+
+// Testes de Armazém de Imagens
+void test_armazem_imagens(Database& db) {
+    bool hashes = ArmazemImagens::sha256("abc") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" &&
+                  ArmazemImagens::sha256("") == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" &&
+                  ArmazemImagens::sha256("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") ==
+                      "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1";
+
+    // Tres receitas com o mesmo arquivo (ainda como caminho) viram um unico blob
+    std::string arquivo = "./test_imagem.png";
+    std::string conteudo = std::string("\x89PNG\r\n\x1a\n", 8) + std::string(100000, 'x');
+    std::ofstream(arquivo, std::ios::binary) << conteudo;
+    std::vector<int> ids;
+    for (int i = 0; i < 3; ++i) {
+        Receita receita("Receita com imagem " + std::to_string(i), "", "", 10, "Teste", 1);
+        receita.imagem = arquivo;
+        ids.push_back(db.cadastrarReceita(receita));
+    }
+    ArmazemImagens& armazem = db.imagens();
+    bool importou = db.importarImagens() == 3 && armazem.listar().size() == 1;
+    std::string hash(ArmazemImagens::hashDaReferencia(db.consultarPorId(ids[2]).imagem));
+    ImagemMapeada imagem = armazem.mapear(hash);
+    bool mapeada = hash == ArmazemImagens::sha256(conteudo) && imagem.aberta() &&
+                   std::string(reinterpret_cast<const char*>(imagem.data()), imagem.size()) == conteudo &&
+                   std::string(ArmazemImagens::tipoMime(imagem.data(), imagem.size())) == "image/png" &&
+                   armazem.verificar(hash);
+
+    // Backups no mesmo diretorio copiam so os blobs que faltam
+    std::string diretorioBackup = "./test_backups_imagens";
+    bool backup = db.fazerBackup(diretorioBackup + "/b1.db") &&
+                  ArmazemImagens(diretorioBackup + "/imagens").contem(hash) &&
+                  armazem.copiarPara(diretorioBackup + "/imagens") == 0;
+
+    for (int id : ids) {
+        db.excluirReceita(id);
+    }
+    // Blob recem-gravado sobrevive a carencia padrao; guardar de novo nao copia
+    std::string outra = ArmazemImagens::referencia(armazem.guardarBytes("sem receita"));
+    bool reaproveitou = armazem.guardarArquivo(arquivo) == ArmazemImagens::referencia(hash) && armazem.listar().size() == 2;
+    bool coletou = reaproveitou && db.removerImagensSemUso() == 0 && armazem.contem(hash) &&
+                   db.removerImagensSemUso(0) == 2 && !armazem.contem(hash) &&
+                   !armazem.contem(ArmazemImagens::hashDaReferencia(outra));
+
+    std::filesystem::remove(arquivo);
+    std::filesystem::remove_all(diretorioBackup);
+    std::filesystem::remove_all(armazem.diretorio());
+    test_result("Armazem de imagens por conteudo", hashes && importou && mapeada && backup && coletou);
+}
+
+// Testes de Snapshot
+void test_snapshot_vault(Database& db) {
+    Receita receita("Receita snapshot", "", "Misturar", 15, "Teste", 3);
+    receita.ingredientesEstruturados.push_back(Ingrediente("farinha", 2.5, "xicara"));
+    receita.ingredientesEstruturados.push_back(Ingrediente("ovo", 3, "unidade"));
+    receita.atualizarIngredientesString();
+    int id = db.cadastrarReceita(receita);
+    db.addTagToReceita(id, db.createTag("zeta"));
+    db.addTagToReceita(id, db.createTag("alfa"));
+    db.marcarReceitaComoFeita(id, true);
+    db.avaliarReceita(id, 4);
+
+    std::string caminho = "./test_snapshot.snap";
+    bool exportou = db.exportarSnapshot(caminho);
+    SnapshotVault snapshot;
+    bool abriu = exportou && snapshot.abrir(caminho);
+
+    ListaReceitas todas = db.listarReceitas();
+    bool iguais = abriu && snapshot.size() == todas.size();
+    for (size_t i = 0; iguais && i < todas.size(); ++i) {
+        Receita original = db.consultarPorId(todas[i].id);
+        uint32_t posicao = snapshot.indiceDe(original.id);
+        if (posicao == SnapshotVault::NENHUM) {
+            iguais = false;
+            break;
+        }
+        Receita lida = snapshot[posicao].paraReceita();
+        iguais = lida.id == original.id && lida.nome == original.nome && lida.preparo == original.preparo &&
+                 lida.tempo == original.tempo && lida.categoria == original.categoria && lida.feita == original.feita &&
+                 lida.nota == original.nota && lida.tags == original.tags &&
+                 lida.ingredientes == original.ingredientes &&
+                 lida.ingredientesEstruturados.size() == original.ingredientesEstruturados.size();
+
+    }
+    uint32_t indice = abriu ? snapshot.indiceDe(id) : SnapshotVault::NENHUM;
+    bool consulta = indice != SnapshotVault::NENHUM && snapshot[indice].numTags() == 2 &&
+                    snapshot[indice].tag(0) == "alfa" && snapshot[indice].ingrediente(0).quantidade == 2.5 &&
+                    snapshot[indice].ingrediente(1).unidade == "unidade" &&
+                    snapshot.indiceTag("zeta") != SnapshotVault::NENHUM &&
+                    snapshot.indiceDe(id + 1000) == SnapshotVault::NENHUM;
+    snapshot.fechar();
+
+    // Arquivo truncado e recusado na abertura
+    std::filesystem::resize_file(caminho, std::filesystem::file_size(caminho) / 2);
+    bool recusou = !snapshot.abrir(caminho);
+    std::filesystem::remove(caminho);
+    db.excluirReceita(id);
+    test_result("Snapshot binario mapeado em memoria", exportou && iguais && consulta && recusou);
+}
+
+// Testes de Database Assíncrona
+void test_database_assincrona(Database& db) {
+    Receita receita("Receita assincrona", "agua", "Ferver", 5, "Teste", 1);
+    int id = db.cadastrarReceita(receita);
+
+    bool emOrdem = false;
+    bool filaCancelada = false;
+    bool andamentoCancelado = false;
+    bool escritaDesfeita = false;
+    bool sincronaDepois = false;
+    {
+        DatabaseAssincrona assincrona(db);
+        // Segura a executora ate a fila estar montada
+        std::promise<void> liberar;
+        std::shared_future<void> liberado = liberar.get_future().share();
+        auto bloqueio = assincrona.executar([liberado](Database&) { liberado.wait(); });
+
+        DatabaseAssincrona::Tarefa cancelada = 0;
+        auto busca = assincrona.buscarPorNome("assincrona");
+        auto descartada = assincrona.consultarPorId(id, &cancelada);
+        auto consulta = assincrona.consultarPorId(id);
+        bool retirou = assincrona.cancelar(cancelada);
+        liberar.set_value();
+
+        try {
+            descartada.get();
+        } catch (const OperacaoCancelada&) {
+            filaCancelada = retirou;
+        }
+        bloqueio.get();
+        auto encontradas = busca.get();
+        emOrdem = encontradas.size() == 1 && consulta.get().nome == "Receita assincrona";
+
+        // Em andamento: a tarefa so termina quando o pedido de interrupcao chega
+        DatabaseAssincrona::Tarefa longa = 0;
+        auto espera = assincrona.executar([](Database& alvo) {
+            while (!alvo.interrompida()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            return 1;
+        }, &longa);
+        while (!assincrona.cancelar(longa)) {
+            std::this_thread::yield();
+        }
+        try {
+            espera.get();
+        } catch (const OperacaoCancelada&) {
+            andamentoCancelado = assincrona.consultarPorId(id).get().id == id;
+        }
+
+        // Escrita ja gravada quando o cancelamento chega: e desfeita antes do OperacaoCancelada
+        DatabaseAssincrona::Tarefa escrita = 0;
+        auto gravacao = assincrona.executar([](Database& alvo) {
+            int novo = alvo.cadastrarReceita(Receita("Receita cancelada", "", "Preparo", 5, "Teste", 1));
+            while (!alvo.interrompida()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            return novo;
+        }, &escrita);
+        while (!assincrona.cancelar(escrita)) {
+            std::this_thread::yield();
+        }
+        try {
+            gravacao.get();
+        } catch (const OperacaoCancelada&) {
+            // Sem outra tarefa depois: o uso direto do Database nao herda a interrupcao
+            sincronaDepois = !db.interrompida() && db.consultarPorId(id).id == id;
+            escritaDesfeita = assincrona.consultar([](Database& alvo) {
+                return alvo.buscarPorNome("Receita cancelada").empty();
+            }).get();
+        }
+    }
+    // Nem depois que a fachada e destruida
+    {
+        DatabaseAssincrona assincrona(db);
+        DatabaseAssincrona::Tarefa longa = 0;
+        auto espera = assincrona.executar([](Database& alvo) {
+            while (!alvo.interrompida()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            return 1;
+        }, &longa);
+        while (!assincrona.cancelar(longa)) {
+            std::this_thread::yield();
+        }
+        try {
+            espera.get();
+        } catch (const OperacaoCancelada&) {
+        }
+    }
+    StatusConsulta status = StatusConsulta::Erro;
+    sincronaDepois = sincronaDepois && db.consultarPorId(id).id == id &&
+                     db.buscarPorNome("Receita assincrona", &status).size() == 1 && status == StatusConsulta::Ok;
+    db.excluirReceita(id);
+    test_result("Fachada assincrona com cancelamento", emOrdem && filaCancelada && andamentoCancelado);
+    test_result("Escrita cancelada e desfeita", escritaDesfeita);
+    test_result("Database sincrono depois de um cancelamento", sincronaDepois);
+}
+
+void test_metricas(Database& db) {
+    HistogramaLatencia h;
+    for (uint64_t i = 1; i <= 1000; ++i) {
+        h.registrar(i * 1000);
+    }
+    // Faixas de ~6%: p50 perto de 500us e p99 perto de 990us
+    uint64_t p50 = h.percentil(0.50);
+    uint64_t p99 = h.percentil(0.99);
+    bool histograma = h.contagem() == 1000 && p50 > 460000 && p50 < 540000 && p99 > 930000 && p99 <= 1000000;
+
+    Metricas& metricas = Metricas::global();
+    uint64_t chamadas = metricas.metodo("consultarPorId").latencia.contagem();
+    uint64_t linhas = metricas.sql().linhasLidas.load();
+    db.consultarPorId(1);
+    bool contou = metricas.metodo("consultarPorId").latencia.contagem() == chamadas + 1 &&
+                  metricas.sql().linhasLidas.load() > linhas &&
+                  metricas.paraJson().find("\"consultarPorId\":{\"chamadas\":") != std::string::npos;
+    test_result("Metricas de latencia e SQL", histograma && contou);
+}
+
+void test_cache_receitas(Database& db, const std::string& caminho) {
+    Receita nova;
+    nova.nome = "Receita Cache";
+    nova.ingredientes = "agua";
+    nova.preparo = "ferver";
+    nova.categoria = "Teste";
+    nova.tempo = 5;
+    nova.porcoes = 1;
+    nova.feita = false;
+    nova.nota = 0;
+    int id = db.cadastrarReceita(nova);
+
+    ContadoresCache& cache = Metricas::global().cache();
+    db.consultarPorId(id);
+    uint64_t acertos = cache.acertos.load();
+    bool acertou = db.consultarPorId(id).nome == "Receita Cache" && cache.acertos.load() == acertos + 1;
+
+    // Escrita pela mesma conexao invalida so a entrada afetada
+    db.addTagToReceita(id, db.createTag("cacheada"));
+    db.addIngredienteToReceita(id, Ingrediente("sal", 1, "pitada"));
+    Receita atualizada = db.consultarPorId(id);
+    bool invalidou = atualizada.tags.size() == 1 && atualizada.ingredientesEstruturados.size() == 1;
+
+    // Escrita por outra conexao e percebida via data_version
+    Database outra(caminho);
+    outra.initialize();
+    outra.marcarReceitaComoFeita(id, true);
+    outra.close();
+    bool externa = db.consultarPorId(id).feita;
+
+    db.excluirReceita(id);
+    test_result("Cache de receitas com invalidacao", acertou && invalidou && externa && db.consultarPorId(id).id == 0);
+}
+
+void test_cache_consultas(Database& db) {
+    ContadoresCache& cache = Metricas::global().cache();
+    size_t antes = db.getReceitasPorNota(5).size();
+    uint64_t acertos = cache.consultasAcertos.load();
+    bool acertou = db.getReceitasPorNota(5).size() == antes && cache.consultasAcertos.load() == acertos + 1;
+
+    // Qualquer escrita avanca a geracao: a proxima listagem volta ao banco
+    int id = db.listarReceitas().front().id;
+    db.marcarReceitaComoFeita(id, true);
+    db.avaliarReceita(id, 5);
+    auto depois = db.getReceitasPorNota(5);
+    bool atualizou = cache.consultasAcertos.load() == acertos + 1 &&
+                     std::any_of(depois.begin(), depois.end(), [id](const Receita& r) { return r.id == id; });
+
+    // Acertos compartilham o vetor do cache; o limite de linhas so encurta a visao
+    LimitesConsulta umaLinha;
+    umaLinha.maxLinhas = 1;
+    StatusConsulta status;
+    ListaReceitas primeira = db.listarReceitas();
+    ListaReceitas segunda = db.listarReceitas();
+    ListaReceitas truncada = db.listarReceitas(&status, &umaLinha);
+    bool semCopia = primeira.size() > 1 && &primeira[0] == &segunda[0] && &truncada[0] == &primeira[0] &&
+                    truncada.size() == 1 && status == StatusConsulta::LimiteLinhas;
+    test_result("Cache de listagens por geracao de escrita", acertou && semCopia && atualizou);
+}
+
+void test_log_consultas_lentas(Database& db) {
+    std::string caminho = "./test_lentas.log";
+    LogConsultasLentas& log = LogConsultasLentas::global();
+    log.configurar(0, caminho, 600, 1, 64);   // tudo e "lento"; arquivo minusculo para forcar rotacao
+
+    for (int i = 0; i < 3; ++i) {
+        db.buscarPorNome("Receita");
+    }
+    // Medidas em uma thread que ja terminou tambem chegam ao log
+    std::thread([&db] { db.buscarPorNome("Outra thread"); }).join();
+
+    auto recentes = log.recentes();
+    bool achouVarredura = false;
+    bool achouOutraThread = false;
+    for (const auto& consulta : recentes) {
+        if (consulta.sql.find("LIKE '%Receita%'") != std::string::npos) {
+            achouVarredura = consulta.varredura && consulta.plano.find("SCAN receitas") != std::string::npos;
+        }
+        achouOutraThread = achouOutraThread || consulta.sql.find("LIKE '%Outra thread%'") != std::string::npos;
+    }
+    bool rotacionou = std::filesystem::exists(caminho + ".1") && !std::filesystem::exists(caminho + ".2");
+
+    // O anel guarda so as ultimas
+    log.configurar(0, "", 0, 0, 4);
+    for (int i = 0; i < 3; ++i) {
+        db.buscarPorNome("Receita");
+    }
+    bool limitou = log.recentes().size() == 4 && log.descartadas() == 0;
+
+    log.configurar(100);
+    std::filesystem::remove(caminho);
+    std::filesystem::remove(caminho + ".1");
+    test_result("Log de consultas lentas com plano e rotacao",
+                achouVarredura && achouOutraThread && rotacionou && limitou);
+}
+
+// Envia a requisicao (possivelmente varias em pipeline) e le ate o servidor fechar
+std::string requisicaoHttp(int porta, const std::string& texto) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in endereco{};
+    endereco.sin_family = AF_INET;
+    endereco.sin_port = htons(static_cast<uint16_t>(porta));
+    inet_pton(AF_INET, "127.0.0.1", &endereco.sin_addr);
+    std::string resposta;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&endereco), sizeof(endereco)) == 0 &&
+        send(fd, texto.data(), texto.size(), 0) == static_cast<ssize_t>(texto.size())) {
+        char bloco[4096];
+        ssize_t n;
+        while ((n = recv(fd, bloco, sizeof(bloco), 0)) > 0) {
+            resposta.append(bloco, static_cast<size_t>(n));
+        }
+    }
+    close(fd);
+    return resposta;
+}
+
+void test_servidor_http() {
+    std::string caminho = "./test_servidor.db";
+    std::filesystem::remove(caminho);
+
+    ConfiguracaoServidor configuracao;
+    configuracao.caminhoDb = caminho;
+    configuracao.porta = 0;
+    configuracao.trabalhadores = 2;
+    ServidorHttp servidor(configuracao);
+    bool ok = servidor.iniciar();
+
+    if (ok) {
+        std::string corpo = "nome=Bolo+de+fub%C3%A1&tempo=40&tags=doce,caseiro";
+        std::string criada = requisicaoHttp(servidor.porta(),
+            "POST /receitas HTTP/1.1\r\nContent-Type: application/x-www-form-urlencoded\r\n"
+            "Content-Length: " + std::to_string(corpo.size()) + "\r\nConnection: close\r\n\r\n" + corpo);
+        ok = criada.rfind("HTTP/1.1 201", 0) == 0 && criada.find("{\"id\":1}") != std::string::npos;
+
+        // Duas requisicoes em pipeline na mesma conexao; a ultima pede o fechamento
+        std::string lidas = requisicaoHttp(servidor.porta(),
+            "GET /receitas?tag=doce HTTP/1.1\r\n\r\n"
+            "GET /receitas/99 HTTP/1.1\r\nConnection: close\r\n\r\n");
+        size_t segunda = lidas.find("HTTP/1.1 404");
+        ok = ok && lidas.rfind("HTTP/1.1 200", 0) == 0 && segunda != std::string::npos
+                && lidas.find("\"nome\":\"Bolo de fubá\"") < segunda;
+
+        // HEAD: mesmo Content-Length do GET, sem corpo
+        std::string cabecalho = requisicaoHttp(servidor.porta(),
+            "HEAD /receitas/1 HTTP/1.1\r\nConnection: close\r\n\r\n");
+        std::string completa = requisicaoHttp(servidor.porta(),
+            "GET /receitas/1 HTTP/1.1\r\nConnection: close\r\n\r\n");
+        size_t fimCabecalho = completa.find("\r\n\r\n");
+        ok = ok && cabecalho.rfind("HTTP/1.1 200", 0) == 0 && fimCabecalho != std::string::npos
+                && cabecalho == completa.substr(0, fimCabecalho + 4)
+                && cabecalho.find("Content-Length: " + std::to_string(completa.size() - fimCabecalho - 4)) != std::string::npos;
+    }
+    servidor.parar();
+
+    std::filesystem::remove(caminho);
+    std::filesystem::remove(caminho + "-wal");
+    std::filesystem::remove(caminho + "-shm");
+    test_result("Servidor HTTP com pipelining", ok);
+}
+
+// Testes de Linha de Comando
+// Roda "cookbook --db caminho args..." no proprio processo, capturando o stdout
+int executarCli(const std::string& caminhoDb, std::vector<std::string> args, std::string* saida = nullptr) {
+    args.insert(args.begin(), {"cookbook", "--db", caminhoDb});
+    std::vector<char*> argv;
+    for (auto& arg : args) {
+        argv.push_back(arg.data());
+    }
+    std::ostringstream capturada;
+    std::streambuf* anterior = std::cout.rdbuf(capturada.rdbuf());
+    int codigo = executarLinhaDeComando(static_cast<int>(argv.size()), argv.data());
+    std::cout.rdbuf(anterior);
+    if (saida) {
+        *saida = capturada.str();
+    }
+    return codigo;
+}
+
+void test_comandos_cli() {
+    std::string caminho = "./test_comandos.db";
+    std::filesystem::remove(caminho);
+    std::string saida;
+    bool adicionou = executarCli(caminho, {"add", "Bolo CLI", "--tempo", "30", "--tag", "doce", "--tag", "rapida"},
+                                 &saida) == 0;
+    std::string id = saida.substr(0, saida.find('\n'));
+    adicionou = adicionou && std::atoi(id.c_str()) > 0;
+
+    // Erros de uso e alvos inexistentes saem com 1
+    bool recusou = executarCli(caminho, {}) == 1 && executarCli(caminho, {"--opcao-inexistente", "get", id}) == 1 &&
+                   executarCli(caminho, {"comando-inexistente"}) == 1 &&
+                   executarCli(caminho, {"add", "Sem valor", "--tempo"}) == 1 &&
+                   executarCli(caminho, {"add", "Tempo ruim", "--tempo", "abc"}) == 1 &&
+                   executarCli(caminho, {"tag", "abc", "add", "x"}) == 1 &&
+                   executarCli(caminho, {"tag", id, "trocar", "x"}) == 1 &&
+                   executarCli(caminho, {"tag", "999999", "add", "x"}) == 1 &&
+                   executarCli(caminho, {"get", "999999"}) == 1 && executarCli(caminho, {"rate", id, "5"}) == 1 &&
+                   executarCli(caminho, {"tags", "merge", "inexistente", "doce"}) == 1;
+
+    // tag remove tira so os nomes pedidos; desconhecidos sao ignorados
+    bool tags = executarCli(caminho, {"tag", id, "remove", "doce", "inexistente"}) == 0 &&
+                executarCli(caminho, {"--formato", "json", "get", id}, &saida) == 0 &&
+                saida.find("\"tags\":[\"rapida\"]") != std::string::npos;
+    // rate exige receita feita e nota de 1 a 5
+    bool avaliou = executarCli(caminho, {"done", id}) == 0 && executarCli(caminho, {"rate", id, "9"}) == 1 &&
+                   executarCli(caminho, {"rate", id, "5"}) == 0 &&
+                   executarCli(caminho, {"--formato", "json", "get", id}, &saida) == 0 &&
+                   saida.find("\"nota\":5") != std::string::npos;
+
+    // Uma linha com falha desfaz o lote inteiro
+    std::string lote = "./test_comandos_lote.txt";
+    std::ofstream(lote) << "add \"Receita do lote\"\nrate " << id << " 0\n";
+    bool desfez = executarCli(caminho, {"--batch", lote}) == 1 &&
+                  executarCli(caminho, {"--formato", "ndjson", "search", "Receita do lote"}, &saida) == 0 &&
+                  saida.empty();
+
+    std::filesystem::remove(lote);
+    std::filesystem::remove(caminho);
+    test_result("Subcomandos: argumentos e codigos de saida", adicionou && recusou && tags && avaliou && desfez);
+}
+
 int main() {
     std::cout << "=== Testes ChefVault ===" << std::endl;
     std::cout << std::endl;
@@ -244,6 +1445,9 @@ int main() {
     test_adicionar_tag_receita(db);
     test_remover_tag_receita(db);
     test_filtrar_por_tag(db);
+    test_listar_receitas_compacto(db);
+    test_visitar_receitas(db);
+    test_projecao_carga_tardia(db);
     
     std::cout << std::endl;
     std::cout << "--- Testes Funcionalidade Feita ---" << std::endl;
@@ -257,6 +1461,80 @@ int main() {
     test_filtrar_por_nota(db);
     test_validacao_nota_invalida(db);
     
+    std::cout << std::endl;
+    std::cout << "--- Testes Transação ---" << std::endl;
+    test_desfazer_transacao(db);
+    test_savepoints(db);
+    
+    std::cout << std::endl;
+    std::cout << "--- Testes Edição ---" << std::endl;
+    test_atualizar_receita(db, testDbPath);
+    
+    std::cout << std::endl;
+    std::cout << "--- Testes Tags em Massa ---" << std::endl;
+    test_tags_em_massa(db, testDbPath);
+    
+    std::cout << std::endl;
+    std::cout << "--- Testes Carga em Lote ---" << std::endl;
+    test_gerar_vault_em_lote(db);
+    test_lote_com_falha_em_transacao(db);
+    
+    std::cout << std::endl;
+    std::cout << "--- Testes Hidratação Paralela ---" << std::endl;
+    test_hidratacao_paralela(db);
+    
+    std::cout << std::endl;
+    std::cout << "--- Testes Limites de Consulta ---" << std::endl;
+    test_limites_consulta(db);
+    
+    std::cout << std::endl;
+    std::cout << "--- Testes Database Assíncrona ---" << std::endl;
+    test_database_assincrona(db);
+    
+    std::cout << std::endl;
+    std::cout << "--- Testes Snapshot ---" << std::endl;
+    test_snapshot_vault(db);
+    
+    std::cout << std::endl;
+    std::cout << "--- Testes Análise Colunar ---" << std::endl;
+    test_analise_colunar(db, testDbPath);
+    
+    std::cout << std::endl;
+    std::cout << "--- Testes Armazém de Imagens ---" << std::endl;
+    test_armazem_imagens(db);
+    
+    std::cout << std::endl;
+    std::cout << "--- Testes Log de Alterações ---" << std::endl;
+    test_log_alteracoes(db);
+    
+    std::cout << std::endl;
+    std::cout << "--- Testes Ingredientes ---" << std::endl;
+    test_formatar_ingredientes();
+    test_lista_compras(db);
+    test_similares(db, testDbPath);
+    test_restaurar_backup_sem_assinaturas();
+    test_duplicadas(db);
+    
+    std::cout << std::endl;
+    std::cout << "--- Testes Renderização ---" << std::endl;
+    test_renderizar_celula_utf8();
+    test_renderizar_json(db);
+    
+    std::cout << std::endl;
+    std::cout << "--- Testes Métricas ---" << std::endl;
+    test_metricas(db);
+    test_cache_receitas(db, testDbPath);
+    test_cache_consultas(db);
+    test_log_consultas_lentas(db);
+    
+    std::cout << std::endl;
+    std::cout << "--- Testes Servidor HTTP ---" << std::endl;
+    test_servidor_http();
+    
+    std::cout << std::endl;
+    std::cout << "--- Testes Linha de Comando ---" << std::endl;
+    test_comandos_cli();
+    
     std::cout << std::endl;
     std::cout << "=== Resultados ===" << std::endl;
     std::cout << "Testes passados: " << tests_passed << std::endl;